@@ -0,0 +1,28 @@
+//
+//  AllocationCounter.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <cstdint>
+
+namespace rsr {
+namespace bench {
+
+/**
+ * Calls to the global operator new so far, from any thread. Benchmarks that
+ * call this get the counting operator new linked in; the others keep the
+ * standard one.
+ */
+uint64_t allocationCount();
+
+/**
+ * Calls to the global operator new so far from the calling thread.
+ */
+uint64_t threadAllocationCount();
+
+}
+}
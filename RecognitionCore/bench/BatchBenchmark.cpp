@@ -0,0 +1,94 @@
+//
+//  BatchBenchmark.cpp
+//  RecognitionCore
+//
+//  Throughput of searchWithImages against one searchWithVideoFrame call per
+//  image, for 1 to --max-threads threads of the search scheduler (--pin 1 binds
+//  its workers to cores).
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "SyntheticSigns.h"
+#include "rsr/OnDeviceIR.h"
+
+using namespace rsr;
+using namespace rsr::bench;
+
+int main(int argc, char** argv) {
+    const int itemCount = argInt(argc, argv, "--items", 50);
+    const int imageCount = argInt(argc, argv, "--images", 200);
+    const int maxThreads = argInt(argc, argv, "--max-threads", 8);
+
+    auto collection = std::make_shared<Collection>("bench", "Synthetic signs");
+    for (int i = 0; i < itemCount; ++i) {
+        Item item;
+        item.uuid = "item-" + std::to_string(i);
+        collection->addImage(item, "image-" + std::to_string(i), makeSignTemplate(i).toQueryImage());
+    }
+    // The calling thread runs one part of every batch, the scheduler workers the rest.
+    SchedulerOptions schedulerOptions;
+    schedulerOptions.workerCount = std::max(1, maxThreads - 1);
+    schedulerOptions.pinWorkers = argInt(argc, argv, "--pin", 0) != 0;
+    OnDeviceIR onDeviceIR(ExtractorOptions(), MatcherOptions(), schedulerOptions);
+    onDeviceIR.setCollection(collection);
+
+    // Road-sign crops: smaller frames around the sign, like a re-scoring backlog.
+    SceneOptions crops;
+    crops.width = 480;
+    crops.height = 360;
+    crops.minSize = 0.5f;
+    crops.maxSize = 0.7f;
+    std::vector<BgraImage> images;
+    std::vector<SearchRequest> requests;
+    for (int i = 0; i < imageCount; ++i) {
+        images.push_back(makeScene(makeSignTemplate(i % itemCount), 5000u + i, crops));
+    }
+    for (int i = 0; i < imageCount; ++i) {
+        const BgraImage& image = images[i];
+        requests.push_back({VideoFrame{image.pixels.data(), image.width, image.height, image.bytesPerRow()}, 100 + i});
+    }
+
+    auto isCorrect = [](const std::vector<SearchResult>& results, int i, int items) {
+        return !results.empty() && results[0].item.uuid == "item-" + std::to_string(i % items);
+    };
+
+    std::printf("%d images, %d items, %u hardware threads\n", imageCount, itemCount,
+                std::thread::hardware_concurrency());
+    std::printf("%-24s %12s %10s %15s\n", "mode", "images/s", "top-1", "tasks stolen");
+
+    Stopwatch stopwatch;
+    std::vector<SearchResult> results;
+    int correct = 0;
+    for (int i = 0; i < imageCount; ++i) {
+        onDeviceIR.searchWithVideoFrame(requests[i].frame, results);
+        correct += isCorrect(results, i, itemCount);
+    }
+    std::printf("%-24s %12.1f %9.1f%%\n", "one call per image", imageCount / stopwatch.elapsedMs() * 1e3,
+                100.0 * correct / imageCount);
+
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        const uint64_t stolenBefore = onDeviceIR.scheduler().counters().stolen;
+        std::vector<BatchSearchResult> batch;
+        stopwatch.restart();
+        onDeviceIR.searchWithImages(requests, batch, threads);
+        const double ms = stopwatch.elapsedMs();
+        correct = 0;
+        for (int i = 0; i < imageCount; ++i) {
+            correct += batch[i].requestCode == 100 + i && isCorrect(batch[i].results, i, itemCount);
+        }
+        const std::string mode = "batch, " + std::to_string(threads) + " thread(s)";
+        std::printf("%-24s %12.1f %9.1f%% %15llu\n", mode.c_str(), imageCount / ms * 1e3,
+                    100.0 * correct / imageCount,
+                    static_cast<unsigned long long>(onDeviceIR.scheduler().counters().stolen - stolenBefore));
+    }
+    return 0;
+}
@@ -0,0 +1,70 @@
+//
+//  BenchUtil.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace rsr {
+namespace bench {
+
+/**
+ * Value of a "--name value" command line option, or the fallback.
+ */
+inline double argValue(int argc, char** argv, const char* name, double fallback) {
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], name) == 0) {
+            return std::atof(argv[i + 1]);
+        }
+    }
+    return fallback;
+}
+
+inline int argInt(int argc, char** argv, const char* name, int fallback) {
+    return static_cast<int>(argValue(argc, argv, name, fallback));
+}
+
+/**
+ * Percentile (0-100) of a sample, nearest rank.
+ */
+inline double percentile(std::vector<double> values, double p) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    const size_t rank = static_cast<size_t>(p / 100.0 * (values.size() - 1) + 0.5);
+    return values[std::min(rank, values.size() - 1)];
+}
+
+inline double mean(const std::vector<double>& values) {
+    double sum = 0.0;
+    for (double v : values) {
+        sum += v;
+    }
+    return values.empty() ? 0.0 : sum / values.size();
+}
+
+class Stopwatch {
+public:
+    Stopwatch() : mStart(std::chrono::steady_clock::now()) {}
+
+    void restart() { mStart = std::chrono::steady_clock::now(); }
+
+    double elapsedMs() const {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - mStart).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point mStart;
+};
+
+}
+}
@@ -0,0 +1,145 @@
+//
+//  BundleInstallBenchmark.cpp
+//  RecognitionCore
+//
+//  First launch install time of a zipped collection bundle: extracting the
+//  archive to disk and loading the files, as addCollectionFromBundle: does,
+//  against streaming the archive straight into the collection with feature
+//  extraction inline or overlapped with inflating.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "SyntheticSigns.h"
+#include "rsr/Bundle.h"
+#include "rsr/ZipStream.h"
+
+using namespace rsr;
+using namespace rsr::bench;
+
+namespace {
+
+double fileMB(const std::string& path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 ? info.st_size / (1024.0 * 1024.0) : 0.0;
+}
+
+// The old install path: every entry written out, then the bundle directory loaded.
+ErrorCode extractThenLoad(const std::string& zipPath, const std::string& directory,
+                          std::unique_ptr<Collection>& collection, std::vector<std::string>& written) {
+    ZipStreamReader reader;
+    ErrorCode error = reader.open(zipPath);
+    std::string name;
+    std::vector<uint8_t> contents;
+    std::string manifestDirectory;
+    while (error == ErrorCode::SUCCESS) {
+        error = reader.next(name, contents);
+        if (error != ErrorCode::SUCCESS || name.empty()) {
+            break;
+        }
+        const size_t slash = name.rfind('/');
+        if (slash != std::string::npos) {
+            mkdir((directory + "/" + name.substr(0, slash)).c_str(), 0755);
+        }
+        const std::string path = directory + "/" + name;
+        FILE* file = std::fopen(path.c_str(), "wb");
+        if (!file || std::fwrite(contents.data(), 1, contents.size(), file) != contents.size()) {
+            error = ErrorCode::COLLECTION_MANAGER_EXTRACT_ERROR;
+        }
+        if (file) {
+            std::fclose(file);
+            written.push_back(path);
+        }
+        if (name.size() >= std::strlen(kBundleManifestName) &&
+            name.compare(name.size() - std::strlen(kBundleManifestName), std::string::npos, kBundleManifestName) == 0) {
+            manifestDirectory = directory + "/" + name.substr(0, name.size() - std::strlen(kBundleManifestName));
+        }
+    }
+    if (error != ErrorCode::SUCCESS) {
+        return error;
+    }
+    return loadCollectionBundle(manifestDirectory, collection);
+}
+
+void report(const char* mode, double ms, double megabytes, const std::unique_ptr<Collection>& collection,
+            ErrorCode error) {
+    if (error != ErrorCode::SUCCESS) {
+        std::printf("%-30s failed: %s\n", mode, errorCodeName(error));
+        return;
+    }
+    std::printf("%-30s %10.0f %10.1f %8zu\n", mode, ms, megabytes / ms * 1e3, collection->images().size());
+}
+
+}
+
+int main(int argc, char** argv) {
+    const int itemCount = argInt(argc, argv, "--items", 500);
+
+    char directory[] = "/tmp/rsr-bundle-install-XXXXXX";
+    if (!mkdtemp(directory)) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    const std::string zipPath = std::string(directory) + "/bundle.zip";
+    if (!writeSignBundleZip(zipPath, itemCount)) {
+        std::fprintf(stderr, "cannot write %s\n", zipPath.c_str());
+        return 1;
+    }
+
+    // Inflating alone bounds what overlapping can hide.
+    Stopwatch stopwatch;
+    ZipStreamReader reader;
+    reader.open(zipPath);
+    std::string name;
+    std::vector<uint8_t> contents;
+    double megabytes = 0.0;
+    while (reader.next(name, contents) == ErrorCode::SUCCESS && !name.empty()) {
+        megabytes += contents.size() / (1024.0 * 1024.0);
+    }
+    const double inflateMs = stopwatch.elapsedMs();
+
+    std::printf("%d items: %.1f MB bundle, %.1f MB zipped, inflating alone %.0f ms, %u hardware threads\n", itemCount,
+                megabytes, fileMB(zipPath), inflateMs, std::thread::hardware_concurrency());
+    std::printf("%-30s %10s %10s %8s\n", "install", "ms", "MB/s", "images");
+
+    std::unique_ptr<Collection> collection;
+    std::vector<std::string> written;
+    stopwatch.restart();
+    ErrorCode error = extractThenLoad(zipPath, directory, collection, written);
+    report("extract to disk, then load", stopwatch.elapsedMs(), megabytes, collection, error);
+
+    std::vector<int> parserThreads = {0, 1};
+    const int cores = static_cast<int>(std::thread::hardware_concurrency());
+    if (cores > 2) {
+        parserThreads.push_back(cores - 1);
+    }
+    for (int threads : parserThreads) {
+        BundleOptions options;
+        options.parserThreads = threads;
+        collection.reset();
+        stopwatch.restart();
+        error = loadCollectionBundleZip(zipPath, collection, nullptr, options);
+        const std::string mode = threads == 0 ? std::string("streaming, inline parsing")
+                                              : "streaming, " + std::to_string(threads) + " parser thread(s)";
+        report(mode.c_str(), stopwatch.elapsedMs(), megabytes, collection, error);
+    }
+
+    for (auto it = written.rbegin(); it != written.rend(); ++it) {
+        std::remove(it->c_str());
+    }
+    rmdir((std::string(directory) + "/bench").c_str());
+    std::remove(zipPath.c_str());
+    rmdir(directory);
+    return 0;
+}
@@ -0,0 +1,170 @@
+//
+//  CatalogueServer.cpp
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "CatalogueServer.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "rsr/CollectionSync.h"
+#include "rsr/HttpClient.h"
+
+namespace rsr {
+namespace bench {
+
+namespace {
+
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+constexpr size_t kMaxRequestSize = 64 * 1024;
+
+void sendAll(int connection, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        const ssize_t n = send(connection, data.data() + sent, data.size() - sent, kSendFlags);
+        if (n <= 0) {
+            return;
+        }
+        sent += static_cast<size_t>(n);
+    }
+}
+
+std::string response(const char* status, const std::string& contentType, const std::string& body) {
+    return std::string("HTTP/1.1 ") + status + "\r\nContent-Type: " + contentType +
+           "\r\nContent-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+}
+
+std::vector<std::string> splitIds(const std::string& list) {
+    std::vector<std::string> ids;
+    size_t start = 0;
+    while (start <= list.size()) {
+        const size_t comma = std::min(list.find(',', start), list.size());
+        if (comma > start) {
+            ids.push_back(urlDecode(list.substr(start, comma - start)));
+        }
+        start = comma + 1;
+    }
+    return ids;
+}
+
+}
+
+CatalogueServer::~CatalogueServer() {
+    stop();
+}
+
+bool CatalogueServer::start() {
+    mListener = socket(AF_INET, SOCK_STREAM, 0);
+    if (mListener < 0) {
+        return false;
+    }
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+    socklen_t length = sizeof(address);
+    if (bind(mListener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(mListener, 16) != 0 ||
+        getsockname(mListener, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+        close(mListener);
+        mListener = -1;
+        return false;
+    }
+    mPort = ntohs(address.sin_port);
+    mStopping = false;
+    mThread = std::thread(&CatalogueServer::serve, this);
+    return true;
+}
+
+void CatalogueServer::stop() {
+    if (mListener < 0) {
+        return;
+    }
+    mStopping = true;
+    // Wakes the blocked accept().
+    shutdown(mListener, SHUT_RDWR);
+    mThread.join();
+    close(mListener);
+    mListener = -1;
+}
+
+std::string CatalogueServer::url() const {
+    return "http://127.0.0.1:" + std::to_string(mPort);
+}
+
+void CatalogueServer::setCatalogue(std::shared_ptr<const Collection> catalogue) {
+    auto manifest = std::make_shared<const std::string>(CollectionManifest::describe(*catalogue).serialize());
+    std::lock_guard<std::mutex> lock(mMutex);
+    mCatalogue = std::move(catalogue);
+    mManifest = std::move(manifest);
+}
+
+void CatalogueServer::serve() {
+    while (!mStopping) {
+        const int connection = accept(mListener, nullptr, nullptr);
+        if (connection < 0) {
+            continue;
+        }
+        handle(connection);
+        close(connection);
+    }
+}
+
+void CatalogueServer::handle(int connection) {
+    std::string request;
+    char buffer[4096];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < kMaxRequestSize) {
+        const ssize_t n = recv(connection, buffer, sizeof(buffer), 0);
+        if (n <= 0) {
+            return;
+        }
+        request.append(buffer, static_cast<size_t>(n));
+    }
+    ++mRequestCount;
+
+    std::shared_ptr<const Collection> catalogue;
+    std::shared_ptr<const std::string> manifest;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        catalogue = mCatalogue;
+        manifest = mManifest;
+    }
+    const size_t pathStart = request.find(' ') + 1;
+    const size_t pathEnd = request.find(' ', pathStart);
+    const std::string path =
+        pathEnd == std::string::npos ? std::string() : request.substr(pathStart, pathEnd - pathStart);
+
+    std::string reply;
+    static const char kItemsRoute[] = "/items?ids=";
+    if (request.compare(0, 4, "GET ") != 0 || !catalogue) {
+        reply = response("404 Not Found", "text/plain", "");
+    } else if (path == "/manifest") {
+        reply = response("200 OK", "text/tab-separated-values", *manifest);
+    } else if (path.compare(0, sizeof(kItemsRoute) - 1, kItemsRoute) == 0) {
+        std::string payload;
+        serializeItems(*catalogue, splitIds(path.substr(sizeof(kItemsRoute) - 1)), payload);
+        reply = response("200 OK", "application/octet-stream", payload);
+    } else {
+        reply = response("404 Not Found", "text/plain", "");
+    }
+    sendAll(connection, reply);
+    mBytesSent += reply.size();
+}
+
+}
+}
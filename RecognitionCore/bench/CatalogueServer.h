@@ -0,0 +1,71 @@
+//
+//  CatalogueServer.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "rsr/Collection.h"
+
+namespace rsr {
+namespace bench {
+
+/**
+ * Local stand-in for a collection sync server. Serves the manifest and item
+ * records of a catalogue collection over HTTP on 127.0.0.1, one request at a
+ * time, with the routes CollectionSync expects. Swapping the catalogue
+ * simulates changes published on the server.
+ */
+class CatalogueServer {
+public:
+    CatalogueServer() = default;
+    ~CatalogueServer();
+
+    CatalogueServer(const CatalogueServer&) = delete;
+    CatalogueServer& operator=(const CatalogueServer&) = delete;
+
+    /**
+     * Listen on an ephemeral loopback port.
+     * @return false if the socket could not be set up.
+     */
+    bool start();
+    void stop();
+
+    /**
+     * Base URL to give CollectionSync, e.g. http://127.0.0.1:49152.
+     */
+    std::string url() const;
+
+    void setCatalogue(std::shared_ptr<const Collection> catalogue);
+
+    size_t bytesSent() const { return mBytesSent.load(); }
+    int requestCount() const { return mRequestCount.load(); }
+
+private:
+    void serve();
+    void handle(int connection);
+
+    int mListener = -1;
+    int mPort = 0;
+    std::thread mThread;
+    std::atomic<bool> mStopping{false};
+
+    std::mutex mMutex;
+    std::shared_ptr<const Collection> mCatalogue;
+    std::shared_ptr<const std::string> mManifest;
+
+    std::atomic<size_t> mBytesSent{0};
+    std::atomic<int> mRequestCount{0};
+};
+
+}
+}
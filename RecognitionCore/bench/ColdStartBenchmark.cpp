@@ -0,0 +1,185 @@
+//
+//  ColdStartBenchmark.cpp
+//  RecognitionCore
+//
+//  Time to first search result and resident memory after loading a
+//  collection from an unpacked bundle versus mapping a collection file.
+//  Every measurement runs in a fresh process, with the collection files
+//  evicted from the page cache where the platform allows it.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "SyntheticSigns.h"
+#include "rsr/Bundle.h"
+#include "rsr/OnDeviceIR.h"
+
+using namespace rsr;
+using namespace rsr::bench;
+
+namespace {
+
+double residentMB() {
+    FILE* statm = std::fopen("/proc/self/statm", "r");
+    if (!statm) {
+        return 0.0;
+    }
+    long pages = 0;
+    long resident = 0;
+    const int fields = std::fscanf(statm, "%ld %ld", &pages, &resident);
+    std::fclose(statm);
+    return fields == 2 ? resident * static_cast<double>(sysconf(_SC_PAGESIZE)) / (1024.0 * 1024.0) : 0.0;
+}
+
+double fileMB(const std::string& path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 ? info.st_size / (1024.0 * 1024.0) : 0.0;
+}
+
+// Flushes a file and drops it from the page cache so the next open reads it from storage.
+void evictFromPageCache(const std::string& path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    fsync(fd);
+#ifdef POSIX_FADV_DONTNEED
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+    close(fd);
+}
+
+IndexOptions lshOptions() {
+    IndexOptions options;
+    options.type = IndexType::LSH;
+    return options;
+}
+
+constexpr int kSearches = 5;
+
+// Child process: load one way, activate, search a few frames and print a table row.
+int measure(const std::string& mode, const std::string& path) {
+    std::vector<BgraImage> scenes;
+    for (int i = 0; i < kSearches; ++i) {
+        scenes.push_back(makeScene(makeSignTemplate(i), 1000u + i));
+    }
+    const double baseline = residentMB();
+
+    Stopwatch stopwatch;
+    std::shared_ptr<const Collection> collection;
+    ErrorCode error;
+    if (mode == "bundle") {
+        std::unique_ptr<Collection> loaded;
+        error = loadCollectionBundle(path, loaded);
+        collection = std::move(loaded);
+    } else {
+        error = Collection::open(path, collection);
+    }
+    if (error != ErrorCode::SUCCESS) {
+        std::fprintf(stderr, "%s: %s\n", mode.c_str(), errorCodeName(error));
+        return 1;
+    }
+    OnDeviceIR onDeviceIR;
+    onDeviceIR.setCollection(collection, true, mode == "file, lsh index" ? lshOptions() : IndexOptions());
+    const double activeMs = stopwatch.elapsedMs();
+    const double activeRss = residentMB() - baseline;
+
+    double firstMs = 0.0;
+    int found = 0;
+    for (int i = 0; i < kSearches; ++i) {
+        const BgraImage& scene = scenes[i];
+        std::vector<SearchResult> results;
+        onDeviceIR.searchWithVideoFrame(VideoFrame{scene.pixels.data(), scene.width, scene.height,
+                                                   scene.bytesPerRow()},
+                                        results);
+        if (i == 0) {
+            firstMs = stopwatch.elapsedMs();
+        }
+        found += !results.empty() && results[0].item.uuid == "item-" + std::to_string(i);
+    }
+
+    std::printf("%-20s %12.1f %14.1f %12.1f %14.1f %4d/%d\n", mode.c_str(), activeMs, firstMs, activeRss,
+                residentMB() - baseline, found, kSearches);
+    return 0;
+}
+
+int runChild(const char* self, const char* mode, const std::string& path) {
+    std::fflush(stdout);
+    const pid_t pid = fork();
+    if (pid == 0) {
+        execl(self, self, "--measure", mode, path.c_str(), static_cast<char*>(nullptr));
+        _exit(127);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
+
+}
+
+int main(int argc, char** argv) {
+    if (argc == 4 && std::strcmp(argv[1], "--measure") == 0) {
+        return measure(argv[2], argv[3]);
+    }
+    const int itemCount = argInt(argc, argv, "--items", 200);
+
+    char directory[] = "/tmp/rsr-cold-start-XXXXXX";
+    if (!mkdtemp(directory)) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    const std::string bundle = directory;
+    const std::string exactFile = bundle + "/exact.rsrc";
+    const std::string lshFile = bundle + "/lsh.rsrc";
+
+    Stopwatch stopwatch;
+    std::unique_ptr<Collection> collection;
+    ErrorCode error = writeSignBundle(bundle, itemCount) ? loadCollectionBundle(bundle, collection)
+                                                         : ErrorCode::COLLECTION_MANAGER_EXTRACT_ERROR;
+    const double convertMs = stopwatch.elapsedMs();
+    if (error == ErrorCode::SUCCESS) {
+        error = collection->write(exactFile, IndexOptions());
+    }
+    if (error == ErrorCode::SUCCESS) {
+        error = collection->write(lshFile, lshOptions());
+    }
+    if (error != ErrorCode::SUCCESS) {
+        std::fprintf(stderr, "preparing collection files failed: %s\n", errorCodeName(error));
+        return 1;
+    }
+    std::printf("%d items, %zu features; bundle converted in %.0f ms\n", itemCount, collection->descriptors().size(),
+                convertMs);
+    std::printf("collection file %.1f MB without index, %.1f MB with LSH index\n", fileMB(exactFile),
+                fileMB(lshFile));
+    collection.reset();
+
+    std::printf("%-20s %12s %14s %12s %14s %6s\n", "load", "active ms", "first result", "RSS MB", "RSS MB search",
+                "top-1");
+    evictFromPageCache(exactFile);
+    evictFromPageCache(lshFile);
+    int status = runChild(argv[0], "bundle", bundle);
+    status |= runChild(argv[0], "file, exact index", exactFile);
+    status |= runChild(argv[0], "file, lsh index", lshFile);
+
+    std::remove(exactFile.c_str());
+    std::remove(lshFile.c_str());
+    std::remove((bundle + "/" + kBundleManifestName).c_str());
+    for (int i = 0; i < itemCount; ++i) {
+        std::remove((bundle + "/sign-" + std::to_string(i) + ".ppm").c_str());
+    }
+    rmdir(directory);
+    return status;
+}
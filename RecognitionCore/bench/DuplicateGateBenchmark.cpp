@@ -0,0 +1,104 @@
+//
+//  DuplicateGateBenchmark.cpp
+//  RecognitionCore
+//
+//  Finder frames of a drive that stops at a light: searches avoided by the
+//  DuplicateFrameGate and, for every frame it answered from an earlier
+//  search, whether a real search would have given the same top result.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "SyntheticSigns.h"
+#include "rsr/DuplicateFrameGate.h"
+#include "rsr/OnDeviceIR.h"
+
+using namespace rsr;
+using namespace rsr::bench;
+
+namespace {
+
+std::string topItem(const std::vector<SearchResult>& results) {
+    return results.empty() ? std::string("(none)") : results[0].item.uuid;
+}
+
+}
+
+int main(int argc, char** argv) {
+    const int itemCount = argInt(argc, argv, "--items", 20);
+    const double fps = argValue(argc, argv, "--fps", 10);
+    const double seconds = argValue(argc, argv, "--seconds", 10);
+    const double stopFrom = 3.0;
+    const double stopUntil = 8.0;
+
+    auto collection = std::make_shared<Collection>("bench", "Synthetic signs");
+    for (int i = 0; i < itemCount; ++i) {
+        Item item;
+        item.uuid = "item-" + std::to_string(i);
+        collection->addImage(item, "image-" + std::to_string(i), makeSignTemplate(i).toQueryImage());
+    }
+    OnDeviceIR onDeviceIR;
+    onDeviceIR.setCollection(collection);
+
+    // Driving: a new view every frame, a new sign every second. Stopped: the
+    // same view with fresh sensor noise and a slow exposure drift.
+    const int frameCount = static_cast<int>(fps * seconds);
+    std::vector<BgraImage> frames;
+    std::mt19937 random(5);
+    std::uniform_int_distribution<int> noise(-4, 4);
+    const BgraImage atLight = makeScene(makeSignTemplate(3 % itemCount), 777u);
+    for (int i = 0; i < frameCount; ++i) {
+        const double t = i / fps;
+        if (t >= stopFrom && t < stopUntil) {
+            BgraImage frame = atLight;
+            const int drift = static_cast<int>((t - stopFrom) * 1.5);
+            for (uint8_t& value : frame.pixels) {
+                value = static_cast<uint8_t>(std::min(255, std::max(0, value + drift + noise(random))));
+            }
+            frames.push_back(std::move(frame));
+        } else {
+            frames.push_back(makeScene(makeSignTemplate(static_cast<int>(t) % itemCount), 2000u + i));
+        }
+    }
+
+    DuplicateFrameGate gate;
+    int agreed = 0;
+    int reusedFrames = 0;
+    double gatedMs = 0.0;
+    double ungatedMs = 0.0;
+    std::vector<SearchResult> results;
+    std::vector<SearchResult> truth;
+    for (const BgraImage& image : frames) {
+        const VideoFrame frame{image.pixels.data(), image.width, image.height, image.bytesPerRow()};
+        Stopwatch stopwatch;
+        bool reused = false;
+        gate.search(onDeviceIR, frame, results, &reused);
+        gatedMs += stopwatch.elapsedMs();
+
+        stopwatch.restart();
+        onDeviceIR.searchWithVideoFrame(frame, truth);
+        ungatedMs += stopwatch.elapsedMs();
+        if (reused) {
+            ++reusedFrames;
+            agreed += topItem(results) == topItem(truth);
+        }
+    }
+
+    const FrameGateCounters& counters = gate.counters();
+    std::printf("%d frames at %.0f fps, stopped from %.0f s to %.0f s, %d items\n", frameCount, fps, stopFrom,
+                stopUntil, itemCount);
+    std::printf("searched %llu, answered from an earlier search %llu (%.1f%% avoided)\n",
+                static_cast<unsigned long long>(counters.searched), static_cast<unsigned long long>(counters.reused),
+                100.0 * counters.reused / std::max<uint64_t>(1, counters.frames));
+    std::printf("top result agreement on reused frames %d/%d\n", agreed, reusedFrames);
+    std::printf("search time %.0f ms with the gate, %.0f ms without\n", gatedMs, ungatedMs);
+    return 0;
+}
@@ -0,0 +1,200 @@
+//
+//  FinderRateSimulator.cpp
+//  RecognitionCore
+//
+//  Feeds FinderRateController synthetic latency and CPU load profiles in
+//  simulated time and prints how the finder search rate tracks them: a
+//  device that heats up and slows down, background work taking the CPU, and
+//  a cloud round trip that degrades, and searches that are cancelled when a
+//  newer frame replaces them or that fail. "ideal" is the rate that keeps
+//  the workers at the target utilization within the CPU left by other work.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "rsr/FinderRateController.h"
+
+using namespace rsr;
+using namespace rsr::bench;
+
+namespace {
+
+struct Profile {
+    const char* name;
+    RateControllerOptions options;
+    double cameraFps;
+    std::function<double(double)> serviceSeconds;  ///< Search time at time t, without queueing.
+    std::function<double(double)> backgroundLoad;  ///< Share of all cores used by other work at time t.
+    bool replaceWaiting = false;  ///< A new search cancels the one waiting, as finder searches do on device.
+    double failureShare = 0.0;    ///< Searches that end without a result.
+};
+
+struct Summary {
+    double trackingError = 0.0;  ///< Mean |rate - ideal| / ideal after the first seconds.
+    double p99Latency = 0.0;
+    double maxLatency = 0.0;
+    int searches = 0;
+    int dropped = 0;  ///< Cancelled or failed.
+};
+
+constexpr double kTick = 0.001;
+constexpr double kHeadroomPeriod = 0.25;
+constexpr double kWarmup = 5.0;
+
+double idealRate(const Profile& profile, double t) {
+    const RateControllerOptions& options = profile.options;
+    const double service = profile.serviceSeconds(t);
+    double ideal = options.targetUtilization * options.workers / service;
+    if (options.cpuReserve > 0.0) {
+        // Workers stand for cores on device: only what other work leaves, minus the reserve, is ours.
+        const double share = std::max(0.0, 1.0 - profile.backgroundLoad(t) - options.cpuReserve);
+        ideal = std::min(ideal, share * options.workers / service);
+    }
+    return std::min(options.maxRate, std::max(options.minRate, ideal));
+}
+
+Summary simulate(const Profile& profile, double duration, bool verbose) {
+    const RateControllerOptions& options = profile.options;
+    FinderRateController controller(options);
+    std::mt19937 random(42);
+    std::lognormal_distribution<double> jitter(0.0, 0.15);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    std::deque<double> queue;                          // Submission times of waiting searches.
+    std::vector<double> busyUntil(options.workers, -1.0);
+    std::vector<double> submittedAt(options.workers, 0.0);
+    std::vector<double> latencies;
+    double busyTime = 0.0;
+    double nextFrame = 0.0;
+    double nextHeadroom = kHeadroomPeriod;
+    double nextReport = 1.0;
+    int searchedThisSecond = 0;
+    double errorSum = 0.0;
+    int errorSamples = 0;
+    Summary summary;
+
+    if (verbose) {
+        std::printf("  %6s %10s %10s %10s %12s %12s %10s\n", "t s", "search ms", "load", "ideal/s", "controller/s",
+                    "searched/s", "latency ms");
+    }
+    const long ticks = std::lround(duration / kTick);
+    for (long tick = 0; tick <= ticks; ++tick) {
+        const double t = tick * kTick;
+        for (int w = 0; w < options.workers; ++w) {
+            if (busyUntil[w] >= 0.0 && t >= busyUntil[w]) {
+                const double latency = t - submittedAt[w];
+                if (unit(random) < profile.failureShare) {
+                    controller.onSearchDropped(t);
+                    ++summary.dropped;
+                } else {
+                    controller.onSearchCompleted(t, latency);
+                    latencies.push_back(latency);
+                    ++searchedThisSecond;
+                }
+                busyUntil[w] = -1.0;
+            }
+            if (busyUntil[w] < 0.0 && !queue.empty()) {
+                submittedAt[w] = queue.front();
+                queue.pop_front();
+                busyUntil[w] = t + profile.serviceSeconds(t) * jitter(random);
+            }
+            busyTime += busyUntil[w] >= 0.0 ? kTick : 0.0;
+        }
+        if (t >= nextFrame) {
+            nextFrame += 1.0 / profile.cameraFps;
+            if (controller.shouldSubmit(t)) {
+                if (profile.replaceWaiting && !queue.empty()) {
+                    queue.pop_front();
+                    controller.onSearchDropped(t);
+                    ++summary.dropped;
+                }
+                queue.push_back(t);
+            }
+        }
+        if (t >= nextHeadroom) {
+            nextHeadroom += kHeadroomPeriod;
+            const double ours = busyTime / (kHeadroomPeriod * options.workers);
+            busyTime = 0.0;
+            controller.onCpuHeadroom(t, std::max(0.0, 1.0 - profile.backgroundLoad(t) - ours));
+        }
+        if (t >= nextReport) {
+            nextReport += 1.0;
+            const double ideal = idealRate(profile, t);
+            if (t > kWarmup) {
+                errorSum += std::fabs(controller.rate() - ideal) / ideal;
+                ++errorSamples;
+            }
+            if (verbose && std::lround(t) % 2 == 0) {
+                std::printf("  %6.0f %10.1f %10.2f %10.1f %12.1f %12d %10.1f\n", t, profile.serviceSeconds(t) * 1e3,
+                            profile.backgroundLoad(t), ideal, controller.rate(), searchedThisSecond,
+                            controller.smoothedLatency() * 1e3);
+            }
+            summary.searches += searchedThisSecond;
+            searchedThisSecond = 0;
+        }
+    }
+    summary.trackingError = errorSamples ? errorSum / errorSamples : 0.0;
+    summary.p99Latency = percentile(latencies, 99);
+    summary.maxLatency = percentile(latencies, 100);
+    return summary;
+}
+
+double step(double t, const std::vector<std::pair<double, double>>& phases) {
+    double value = phases.front().second;
+    for (const auto& phase : phases) {
+        if (t >= phase.first) {
+            value = phase.second;
+        }
+    }
+    return value;
+}
+
+}
+
+int main(int argc, char** argv) {
+    const double duration = argValue(argc, argv, "--seconds", 40);
+    const int workers = argInt(argc, argv, "--workers", 2);
+    const bool quiet = argc > 1 && std::strcmp(argv[argc - 1], "--quiet") == 0;
+
+    const std::vector<Profile> profiles = {
+        {"on device, thermal throttling", RateControllerOptions::onDevice(30, workers), 30,
+         [](double t) { return step(t, {{0, 0.040}, {10, 0.090}, {20, 0.150}, {30, 0.050}}); },
+         [](double) { return 0.0; }},
+        {"on device, background load", RateControllerOptions::onDevice(30, workers), 30,
+         [](double) { return 0.060; },
+         [](double t) { return step(t, {{0, 0.0}, {10, 0.50}, {25, 0.20}}); }},
+        {"cloud, 2 searches/s budget", RateControllerOptions::cloud(2.0), 30,
+         [](double t) { return step(t, {{0, 0.400}, {10, 3.000}, {25, 0.600}}); },
+         [](double) { return 0.0; }},
+        {"on device, cancelled and failed", RateControllerOptions::onDevice(30, workers), 30,
+         [](double t) { return step(t, {{0, 0.040}, {10, 0.150}, {25, 0.050}}); },
+         [](double) { return 0.0; }, true, 0.1},
+    };
+
+    std::vector<Summary> summaries;
+    for (const Profile& profile : profiles) {
+        if (!quiet) {
+            std::printf("%s\n", profile.name);
+        }
+        summaries.push_back(simulate(profile, duration, !quiet));
+    }
+    std::printf("%-34s %14s %12s %12s %10s %10s\n", "profile", "tracking error", "p99 ms", "max ms", "searches",
+                "dropped");
+    for (size_t i = 0; i < profiles.size(); ++i) {
+        std::printf("%-34s %13.1f%% %12.1f %12.1f %10d %10d\n", profiles[i].name,
+                    summaries[i].trackingError * 100.0, summaries[i].p99Latency * 1e3, summaries[i].maxLatency * 1e3,
+                    summaries[i].searches, summaries[i].dropped);
+    }
+    return 0;
+}
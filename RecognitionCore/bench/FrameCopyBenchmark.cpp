@@ -0,0 +1,134 @@
+//
+//  FrameCopyBenchmark.cpp
+//  RecognitionCore
+//
+//  Bytes copied and allocated per 1280x720 camera frame when searching
+//  through a QueryImage (initWithVideoFrame: style) versus the in-place
+//  VideoFrame path.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "SyntheticSigns.h"
+#include "rsr/OnDeviceIR.h"
+
+using namespace rsr;
+using namespace rsr::bench;
+
+namespace {
+
+std::atomic<unsigned long long> gAllocatedBytes{0};
+std::atomic<unsigned long long> gAllocations{0};
+
+struct PathStats {
+    double bytesCopied = 0.0;
+    double bytesAllocated = 0.0;
+    double allocations = 0.0;
+    std::vector<double> latencies;
+};
+
+}
+
+void* operator new(std::size_t size) {
+    gAllocatedBytes += size;
+    ++gAllocations;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+// Aligned ones too, which collection storage uses: both kinds must come from here.
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    gAllocatedBytes += size;
+    ++gAllocations;
+    const std::size_t align = static_cast<std::size_t>(alignment);
+    if (void* p = std::aligned_alloc(align, (size + align - 1) / align * align)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+int main(int argc, char** argv) {
+    const int frames = argInt(argc, argv, "--frames", 30);
+    const int padding = argInt(argc, argv, "--row-padding", 64);
+
+    auto collection = std::make_shared<Collection>("bench", "Synthetic signs");
+    for (int i = 0; i < 10; ++i) {
+        Item item;
+        item.uuid = "item-" + std::to_string(i);
+        collection->addImage(item, "image-" + std::to_string(i), makeSignTemplate(i).toQueryImage());
+    }
+    OnDeviceIR onDeviceIR;
+    onDeviceIR.setCollection(collection);
+
+    // Camera buffers usually carry row padding, so lay the frame out with a
+    // stride wider than 4 * width like CVPixelBuffer does.
+    const BgraImage scene = makeScene(makeSignTemplate(3), 42u);
+    const int bytesPerRow = scene.bytesPerRow() + padding;
+    std::vector<uint8_t> cameraBuffer(static_cast<size_t>(bytesPerRow) * scene.height);
+    for (int y = 0; y < scene.height; ++y) {
+        std::copy(scene.pixel(0, y), scene.pixel(0, y) + scene.bytesPerRow(),
+                  cameraBuffer.begin() + static_cast<size_t>(y) * bytesPerRow);
+    }
+    const VideoFrame frame{cameraBuffer.data(), scene.width, scene.height, bytesPerRow};
+
+    std::vector<SearchResult> results;
+    results.reserve(16);
+    PathStats copied;
+    PathStats inPlace;
+    for (int i = 0; i < frames; ++i) {
+        {
+            const unsigned long long bytes = gAllocatedBytes;
+            const unsigned long long count = gAllocations;
+            Stopwatch stopwatch;
+            const QueryImage image(frame);
+            onDeviceIR.searchWithImage(image, results);
+            copied.latencies.push_back(stopwatch.elapsedMs());
+            copied.bytesCopied += static_cast<double>(image.bytesPerRow()) * image.height();
+            copied.bytesAllocated += static_cast<double>(gAllocatedBytes - bytes);
+            copied.allocations += static_cast<double>(gAllocations - count);
+        }
+        {
+            const unsigned long long bytes = gAllocatedBytes;
+            const unsigned long long count = gAllocations;
+            Stopwatch stopwatch;
+            onDeviceIR.searchWithVideoFrame(frame, results);
+            inPlace.latencies.push_back(stopwatch.elapsedMs());
+            inPlace.bytesAllocated += static_cast<double>(gAllocatedBytes - bytes);
+            inPlace.allocations += static_cast<double>(gAllocations - count);
+        }
+    }
+
+    std::printf("frame %dx%d, bytesPerRow %d, %d frames\n", frame.width, frame.height, frame.bytesPerRow, frames);
+    std::printf("%-22s %14s %16s %12s %10s\n", "path", "BGRA copied/f", "allocated B/f", "allocs/f", "p50 ms");
+    std::printf("%-22s %14.0f %16.0f %12.1f %10.2f\n", "QueryImage (before)", copied.bytesCopied / frames,
+                copied.bytesAllocated / frames, copied.allocations / frames, percentile(copied.latencies, 50));
+    std::printf("%-22s %14.0f %16.0f %12.1f %10.2f\n", "VideoFrame (after)", inPlace.bytesCopied / frames,
+                inPlace.bytesAllocated / frames, inPlace.allocations / frames, percentile(inPlace.latencies, 50));
+    return 0;
+}
@@ -0,0 +1,231 @@
+//
+//  FramePoolBenchmark.cpp
+//  RecognitionCore
+//
+//  Capture, preprocessing and search on three threads at --fps. Camera frames
+//  reach the preprocessing thread as a QueryImage copy, a pooled copy or a
+//  wrapped camera buffer, and go on to searchAsync from there. The camera has
+//  a fixed number of buffers, as AVCaptureVideoDataOutput does, and cannot
+//  deliver into one that is still held. Reports the capture thread's time and
+//  heap allocations per frame and where frames were lost.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AllocationCounter.h"
+#include "BenchUtil.h"
+#include "SyntheticSigns.h"
+#include "rsr/FrameBufferPool.h"
+#include "rsr/FrameSketch.h"
+#include "rsr/OnDeviceIR.h"
+
+using namespace rsr;
+using namespace rsr::bench;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+enum class Mode { QUERY_IMAGE, POOLED_COPY, WRAPPED };
+
+const char* modeName(Mode mode) {
+    switch (mode) {
+        case Mode::QUERY_IMAGE: return "QueryImage copy";
+        case Mode::POOLED_COPY: return "pooled copy";
+        case Mode::WRAPPED: return "wrapped";
+    }
+    return "";
+}
+
+// A frame on its way from capture to preprocessing.
+struct Captured {
+    uint64_t sequence = 0;
+    QueryImage image;
+    FrameBuffer buffer;
+
+    VideoFrame frame() const { return buffer ? buffer.frame() : image.view(); }
+};
+
+// Latest-wins handoff of a few frames, so capture never waits.
+class Handoff {
+public:
+    explicit Handoff(size_t depth) : mDepth(depth) {}
+
+    // @return Whether the oldest waiting frame was dropped to make room.
+    bool push(Captured captured) {
+        Captured dropped;
+        std::lock_guard<std::mutex> lock(mMutex);
+        const bool full = mFrames.size() >= mDepth;
+        if (full) {
+            dropped = std::move(mFrames.front());
+            mFrames.pop_front();
+        }
+        mFrames.push_back(std::move(captured));
+        mAvailable.notify_one();
+        return full;
+    }
+
+    bool pop(Captured& captured) {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mAvailable.wait(lock, [this] { return !mFrames.empty() || mClosed; });
+        if (mFrames.empty()) {
+            return false;
+        }
+        captured = std::move(mFrames.front());
+        mFrames.pop_front();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mClosed = true;
+        mAvailable.notify_all();
+    }
+
+private:
+    size_t mDepth;
+    std::mutex mMutex;
+    std::condition_variable mAvailable;
+    std::deque<Captured> mFrames;
+    bool mClosed = false;
+};
+
+struct Run {
+    std::vector<double> captureMs;  ///< Capture thread time per delivered frame.
+    uint64_t allocations = 0;       ///< Heap allocations on the capture thread.
+    int delivered = 0;
+    int starved = 0;                ///< Frames the camera had no free buffer for.
+    int refused = 0;                ///< Frames the pool turned down at its cap.
+    int dropped = 0;                ///< Frames replaced in the handoff by newer ones.
+    std::atomic<int> searched{0};
+    std::atomic<int> correct{0};
+};
+
+}
+
+int main(int argc, char** argv) {
+    const int itemCount = argInt(argc, argv, "--items", 20);
+    const double fps = argValue(argc, argv, "--fps", 30);
+    const double seconds = argValue(argc, argv, "--seconds", 4);
+    const int cameraBuffers = argInt(argc, argv, "--camera-buffers", 6);
+    const int maxOutstanding = argInt(argc, argv, "--max-outstanding", 4);
+
+    auto collection = std::make_shared<Collection>("bench", "Synthetic signs");
+    for (int i = 0; i < itemCount; ++i) {
+        Item item;
+        item.uuid = "item-" + std::to_string(i);
+        collection->addImage(item, "image-" + std::to_string(i), makeSignTemplate(i).toQueryImage());
+    }
+
+    // The camera's buffers, each showing its own sign.
+    std::vector<BgraImage> camera;
+    for (int i = 0; i < cameraBuffers; ++i) {
+        camera.push_back(makeScene(makeSignTemplate(i % itemCount), 3000u + i));
+    }
+    const int frameCount = static_cast<int>(fps * seconds);
+    const auto interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / fps));
+
+    std::printf("%d frames of %dx%d at %.0f fps, %d camera buffers, at most %d frames held\n", frameCount,
+                camera[0].width, camera[0].height, fps, cameraBuffers, maxOutstanding);
+    std::printf("%-16s %8s %8s %8s %8s %8s %8s %9s %9s %8s\n", "handoff", "frames", "starved", "refused", "dropped",
+                "searched", "top-1", "p50 ms", "p99 ms", "allocs");
+    for (const Mode mode : {Mode::QUERY_IMAGE, Mode::POOLED_COPY, Mode::WRAPPED}) {
+        OnDeviceIR onDeviceIR;
+        onDeviceIR.setCollection(collection);
+        FramePoolOptions poolOptions;
+        poolOptions.maxOutstanding = maxOutstanding;
+        FrameBufferPool pool(poolOptions);
+        std::unique_ptr<std::atomic<bool>[]> held(new std::atomic<bool>[cameraBuffers]);
+        for (int i = 0; i < cameraBuffers; ++i) {
+            held[i] = false;
+        }
+        Handoff handoff(2);
+        Run run;
+
+        std::thread capture([&] {
+            auto next = Clock::now();
+            for (int i = 0; i < frameCount; ++i) {
+                std::this_thread::sleep_until(next);
+                next += interval;
+                const int index = i % cameraBuffers;
+                if (held[index]) {
+                    ++run.starved;
+                    continue;
+                }
+                const BgraImage& image = camera[index];
+                const VideoFrame frame{image.pixels.data(), image.width, image.height, image.bytesPerRow()};
+                const uint64_t before = threadAllocationCount();
+                Stopwatch stopwatch;
+                // What didReceivePreviewFrame: would do before returning the buffer to the camera.
+                Captured captured;
+                captured.sequence = static_cast<uint64_t>(i);
+                if (mode == Mode::QUERY_IMAGE) {
+                    captured.image = QueryImage(frame);
+                } else if (mode == Mode::POOLED_COPY) {
+                    captured.buffer = pool.copy(frame);
+                } else {
+                    held[index] = true;
+                    captured.buffer = pool.wrap(frame, [&held, index] { held[index] = false; });
+                }
+                if (mode != Mode::QUERY_IMAGE && !captured.buffer) {
+                    ++run.refused;
+                    continue;
+                }
+                run.dropped += handoff.push(std::move(captured));
+                run.captureMs.push_back(stopwatch.elapsedMs());
+                run.allocations += threadAllocationCount() - before;
+                ++run.delivered;
+            }
+            handoff.close();
+        });
+
+        // Preprocessing: sketch the frame, then queue it as a finder search.
+        std::thread preprocess([&] {
+            Captured captured;
+            while (handoff.pop(captured)) {
+                FrameSketch::of(captured.frame());
+                const std::string expected = "item-" + std::to_string((captured.sequence % cameraBuffers) % itemCount);
+                auto onDone = [&run, expected](ErrorCode error, std::vector<SearchResult> results) {
+                    if (error == ErrorCode::SEARCH_CANCELLED) {
+                        return;
+                    }
+                    ++run.searched;
+                    run.correct += !results.empty() && results[0].item.uuid == expected;
+                };
+                if (captured.buffer) {
+                    onDeviceIR.searchAsync(std::move(captured.buffer), SearchPriority::FINDER, onDone);
+                } else {
+                    onDeviceIR.searchAsync(std::move(captured.image), SearchPriority::FINDER, onDone);
+                }
+                captured = Captured();
+            }
+        });
+
+        capture.join();
+        preprocess.join();
+        while (onDeviceIR.getCurrentSearchCount() > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        std::printf("%-16s %8d %8d %8d %8d %8d %8d %9.3f %9.3f %8.1f\n", modeName(mode), frameCount, run.starved,
+                    run.refused, run.dropped, run.searched.load(), run.correct.load(), percentile(run.captureMs, 50),
+                    percentile(run.captureMs, 99), static_cast<double>(run.allocations) / std::max(1, run.delivered));
+        if (mode != Mode::QUERY_IMAGE) {
+            const FramePoolCounters counters = pool.counters();
+            std::printf("%-16s pool: %llu handed out, %llu pixel allocations, %d held at the end\n", "",
+                        static_cast<unsigned long long>(counters.acquired),
+                        static_cast<unsigned long long>(counters.allocations), counters.outstanding);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,102 @@
+//
+//  HammingBenchmark.cpp
+//  RecognitionCore
+//
+//  Micro-benchmark of the brute force top-two Hamming kernels for every
+//  instruction set available on this machine, against the scalar reference:
+//  descriptor comparisons per second for a block of queries against a run of
+//  references, and whether the neighbours found are the same.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "rsr/DescriptorIndex.h"
+
+using namespace rsr;
+using namespace rsr::bench;
+
+namespace {
+
+bool sameNeighbours(const std::vector<NearestNeighbours>& a, const std::vector<NearestNeighbours>& b) {
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].best != b[i].best || a[i].second != b[i].second || a[i].image != b[i].image ||
+            a[i].reference != b[i].reference) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+int main(int argc, char** argv) {
+    const int queryCount = argInt(argc, argv, "--queries", 500);
+    const int referenceCount = argInt(argc, argv, "--references", 4099);
+    const int repetitions = argInt(argc, argv, "--repetitions", 10);
+
+    // Half the queries are references with a few bits flipped, so that close
+    // matches and ties between duplicated references occur as in real searches.
+    std::mt19937_64 rng(42);
+    std::vector<Descriptor> references(referenceCount);
+    for (Descriptor& d : references) {
+        for (uint64_t& word : d.bits) {
+            word = rng();
+        }
+    }
+    for (int r = 7; r < referenceCount; r += 97) {
+        references[r] = references[r - 7];
+    }
+    std::vector<Descriptor> queries(queryCount);
+    for (int q = 0; q < queryCount; ++q) {
+        if (q % 2 == 0) {
+            queries[q] = references[rng() % referenceCount];
+            for (int flip = 0; flip < 12; ++flip) {
+                const unsigned bit = rng() % 256;
+                queries[q].bits[bit / 64] ^= uint64_t(1) << (bit % 64);
+            }
+        } else {
+            for (uint64_t& word : queries[q].bits) {
+                word = rng();
+            }
+        }
+    }
+
+    std::printf("%d queries x %d references, best level: %s\n", queryCount, referenceCount,
+                simdLevelName(bestSimdLevel()));
+    std::printf("%-8s %10s %14s %9s %s\n", "kernel", "ms", "Mcompares/s", "speedup", "neighbours");
+    std::vector<NearestNeighbours> expected;
+    double scalarMs = 0.0;
+    bool mismatch = false;
+    for (SimdLevel level : {SimdLevel::SCALAR, SimdLevel::AVX2, SimdLevel::AVX512, SimdLevel::NEON}) {
+        if (!isSimdLevelSupported(level)) {
+            continue;
+        }
+        std::vector<NearestNeighbours> found(queryCount);
+        std::vector<double> times;
+        for (int i = 0; i < repetitions; ++i) {
+            std::fill(found.begin(), found.end(), NearestNeighbours());
+            Stopwatch stopwatch;
+            for (int q = 0; q < queryCount; ++q) {
+                nearestTwo(queries[q], references.data(), references.size(), 0, 0, found[q], level);
+            }
+            times.push_back(stopwatch.elapsedMs());
+        }
+        const double ms = percentile(times, 50);
+        if (level == SimdLevel::SCALAR) {
+            expected = found;
+            scalarMs = ms;
+        }
+        const bool same = sameNeighbours(found, expected);
+        mismatch = mismatch || !same;
+        std::printf("%-8s %10.3f %14.1f %8.2fx %s\n", simdLevelName(level), ms,
+                    static_cast<double>(queryCount) * referenceCount / (ms * 1000.0), scalarMs / ms,
+                    same ? "same" : "DIFFERENT");
+    }
+    return mismatch ? 1 : 0;
+}
@@ -0,0 +1,223 @@
+//
+//  HandoffBenchmark.cpp
+//  RecognitionCore
+//
+//  Camera-to-recognizer frame handoff at --fps with a recognizer slower than
+//  capture: the latest-wins FrameRing against a bounded blocking FIFO. Reports
+//  how long the capture thread spends handing a frame over and how old a
+//  frame is when its search starts.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "SyntheticSigns.h"
+#include "rsr/FrameRing.h"
+#include "rsr/OnDeviceIR.h"
+
+using namespace rsr;
+using namespace rsr::bench;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double msBetween(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+// Baseline: frames copied into a FIFO of --depth entries; capture waits while it is full.
+class BlockingQueue {
+public:
+    explicit BlockingQueue(size_t depth) : mDepth(depth) {}
+
+    void push(const VideoFrame& frame, uint64_t sequence) {
+        Entry entry;
+        entry.sequence = sequence;
+        entry.width = frame.width;
+        entry.height = frame.height;
+        entry.pixels.assign(frame.bgraBytes, frame.bgraBytes + static_cast<size_t>(frame.bytesPerRow) * frame.height);
+        entry.bytesPerRow = frame.bytesPerRow;
+        std::unique_lock<std::mutex> lock(mMutex);
+        mNotFull.wait(lock, [&] { return mEntries.size() < mDepth || mClosed; });
+        mEntries.push_back(std::move(entry));
+        mNotEmpty.notify_one();
+    }
+
+    bool pop(std::vector<uint8_t>& pixels, VideoFrame& frame, uint64_t& sequence) {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mNotEmpty.wait(lock, [&] { return !mEntries.empty() || mClosed; });
+        if (mEntries.empty()) {
+            return false;
+        }
+        Entry entry = std::move(mEntries.front());
+        mEntries.pop_front();
+        mNotFull.notify_one();
+        pixels = std::move(entry.pixels);
+        frame = VideoFrame{pixels.data(), entry.width, entry.height, entry.bytesPerRow};
+        sequence = entry.sequence;
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mClosed = true;
+        mNotFull.notify_all();
+        mNotEmpty.notify_all();
+    }
+
+private:
+    struct Entry {
+        std::vector<uint8_t> pixels;
+        int width = 0;
+        int height = 0;
+        int bytesPerRow = 0;
+        uint64_t sequence = 0;
+    };
+
+    size_t mDepth;
+    std::mutex mMutex;
+    std::condition_variable mNotFull;
+    std::condition_variable mNotEmpty;
+    std::deque<Entry> mEntries;
+    bool mClosed = false;
+};
+
+struct Run {
+    std::vector<double> handoffMs;  ///< Capture thread time per frame.
+    std::vector<double> ageMs;      ///< From capture to the start of its search.
+    uint64_t captured = 0;
+    uint64_t searched = 0;
+    int correct = 0;
+};
+
+void printRun(const char* mode, const Run& run, uint64_t dropped) {
+    std::printf("%-16s %8llu %8llu %8llu %10.3f %10.3f %10.1f %10.1f %6d\n", mode,
+                static_cast<unsigned long long>(run.captured), static_cast<unsigned long long>(run.searched),
+                static_cast<unsigned long long>(dropped), percentile(run.handoffMs, 50), percentile(run.handoffMs, 99),
+                percentile(run.ageMs, 50), percentile(run.ageMs, 99), run.correct);
+}
+
+}
+
+int main(int argc, char** argv) {
+    const int itemCount = argInt(argc, argv, "--items", 20);
+    const double fps = argValue(argc, argv, "--fps", 60);
+    const double seconds = argValue(argc, argv, "--seconds", 5);
+    const int depth = argInt(argc, argv, "--depth", 3);
+
+    auto collection = std::make_shared<Collection>("bench", "Synthetic signs");
+    for (int i = 0; i < itemCount; ++i) {
+        Item item;
+        item.uuid = "item-" + std::to_string(i);
+        collection->addImage(item, "image-" + std::to_string(i), makeSignTemplate(i).toQueryImage());
+    }
+    OnDeviceIR onDeviceIR;
+    onDeviceIR.setCollection(collection);
+
+    // A few distinct frames the camera cycles through; the sign shown identifies the frame.
+    std::vector<BgraImage> scenes;
+    for (int i = 0; i < 8; ++i) {
+        scenes.push_back(makeScene(makeSignTemplate(i % itemCount), 1000u + i));
+    }
+    const int frameCount = static_cast<int>(fps * seconds);
+    const auto interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / fps));
+    auto frameOf = [&](uint64_t sequence) {
+        const BgraImage& scene = scenes[(sequence - 1) % scenes.size()];
+        return VideoFrame{scene.pixels.data(), scene.width, scene.height, scene.bytesPerRow()};
+    };
+    auto isCorrect = [&](const std::vector<SearchResult>& results, uint64_t sequence) {
+        return !results.empty() &&
+               results[0].item.uuid == "item-" + std::to_string(((sequence - 1) % scenes.size()) % itemCount);
+    };
+
+    std::printf("%d frames at %.0f fps, %d items, %u hardware threads\n", frameCount, fps, itemCount,
+                std::thread::hardware_concurrency());
+    std::printf("%-16s %8s %8s %8s %10s %10s %10s %10s %6s\n", "handoff", "captured", "searched", "dropped",
+                "p50 ms", "p99 ms", "age p50", "age p99", "top-1");
+
+    // Capture timestamps by sequence number; written before a frame is handed over.
+    std::vector<Clock::time_point> capturedAt(frameCount + 1);
+
+    {
+        FrameRing ring;
+        Run run;
+        std::atomic<bool> capturing{true};
+        std::thread capture([&] {
+            auto next = Clock::now();
+            for (int i = 1; i <= frameCount; ++i) {
+                std::this_thread::sleep_until(next);
+                next += interval;
+                const auto start = Clock::now();
+                capturedAt[i] = start;
+                ring.publish(frameOf(i));
+                run.handoffMs.push_back(msBetween(start, Clock::now()));
+            }
+            capturing = false;
+        });
+        VideoFrame frame;
+        uint64_t sequence = 0;
+        std::vector<SearchResult> results;
+        for (;;) {
+            const bool running = capturing;
+            if (!ring.acquireLatest(frame, &sequence)) {
+                if (!running) {
+                    break;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            run.ageMs.push_back(msBetween(capturedAt[sequence], Clock::now()));
+            onDeviceIR.searchWithVideoFrame(frame, results);
+            run.correct += isCorrect(results, sequence);
+        }
+        capture.join();
+        const FrameRingCounters counters = ring.counters();
+        run.captured = counters.published;
+        run.searched = counters.consumed;
+        printRun("latest-wins ring", run, counters.dropped);
+        std::printf("%-16s pooled buffer allocations %llu, depth at end %d\n", "",
+                    static_cast<unsigned long long>(counters.allocations), counters.depth);
+    }
+
+    {
+        BlockingQueue queue(depth);
+        Run run;
+        std::thread capture([&] {
+            auto next = Clock::now();
+            for (int i = 1; i <= frameCount; ++i) {
+                std::this_thread::sleep_until(next);
+                next += interval;
+                const auto start = Clock::now();
+                capturedAt[i] = start;
+                queue.push(frameOf(i), i);
+                run.handoffMs.push_back(msBetween(start, Clock::now()));
+            }
+            queue.close();
+        });
+        std::vector<uint8_t> pixels;
+        VideoFrame frame;
+        uint64_t sequence = 0;
+        std::vector<SearchResult> results;
+        while (queue.pop(pixels, frame, sequence)) {
+            run.ageMs.push_back(msBetween(capturedAt[sequence], Clock::now()));
+            onDeviceIR.searchWithVideoFrame(frame, results);
+            run.correct += isCorrect(results, sequence);
+            ++run.searched;
+        }
+        capture.join();
+        run.captured = frameCount;
+        printRun("blocking FIFO", run, 0);
+    }
+    return 0;
+}
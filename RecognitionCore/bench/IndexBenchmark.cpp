@@ -0,0 +1,206 @@
+//
+//  IndexBenchmark.cpp
+//  RecognitionCore
+//
+//  Recall against latency of the descriptor indexes on a large synthetic
+//  collection. Reference images are random descriptors at random positions;
+//  a query takes part of one image's descriptors with --noise bits flipped,
+//  moves them by a similarity transform and adds random distractors. Cache
+//  counters per query follow the table where the machine offers them.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "PerfCounters.h"
+#include "rsr/DescriptorIndex.h"
+#include "rsr/Matcher.h"
+
+using namespace rsr;
+using namespace rsr::bench;
+
+namespace {
+
+constexpr int kImageSize = 256;
+
+Descriptor randomDescriptor(std::mt19937_64& rng) {
+    Descriptor d;
+    for (uint64_t& word : d.bits) {
+        word = rng();
+    }
+    return d;
+}
+
+struct Query {
+    FeatureSet features;
+    int item;
+};
+
+Query makeQuery(const Collection& collection, int item, int keep, int distractors, int noise, uint32_t seed) {
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    const ReferenceImage& image = collection.images()[item];
+
+    const float angle = (unit(rng) - 0.5f) * 0.6f;
+    const float scale = 1.5f + unit(rng);
+    const float c = std::cos(angle) * scale;
+    const float s = std::sin(angle) * scale;
+    const float tx = 200.0f + unit(rng) * 300.0f;
+    const float ty = 100.0f + unit(rng) * 200.0f;
+
+    Query query;
+    query.item = item;
+    query.features.width = 1280;
+    query.features.height = 720;
+    std::vector<int> order(image.descriptors.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = static_cast<int>(i);
+    }
+    std::shuffle(order.begin(), order.end(), rng);
+    for (int k = 0; k < keep && k < static_cast<int>(order.size()); ++k) {
+        const Keypoint& p = image.keypoints[order[k]];
+        Keypoint moved = p;
+        moved.x = c * p.x - s * p.y + tx;
+        moved.y = s * p.x + c * p.y + ty;
+        Descriptor d = image.descriptors[order[k]];
+        for (int b = 0; b < noise; ++b) {
+            const int bit = static_cast<int>(rng() % 256);
+            d.bits[bit >> 6] ^= uint64_t(1) << (bit & 63);
+        }
+        query.features.keypoints.push_back(moved);
+        query.features.descriptors.push_back(d);
+    }
+    for (int k = 0; k < distractors; ++k) {
+        Keypoint p;
+        p.x = unit(rng) * query.features.width;
+        p.y = unit(rng) * query.features.height;
+        query.features.keypoints.push_back(p);
+        query.features.descriptors.push_back(randomDescriptor(rng));
+    }
+    return query;
+}
+
+struct Setting {
+    const char* name;
+    IndexOptions options;
+};
+
+IndexOptions lsh(int tables, int keyBits, bool multiProbe) {
+    IndexOptions options;
+    options.type = IndexType::LSH;
+    options.lshTables = tables;
+    options.lshKeyBits = keyBits;
+    options.lshMultiProbe = multiProbe;
+    return options;
+}
+
+}
+
+int main(int argc, char** argv) {
+    const int itemCount = argInt(argc, argv, "--items", 10000);
+    const int perImage = argInt(argc, argv, "--descriptors", 100);
+    const int queryCount = argInt(argc, argv, "--queries", 10);
+    const int noise = argInt(argc, argv, "--noise", 25);
+    const int keep = argInt(argc, argv, "--keep", 60);
+    const int distractors = argInt(argc, argv, "--distractors", 200);
+
+    Stopwatch stopwatch;
+    Collection collection("bench", "Synthetic descriptors");
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<float> position(0.0f, static_cast<float>(kImageSize));
+    for (int i = 0; i < itemCount; ++i) {
+        FeatureSet features;
+        features.width = kImageSize;
+        features.height = kImageSize;
+        for (int k = 0; k < perImage; ++k) {
+            Keypoint p;
+            p.x = position(rng);
+            p.y = position(rng);
+            features.keypoints.push_back(p);
+            features.descriptors.push_back(randomDescriptor(rng));
+        }
+        Item item;
+        item.uuid = "item-" + std::to_string(i);
+        collection.addImageFeatures(item, "image-" + std::to_string(i), std::move(features));
+    }
+    std::printf("%d items, %d descriptors each, built in %.0f ms\n", itemCount, perImage, stopwatch.elapsedMs());
+
+    std::vector<Query> queries;
+    for (int q = 0; q < queryCount; ++q) {
+        queries.push_back(makeQuery(collection, (q * 7919) % itemCount, keep, distractors, noise, 1000u + q));
+    }
+
+    // Ground truth: exact neighbours of the query descriptors that pass the ratio test.
+    Matcher matcher;
+    const std::unique_ptr<DescriptorIndex> exact = DescriptorIndex::create(collection, IndexOptions());
+    std::vector<std::vector<NearestNeighbours>> truth(queries.size());
+    for (size_t q = 0; q < queries.size(); ++q) {
+        std::vector<const Descriptor*> descriptors;
+        for (const Descriptor& d : queries[q].features.descriptors) {
+            descriptors.push_back(&d);
+        }
+        exact->search(descriptors, truth[q]);
+    }
+
+    const Setting settings[] = {
+        {"exact", IndexOptions()},
+        {"lsh 4x16 multi-probe", lsh(4, 16, true)},
+        {"lsh 8x16", lsh(8, 16, false)},
+        {"lsh 8x16 multi-probe", lsh(8, 16, true)},
+        {"lsh 8x20 multi-probe", lsh(8, 20, true)},
+        {"lsh 12x20 multi-probe", lsh(12, 20, true)},
+    };
+
+    std::printf("%-24s %10s %10s %10s %10s %8s\n", "index", "build ms", "recall@1", "top-1", "mean ms", "p95 ms");
+    std::vector<std::string> countersBySetting;
+    for (const Setting& setting : settings) {
+        PerfCounters counters;
+        stopwatch.restart();
+        const std::unique_ptr<DescriptorIndex> index = DescriptorIndex::create(collection, setting.options);
+        const double buildMs = stopwatch.elapsedMs();
+
+        int found = 0;
+        int relevant = 0;
+        int correct = 0;
+        std::vector<double> latencies;
+        for (size_t q = 0; q < queries.size(); ++q) {
+            std::vector<const Descriptor*> descriptors;
+            for (const Descriptor& d : queries[q].features.descriptors) {
+                descriptors.push_back(&d);
+            }
+            std::vector<NearestNeighbours> neighbours;
+            index->search(descriptors, neighbours);
+            for (size_t k = 0; k < neighbours.size(); ++k) {
+                const NearestNeighbours& t = truth[q][k];
+                if (t.best <= matcher.options().maxDistance && t.best < matcher.options().ratio * t.second) {
+                    ++relevant;
+                    found += neighbours[k].image == t.image && neighbours[k].reference == t.reference;
+                }
+            }
+
+            std::vector<SearchResult> results;
+            stopwatch.restart();
+            counters.start();
+            matcher.match(queries[q].features, collection, results, index.get());
+            counters.stop();
+            latencies.push_back(stopwatch.elapsedMs());
+            correct += !results.empty() && results[0].item.uuid == "item-" + std::to_string(queries[q].item);
+        }
+        std::printf("%-24s %10.0f %9.1f%% %9.1f%% %10.2f %8.2f\n", setting.name, buildMs,
+                    relevant ? 100.0 * found / relevant : 0.0, 100.0 * correct / queries.size(), mean(latencies),
+                    percentile(latencies, 95));
+        countersBySetting.push_back(counters.summary(static_cast<double>(queries.size())));
+    }
+    std::printf("\nper query:\n");
+    for (size_t i = 0; i < countersBySetting.size(); ++i) {
+        std::printf("%-24s %s\n", settings[i].name, countersBySetting[i].c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,147 @@
+//
+//  PerfCounters.cpp
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "PerfCounters.h"
+
+#include <cstdio>
+#include <cstring>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace rsr {
+namespace bench {
+
+namespace {
+
+#if defined(__linux__)
+int openCounter(PerfEvent event) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    switch (event) {
+        case PerfEvent::CACHE_REFERENCES:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CACHE_REFERENCES;
+            break;
+        case PerfEvent::CACHE_MISSES:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+            break;
+        case PerfEvent::L1D_READ_MISSES:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+        case PerfEvent::PAGE_FAULTS:
+            attr.type = PERF_TYPE_SOFTWARE;
+            attr.config = PERF_COUNT_SW_PAGE_FAULTS;
+            break;
+    }
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+#endif
+
+}
+
+const char* perfEventName(PerfEvent event) {
+    switch (event) {
+        case PerfEvent::CACHE_REFERENCES: return "cache references";
+        case PerfEvent::CACHE_MISSES: return "cache misses";
+        case PerfEvent::L1D_READ_MISSES: return "L1d read misses";
+        case PerfEvent::PAGE_FAULTS: return "page faults";
+    }
+    return "unknown";
+}
+
+PerfCounters::PerfCounters() {
+    for (int i = 0; i < kPerfEventCount; ++i) {
+#if defined(__linux__)
+        mFds[i] = openCounter(static_cast<PerfEvent>(i));
+#else
+        mFds[i] = -1;
+#endif
+    }
+}
+
+PerfCounters::~PerfCounters() {
+#if defined(__linux__)
+    for (int fd : mFds) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+#endif
+}
+
+void PerfCounters::reset() {
+#if defined(__linux__)
+    for (int fd : mFds) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        }
+    }
+#endif
+}
+
+void PerfCounters::start() {
+#if defined(__linux__)
+    for (int fd : mFds) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#endif
+}
+
+void PerfCounters::stop() {
+#if defined(__linux__)
+    for (int fd : mFds) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+#endif
+}
+
+uint64_t PerfCounters::value(PerfEvent event) const {
+    uint64_t count = 0;
+#if defined(__linux__)
+    const int fd = mFds[static_cast<int>(event)];
+    if (fd >= 0 && read(fd, &count, sizeof(count)) != sizeof(count)) {
+        count = 0;
+    }
+#else
+    (void)event;
+#endif
+    return count;
+}
+
+std::string PerfCounters::summary(double per) const {
+    std::string line;
+    for (int i = 0; i < kPerfEventCount; ++i) {
+        const PerfEvent event = static_cast<PerfEvent>(i);
+        char field[64];
+        if (available(event)) {
+            std::snprintf(field, sizeof(field), "%s %.1f", perfEventName(event), value(event) / per);
+        } else {
+            std::snprintf(field, sizeof(field), "%s n/a", perfEventName(event));
+        }
+        line += (i > 0 ? ", " : "") + std::string(field);
+    }
+    return line;
+}
+
+}
+}
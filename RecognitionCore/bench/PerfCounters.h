@@ -0,0 +1,70 @@
+//
+//  PerfCounters.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace rsr {
+namespace bench {
+
+enum class PerfEvent {
+    CACHE_REFERENCES,  ///< Last level cache accesses.
+    CACHE_MISSES,      ///< Last level cache misses.
+    L1D_READ_MISSES,
+    PAGE_FAULTS,       ///< Software event, also counted where the hardware ones are not.
+};
+
+constexpr int kPerfEventCount = 4;
+
+const char* perfEventName(PerfEvent event);
+
+/**
+ * Hardware cache counters of the calling thread, from perf_event_open on
+ * Linux. Counters the kernel or machine does not offer, such as every
+ * hardware one in most virtual machines, read as unavailable; on other
+ * platforms all of them do.
+ */
+class PerfCounters {
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    /**
+     * Set the counters back to zero.
+     */
+    void reset();
+
+    /**
+     * Count until stop(); counts add up over several start() and stop().
+     */
+    void start();
+    void stop();
+
+    bool available(PerfEvent event) const { return mFds[static_cast<int>(event)] >= 0; }
+
+    /**
+     * Count since reset(), 0 if unavailable.
+     */
+    uint64_t value(PerfEvent event) const;
+
+    /**
+     * One line with every counter divided by per, such as the number of
+     * queries, and "n/a" for those unavailable.
+     */
+    std::string summary(double per = 1.0) const;
+
+private:
+    int mFds[kPerfEventCount];
+};
+
+}
+}
@@ -0,0 +1,126 @@
+//
+//  PipelineBenchmark.cpp
+//  RecognitionCore
+//
+//  One search after another with searchWithVideoFrame against a
+//  SearchPipeline fed as fast as it takes frames. Prints the frame rate of
+//  both, whether the pipeline found the same results, and for each stage how
+//  long frames spent in it and waited for it, so the bottleneck shows. The
+//  pipeline can only beat the sequential search with a core per busy stage.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "SyntheticSigns.h"
+#include "rsr/FrameBufferPool.h"
+#include "rsr/OnDeviceIR.h"
+#include "rsr/SearchPipeline.h"
+
+using namespace rsr;
+using namespace rsr::bench;
+
+namespace {
+
+// Top result per frame, "" if none.
+std::string topItem(const std::vector<SearchResult>& results) {
+    return results.empty() ? std::string() : results[0].item.uuid;
+}
+
+}
+
+int main(int argc, char** argv) {
+    const int itemCount = argInt(argc, argv, "--items", 20);
+    const int frameCount = argInt(argc, argv, "--frames", 60);
+    const int workers = argInt(argc, argv, "--workers", 1);
+    const int queueDepth = argInt(argc, argv, "--queue-depth", 2);
+
+    auto collection = std::make_shared<Collection>("bench", "Synthetic signs");
+    for (int i = 0; i < itemCount; ++i) {
+        Item item;
+        item.uuid = "item-" + std::to_string(i);
+        collection->addImage(item, "image-" + std::to_string(i), makeSignTemplate(i).toQueryImage());
+    }
+    std::vector<BgraImage> frames;
+    for (int i = 0; i < frameCount; ++i) {
+        frames.push_back(makeScene(makeSignTemplate(i % itemCount), 5000u + i));
+    }
+    auto frameOf = [&frames](int i) {
+        const BgraImage& image = frames[i];
+        return VideoFrame{image.pixels.data(), image.width, image.height, image.bytesPerRow()};
+    };
+
+    OnDeviceIR onDeviceIR;
+    onDeviceIR.setCollection(collection);
+
+    std::vector<std::string> expected(frameCount);
+    std::vector<SearchResult> results;
+    onDeviceIR.searchWithVideoFrame(frameOf(0), results);  // Warm up the scratch buffers.
+    Stopwatch sequential;
+    for (int i = 0; i < frameCount; ++i) {
+        onDeviceIR.searchWithVideoFrame(frameOf(i), results);
+        expected[i] = topItem(results);
+    }
+    const double sequentialMs = sequential.elapsedMs();
+
+    std::mutex mutex;
+    std::vector<std::string> found(frameCount);
+    PipelineOptions options;
+    options.extractWorkers = workers;
+    options.matchWorkers = workers;
+    options.verifyWorkers = workers;
+    options.queueDepth = queueDepth;
+    SearchPipeline pipeline(
+        onDeviceIR,
+        [&](uint64_t sequence, ErrorCode, const std::vector<SearchResult>& frameResults) {
+            std::lock_guard<std::mutex> lock(mutex);
+            found[(sequence - 1) % frameCount] = topItem(frameResults);
+        },
+        options);
+    FramePoolOptions poolOptions;
+    poolOptions.maxOutstanding = queueDepth + 2;
+    FrameBufferPool pool(poolOptions);
+
+    // A first pass sizes the jobs' buffers and is not measured.
+    for (int pass = 0; pass < 2; ++pass) {
+        pipeline.resetLatencies();
+        Stopwatch stopwatch;
+        for (int i = 0; i < frameCount; ++i) {
+            FrameBuffer frame;
+            while (!(frame = pool.copy(frameOf(i)))) {
+                pipeline.drain();
+            }
+            pipeline.submit(std::move(frame), true);
+        }
+        pipeline.drain();
+        if (pass == 0) {
+            continue;
+        }
+        const double pipelineMs = stopwatch.elapsedMs();
+
+        int same = 0;
+        for (int i = 0; i < frameCount; ++i) {
+            same += found[i] == expected[i];
+        }
+        std::printf("%d frames of %dx%d, %d items, %d worker(s) per stage, queues of %d\n", frameCount,
+                    frames[0].width, frames[0].height, itemCount, workers, queueDepth);
+        std::printf("%-12s %10.1f frames/s\n", "sequential", frameCount * 1000.0 / sequentialMs);
+        std::printf("%-12s %10.1f frames/s, %d/%d frames with the sequential top result\n", "pipeline",
+                    frameCount * 1000.0 / pipelineMs, same, frameCount);
+        std::printf("\n%-12s %9s %9s %9s %9s\n", "stage", "p50 ms", "p99 ms", "wait p50", "wait p99");
+        for (int s = 0; s < kPipelineStageCount; ++s) {
+            const PipelineStage stage = static_cast<PipelineStage>(s);
+            const LatencyHistogram& latency = pipeline.latency(stage);
+            const LatencyHistogram& wait = pipeline.wait(stage);
+            std::printf("%-12s %9.3f %9.3f %9.3f %9.3f\n", pipelineStageName(stage), latency.percentile(50),
+                        latency.percentile(99), wait.percentile(50), wait.percentile(99));
+        }
+    }
+    return 0;
+}
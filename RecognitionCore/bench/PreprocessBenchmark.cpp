@@ -0,0 +1,80 @@
+//
+//  PreprocessBenchmark.cpp
+//  RecognitionCore
+//
+//  Micro-benchmark of the fused BGRA to luminance + box reduction kernel for
+//  every instruction set available on this machine, against the scalar
+//  reference and the previous two-pass conversion (full-size luminance, then
+//  reduction).
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include <cstdio>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "SyntheticSigns.h"
+#include "rsr/Preprocess.h"
+
+using namespace rsr;
+using namespace rsr::bench;
+
+namespace {
+
+template <typename Fn>
+double medianMs(int repetitions, Fn&& fn) {
+    std::vector<double> times;
+    for (int i = 0; i < repetitions; ++i) {
+        Stopwatch stopwatch;
+        fn();
+        times.push_back(stopwatch.elapsedMs());
+    }
+    return percentile(times, 50);
+}
+
+}
+
+int main(int argc, char** argv) {
+    const int repetitions = argInt(argc, argv, "--repetitions", 50);
+    const BgraImage scene = makeScene(makeSignTemplate(1), 7u);
+    const VideoFrame frame{scene.pixels.data(), scene.width, scene.height, scene.bytesPerRow()};
+    const double megapixels = frame.width * frame.height / 1e6;
+
+    std::printf("frame %dx%d, best level: %s\n", frame.width, frame.height, simdLevelName(bestSimdLevel()));
+    std::printf("%-7s %-10s %10s %10s %9s %s\n", "factor", "kernel", "ms/frame", "MPix/s", "speedup", "output");
+
+    bool mismatch = false;
+    for (int factor : {1, 2, 4}) {
+        GrayImage reference;
+        const double scalarMs = medianMs(repetitions, [&] {
+            reduceBGRAToGray(frame, factor, reference, SimdLevel::SCALAR);
+        });
+
+        const double twoPassMs = medianMs(repetitions, [&] {
+            const GrayImage full = convertBGRAToGray(frame.bgraBytes, frame.width, frame.height, frame.bytesPerRow);
+            const GrayImage reduced = downscaleBox(full, factor);
+            (void)reduced;
+        });
+        if (factor > 1) {
+            std::printf("%-7d %-10s %10.3f %10.1f %8.2fx\n", factor, "two-pass", twoPassMs, megapixels / twoPassMs * 1e3,
+                        scalarMs / twoPassMs);
+        }
+        std::printf("%-7d %-10s %10.3f %10.1f %8.2fx reference\n", factor, "scalar", scalarMs,
+                    megapixels / scalarMs * 1e3, 1.0);
+
+        for (SimdLevel level : {SimdLevel::SSE41, SimdLevel::AVX2, SimdLevel::NEON}) {
+            if (!isSimdLevelSupported(level)) {
+                continue;
+            }
+            GrayImage gray;
+            const double ms = medianMs(repetitions, [&] { reduceBGRAToGray(frame, factor, gray, level); });
+            const bool identical = gray.width == reference.width && gray.height == reference.height &&
+                                   gray.pixels == reference.pixels;
+            mismatch = mismatch || !identical;
+            std::printf("%-7d %-10s %10.3f %10.1f %8.2fx %s\n", factor, simdLevelName(level), ms,
+                        megapixels / ms * 1e3, scalarMs / ms, identical ? "identical" : "MISMATCH");
+        }
+    }
+    return mismatch ? 1 : 0;
+}
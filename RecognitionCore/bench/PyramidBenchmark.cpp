@@ -0,0 +1,135 @@
+//
+//  PyramidBenchmark.cpp
+//  RecognitionCore
+//
+//  ImagePyramid build time and memory per level for common camera sizes,
+//  then the three frame stages (duplicate sketch, sign tracking, feature
+//  extraction) run on a drive sequence either each reducing the frame on
+//  its own or all sharing one reused pyramid: time and heap allocations
+//  per frame.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include <cstdio>
+#include <vector>
+
+#include "AllocationCounter.h"
+#include "BenchUtil.h"
+#include "SyntheticSigns.h"
+#include "rsr/Features.h"
+#include "rsr/FrameSketch.h"
+#include "rsr/ImagePyramid.h"
+#include "rsr/Preprocess.h"
+#include "rsr/SignTracker.h"
+
+using namespace rsr;
+using namespace rsr::bench;
+
+namespace {
+
+void levelTable(int width, int height, int rounds) {
+    SceneOptions options;
+    options.width = width;
+    options.height = height;
+    const BgraImage image = makeScene(makeSignTemplate(1), 41u, options);
+    const VideoFrame frame{image.pixels.data(), image.width, image.height, image.bytesPerRow()};
+    const FeatureExtractor extractor;
+    const int factor = extractor.reductionFactor(width, height);
+
+    ImagePyramid pyramid;
+    const int levels = 6;
+    std::vector<double> reduceMs;
+    std::vector<std::vector<double>> levelMs(levels);
+    for (int round = 0; round < rounds; ++round) {
+        Stopwatch stopwatch;
+        pyramid.build(frame, factor, extractor.pyramidOptions());
+        reduceMs.push_back(stopwatch.elapsedMs());
+        for (int l = 0; l < levels; ++l) {
+            stopwatch.restart();
+            pyramid.level(l);
+            levelMs[l].push_back(stopwatch.elapsedMs());
+        }
+    }
+
+    std::printf("%dx%d, reduced by %d to %dx%d: %.3f ms\n", width, height, factor, pyramid.reduced().width,
+                pyramid.reduced().height, percentile(reduceMs, 50));
+    std::printf("  %6s %12s %10s %10s\n", "level", "size", "KiB", "build ms");
+    for (int l = 0; l < levels && l < pyramid.levelCount(); ++l) {
+        const GrayView level = pyramid.level(l);
+        char size[32];
+        std::snprintf(size, sizeof(size), "%dx%d", level.width, level.height);
+        std::printf("  %6d %12s %10.1f %10.3f\n", l, size, level.width * level.height / 1024.0,
+                    percentile(levelMs[l], 50));
+    }
+    std::printf("  pyramid memory %.1f KiB, %llu system allocations after %d frames\n", pyramid.bytes() / 1024.0,
+                static_cast<unsigned long long>(pyramid.systemAllocations()), rounds);
+}
+
+}
+
+int main(int argc, char** argv) {
+    const int rounds = argInt(argc, argv, "--rounds", 30);
+    const int frameCount = argInt(argc, argv, "--frames", 60);
+
+    levelTable(1280, 720, rounds);
+    levelTable(1920, 1080, rounds);
+
+    // A sign approaching, tracked from its true box on the first frame.
+    std::vector<Homography> placements;
+    const BgraImage sign = makeSignTemplate(4);
+    SceneOptions options;
+    options.minSize = 0.25f;
+    options.maxSize = 0.4f;
+    const std::vector<BgraImage> frames = makeDriveSequence(sign, 12u, frameCount, options, &placements);
+    const float w = static_cast<float>(sign.width);
+    const float h = static_cast<float>(sign.height);
+    const Point2f tl = placements[0].map({0, 0});
+    const Point2f tr = placements[0].map({w, 0});
+    const Point2f br = placements[0].map({w, h});
+    const Point2f bl = placements[0].map({0, h});
+    const std::vector<BoundingBox> start = {{tl.x, tl.y, tr.x, tr.y, bl.x, bl.y, br.x, br.y}};
+
+    const FeatureExtractor extractor;
+    std::printf("\n%d frames of %dx%d: sketch, track and extract\n", frameCount, options.width, options.height);
+    std::printf("%-16s %10s %10s %14s %10s\n", "pyramid", "mean ms", "p50 ms", "allocs/frame", "tracked");
+    for (const bool shared : {false, true}) {
+        SignTracker tracker;
+        ImagePyramid pyramid;
+        GrayImage gray;
+        FeatureSet features;
+        std::vector<BoundingBox> boxes;
+        std::vector<double> ms;
+        uint64_t allocations = 0;
+        int tracked = 0;
+        for (size_t i = 0; i < frames.size(); ++i) {
+            const VideoFrame frame{frames[i].pixels.data(), frames[i].width, frames[i].height,
+                                   frames[i].bytesPerRow()};
+            const int factor = extractor.reductionFactor(frame.width, frame.height);
+            const uint64_t before = allocationCount();
+            Stopwatch stopwatch;
+            if (shared) {
+                pyramid.build(frame, factor, extractor.pyramidOptions());
+                FrameSketch::of(pyramid);
+                tracked += i == 0 ? tracker.start(pyramid, start) : tracker.track(pyramid, boxes);
+                extractor.extract(pyramid, features);
+            } else {
+                FrameSketch::of(frame);
+                tracked += i == 0 ? tracker.start(frame, start) : tracker.track(frame, boxes);
+                reduceBGRAToGray(frame, factor, gray);
+                extractor.extract(gray, features, factor);
+            }
+            ms.push_back(stopwatch.elapsedMs());
+            // The first frame sizes every buffer; count the steady state.
+            allocations += i > 0 ? allocationCount() - before : 0;
+        }
+        double total = 0.0;
+        for (double value : ms) {
+            total += value;
+        }
+        std::printf("%-16s %10.2f %10.2f %14.1f %7d/%zu\n", shared ? "shared" : "one per stage", total / ms.size(),
+                    percentile(ms, 50), static_cast<double>(allocations) / (frames.size() - 1), tracked,
+                    frames.size());
+    }
+    return 0;
+}
@@ -0,0 +1,137 @@
+//
+//  RegionSearchBenchmark.cpp
+//  RecognitionCore
+//
+//  Dashcam frames with one small sign each, searched three ways: the whole
+//  frame, the regions of the road-sign SearchPrior, and a region around the
+//  sign (as a tracker or detector would supply). Prints latency, the share
+//  of the frame searched and how often the right sign came out on top.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "SyntheticSigns.h"
+#include "rsr/OnDeviceIR.h"
+
+using namespace rsr;
+using namespace rsr::bench;
+
+namespace {
+
+struct Mode {
+    const char* name;
+    std::vector<double> ms;
+    double area = 0.0;  ///< Searched pixels over frame pixels, summed over frames.
+    int correct = 0;
+};
+
+// The sign's bounding rectangle grown by half its size on each side.
+FrameRect aroundSign(const BgraImage& sign, const Homography& placement) {
+    const float w = static_cast<float>(sign.width);
+    const float h = static_cast<float>(sign.height);
+    const Point2f corners[4] = {placement.map({0, 0}), placement.map({w, 0}), placement.map({w, h}),
+                                placement.map({0, h})};
+    float minX = corners[0].x, minY = corners[0].y, maxX = corners[0].x, maxY = corners[0].y;
+    for (const Point2f& p : corners) {
+        minX = std::min(minX, p.x);
+        minY = std::min(minY, p.y);
+        maxX = std::max(maxX, p.x);
+        maxY = std::max(maxY, p.y);
+    }
+    const float padX = 0.5f * (maxX - minX);
+    const float padY = 0.5f * (maxY - minY);
+    FrameRect rect;
+    rect.x = static_cast<int>(minX - padX);
+    rect.y = static_cast<int>(minY - padY);
+    rect.width = static_cast<int>(maxX - minX + 2 * padX);
+    rect.height = static_cast<int>(maxY - minY + 2 * padY);
+    return rect;
+}
+
+double area(const std::vector<FrameRect>& rects, int width, int height) {
+    double pixels = 0.0;
+    for (const FrameRect& rect : rects) {
+        const int x0 = std::max(0, rect.x);
+        const int y0 = std::max(0, rect.y);
+        const int x1 = std::min(width, rect.x + rect.width);
+        const int y1 = std::min(height, rect.y + rect.height);
+        pixels += std::max(0, x1 - x0) * static_cast<double>(std::max(0, y1 - y0));
+    }
+    return pixels / (static_cast<double>(width) * height);
+}
+
+}
+
+int main(int argc, char** argv) {
+    const int itemCount = argInt(argc, argv, "--items", 20);
+    const int frameCount = argInt(argc, argv, "--frames", 60);
+
+    auto collection = std::make_shared<Collection>("bench", "Synthetic signs");
+    for (int i = 0; i < itemCount; ++i) {
+        Item item;
+        item.uuid = "item-" + std::to_string(i);
+        collection->addImage(item, "image-" + std::to_string(i), makeSignTemplate(i).toQueryImage());
+    }
+    OnDeviceIR onDeviceIR;
+    onDeviceIR.setCollection(collection);
+
+    // Signs a sixth to a third of the frame height, somewhere right of centre.
+    SceneOptions options;
+    options.minSize = 0.17f;
+    options.maxSize = 0.33f;
+    std::vector<BgraImage> signs;
+    std::vector<BgraImage> frames;
+    std::vector<Homography> placements(frameCount);
+    for (int i = 0; i < frameCount; ++i) {
+        signs.push_back(makeSignTemplate(i % itemCount));
+        frames.push_back(makeScene(signs.back(), 9000u + i, options, &placements[i]));
+    }
+
+    const SearchPrior prior = SearchPrior::roadSigns();
+    const std::vector<FrameRect> priorRects = prior.rectsFor(options.width, options.height);
+    Mode modes[3] = {{"whole frame", {}, 0.0, 0}, {"road sign prior", {}, 0.0, 0}, {"around the sign", {}, 0.0, 0}};
+    std::vector<SearchResult> results;
+    for (int i = 0; i < frameCount; ++i) {
+        const VideoFrame frame{frames[i].pixels.data(), frames[i].width, frames[i].height, frames[i].bytesPerRow()};
+        const std::string expected = "item-" + std::to_string(i % itemCount);
+        for (int m = 0; m < 3; ++m) {
+            std::vector<FrameRect> rects;
+            if (m == 1) {
+                rects = priorRects;
+            } else if (m == 2) {
+                rects.push_back(aroundSign(signs[i], placements[i]));
+            }
+            Stopwatch stopwatch;
+            if (m == 1) {
+                // Through the prior, as finder frames would be searched.
+                onDeviceIR.setSearchPrior(prior);
+                onDeviceIR.searchWithVideoFrame(frame, results);
+                onDeviceIR.setSearchPrior(SearchPrior());
+            } else {
+                onDeviceIR.searchWithVideoFrame(frame, rects, results);
+            }
+            modes[m].ms.push_back(stopwatch.elapsedMs());
+            modes[m].area += rects.empty() ? 1.0 : area(rects, frame.width, frame.height);
+            modes[m].correct += !results.empty() && results[0].item.uuid == expected;
+        }
+    }
+
+    std::printf("%d frames of %dx%d, %d items\n", frameCount, options.width, options.height, itemCount);
+    std::printf("%-18s %8s %10s %10s %10s %10s\n", "region", "area", "mean ms", "p50 ms", "p99 ms", "correct");
+    for (const Mode& mode : modes) {
+        double total = 0.0;
+        for (double ms : mode.ms) {
+            total += ms;
+        }
+        std::printf("%-18s %7.0f%% %10.2f %10.2f %10.2f %7d/%d\n", mode.name, 100.0 * mode.area / frameCount,
+                    total / frameCount, percentile(mode.ms, 50), percentile(mode.ms, 99), mode.correct, frameCount);
+    }
+    return 0;
+}
@@ -0,0 +1,158 @@
+//
+//  ReplayBenchmark.cpp
+//  RecognitionCore
+//
+//  Records synthetic drives past a few signs as a Y4M file and a raw BGRA
+//  file, with their labels, then replays them into the search path as
+//  rsr_replay does: in real time, at a fixed rate and as fast as possible,
+//  through finder searches and through a SearchPipeline. Prints one line per
+//  replay, and the JSON report of the last with --json.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "SyntheticSigns.h"
+#include "rsr/OnDeviceIR.h"
+#include "rsr/RecordedVideo.h"
+#include "rsr/Replay.h"
+
+using namespace rsr;
+using namespace rsr::bench;
+
+namespace {
+
+uint8_t clampByte(int value) {
+    return static_cast<uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+// 4:2:0 studio range BT.601, each chroma sample taken from the top left pixel of its block.
+void writeY4mFrame(FILE* file, const BgraImage& image) {
+    const int chromaWidth = (image.width + 1) / 2;
+    const int chromaHeight = (image.height + 1) / 2;
+    std::vector<uint8_t> planes(static_cast<size_t>(image.width) * image.height + 2 * chromaWidth * chromaHeight);
+    uint8_t* y = planes.data();
+    uint8_t* u = y + static_cast<size_t>(image.width) * image.height;
+    uint8_t* v = u + static_cast<size_t>(chromaWidth) * chromaHeight;
+    for (int row = 0; row < image.height; ++row) {
+        for (int x = 0; x < image.width; ++x) {
+            const uint8_t* p = image.pixel(x, row);
+            const int b = p[0], g = p[1], r = p[2];
+            y[row * image.width + x] = clampByte(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+            if ((row & 1) == 0 && (x & 1) == 0) {
+                const size_t c = static_cast<size_t>(row / 2) * chromaWidth + x / 2;
+                u[c] = clampByte(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+                v[c] = clampByte(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+            }
+        }
+    }
+    std::fputs("FRAME\n", file);
+    std::fwrite(planes.data(), 1, planes.size(), file);
+}
+
+}
+
+int main(int argc, char** argv) {
+    const int itemCount = argInt(argc, argv, "--items", 20);
+    const int signCount = argInt(argc, argv, "--signs", 4);
+    const int framesPerSign = argInt(argc, argv, "--frames-per-sign", 30);
+    const double fps = argValue(argc, argv, "--fps", 30);
+    const std::string directory = argc > 1 && argv[1][0] != '-' ? argv[1] : "/tmp";
+    bool json = false;
+    for (int i = 1; i < argc; ++i) {
+        json = json || std::string(argv[i]) == "--json";
+    }
+
+    auto collection = std::make_shared<Collection>("bench", "Synthetic signs");
+    for (int i = 0; i < itemCount; ++i) {
+        Item item;
+        item.uuid = "item-" + std::to_string(i);
+        collection->addImage(item, "image-" + std::to_string(i), makeSignTemplate(i).toQueryImage());
+    }
+
+    const std::string y4mPath = directory + "/rsr_replay.y4m";
+    const std::string rawPath = directory + "/rsr_replay.bgra";
+    FILE* y4m = std::fopen(y4mPath.c_str(), "wb");
+    FILE* raw = std::fopen(rawPath.c_str(), "wb");
+    if (!y4m || !raw) {
+        std::fprintf(stderr, "cannot write to %s\n", directory.c_str());
+        return 1;
+    }
+    std::vector<ReplayLabel> labels;
+    RecordingInfo info;
+    for (int s = 0; s < signCount; ++s) {
+        const int id = (s * 7) % itemCount;
+        const std::vector<BgraImage> drive = makeDriveSequence(makeSignTemplate(id), 700u + s, framesPerSign);
+        if (s == 0) {
+            info.width = drive[0].width;
+            info.height = drive[0].height;
+            info.fps = fps;
+            std::fprintf(y4m, "YUV4MPEG2 W%d H%d F%d:1000 Ip A1:1 C420mpeg2\n", info.width, info.height,
+                         static_cast<int>(fps * 1000));
+        }
+        for (const BgraImage& frame : drive) {
+            writeY4mFrame(y4m, frame);
+            std::fwrite(frame.pixels.data(), 1, frame.pixels.size(), raw);
+        }
+        ReplayLabel label;
+        label.firstFrame = static_cast<uint64_t>(s) * framesPerSign;
+        label.lastFrame = label.firstFrame + framesPerSign - 1;
+        label.itemUUID = "item-" + std::to_string(id);
+        labels.push_back(label);
+    }
+    std::fclose(y4m);
+    std::fclose(raw);
+
+    struct Run {
+        const char* name;
+        const std::string* path;
+        ReplayPacing pacing;
+        bool pipeline;
+    };
+    const Run runs[] = {
+        {"y4m realtime", &y4mPath, ReplayPacing::REAL_TIME, false},
+        {"y4m fixed 10", &y4mPath, ReplayPacing::FIXED_RATE, false},
+        {"y4m fast", &y4mPath, ReplayPacing::AS_FAST_AS_POSSIBLE, false},
+        {"raw realtime", &rawPath, ReplayPacing::REAL_TIME, false},
+        {"raw pipeline", &rawPath, ReplayPacing::REAL_TIME, true},
+        {"raw fast pipe", &rawPath, ReplayPacing::AS_FAST_AS_POSSIBLE, true},
+    };
+    std::printf("%d frames of %dx%d at %.0f fps, %d signs, %d items\n", signCount * framesPerSign, info.width,
+                info.height, fps, signCount, itemCount);
+    std::printf("%-14s %7s %7s %7s %7s %8s %9s %9s %9s %8s\n", "replay", "frames", "late", "refused", "searched",
+                "frames/s", "p50 ms", "p99 ms", "max ms", "rate");
+    ReplayReport report;
+    for (const Run& run : runs) {
+        RecordedVideo video;
+        if (video.open(*run.path, info) != ErrorCode::SUCCESS) {
+            std::fprintf(stderr, "cannot read %s\n", run.path->c_str());
+            return 1;
+        }
+        OnDeviceIR onDeviceIR;
+        onDeviceIR.setCollection(collection);
+        ReplayOptions options;
+        options.pacing = run.pacing;
+        options.rate = 10.0;
+        options.pipeline = run.pipeline;
+        if (replayRecording(onDeviceIR, video, options, labels, report) != ErrorCode::SUCCESS) {
+            std::fprintf(stderr, "%s: damaged recording\n", run.name);
+            return 1;
+        }
+        std::printf("%-14s %7llu %7llu %7llu %7llu %8.2f %9.2f %9.2f %9.2f %7.1f%%\n", run.name,
+                    static_cast<unsigned long long>(report.frames), static_cast<unsigned long long>(report.late),
+                    static_cast<unsigned long long>(report.refused), static_cast<unsigned long long>(report.searched),
+                    report.framesPerSecond(), report.latencyP50, report.latencyP99, report.latencyMax,
+                    report.recognitionRate() * 100.0);
+    }
+    if (json) {
+        std::printf("\n%s\n", report.toJson().c_str());
+    }
+    std::remove(y4mPath.c_str());
+    std::remove(rawPath.c_str());
+    return 0;
+}
@@ -0,0 +1,120 @@
+//
+//  RequestQueueBenchmark.cpp
+//  RecognitionCore
+//
+//  Finder frames queued for a cloud-like sender whose round trip goes from
+//  250 ms to 2 s during a connectivity drop, while the vehicle stops for a
+//  while. Compares an unbounded queue with the bounded SearchRequestQueue
+//  (drop-oldest, deadlines, coalescing): how old results are when they
+//  arrive and how much backlog is left behind.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "SyntheticSigns.h"
+#include "rsr/SearchRequestQueue.h"
+
+using namespace rsr;
+using namespace rsr::bench;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double roundTripSeconds(double t) {
+    return t >= 2.0 && t < 5.0 ? 2.0 : 0.25;
+}
+
+struct Outcome {
+    std::vector<double> ageMs;
+    int fresh = 0;  ///< Results at most 1 s old.
+};
+
+}
+
+int main(int argc, char** argv) {
+    const double fps = argValue(argc, argv, "--fps", 15);
+    const double seconds = argValue(argc, argv, "--seconds", 8);
+    const double stopFrom = 1.0;
+    const double stopUntil = 3.5;
+
+    // A drive past a few signs, rendered small: only the queue is being measured.
+    SceneOptions options;
+    options.width = 640;
+    options.height = 360;
+    std::vector<BgraImage> frames;
+    std::mt19937 random(3);
+    std::uniform_int_distribution<int> noise(-3, 3);
+    const int frameCount = static_cast<int>(fps * seconds);
+    BgraImage stopped = makeScene(makeSignTemplate(0), 900u, options);
+    for (int i = 0; i < frameCount; ++i) {
+        const double t = i / fps;
+        if (t >= stopFrom && t < stopUntil) {
+            // Standing still: the same view with fresh sensor noise.
+            BgraImage frame = stopped;
+            for (uint8_t& value : frame.pixels) {
+                value = static_cast<uint8_t>(std::min(255, std::max(0, value + noise(random))));
+            }
+            frames.push_back(std::move(frame));
+        } else {
+            frames.push_back(makeScene(makeSignTemplate(i / 10), 1000u + i, options));
+        }
+    }
+
+    RequestQueueOptions unbounded;
+    unbounded.depth = std::numeric_limits<size_t>::max();
+    unbounded.deadlineSeconds = 0.0;
+    unbounded.coalesceDistance = 0.0;
+    RequestQueueOptions bounded;
+
+    std::printf("%d frames at %.0f fps, round trip 250 ms, 2 s from 2 s to 5 s, stopped from %.1f s to %.1f s\n",
+                frameCount, fps, stopFrom, stopUntil);
+    std::printf("%-10s %6s %6s %8s %8s %10s %8s %10s %10s %8s\n", "queue", "sent", "fresh", "dropped", "expired",
+                "coalesced", "left", "age p50", "age p99", "age max");
+
+    for (const bool isBounded : {false, true}) {
+        SearchRequestQueue queue(isBounded ? bounded : unbounded);
+        Outcome outcome;
+        const Clock::time_point start = Clock::now();
+        auto elapsed = [&] { return std::chrono::duration<double>(Clock::now() - start).count(); };
+
+        std::thread sender([&] {
+            SearchRequestQueue::Request request;
+            while (elapsed() < seconds) {
+                if (!queue.pop(request, 20)) {
+                    continue;
+                }
+                std::this_thread::sleep_for(std::chrono::duration<double>(roundTripSeconds(elapsed())));
+                const double age = std::chrono::duration<double, std::milli>(Clock::now() - request.enqueuedAt).count();
+                outcome.ageMs.push_back(age);
+                outcome.fresh += age <= 1000.0;
+            }
+        });
+        for (int i = 0; i < frameCount; ++i) {
+            std::this_thread::sleep_until(start + std::chrono::duration_cast<Clock::duration>(
+                                                      std::chrono::duration<double>(i / fps)));
+            const BgraImage& frame = frames[i];
+            queue.push(VideoFrame{frame.pixels.data(), frame.width, frame.height, frame.bytesPerRow()});
+        }
+        sender.join();
+        queue.close();
+
+        const RequestQueueCounters counters = queue.counters();
+        std::printf("%-10s %6llu %6d %8llu %8llu %10llu %8d %10.0f %10.0f %8.0f\n",
+                    isBounded ? "bounded" : "unbounded", static_cast<unsigned long long>(counters.sent),
+                    outcome.fresh, static_cast<unsigned long long>(counters.dropped),
+                    static_cast<unsigned long long>(counters.expired),
+                    static_cast<unsigned long long>(counters.coalesced), counters.depth,
+                    percentile(outcome.ageMs, 50), percentile(outcome.ageMs, 99), percentile(outcome.ageMs, 100));
+    }
+    return 0;
+}
@@ -0,0 +1,115 @@
+//
+//  SchedulerBenchmark.cpp
+//  RecognitionCore
+//
+//  Finder frames at --fps and a single-shot picture every --shot-ms, all
+//  queued with searchAsync. Compares single-shot latency when pictures carry
+//  SINGLE_SHOT priority with queueing them behind finder frames, and counts
+//  the finder frames cancelled once a newer one made them stale.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "SyntheticSigns.h"
+#include "rsr/OnDeviceIR.h"
+
+using namespace rsr;
+using namespace rsr::bench;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Outcome {
+    std::mutex mutex;
+    std::vector<double> shotMs;
+    std::atomic<int> finderSearched{0};
+};
+
+}
+
+int main(int argc, char** argv) {
+    const int itemCount = argInt(argc, argv, "--items", 20);
+    const double fps = argValue(argc, argv, "--fps", 30);
+    const double seconds = argValue(argc, argv, "--seconds", 5);
+    const double shotMs = argValue(argc, argv, "--shot-ms", 500);
+    SchedulerOptions schedulerOptions;
+    schedulerOptions.workerCount = argInt(argc, argv, "--workers", 0);
+
+    auto collection = std::make_shared<Collection>("bench", "Synthetic signs");
+    for (int i = 0; i < itemCount; ++i) {
+        Item item;
+        item.uuid = "item-" + std::to_string(i);
+        collection->addImage(item, "image-" + std::to_string(i), makeSignTemplate(i).toQueryImage());
+    }
+    std::vector<QueryImage> frames;
+    for (int i = 0; i < 8; ++i) {
+        frames.push_back(makeScene(makeSignTemplate(i % itemCount), 1000u + i).toQueryImage());
+    }
+
+    const int frameCount = static_cast<int>(fps * seconds);
+    const int shotEvery = std::max(1, static_cast<int>(shotMs * fps / 1000.0 + 0.5));
+    const auto interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / fps));
+    std::printf("%d finder frames at %.0f fps, a picture every %d frames, %d items\n", frameCount, fps, shotEvery,
+                itemCount);
+    std::printf("%-22s %8s %10s %10s %10s %10s %10s\n", "pictures queued as", "workers", "finder", "cancelled",
+                "shot p50", "shot p99", "shot max");
+
+    for (const SearchPriority shotPriority : {SearchPriority::SINGLE_SHOT, SearchPriority::FINDER}) {
+        OnDeviceIR onDeviceIR(ExtractorOptions(), MatcherOptions(), schedulerOptions);
+        onDeviceIR.setCollection(collection);
+        Outcome outcome;
+        std::vector<std::shared_ptr<SearchTask>> shots;
+
+        auto next = Clock::now();
+        for (int i = 0; i < frameCount; ++i) {
+            std::this_thread::sleep_until(next);
+            next += interval;
+            const QueryImage& frame = frames[i % frames.size()];
+            if (i % shotEvery == shotEvery - 1) {
+                const auto submitted = Clock::now();
+                // Queued as FINDER, a picture would cancel the frame before it; use API for the baseline.
+                const SearchPriority priority =
+                    shotPriority == SearchPriority::SINGLE_SHOT ? SearchPriority::SINGLE_SHOT : SearchPriority::API;
+                auto onDone = [&outcome, submitted](ErrorCode, std::vector<SearchResult>) {
+                    const double ms = std::chrono::duration<double, std::milli>(Clock::now() - submitted).count();
+                    std::lock_guard<std::mutex> lock(outcome.mutex);
+                    outcome.shotMs.push_back(ms);
+                };
+                shots.push_back(onDeviceIR.searchAsync(frame, priority, onDone));
+            }
+            // Finder frames are all API priority in the baseline, so nothing is cancelled or reordered.
+            onDeviceIR.searchAsync(frame,
+                                   shotPriority == SearchPriority::SINGLE_SHOT ? SearchPriority::FINDER
+                                                                              : SearchPriority::API,
+                                   [&outcome](ErrorCode error, std::vector<SearchResult>) {
+                                       outcome.finderSearched += error != ErrorCode::SEARCH_CANCELLED;
+                                   });
+        }
+        for (const auto& shot : shots) {
+            shot->wait();
+        }
+        while (onDeviceIR.getCurrentSearchCount() > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        const SchedulerCounters counters = onDeviceIR.scheduler().counters();
+        std::lock_guard<std::mutex> lock(outcome.mutex);
+        std::printf("%-22s %8d %10d %10llu %10.1f %10.1f %10.1f\n",
+                    shotPriority == SearchPriority::SINGLE_SHOT ? "SINGLE_SHOT" : "API, finder also API",
+                    onDeviceIR.scheduler().workerCount(), outcome.finderSearched.load(),
+                    static_cast<unsigned long long>(counters.cancelled), percentile(outcome.shotMs, 50),
+                    percentile(outcome.shotMs, 99), percentile(outcome.shotMs, 100));
+    }
+    return 0;
+}
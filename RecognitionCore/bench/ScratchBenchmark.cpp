@@ -0,0 +1,187 @@
+//
+//  ScratchBenchmark.cpp
+//  RecognitionCore
+//
+//  Search scratch memory from the general allocator against a per-thread
+//  Arena: several threads search dashcam frames at once, and the benchmark
+//  prints the latency spread and heap allocations per search for both, and
+//  for the arena with candidates verified in parallel on scheduler workers.
+//  Then the peak arena usage OnDeviceIR reports per search.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AllocationCounter.h"
+#include "BenchUtil.h"
+#include "SyntheticSigns.h"
+#include "rsr/OnDeviceIR.h"
+#include "rsr/SearchScheduler.h"
+
+using namespace rsr;
+using namespace rsr::bench;
+
+namespace {
+
+struct Setting {
+    std::string name;
+    bool useArena;
+    SearchScheduler* scheduler;  ///< Verifies candidates in parallel when set.
+};
+
+struct Run {
+    std::vector<double> ms;
+    uint64_t allocations = 0;
+    int searches = 0;
+};
+
+double standardDeviation(const std::vector<double>& values) {
+    const double m = mean(values);
+    double sum = 0.0;
+    for (double v : values) {
+        sum += (v - m) * (v - m);
+    }
+    return values.empty() ? 0.0 : std::sqrt(sum / values.size());
+}
+
+// Every thread searches every frame, rounds times; the first round sizes the
+// buffers and is not measured. Allocations are counted from every thread,
+// scheduler workers included, once all threads are past the first round.
+Run searchFrames(const std::vector<BgraImage>& frames, const Collection& collection, const DescriptorIndex& index,
+                 int threadCount, int rounds, const Setting& setting) {
+    const FeatureExtractor extractor;
+    const Matcher matcher;
+    std::mutex mutex;
+    std::condition_variable warmedUp;
+    int warming = threadCount;
+    uint64_t allocationsBefore = 0;
+    std::vector<std::vector<double>> threadMs(threadCount);
+    auto work = [&](int t) {
+        ImagePyramid pyramid;
+        Arena arena(1024 * 1024);
+        FeatureSet reused;
+        std::vector<SearchResult> results;
+        std::vector<double>& ms = threadMs[t];
+        ms.reserve(rounds * frames.size());
+        for (int round = 0; round < rounds; ++round) {
+            if (round == 1) {
+                std::unique_lock<std::mutex> lock(mutex);
+                if (--warming == 0) {
+                    allocationsBefore = allocationCount();
+                    warmedUp.notify_all();
+                }
+                warmedUp.wait(lock, [&warming] { return warming == 0; });
+            }
+            for (const BgraImage& image : frames) {
+                const VideoFrame frame{image.pixels.data(), image.width, image.height, image.bytesPerRow()};
+                Stopwatch stopwatch;
+                pyramid.build(frame, extractor.reductionFactor(frame.width, frame.height), extractor.pyramidOptions());
+                if (setting.useArena) {
+                    extractor.extract(pyramid, reused, &arena);
+                    {
+                        MatchCandidates candidates(&arena);
+                        matcher.findCandidates(reused, collection, candidates, &index, &arena);
+                        matcher.verify(reused, collection, candidates, results, &arena, setting.scheduler);
+                    }
+                    arena.reset();
+                } else {
+                    FeatureSet features;
+                    extractor.extract(pyramid, features);
+                    matcher.match(features, collection, results, &index);
+                }
+                if (round > 0) {
+                    ms.push_back(stopwatch.elapsedMs());
+                }
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int t = 1; t < threadCount; ++t) {
+        threads.emplace_back(work, t);
+    }
+    work(0);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    Run run;
+    run.allocations = allocationCount() - allocationsBefore;
+    for (const std::vector<double>& ms : threadMs) {
+        run.ms.insert(run.ms.end(), ms.begin(), ms.end());
+    }
+    run.searches = static_cast<int>(run.ms.size());
+    return run;
+}
+
+}
+
+int main(int argc, char** argv) {
+    const int itemCount = argInt(argc, argv, "--items", 20);
+    const int frameCount = argInt(argc, argv, "--frames", 30);
+    const int threadCount = argInt(argc, argv, "--threads", 2);
+    const int rounds = std::max(2, argInt(argc, argv, "--rounds", 3));
+    SchedulerOptions schedulerOptions;
+    schedulerOptions.workerCount = argInt(argc, argv, "--workers", 3);
+
+    auto collection = std::make_shared<Collection>("bench", "Synthetic signs");
+    for (int i = 0; i < itemCount; ++i) {
+        Item item;
+        item.uuid = "item-" + std::to_string(i);
+        collection->addImage(item, "image-" + std::to_string(i), makeSignTemplate(i).toQueryImage());
+    }
+    const std::unique_ptr<DescriptorIndex> index = DescriptorIndex::create(*collection, IndexOptions());
+
+    SceneOptions options;
+    std::vector<BgraImage> frames;
+    for (int i = 0; i < frameCount; ++i) {
+        frames.push_back(makeScene(makeSignTemplate(i % itemCount), 7000u + i, options));
+    }
+
+    SearchScheduler scheduler(schedulerOptions);
+    const Setting settings[] = {
+        {"general allocator", false, nullptr},
+        {"arena", true, nullptr},
+        {"arena, " + std::to_string(scheduler.workerCount()) + " workers", true, &scheduler},
+    };
+
+    std::printf("%d threads searching %d frames of %dx%d, %d items\n", threadCount, frameCount, options.width,
+                options.height, itemCount);
+    std::printf("%-18s %9s %9s %9s %9s %9s %9s %13s\n", "scratch", "mean ms", "p50 ms", "p99 ms", "max ms",
+                "stddev", "p99-p50", "allocs/search");
+    for (const Setting& setting : settings) {
+        const Run run = searchFrames(frames, *collection, *index, threadCount, rounds, setting);
+        const double p50 = percentile(run.ms, 50);
+        const double p99 = percentile(run.ms, 99);
+        std::printf("%-18s %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f %13.1f\n", setting.name.c_str(),
+                    mean(run.ms), p50, p99, percentile(run.ms, 100), standardDeviation(run.ms), p99 - p50,
+                    static_cast<double>(run.allocations) / std::max(1, run.searches));
+    }
+
+    // Peak scratch per search, as OnDeviceIR reports it.
+    OnDeviceIR onDeviceIR;
+    onDeviceIR.setCollection(collection);
+    std::vector<double> peakKiB;
+    ScratchUsage last;
+    onDeviceIR.setScratchObserver([&peakKiB, &last](const ScratchUsage& usage) {
+        peakKiB.push_back(usage.peakBytes / 1024.0);
+        last = usage;
+    });
+    std::vector<SearchResult> results;
+    for (const BgraImage& image : frames) {
+        onDeviceIR.searchWithVideoFrame({image.pixels.data(), image.width, image.height, image.bytesPerRow()},
+                                        results);
+    }
+    std::printf("\nOnDeviceIR scratch per search: peak p50 %.0f KiB, max %.0f KiB; arena %.0f KiB in %llu system "
+                "allocations, pyramid %.0f KiB\n",
+                percentile(peakKiB, 50), percentile(peakKiB, 100), last.arenaBytes / 1024.0,
+                static_cast<unsigned long long>(last.systemAllocations), last.pyramidBytes / 1024.0);
+    return 0;
+}
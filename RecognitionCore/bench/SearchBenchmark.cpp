@@ -0,0 +1,79 @@
+//
+//  SearchBenchmark.cpp
+//  RecognitionCore
+//
+//  Headless end-to-end search benchmark: builds a collection of synthetic
+//  signs and searches dashcam-like frames containing one of them, with cache
+//  counters per search where the machine offers them.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "PerfCounters.h"
+#include "SyntheticSigns.h"
+#include "rsr/OnDeviceIR.h"
+
+using namespace rsr;
+using namespace rsr::bench;
+
+int main(int argc, char** argv) {
+    const int itemCount = argInt(argc, argv, "--items", 20);
+    const int queryCount = argInt(argc, argv, "--queries", 50);
+
+    Stopwatch stopwatch;
+    auto collection = std::make_shared<Collection>("bench", "Synthetic signs");
+    for (int i = 0; i < itemCount; ++i) {
+        Item item;
+        item.uuid = "item-" + std::to_string(i);
+        item.name = "Sign " + std::to_string(i);
+        const ErrorCode error = collection->addImage(item, "image-" + std::to_string(i),
+                                                     makeSignTemplate(i).toQueryImage());
+        if (error != ErrorCode::SUCCESS) {
+            std::fprintf(stderr, "reference %d rejected: %s\n", i, errorCodeName(error));
+        }
+    }
+    const double buildMs = stopwatch.elapsedMs();
+
+    OnDeviceIR onDeviceIR;
+    onDeviceIR.setCollection(collection);
+
+    std::vector<QueryImage> queries;
+    std::vector<int> expected;
+    for (int q = 0; q < queryCount; ++q) {
+        const int id = q % itemCount;
+        queries.push_back(makeScene(makeSignTemplate(id), 1000u + q).toQueryImage());
+        expected.push_back(id);
+    }
+
+    std::vector<double> latencies;
+    std::vector<SearchResult> results;
+    PerfCounters counters;
+    int correct = 0;
+    int failed = 0;
+    for (int q = 0; q < queryCount; ++q) {
+        stopwatch.restart();
+        counters.start();
+        const ErrorCode error = onDeviceIR.searchWithImage(queries[q], results);
+        counters.stop();
+        latencies.push_back(stopwatch.elapsedMs());
+        if (error != ErrorCode::SUCCESS) {
+            ++failed;
+        } else if (!results.empty() && results[0].item.uuid == "item-" + std::to_string(expected[q])) {
+            ++correct;
+        }
+    }
+
+    std::printf("collection: %d items built in %.1f ms\n", itemCount, buildMs);
+    std::printf("queries:    %d (%d failed)\n", queryCount, failed);
+    std::printf("latency:    mean %.2f ms  p50 %.2f ms  p95 %.2f ms\n", mean(latencies),
+                percentile(latencies, 50), percentile(latencies, 95));
+    std::printf("top-1:      %.1f%%\n", 100.0 * correct / std::max(1, queryCount));
+    std::printf("per query:  %s\n", counters.summary(std::max(1, queryCount)).c_str());
+    return 0;
+}
@@ -0,0 +1,110 @@
+//
+//  StatsBenchmark.cpp
+//  RecognitionCore
+//
+//  Cost of the search stats: a histogram record on its own, the timing a
+//  search adds, dashcam frame searches with stats on and off in alternating
+//  rounds, and a snapshot.
+//  Then runs some asynchronous searches, so that queueing and callbacks are
+//  timed too, and prints the snapshot as JSON.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "SyntheticSigns.h"
+#include "rsr/OnDeviceIR.h"
+
+using namespace rsr;
+using namespace rsr::bench;
+
+int main(int argc, char** argv) {
+    const int itemCount = argInt(argc, argv, "--items", 20);
+    const int frameCount = argInt(argc, argv, "--frames", 20);
+    const int rounds = argInt(argc, argv, "--rounds", 6);
+
+    auto collection = std::make_shared<Collection>("bench", "Synthetic signs");
+    for (int i = 0; i < itemCount; ++i) {
+        Item item;
+        item.uuid = "item-" + std::to_string(i);
+        collection->addImage(item, "image-" + std::to_string(i), makeSignTemplate(i).toQueryImage());
+    }
+    std::vector<BgraImage> frames;
+    for (int i = 0; i < frameCount; ++i) {
+        frames.push_back(makeScene(makeSignTemplate(i % itemCount), 9000u + i));
+    }
+    auto frameOf = [&frames](int i) {
+        const BgraImage& image = frames[i];
+        return VideoFrame{image.pixels.data(), image.width, image.height, image.bytesPerRow()};
+    };
+
+    const int records = 10000000;
+    LatencyHistogram histogram;
+    Stopwatch recordClock;
+    for (int i = 0; i < records; ++i) {
+        histogram.record((i & 1023) * 0.05);
+    }
+    std::printf("record: %.1f ns\n", recordClock.elapsedMs() * 1e6 / records);
+
+    // What a frame search adds: a timer lapped at each stage and an outcome.
+    SearchStats stats;
+    const int timed = 1000000;
+    Stopwatch timerClock;
+    for (int i = 0; i < timed; ++i) {
+        StageTimer timer(&stats);
+        timer.lap(SearchStage::PREPROCESS);
+        timer.lap(SearchStage::EXTRACT);
+        timer.lap(SearchStage::MATCH);
+        timer.lap(SearchStage::VERIFY);
+        stats.countOutcome(ErrorCode::SUCCESS);
+    }
+    std::printf("per search: %.1f ns\n", timerClock.elapsedMs() * 1e6 / timed);
+
+    OnDeviceIR onDeviceIR;
+    onDeviceIR.setCollection(collection);
+    std::vector<SearchResult> results;
+    onDeviceIR.searchWithVideoFrame(frameOf(0), results);  // Warm up the scratch buffers.
+
+    // Rounds alternate so that drift in the machine's speed hits both alike.
+    std::vector<double> on, off;
+    for (int round = 0; round < rounds; ++round) {
+        const bool enabled = round % 2 == 0;
+        onDeviceIR.stats().setEnabled(enabled);
+        for (int i = 0; i < frameCount; ++i) {
+            Stopwatch stopwatch;
+            onDeviceIR.searchWithVideoFrame(frameOf(i), results);
+            (enabled ? on : off).push_back(stopwatch.elapsedMs());
+        }
+    }
+    std::printf("%d searches of %dx%d frames each way, %d items\n", frameCount * rounds / 2, frames[0].width,
+                frames[0].height, itemCount);
+    std::printf("%-10s %9s %9s %9s\n", "stats", "mean ms", "p50 ms", "p99 ms");
+    std::printf("%-10s %9.3f %9.3f %9.3f\n", "off", mean(off), percentile(off, 50), percentile(off, 99));
+    std::printf("%-10s %9.3f %9.3f %9.3f\n", "on", mean(on), percentile(on, 50), percentile(on, 99));
+    std::printf("overhead: %+.2f%% of the mean\n", (mean(on) / mean(off) - 1.0) * 100.0);
+
+    onDeviceIR.stats().setEnabled(true);
+    for (int i = 0; i < frameCount; ++i) {
+        onDeviceIR.searchAsync(QueryImage(frameOf(i)), SearchPriority::API, nullptr);
+    }
+    onDeviceIR.searchAsync(QueryImage(frameOf(0)), SearchPriority::API, [](ErrorCode, std::vector<SearchResult>) {});
+    while (onDeviceIR.getCurrentSearchCount() > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    const int snapshots = 1000;
+    Stopwatch snapshotClock;
+    for (int i = 0; i < snapshots; ++i) {
+        onDeviceIR.statsSnapshot();
+    }
+    std::printf("snapshot: %.1f us\n\n", snapshotClock.elapsedMs() * 1000.0 / snapshots);
+    std::printf("%s\n", onDeviceIR.statsSnapshot().toJson().c_str());
+    return 0;
+}
@@ -0,0 +1,249 @@
+//
+//  SuiteBenchmark.cpp
+//  RecognitionCore
+//
+//  Benchmark suite over a synthetic road-sign collection: pictogram, plain
+//  shape and text signs in turn, searched in scenes with one degradation at a
+//  time (blur, perspective, noise, occlusion). Measures building, writing and
+//  loading the collection, then per condition and per sign family the search
+//  latency percentiles, throughput and top-1 accuracy. Prints a table, and
+//  with --json <path> also writes the results as JSON with stable keys so that
+//  runs can be diffed; --json - writes the JSON to stdout instead of the table.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "SyntheticSigns.h"
+#include "rsr/DescriptorIndex.h"
+#include "rsr/OnDeviceIR.h"
+
+using namespace rsr;
+using namespace rsr::bench;
+
+namespace {
+
+constexpr int kFamilyCount = 3;
+const SignFamily kFamilies[kFamilyCount] = {SignFamily::PICTOGRAM, SignFamily::SHAPE, SignFamily::TEXT};
+
+struct Condition {
+    const char* name;
+    SceneOptions scene;
+};
+
+std::vector<Condition> conditions() {
+    std::vector<Condition> list;
+    SceneOptions clean;
+    clean.maxRotation = 0.0f;
+    clean.maxPerspective = 0.0f;
+    clean.noise = 0.0f;
+    list.push_back({"clean", clean});
+    list.push_back({"default", SceneOptions()});
+    const struct {
+        const char* name;
+        float SceneOptions::*field;
+        float value;
+    } degradations[] = {
+        {"blur_1.5", &SceneOptions::blur, 1.5f},
+        {"blur_3", &SceneOptions::blur, 3.0f},
+        {"perspective_0.3", &SceneOptions::maxPerspective, 0.3f},
+        {"perspective_0.5", &SceneOptions::maxPerspective, 0.5f},
+        {"noise_15", &SceneOptions::noise, 15.0f},
+        {"noise_30", &SceneOptions::noise, 30.0f},
+        {"occlusion_0.25", &SceneOptions::occlusion, 0.25f},
+        {"occlusion_0.5", &SceneOptions::occlusion, 0.5f},
+    };
+    for (const auto& degradation : degradations) {
+        SceneOptions scene = clean;
+        scene.*degradation.field = degradation.value;
+        list.push_back({degradation.name, scene});
+    }
+    return list;
+}
+
+struct Result {
+    std::vector<double> latencies;
+    int queries = 0;
+    int correct = 0;
+    int failed = 0;
+
+    void add(const Result& other) {
+        latencies.insert(latencies.end(), other.latencies.begin(), other.latencies.end());
+        queries += other.queries;
+        correct += other.correct;
+        failed += other.failed;
+    }
+
+    double total() const {
+        double sum = 0.0;
+        for (double latency : latencies) {
+            sum += latency;
+        }
+        return sum;
+    }
+
+    std::string json() const {
+        char buffer[256];
+        std::snprintf(buffer, sizeof(buffer),
+                      "{\"queries\":%d,\"failed\":%d,\"top1\":%.4f,\"p50_ms\":%.3f,\"p90_ms\":%.3f,"
+                      "\"p99_ms\":%.3f,\"queries_per_second\":%.2f}",
+                      queries, failed, queries > 0 ? static_cast<double>(correct) / queries : 0.0,
+                      percentile(latencies, 50), percentile(latencies, 90), percentile(latencies, 99),
+                      total() > 0.0 ? queries * 1000.0 / total() : 0.0);
+        return buffer;
+    }
+};
+
+const char* jsonPath(int argc, char** argv) {
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], "--json") == 0) {
+            return argv[i + 1];
+        }
+    }
+    return nullptr;
+}
+
+}
+
+int main(int argc, char** argv) {
+    const int itemCount = std::max(1, argInt(argc, argv, "--items", 30));
+    const int queryCount = argInt(argc, argv, "--queries", 30);
+    const char* json = jsonPath(argc, argv);
+    const bool table = !json || std::strcmp(json, "-") != 0;
+
+    // Item i is sign i / 3 of family i % 3.
+    Stopwatch stopwatch;
+    auto built = std::make_shared<Collection>("bench", "Synthetic signs");
+    std::vector<BgraImage> signs;
+    for (int i = 0; i < itemCount; ++i) {
+        signs.push_back(makeSign(kFamilies[i % kFamilyCount], i / kFamilyCount));
+        Item item;
+        item.uuid = "item-" + std::to_string(i);
+        const ErrorCode error = built->addImage(item, "image-" + std::to_string(i), signs.back().toQueryImage());
+        if (error != ErrorCode::SUCCESS) {
+            std::fprintf(stderr, "reference %d rejected: %s\n", i, errorCodeName(error));
+        }
+    }
+    const double buildMs = stopwatch.elapsedMs();
+
+    stopwatch.restart();
+    {
+        OnDeviceIR indexer;
+        indexer.setCollection(built);
+    }
+    const double indexMs = stopwatch.elapsedMs();
+
+    const std::string path = "/tmp/rsr_bench_suite.collection";
+    stopwatch.restart();
+    if (built->write(path, IndexOptions()) != ErrorCode::SUCCESS) {
+        std::fprintf(stderr, "cannot write %s\n", path.c_str());
+        return 1;
+    }
+    const double writeMs = stopwatch.elapsedMs();
+
+    stopwatch.restart();
+    std::shared_ptr<const Collection> collection;
+    if (Collection::open(path, collection) != ErrorCode::SUCCESS) {
+        std::fprintf(stderr, "cannot open %s\n", path.c_str());
+        return 1;
+    }
+    OnDeviceIR onDeviceIR;
+    onDeviceIR.setCollection(collection);
+    const double loadMs = stopwatch.elapsedMs();
+
+    std::vector<SearchResult> results;
+    stopwatch.restart();
+    onDeviceIR.searchWithImage(makeScene(signs[0], 1u).toQueryImage(), results);
+    const double firstSearchMs = stopwatch.elapsedMs();
+
+    const std::vector<Condition> list = conditions();
+    std::vector<Result> byCondition(list.size());
+    std::vector<std::vector<Result>> byFamily(list.size(), std::vector<Result>(kFamilyCount));
+    Result overall;
+    for (size_t c = 0; c < list.size(); ++c) {
+        for (int q = 0; q < queryCount; ++q) {
+            const int id = (q * 7 + static_cast<int>(c)) % itemCount;
+            const QueryImage query = makeScene(signs[id], 5000u + static_cast<uint32_t>(c * 1000 + q),
+                                               list[c].scene).toQueryImage();
+            Result& result = byFamily[c][id % kFamilyCount];
+            stopwatch.restart();
+            const ErrorCode error = onDeviceIR.searchWithImage(query, results);
+            result.latencies.push_back(stopwatch.elapsedMs());
+            ++result.queries;
+            if (error != ErrorCode::SUCCESS) {
+                ++result.failed;
+            } else if (!results.empty() && results[0].item.uuid == "item-" + std::to_string(id)) {
+                ++result.correct;
+            }
+        }
+        for (const Result& family : byFamily[c]) {
+            byCondition[c].add(family);
+        }
+        overall.add(byCondition[c]);
+    }
+    std::remove(path.c_str());
+
+    if (table) {
+        std::printf("collection: %d items, templates %.1f ms, index %.1f ms, write %.1f ms, load %.1f ms, "
+                    "first search %.1f ms\n",
+                    itemCount, buildMs, indexMs, writeMs, loadMs, firstSearchMs);
+        std::printf("%-16s %7s %8s %8s %8s %9s %7s", "condition", "queries", "p50 ms", "p90 ms", "p99 ms",
+                    "queries/s", "top-1");
+        for (SignFamily family : kFamilies) {
+            std::printf(" %9s", signFamilyName(family));
+        }
+        std::printf("\n");
+        for (size_t c = 0; c <= list.size(); ++c) {
+            const Result& result = c < list.size() ? byCondition[c] : overall;
+            const double total = result.total();
+            std::printf("%-16s %7d %8.2f %8.2f %8.2f %9.2f %6.1f%%", c < list.size() ? list[c].name : "all",
+                        result.queries, percentile(result.latencies, 50), percentile(result.latencies, 90),
+                        percentile(result.latencies, 99), total > 0.0 ? result.queries * 1000.0 / total : 0.0,
+                        100.0 * result.correct / std::max(1, result.queries));
+            for (int f = 0; f < kFamilyCount && c < list.size(); ++f) {
+                const Result& family = byFamily[c][f];
+                std::printf(" %8.1f%%", 100.0 * family.correct / std::max(1, family.queries));
+            }
+            std::printf("\n");
+        }
+    }
+
+    if (json) {
+        std::string out = "{\"items\":" + std::to_string(itemCount) +
+                          ",\"queries_per_condition\":" + std::to_string(queryCount);
+        char timings[256];
+        std::snprintf(timings, sizeof(timings),
+                      ",\"collection\":{\"templates_ms\":%.3f,\"index_ms\":%.3f,\"write_ms\":%.3f,\"load_ms\":%.3f,"
+                      "\"first_search_ms\":%.3f}",
+                      buildMs, indexMs, writeMs, loadMs, firstSearchMs);
+        out += timings;
+        out += ",\"conditions\":{";
+        for (size_t c = 0; c < list.size(); ++c) {
+            out += std::string(c > 0 ? "," : "") + "\"" + list[c].name + "\":" + byCondition[c].json();
+            out.insert(out.size() - 1, ",\"families\":{");
+            for (int f = 0; f < kFamilyCount; ++f) {
+                out.insert(out.size() - 1, std::string(f > 0 ? "," : "") + "\"" + signFamilyName(kFamilies[f]) +
+                                               "\":" + byFamily[c][f].json());
+            }
+            out.insert(out.size() - 1, "}");
+        }
+        out += "},\"overall\":" + overall.json() + "}\n";
+        FILE* file = table ? std::fopen(json, "w") : stdout;
+        if (!file) {
+            std::fprintf(stderr, "cannot write %s\n", json);
+            return 1;
+        }
+        std::fputs(out.c_str(), file);
+        if (file != stdout) {
+            std::fclose(file);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,175 @@
+//
+//  SyncBenchmark.cpp
+//  RecognitionCore
+//
+//  Delta sync of a loaded collection against a local catalogue server when
+//  1%, 10% and 100% of its items change, next to downloading the whole
+//  catalogue again. A search thread keeps querying the collection during
+//  every sync to show that searches are served throughout.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "CatalogueServer.h"
+#include "SyntheticSigns.h"
+#include "rsr/CollectionSync.h"
+#include "rsr/OnDeviceIR.h"
+
+using namespace rsr;
+using namespace rsr::bench;
+
+namespace {
+
+constexpr const char* kCatalogueUUID = "sync-bench";
+
+FeatureSet extractSign(const FeatureExtractor& extractor, int templateId) {
+    FeatureSet features;
+    extractor.extract(makeSignTemplate(templateId).toQueryImage().toGray(), features);
+    return features;
+}
+
+// Catalogue with item-<i> showing template versions[i].
+std::shared_ptr<const Collection> makeCatalogue(const std::vector<int>& versions,
+                                                const std::vector<FeatureSet>& features) {
+    auto catalogue = std::make_shared<Collection>(kCatalogueUUID, "Sync benchmark");
+    for (size_t i = 0; i < versions.size(); ++i) {
+        const std::string n = std::to_string(i);
+        catalogue->addImageFeatures(Item{"item-" + n, "Sign " + n, "", ""}, "image-" + n, features[i]);
+    }
+    return catalogue;
+}
+
+struct SearchLoad {
+    std::atomic<bool> running{true};
+    std::atomic<int> searches{0};
+    std::atomic<int> failures{0};
+    std::atomic<double> worstMs{0.0};
+};
+
+void searchContinuously(OnDeviceIR& onDeviceIR, const BgraImage& scene, SearchLoad& load) {
+    const VideoFrame frame{scene.pixels.data(), scene.width, scene.height, scene.bytesPerRow()};
+    while (load.running) {
+        Stopwatch stopwatch;
+        std::vector<SearchResult> results;
+        if (onDeviceIR.searchWithVideoFrame(frame, results) != ErrorCode::SUCCESS) {
+            ++load.failures;
+        }
+        const double ms = stopwatch.elapsedMs();
+        if (ms > load.worstMs) {
+            load.worstMs = ms;
+        }
+        ++load.searches;
+    }
+}
+
+bool inStep(const OnDeviceIR& onDeviceIR, const Collection& catalogue) {
+    const std::shared_ptr<const Collection> local = onDeviceIR.getCollection(kCatalogueUUID);
+    return local && CollectionManifest::describe(*local).serialize() ==
+                        CollectionManifest::describe(catalogue).serialize();
+}
+
+}
+
+int main(int argc, char** argv) {
+    const int itemCount = argInt(argc, argv, "--items", 200);
+    const FeatureExtractor extractor(Collection::referenceExtractorOptions());
+
+    std::vector<int> versions(itemCount);
+    std::iota(versions.begin(), versions.end(), 0);
+    std::vector<FeatureSet> features;
+    for (int i = 0; i < itemCount; ++i) {
+        features.push_back(extractSign(extractor, i));
+    }
+    const std::shared_ptr<const Collection> base = makeCatalogue(versions, features);
+
+    CatalogueServer server;
+    if (!server.start()) {
+        std::perror("catalogue server");
+        return 1;
+    }
+    server.setCatalogue(base);
+    std::printf("%d items, %zu features, catalogue server at %s\n", itemCount, base->descriptors().size(),
+                server.url().c_str());
+
+    const BgraImage scene = makeScene(makeSignTemplate(0), 1000u);
+    std::printf("%-8s %8s %10s %10s %12s %12s %10s %10s %8s\n", "changed", "fetched", "errors", "KB", "sync ms",
+                "full ms", "searches", "worst ms", "in step");
+
+    std::mt19937 random(7);
+    int status = 0;
+    for (const double fraction : {0.01, 0.10, 1.00}) {
+        // Every round starts from the base catalogue, loaded by a first full sync.
+        OnDeviceIR onDeviceIR;
+        CollectionSync sync(onDeviceIR, server.url());
+        server.setCatalogue(base);
+        SyncReport report;
+        ErrorCode error = sync.sync(report);
+
+        std::vector<int> order(itemCount);
+        std::iota(order.begin(), order.end(), 0);
+        std::shuffle(order.begin(), order.end(), random);
+        const int changes = std::max(1, static_cast<int>(itemCount * fraction + 0.5));
+        std::vector<int> changedVersions = versions;
+        std::vector<FeatureSet> changedFeatures = features;
+        for (int i = 0; i < changes; ++i) {
+            const int item = order[i];
+            changedVersions[item] = item + 100000;
+            changedFeatures[item] = extractSign(extractor, changedVersions[item]);
+        }
+        const std::shared_ptr<const Collection> catalogue = makeCatalogue(changedVersions, changedFeatures);
+        server.setCatalogue(catalogue);
+
+        SearchLoad load;
+        std::thread searcher(searchContinuously, std::ref(onDeviceIR), std::cref(scene), std::ref(load));
+        // Let the search thread get going before the sync starts.
+        while (load.searches == 0) {
+            std::this_thread::yield();
+        }
+        const int searchesBefore = load.searches;
+        const size_t sentBefore = server.bytesSent();
+        Stopwatch stopwatch;
+        if (error == ErrorCode::SUCCESS) {
+            error = sync.sync(report);
+        }
+        const double syncMs = stopwatch.elapsedMs();
+        const double kilobytes = (server.bytesSent() - sentBefore) / 1024.0;
+        load.running = false;
+        searcher.join();
+        const bool synced = inStep(onDeviceIR, *catalogue);
+
+        // Baseline: a device without the collection downloads all of it.
+        OnDeviceIR fresh;
+        CollectionSync full(fresh, server.url());
+        SyncReport fullReport;
+        stopwatch.restart();
+        if (error == ErrorCode::SUCCESS) {
+            error = full.sync(fullReport);
+        }
+        const double fullMs = stopwatch.elapsedMs();
+
+        if (error != ErrorCode::SUCCESS) {
+            std::fprintf(stderr, "sync failed: %s\n", errorCodeName(error));
+            status = 1;
+            break;
+        }
+        char label[16];
+        std::snprintf(label, sizeof(label), "%.0f%%", fraction * 100.0);
+        std::printf("%-8s %8d %10d %10.1f %12.1f %12.1f %10d %10.1f %8s\n", label, report.itemDownloads,
+                    report.downloadErrors, kilobytes, syncMs, fullMs, load.searches - searchesBefore,
+                    load.worstMs.load(), synced && load.failures == 0 ? "yes" : "no");
+        status |= synced && load.failures == 0 ? 0 : 1;
+    }
+    server.stop();
+    return status;
+}
@@ -0,0 +1,696 @@
+//
+//  SyntheticSigns.cpp
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "SyntheticSigns.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+
+#include "rsr/Bundle.h"
+
+namespace rsr {
+namespace bench {
+
+namespace {
+
+constexpr float kPi = 3.14159265358979f;
+
+struct Color {
+    uint8_t b, g, r;
+};
+
+const Color kWhite = {255, 255, 255};
+const Color kBlack = {20, 20, 20};
+const Color kRed = {40, 30, 200};
+const Color kBlue = {170, 80, 20};
+const Color kYellow = {30, 200, 240};
+
+bool insidePolygon(const std::vector<Point2f>& polygon, float x, float y) {
+    bool inside = false;
+    for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+        const Point2f& a = polygon[i];
+        const Point2f& b = polygon[j];
+        if ((a.y > y) != (b.y > y) && x < (b.x - a.x) * (y - a.y) / (b.y - a.y) + a.x) {
+            inside = !inside;
+        }
+    }
+    return inside;
+}
+
+void put(BgraImage& image, int x, int y, const Color& c) {
+    uint8_t* p = image.pixel(x, y);
+    p[0] = c.b;
+    p[1] = c.g;
+    p[2] = c.r;
+    p[3] = 255;
+}
+
+void fillPolygon(BgraImage& image, const std::vector<Point2f>& polygon, const Color& color) {
+    float minX = 1e9f, minY = 1e9f, maxX = -1e9f, maxY = -1e9f;
+    for (const Point2f& p : polygon) {
+        minX = std::min(minX, p.x);
+        minY = std::min(minY, p.y);
+        maxX = std::max(maxX, p.x);
+        maxY = std::max(maxY, p.y);
+    }
+    const int x0 = std::max(0, static_cast<int>(minX));
+    const int y0 = std::max(0, static_cast<int>(minY));
+    const int x1 = std::min(image.width - 1, static_cast<int>(maxX) + 1);
+    const int y1 = std::min(image.height - 1, static_cast<int>(maxY) + 1);
+    for (int y = y0; y <= y1; ++y) {
+        for (int x = x0; x <= x1; ++x) {
+            if (insidePolygon(polygon, x + 0.5f, y + 0.5f)) {
+                put(image, x, y, color);
+            }
+        }
+    }
+}
+
+void fillCircle(BgraImage& image, float cx, float cy, float radius, const Color& color) {
+    const int x0 = std::max(0, static_cast<int>(cx - radius));
+    const int y0 = std::max(0, static_cast<int>(cy - radius));
+    const int x1 = std::min(image.width - 1, static_cast<int>(cx + radius) + 1);
+    const int y1 = std::min(image.height - 1, static_cast<int>(cy + radius) + 1);
+    for (int y = y0; y <= y1; ++y) {
+        for (int x = x0; x <= x1; ++x) {
+            const float dx = x + 0.5f - cx;
+            const float dy = y + 0.5f - cy;
+            if (dx * dx + dy * dy <= radius * radius) {
+                put(image, x, y, color);
+            }
+        }
+    }
+}
+
+std::vector<Point2f> regularPolygon(float cx, float cy, float radius, int sides, float rotation) {
+    std::vector<Point2f> polygon;
+    for (int i = 0; i < sides; ++i) {
+        const float a = rotation + i * 2.0f * kPi / sides;
+        polygon.push_back({cx + radius * std::cos(a), cy + radius * std::sin(a)});
+    }
+    return polygon;
+}
+
+// Random black glyphs inside a box: the pictogram that tells signs apart.
+void drawPictogram(BgraImage& image, std::mt19937& rng, float cx, float cy, float extent, const Color& ink) {
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    const int shapes = 7 + static_cast<int>(unit(rng) * 6);
+    for (int s = 0; s < shapes; ++s) {
+        const float x = cx + (unit(rng) - 0.5f) * extent;
+        const float y = cy + (unit(rng) - 0.5f) * extent;
+        const float size = extent * (0.08f + 0.14f * unit(rng));
+        const Color& color = unit(rng) < 0.8f ? ink : kWhite;
+        switch (static_cast<int>(unit(rng) * 3)) {
+            case 0: {
+                const int sides = 3 + static_cast<int>(unit(rng) * 4);
+                std::vector<Point2f> polygon;
+                for (int i = 0; i < sides; ++i) {
+                    const float a = i * 2.0f * kPi / sides + unit(rng) * 0.8f;
+                    const float r = size * (0.5f + 0.5f * unit(rng));
+                    polygon.push_back({x + r * std::cos(a), y + r * std::sin(a)});
+                }
+                fillPolygon(image, polygon, color);
+                break;
+            }
+            case 1: {
+                const float w = size * (0.3f + unit(rng));
+                const float h = size * (0.3f + unit(rng));
+                fillPolygon(image, {{x - w, y - h}, {x + w, y - h}, {x + w, y + h}, {x - w, y + h}}, color);
+                break;
+            }
+            default:
+                fillCircle(image, x, y, size * 0.6f, color);
+                break;
+        }
+    }
+}
+
+uint8_t clampByte(float v) {
+    return static_cast<uint8_t>(std::max(0.0f, std::min(255.0f, v)));
+}
+
+}
+
+BgraImage makeSignTemplate(int id, int size) {
+    BgraImage sign(size, size);
+    std::mt19937 rng(static_cast<uint32_t>(id) * 2654435761u + 17u);
+    const float c = size * 0.5f;
+    switch (id % 3) {
+        case 0:
+            fillCircle(sign, c, c, size * 0.48f, kRed);
+            fillCircle(sign, c, c, size * 0.38f, kWhite);
+            drawPictogram(sign, rng, c, c, size * 0.5f, kBlack);
+            break;
+        case 1: {
+            fillPolygon(sign, regularPolygon(c, c * 1.15f, size * 0.55f, 3, -kPi / 2.0f), kRed);
+            fillPolygon(sign, regularPolygon(c, c * 1.15f, size * 0.40f, 3, -kPi / 2.0f), kYellow);
+            drawPictogram(sign, rng, c, c * 1.2f, size * 0.3f, kBlack);
+            break;
+        }
+        default:
+            fillPolygon(sign, {{4.0f, 4.0f}, {size - 4.0f, 4.0f}, {size - 4.0f, size - 4.0f}, {4.0f, size - 4.0f}},
+                        kBlue);
+            drawPictogram(sign, rng, c, c, size * 0.6f, kWhite);
+            break;
+    }
+    return sign;
+}
+
+namespace {
+
+const Color kGreen = {60, 110, 0};
+
+// 5x7 capitals and digits, one row per byte with the leftmost column in bit 4.
+const uint8_t kFont[36][7] = {
+    {0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E}, {0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E},
+    {0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F}, {0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E},
+    {0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02}, {0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E},
+    {0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E}, {0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08},
+    {0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E}, {0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C},
+    {0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}, {0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E},
+    {0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E}, {0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C},
+    {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F}, {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10},
+    {0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F}, {0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11},
+    {0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E}, {0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C},
+    {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11}, {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F},
+    {0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11}, {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11},
+    {0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}, {0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10},
+    {0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D}, {0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11},
+    {0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E}, {0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04},
+    {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}, {0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04},
+    {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A}, {0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11},
+    {0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04}, {0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F},
+};
+
+// Glyph index of a digit or capital; anything else is a space.
+int glyphOf(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'A' && c <= 'Z') {
+        return 10 + c - 'A';
+    }
+    return -1;
+}
+
+// Text centred on (cx, cy) with cells of the given size in pixels.
+void drawText(BgraImage& image, const std::string& text, float cx, float cy, float cell, const Color& ink) {
+    const float advance = cell * 6.0f;
+    float x = cx - (advance * text.size() - cell) / 2.0f;
+    const float y = cy - cell * 3.5f;
+    for (char c : text) {
+        const int glyph = glyphOf(c);
+        for (int row = 0; glyph >= 0 && row < 7; ++row) {
+            for (int column = 0; column < 5; ++column) {
+                if (kFont[glyph][row] & (0x10 >> column)) {
+                    const float left = x + column * cell;
+                    const float top = y + row * cell;
+                    fillPolygon(image, {{left, top}, {left + cell, top}, {left + cell, top + cell}, {left, top + cell}},
+                                ink);
+                }
+            }
+        }
+        x += advance;
+    }
+}
+
+BgraImage makeShapeSign(int id, int size) {
+    BgraImage sign(size, size);
+    std::mt19937 rng(static_cast<uint32_t>(id) * 2246822519u + 5u);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    const float c = size * 0.5f;
+    const Color rims[] = {kRed, kBlue, kBlack};
+    const Color& rim = rims[id % 3];
+    const int sides = id / 3 % 3 == 0 ? 0 : (id / 3 % 3 == 1 ? 4 : 8);
+    if (sides == 0) {
+        fillCircle(sign, c, c, size * 0.48f, rim);
+        fillCircle(sign, c, c, size * 0.40f, kWhite);
+    } else {
+        const float rotation = sides == 4 ? kPi / 4.0f : kPi / 8.0f;
+        fillPolygon(sign, regularPolygon(c, c, size * 0.50f, sides, rotation), rim);
+        fillPolygon(sign, regularPolygon(c, c, size * 0.42f, sides, rotation), kWhite);
+    }
+    // One bold symbol: a bar, an arrow or a ring, at an angle set by the id.
+    const float angle = unit(rng) * kPi;
+    const float along = size * 0.28f;
+    const float across = size * (0.05f + 0.04f * unit(rng));
+    const float dx = std::cos(angle), dy = std::sin(angle);
+    switch (id / 9 % 3) {
+        case 0:
+            fillPolygon(sign, {{c - dx * along - dy * across, c - dy * along + dx * across},
+                               {c + dx * along - dy * across, c + dy * along + dx * across},
+                               {c + dx * along + dy * across, c + dy * along - dx * across},
+                               {c - dx * along + dy * across, c - dy * along - dx * across}},
+                        rim);
+            break;
+        case 1:
+            fillPolygon(sign, {{c - dx * along - dy * across, c - dy * along + dx * across},
+                               {c + dx * along * 0.3f - dy * across, c + dy * along * 0.3f + dx * across},
+                               {c + dx * along * 0.3f - dy * across * 3, c + dy * along * 0.3f + dx * across * 3},
+                               {c + dx * along, c + dy * along},
+                               {c + dx * along * 0.3f + dy * across * 3, c + dy * along * 0.3f - dx * across * 3},
+                               {c + dx * along * 0.3f + dy * across, c + dy * along * 0.3f - dx * across},
+                               {c - dx * along + dy * across, c - dy * along - dx * across}},
+                        kBlack);
+            break;
+        default:
+            fillCircle(sign, c + dx * size * 0.08f, c + dy * size * 0.08f, size * 0.2f, rim);
+            fillCircle(sign, c + dx * size * 0.08f, c + dy * size * 0.08f, size * 0.2f - across, kWhite);
+            break;
+    }
+    return sign;
+}
+
+BgraImage makeTextSign(int id, int size) {
+    BgraImage sign(size * 3 / 2, size);
+    std::mt19937 rng(static_cast<uint32_t>(id) * 3266489917u + 11u);
+    std::uniform_int_distribution<int> letter(0, 25);
+    std::uniform_int_distribution<int> digit(0, 9);
+    const Color& panel = id % 2 == 0 ? kGreen : kBlue;
+    const float w = static_cast<float>(sign.width);
+    const float h = static_cast<float>(sign.height);
+    fillPolygon(sign, {{2.0f, 2.0f}, {w - 2.0f, 2.0f}, {w - 2.0f, h - 2.0f}, {2.0f, h - 2.0f}}, kWhite);
+    fillPolygon(sign, {{8.0f, 8.0f}, {w - 8.0f, 8.0f}, {w - 8.0f, h - 8.0f}, {8.0f, h - 8.0f}}, panel);
+
+    // A place name over a distance, as on a direction sign.
+    std::string name;
+    const int length = 4 + id % 4;
+    for (int i = 0; i < length; ++i) {
+        name.push_back(static_cast<char>('A' + letter(rng)));
+    }
+    std::string distance = std::to_string(1 + digit(rng)) + std::to_string(digit(rng)) + " KM";
+    const float cell = std::min(w * 0.8f / (6.0f * length), h * 0.09f);
+    drawText(sign, name, w * 0.5f, h * 0.33f, cell, kWhite);
+    drawText(sign, distance, w * 0.5f, h * 0.70f, cell, kWhite);
+    return sign;
+}
+
+BgraImage makeSpeedLimitSign(int id, int size) {
+    BgraImage sign(size, size);
+    const float c = size * 0.5f;
+    fillCircle(sign, c, c, size * 0.48f, kRed);
+    fillCircle(sign, c, c, size * 0.38f, kWhite);
+    const char* words[] = {"", "ZONE", "END", "MAX"};
+    const char* word = words[id / 13 % 4];
+    const float cell = size * 0.035f;
+    drawText(sign, std::to_string(10 * (1 + id % 13)), c, word[0] ? c - cell * 2.5f : c, cell, kBlack);
+    drawText(sign, word, c, c + cell * 4.0f, cell * 0.6f, kBlack);
+    return sign;
+}
+
+}
+
+const char* signFamilyName(SignFamily family) {
+    switch (family) {
+        case SignFamily::PICTOGRAM: return "pictogram";
+        case SignFamily::SHAPE: return "shape";
+        case SignFamily::TEXT: return "text";
+        case SignFamily::SPEED_LIMIT: return "speed_limit";
+    }
+    return "";
+}
+
+BgraImage makeSign(SignFamily family, int id, int size) {
+    switch (family) {
+        case SignFamily::PICTOGRAM: return makeSignTemplate(id, size);
+        case SignFamily::SHAPE: return makeShapeSign(id, size);
+        case SignFamily::TEXT: return makeTextSign(id, size);
+        case SignFamily::SPEED_LIMIT: return makeSpeedLimitSign(id, size);
+    }
+    return BgraImage();
+}
+
+namespace {
+
+// Road, sky and roadside clutter.
+BgraImage makeBackground(std::mt19937& rng, const SceneOptions& options) {
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    BgraImage frame(options.width, options.height);
+    for (int y = 0; y < frame.height; ++y) {
+        const float shade = y < frame.height / 2 ? 190.0f - 60.0f * y / frame.height : 90.0f;
+        for (int x = 0; x < frame.width; ++x) {
+            uint8_t* p = frame.pixel(x, y);
+            p[0] = clampByte(shade + 20.0f);
+            p[1] = clampByte(shade);
+            p[2] = clampByte(shade - 10.0f);
+            p[3] = 255;
+        }
+    }
+    for (int i = 0; i < 40; ++i) {
+        const float x = unit(rng) * frame.width;
+        const float y = unit(rng) * frame.height;
+        const float w = 10.0f + unit(rng) * 120.0f;
+        const float h = 10.0f + unit(rng) * 120.0f;
+        const Color color = {clampByte(unit(rng) * 255), clampByte(unit(rng) * 255), clampByte(unit(rng) * 255)};
+        fillPolygon(frame, {{x, y}, {x + w, y}, {x + w, y + h}, {x, y + h}}, color);
+    }
+    return frame;
+}
+
+// Warps the sign onto the quad (clockwise from its top left corner) with bilinear sampling.
+void pasteSign(BgraImage& frame, const BgraImage& sign, const Point2f quad[4], Homography* placement) {
+    const Point2f corners[4] = {
+        {0.0f, 0.0f}, {static_cast<float>(sign.width), 0.0f},
+        {static_cast<float>(sign.width), static_cast<float>(sign.height)}, {0.0f, static_cast<float>(sign.height)},
+    };
+    Homography toSign;
+    fitHomography(quad, corners, 4, toSign);
+    if (placement) {
+        fitHomography(corners, quad, 4, *placement);
+    }
+
+    float minX = 1e9f, minY = 1e9f, maxX = -1e9f, maxY = -1e9f;
+    for (int i = 0; i < 4; ++i) {
+        minX = std::min(minX, quad[i].x);
+        minY = std::min(minY, quad[i].y);
+        maxX = std::max(maxX, quad[i].x);
+        maxY = std::max(maxY, quad[i].y);
+    }
+    for (int y = std::max(0, static_cast<int>(minY)); y <= std::min(frame.height - 1, static_cast<int>(maxY)); ++y) {
+        for (int x = std::max(0, static_cast<int>(minX)); x <= std::min(frame.width - 1, static_cast<int>(maxX)); ++x) {
+            const Point2f s = toSign.map({x + 0.5f, y + 0.5f});
+            const float sx = s.x - 0.5f;
+            const float sy = s.y - 0.5f;
+            if (sx < 0.0f || sy < 0.0f || sx >= sign.width - 1 || sy >= sign.height - 1) {
+                continue;
+            }
+            const int x0 = static_cast<int>(sx);
+            const int y0 = static_cast<int>(sy);
+            const float fx = sx - x0;
+            const float fy = sy - y0;
+            uint8_t* out = frame.pixel(x, y);
+            for (int ch = 0; ch < 3; ++ch) {
+                const float top = sign.pixel(x0, y0)[ch] * (1 - fx) + sign.pixel(x0 + 1, y0)[ch] * fx;
+                const float bottom = sign.pixel(x0, y0 + 1)[ch] * (1 - fx) + sign.pixel(x0 + 1, y0 + 1)[ch] * fx;
+                out[ch] = clampByte(top * (1 - fy) + bottom * fy);
+            }
+        }
+    }
+}
+
+// A dark bar in front of the sign, upright like a pole or level like a
+// branch, covering that fraction of the sign's bounding box.
+void occludeSign(BgraImage& frame, std::mt19937& rng, const Point2f quad[4], float fraction) {
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    float minX = 1e9f, minY = 1e9f, maxX = -1e9f, maxY = -1e9f;
+    for (int i = 0; i < 4; ++i) {
+        minX = std::min(minX, quad[i].x);
+        minY = std::min(minY, quad[i].y);
+        maxX = std::max(maxX, quad[i].x);
+        maxY = std::max(maxY, quad[i].y);
+    }
+    const Color color = {clampByte(30 + unit(rng) * 40), clampByte(40 + unit(rng) * 50),
+                         clampByte(30 + unit(rng) * 40)};
+    if (unit(rng) < 0.5f) {
+        const float width = (maxX - minX) * fraction;
+        const float x = minX + (maxX - minX - width) * unit(rng);
+        fillPolygon(frame, {{x, minY - 4}, {x + width, minY - 4}, {x + width, maxY + 4}, {x, maxY + 4}}, color);
+    } else {
+        const float height = (maxY - minY) * fraction;
+        const float y = minY + (maxY - minY - height) * unit(rng);
+        fillPolygon(frame, {{minX - 4, y}, {maxX + 4, y}, {maxX + 4, y + height}, {minX - 4, y + height}}, color);
+    }
+}
+
+// Three box blurs in a row, about a Gaussian of that standard deviation.
+void blurFrame(BgraImage& frame, float sigma) {
+    const int radius = static_cast<int>((std::sqrt(4.0f * sigma * sigma + 1.0f) - 1.0f) / 2.0f + 0.5f);
+    if (radius <= 0) {
+        return;
+    }
+    const int width = frame.width;
+    const int height = frame.height;
+    std::vector<uint8_t> line(static_cast<size_t>(std::max(width, height)) * 4);
+    // One pass along a line of count pixels, stride apart, clamping at the ends.
+    auto pass = [&](uint8_t* first, int count, size_t stride) {
+        for (int i = 0; i < count; ++i) {
+            std::memcpy(&line[static_cast<size_t>(i) * 4], first + i * stride, 4);
+        }
+        const int window = 2 * radius + 1;
+        for (int ch = 0; ch < 3; ++ch) {
+            int sum = 0;
+            for (int k = -radius; k <= radius; ++k) {
+                sum += line[static_cast<size_t>(std::min(std::max(k, 0), count - 1)) * 4 + ch];
+            }
+            for (int i = 0; i < count; ++i) {
+                first[i * stride + ch] = static_cast<uint8_t>((sum + window / 2) / window);
+                const int leaving = std::max(i - radius, 0);
+                const int entering = std::min(i + radius + 1, count - 1);
+                sum += line[static_cast<size_t>(entering) * 4 + ch] - line[static_cast<size_t>(leaving) * 4 + ch];
+            }
+        }
+    };
+    for (int repeat = 0; repeat < 3; ++repeat) {
+        for (int y = 0; y < height; ++y) {
+            pass(frame.pixel(0, y), width, 4);
+        }
+        for (int x = 0; x < width; ++x) {
+            pass(frame.pixel(x, 0), height, static_cast<size_t>(width) * 4);
+        }
+    }
+}
+
+void addNoise(BgraImage& frame, std::mt19937& rng, float amount) {
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    if (amount > 0.0f) {
+        for (size_t i = 0; i < frame.pixels.size(); ++i) {
+            if ((i & 3) != 3) {
+                frame.pixels[i] = clampByte(frame.pixels[i] + (unit(rng) * 2.0f - 1.0f) * amount);
+            }
+        }
+    }
+}
+
+// Sign corners for a sign of the given size centred at (cx, cy), clockwise from the top left.
+void signQuad(const BgraImage& sign, float cx, float cy, float height, float rotation, float squeeze,
+              Point2f quad[4]) {
+    const float width = height * sign.width / sign.height;
+    const Point2f local[4] = {
+        {-width / 2, -height / 2}, {width / 2, -height / 2 * squeeze},
+        {width / 2, height / 2 * squeeze}, {-width / 2, height / 2},
+    };
+    for (int i = 0; i < 4; ++i) {
+        quad[i].x = cx + local[i].x * std::cos(rotation) - local[i].y * std::sin(rotation);
+        quad[i].y = cy + local[i].x * std::sin(rotation) + local[i].y * std::cos(rotation);
+    }
+}
+
+}
+
+BgraImage makeScene(const BgraImage& sign, uint32_t seed, const SceneOptions& options, Homography* placement) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    BgraImage frame = makeBackground(rng, options);
+
+    // Pose of the sign: size, position (biased to the upper right), in-plane
+    // rotation and a perspective squeeze of one side.
+    const float height = options.height * (options.minSize + (options.maxSize - options.minSize) * unit(rng));
+    const float width = height * sign.width / sign.height;
+    const float cx = options.width * (0.45f + 0.5f * unit(rng));
+    const float cy = options.height * (0.15f + 0.5f * unit(rng));
+    const float clampedCx = std::min(std::max(cx, width * 0.75f), options.width - width * 0.75f);
+    const float clampedCy = std::min(std::max(cy, height * 0.75f), options.height - height * 0.75f);
+    const float rotation = (unit(rng) * 2.0f - 1.0f) * options.maxRotation;
+    const float squeeze = 1.0f - unit(rng) * options.maxPerspective;
+    Point2f quad[4];
+    signQuad(sign, clampedCx, clampedCy, height, rotation, squeeze, quad);
+    pasteSign(frame, sign, quad, placement);
+    if (options.occlusion > 0.0f) {
+        occludeSign(frame, rng, quad, options.occlusion);
+    }
+    blurFrame(frame, options.blur);
+    addNoise(frame, rng, options.noise);
+    return frame;
+}
+
+std::vector<BgraImage> makeDriveSequence(const BgraImage& sign, uint32_t seed, int frameCount,
+                                         const SceneOptions& options, std::vector<Homography>* placements) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    const BgraImage background = makeBackground(rng, options);
+    std::vector<BgraImage> frames;
+    if (placements) {
+        placements->assign(frameCount, Homography());
+    }
+    for (int i = 0; i < frameCount; ++i) {
+        // Approaching: the sign grows and drifts up and to the right, with a little camera shake.
+        const float t = frameCount > 1 ? static_cast<float>(i) / (frameCount - 1) : 0.0f;
+        const float height = options.height * (options.minSize + (options.maxSize - options.minSize) * t);
+        const float cx = options.width * (0.55f + 0.2f * t) + (unit(rng) - 0.5f) * 4.0f;
+        const float cy = options.height * (0.45f - 0.15f * t) + (unit(rng) - 0.5f) * 4.0f;
+        const float rotation = options.maxRotation * std::sin(6.0f * t);
+        Point2f quad[4];
+        signQuad(sign, cx, cy, height, rotation, 1.0f - options.maxPerspective * t, quad);
+        BgraImage frame = background;
+        pasteSign(frame, sign, quad, placements ? &(*placements)[i] : nullptr);
+        addNoise(frame, rng, options.noise);
+        frames.push_back(std::move(frame));
+    }
+    return frames;
+}
+
+namespace {
+
+std::string bundleManifest(int itemCount) {
+    std::string manifest = "collection\tbench\tSynthetic signs\n";
+    for (int i = 0; i < itemCount; ++i) {
+        const std::string n = std::to_string(i);
+        manifest += "item-" + n + "\timage-" + n + "\tsign-" + n + ".ppm\tSign " + n + "\n";
+    }
+    return manifest;
+}
+
+std::vector<uint8_t> encodePPM(const BgraImage& image) {
+    const std::string header = "P6\n" + std::to_string(image.width) + " " + std::to_string(image.height) + "\n255\n";
+    std::vector<uint8_t> bytes(header.begin(), header.end());
+    bytes.reserve(bytes.size() + static_cast<size_t>(image.width) * image.height * 3);
+    for (size_t p = 0; p < static_cast<size_t>(image.width) * image.height; ++p) {
+        bytes.push_back(image.pixels[p * 4 + 2]);
+        bytes.push_back(image.pixels[p * 4 + 1]);
+        bytes.push_back(image.pixels[p * 4 + 0]);
+    }
+    return bytes;
+}
+
+bool writeFile(const std::string& path, const void* data, size_t size) {
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    const bool ok = std::fwrite(data, 1, size, file) == size;
+    return std::fclose(file) == 0 && ok;
+}
+
+void put16(std::vector<uint8_t>& out, uint32_t v) {
+    out.push_back(static_cast<uint8_t>(v));
+    out.push_back(static_cast<uint8_t>(v >> 8));
+}
+
+void put32(std::vector<uint8_t>& out, uint32_t v) {
+    put16(out, v & 0xFFFF);
+    put16(out, v >> 16);
+}
+
+// Minimal zip writer: deflated entries with sizes in the local headers.
+class ZipWriter {
+public:
+    explicit ZipWriter(const std::string& path) : mFile(std::fopen(path.c_str(), "wb")) {}
+
+    bool add(const std::string& name, const std::vector<uint8_t>& contents) {
+        std::vector<uint8_t> compressed(deflateBound(nullptr, static_cast<uLong>(contents.size())) + 64);
+        z_stream stream;
+        std::memset(&stream, 0, sizeof(stream));
+        if (!mFile || deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8,
+                                   Z_DEFAULT_STRATEGY) != Z_OK) {
+            return false;
+        }
+        stream.next_in = const_cast<Bytef*>(contents.data());
+        stream.avail_in = static_cast<uInt>(contents.size());
+        stream.next_out = compressed.data();
+        stream.avail_out = static_cast<uInt>(compressed.size());
+        const bool deflated = deflate(&stream, Z_FINISH) == Z_STREAM_END;
+        compressed.resize(stream.total_out);
+        deflateEnd(&stream);
+        if (!deflated) {
+            return false;
+        }
+        const uint32_t crc = static_cast<uint32_t>(crc32(0L, contents.data(), static_cast<uInt>(contents.size())));
+
+        std::vector<uint8_t> header;
+        put32(header, 0x04034b50);
+        put16(header, 20);
+        put16(header, 0);
+        put16(header, 8);
+        put16(header, 0);
+        put16(header, 0x21);  // 1 January 1980, the earliest DOS date
+        put32(header, crc);
+        put32(header, static_cast<uint32_t>(compressed.size()));
+        put32(header, static_cast<uint32_t>(contents.size()));
+        put16(header, static_cast<uint32_t>(name.size()));
+        put16(header, 0);
+        header.insert(header.end(), name.begin(), name.end());
+
+        put32(mDirectory, 0x02014b50);
+        put16(mDirectory, 20);
+        mDirectory.insert(mDirectory.end(), header.begin() + 4, header.begin() + 30);
+        put16(mDirectory, 0);
+        put16(mDirectory, 0);
+        put16(mDirectory, 0);
+        put32(mDirectory, 0);
+        put32(mDirectory, mOffset);
+        mDirectory.insert(mDirectory.end(), name.begin(), name.end());
+        ++mEntries;
+
+        mOffset += static_cast<uint32_t>(header.size() + compressed.size());
+        return std::fwrite(header.data(), 1, header.size(), mFile) == header.size() &&
+               std::fwrite(compressed.data(), 1, compressed.size(), mFile) == compressed.size();
+    }
+
+    bool finish() {
+        if (!mFile) {
+            return false;
+        }
+        std::vector<uint8_t> end;
+        put32(end, 0x06054b50);
+        put16(end, 0);
+        put16(end, 0);
+        put16(end, mEntries);
+        put16(end, mEntries);
+        put32(end, static_cast<uint32_t>(mDirectory.size()));
+        put32(end, mOffset);
+        put16(end, 0);
+        bool ok = std::fwrite(mDirectory.data(), 1, mDirectory.size(), mFile) == mDirectory.size() &&
+                  std::fwrite(end.data(), 1, end.size(), mFile) == end.size();
+        ok = std::fclose(mFile) == 0 && ok;
+        mFile = nullptr;
+        return ok;
+    }
+
+    ~ZipWriter() {
+        if (mFile) {
+            std::fclose(mFile);
+        }
+    }
+
+private:
+    FILE* mFile;
+    std::vector<uint8_t> mDirectory;
+    uint32_t mOffset = 0;
+    uint32_t mEntries = 0;
+};
+
+}
+
+bool writeSignBundle(const std::string& directory, int itemCount) {
+    const std::string manifest = bundleManifest(itemCount);
+    bool ok = writeFile(directory + "/" + kBundleManifestName, manifest.data(), manifest.size());
+    for (int i = 0; i < itemCount && ok; ++i) {
+        const std::vector<uint8_t> ppm = encodePPM(makeSignTemplate(i));
+        ok = writeFile(directory + "/sign-" + std::to_string(i) + ".ppm", ppm.data(), ppm.size());
+    }
+    return ok;
+}
+
+bool writeSignBundleZip(const std::string& path, int itemCount) {
+    const std::string manifest = bundleManifest(itemCount);
+    const std::string directory = "bench/";
+    ZipWriter zip(path);
+    bool ok = zip.add(directory + kBundleManifestName, std::vector<uint8_t>(manifest.begin(), manifest.end()));
+    for (int i = 0; i < itemCount && ok; ++i) {
+        ok = zip.add(directory + "sign-" + std::to_string(i) + ".ppm", encodePPM(makeSignTemplate(i)));
+    }
+    return zip.finish() && ok;
+}
+
+}
+}
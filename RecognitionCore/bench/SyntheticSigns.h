@@ -0,0 +1,104 @@
+//
+//  SyntheticSigns.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "rsr/Geometry.h"
+#include "rsr/QueryImage.h"
+
+namespace rsr {
+namespace bench {
+
+/**
+ * Tightly packed BGRA image used to fake camera frames and sign artwork.
+ */
+struct BgraImage {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> pixels;
+
+    BgraImage() = default;
+    BgraImage(int w, int h) : width(w), height(h), pixels(static_cast<size_t>(w) * h * 4, 255) {}
+
+    int bytesPerRow() const { return width * 4; }
+    uint8_t* pixel(int x, int y) { return pixels.data() + (static_cast<size_t>(y) * width + x) * 4; }
+    const uint8_t* pixel(int x, int y) const { return pixels.data() + (static_cast<size_t>(y) * width + x) * 4; }
+    QueryImage toQueryImage() const { return QueryImage(pixels.data(), width, height, bytesPerRow()); }
+};
+
+/**
+ * Procedural road sign: a red-rimmed disc, a warning triangle or a blue
+ * panel with a random pictogram inside. The same id always gives the same sign.
+ */
+BgraImage makeSignTemplate(int id, int size = 256);
+
+enum class SignFamily {
+    PICTOGRAM,  ///< makeSignTemplate: a rimmed shape around a busy pictogram.
+    SHAPE,      ///< A plain shape with a single bold symbol, little texture to match on.
+    TEXT,       ///< A direction panel, half again as wide as high, with two lines of capitals.
+    SPEED_LIMIT,  ///< A red ring around a speed from 10 to 130, over a word for some: signs that differ
+                  ///< only in a few digits, so that a query votes for many of them.
+};
+
+const char* signFamilyName(SignFamily family);
+
+/**
+ * Sign of the family; the same family and id always give the same sign.
+ * @param size Height of the sign; text panels are wider.
+ */
+BgraImage makeSign(SignFamily family, int id, int size = 256);
+
+struct SceneOptions {
+    int width = 1280;
+    int height = 720;
+    float minSize = 0.30f;      ///< Sign height as a fraction of the frame height.
+    float maxSize = 0.50f;
+    float maxRotation = 0.15f;  ///< Radians.
+    float maxPerspective = 0.15f; ///< Relative foreshortening of one side of the sign.
+    float noise = 6.0f;         ///< Amplitude of the uniform sensor noise.
+    float blur = 0.0f;          ///< Standard deviation in pixels of the defocus blur; 0 is sharp.
+    float occlusion = 0.0f;     ///< Fraction of the sign covered by a pole or branch in front of it.
+};
+
+/**
+ * Dashcam-like frame with the sign pasted at a random pose over a cluttered
+ * background, then occluded, blurred and noised as the options say.
+ * @param placement If given, receives the homography from sign to frame pixels.
+ */
+BgraImage makeScene(const BgraImage& sign, uint32_t seed, const SceneOptions& options = SceneOptions(),
+                    Homography* placement = nullptr);
+
+/**
+ * Consecutive frames of a car approaching one sign over a fixed background:
+ * the sign grows from options.minSize to options.maxSize of the frame height
+ * while it drifts up and to the right, with slight camera shake. Blur and
+ * occlusion do not apply.
+ * @param placements If given, receives the homography from sign to frame pixels of every frame.
+ */
+std::vector<BgraImage> makeDriveSequence(const BgraImage& sign, uint32_t seed, int frameCount,
+                                         const SceneOptions& options = SceneOptions(),
+                                         std::vector<Homography>* placements = nullptr);
+
+/**
+ * Write an unpacked collection bundle (see loadCollectionBundle) with one
+ * sign per item: item-<i>, image-<i>, stored as sign-<i>.ppm.
+ * @return false if a file could not be written.
+ */
+bool writeSignBundle(const std::string& directory, int itemCount);
+
+/**
+ * The same bundle zipped, with its files in a bench/ directory of the archive.
+ * @return false if the archive could not be written.
+ */
+bool writeSignBundleZip(const std::string& path, int itemCount);
+
+}
+}
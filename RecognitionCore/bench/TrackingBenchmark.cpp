@@ -0,0 +1,125 @@
+//
+//  TrackingBenchmark.cpp
+//  RecognitionCore
+//
+//  A car approaching a sign: per-frame cost of TrackedSearch, which tracks
+//  the match bounding box between searches, against a full search on every
+//  frame, and how far each puts the box corners from the true ones.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "SyntheticSigns.h"
+#include "rsr/OnDeviceIR.h"
+#include "rsr/SignTracker.h"
+
+using namespace rsr;
+using namespace rsr::bench;
+
+namespace {
+
+// Mean distance of the box corners from the true sign corners, or -1 without a result.
+double cornerError(const std::vector<SearchResult>& results, const BgraImage& sign, const Homography& placement) {
+    if (results.empty()) {
+        return -1.0;
+    }
+    const BoundingBox& box = results[0].matchBoundingBox;
+    const float w = static_cast<float>(sign.width);
+    const float h = static_cast<float>(sign.height);
+    const Point2f truth[4] = {placement.map({0, 0}), placement.map({w, 0}), placement.map({w, h}),
+                              placement.map({0, h})};
+    const Point2f found[4] = {{box.topLeftX, box.topLeftY}, {box.topRightX, box.topRightY},
+                              {box.bottomRightX, box.bottomRightY}, {box.bottomLeftX, box.bottomLeftY}};
+    double sum = 0.0;
+    for (int i = 0; i < 4; ++i) {
+        sum += std::hypot(found[i].x - truth[i].x, found[i].y - truth[i].y);
+    }
+    return sum / 4.0;
+}
+
+struct Run {
+    std::vector<double> frameMs;
+    std::vector<double> errors;
+    int missed = 0;  ///< Frames without a result.
+};
+
+void record(Run& run, double ms, double error) {
+    run.frameMs.push_back(ms);
+    if (error < 0.0) {
+        ++run.missed;
+    } else {
+        run.errors.push_back(error);
+    }
+}
+
+void print(const char* name, const Run& run, uint64_t searches) {
+    double total = 0.0;
+    for (double ms : run.frameMs) {
+        total += ms;
+    }
+    std::printf("%-16s %9llu %10.2f %10.2f %10.2f %8d %12.1f %12.1f\n", name,
+                static_cast<unsigned long long>(searches), total / run.frameMs.size(), percentile(run.frameMs, 50),
+                percentile(run.frameMs, 99), run.missed, percentile(run.errors, 50), percentile(run.errors, 99));
+}
+
+}
+
+int main(int argc, char** argv) {
+    const int itemCount = argInt(argc, argv, "--items", 20);
+    const int frameCount = argInt(argc, argv, "--frames", 90);
+    const int refresh = argInt(argc, argv, "--refresh", 15);
+
+    auto collection = std::make_shared<Collection>("bench", "Synthetic signs");
+    for (int i = 0; i < itemCount; ++i) {
+        Item item;
+        item.uuid = "item-" + std::to_string(i);
+        collection->addImage(item, "image-" + std::to_string(i), makeSignTemplate(i).toQueryImage());
+    }
+    OnDeviceIR onDeviceIR;
+    onDeviceIR.setCollection(collection);
+
+    // Three seconds at 30 fps, the sign growing from a fifth to half of the frame height.
+    SceneOptions options;
+    options.minSize = 0.2f;
+    options.maxSize = 0.5f;
+    options.maxRotation = 0.05f;
+    const BgraImage sign = makeSignTemplate(7 % itemCount);
+    std::vector<Homography> placements;
+    const std::vector<BgraImage> frames = makeDriveSequence(sign, 31u, frameCount, options, &placements);
+
+    TrackingOptions trackingOptions;
+    trackingOptions.refreshFrames = refresh;
+    TrackedSearch tracked(trackingOptions);
+    Run trackedRun;
+    Run searchRun;
+    std::vector<SearchResult> results;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        const VideoFrame frame{frames[i].pixels.data(), frames[i].width, frames[i].height, frames[i].bytesPerRow()};
+        Stopwatch stopwatch;
+        tracked.process(onDeviceIR, frame, results);
+        record(trackedRun, stopwatch.elapsedMs(), cornerError(results, sign, placements[i]));
+
+        stopwatch.restart();
+        onDeviceIR.searchWithVideoFrame(frame, results);
+        record(searchRun, stopwatch.elapsedMs(), cornerError(results, sign, placements[i]));
+    }
+
+    const TrackedSearchCounters& counters = tracked.counters();
+    std::printf("%d frames of %dx%d, %d items, refresh every %d frames\n", frameCount, options.width, options.height,
+                itemCount, refresh);
+    std::printf("%-16s %9s %10s %10s %10s %8s %12s %12s\n", "mode", "searches", "mean ms", "p50 ms", "p99 ms",
+                "missed", "err p50 px", "err p99 px");
+    print("search always", searchRun, frames.size());
+    print("tracked", trackedRun, counters.searches);
+    std::printf("tracked frames %llu, tracks lost %llu\n", static_cast<unsigned long long>(counters.tracked),
+                static_cast<unsigned long long>(counters.losses));
+    return 0;
+}
@@ -0,0 +1,59 @@
+//
+//  AlignedAllocator.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace rsr {
+
+/**
+ * Standard allocator whose blocks start on an Alignment byte boundary, such
+ * as a cache line, so that vector kernels streaming through the elements
+ * never split a row across two lines.
+ */
+template <typename T, size_t Alignment>
+class AlignedAllocator {
+public:
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+    T* allocate(size_t count) {
+        return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(Alignment)));
+    }
+    void deallocate(T* p, size_t) { ::operator delete(p, std::align_val_t(Alignment)); }
+};
+
+template <typename T, typename U, size_t Alignment>
+bool operator==(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&) {
+    return true;
+}
+
+template <typename T, typename U, size_t Alignment>
+bool operator!=(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&) {
+    return false;
+}
+
+constexpr size_t kCacheLineSize = 64;
+
+/**
+ * Vector whose storage starts on a cache line.
+ */
+template <typename T>
+using CacheAlignedVector = std::vector<T, AlignedAllocator<T, kCacheLineSize>>;
+
+}
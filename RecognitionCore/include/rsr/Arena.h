@@ -0,0 +1,119 @@
+//
+//  Arena.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace rsr {
+
+/**
+ * Bump allocator for memory that is released all at once. Allocations are
+ * carved out of large chunks and never freed one by one; reset() makes the
+ * whole arena available again. If a workload needed more than one chunk,
+ * reset() replaces them with a single chunk of their combined size, so the
+ * next workload of the same shape makes no system allocation at all.
+ *
+ * Not thread-safe. Pointers stay valid until reset() or destruction.
+ */
+class Arena {
+public:
+    static constexpr size_t kDefaultAlignment = 64;  ///< A cache line, and enough for any vector load.
+
+    explicit Arena(size_t chunkBytes = 64 * 1024);
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    /**
+     * @param alignment Power of two.
+     * @return Uninitialized memory, never null.
+     */
+    void* allocate(size_t bytes, size_t alignment = kDefaultAlignment);
+
+    template <typename T>
+    T* allocateArray(size_t count) {
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T) > kDefaultAlignment ? alignof(T)
+                                                                                          : kDefaultAlignment));
+    }
+
+    void reset();
+
+    size_t used() const { return mUsed; }          ///< Bytes handed out since the last reset, padding included;
+                                                   ///< nothing is freed before, so also their peak.
+    size_t capacity() const { return mCapacity; }  ///< Bytes held in chunks.
+    uint64_t systemAllocations() const { return mSystemAllocations; }  ///< Chunks requested so far.
+
+private:
+    struct Chunk {
+        std::unique_ptr<uint8_t[]> memory;
+        size_t size = 0;
+    };
+
+    void addChunk(size_t bytes);
+
+    size_t mChunkBytes;
+    std::vector<Chunk> mChunks;
+    size_t mChunk = 0;   ///< Chunk being carved.
+    size_t mOffset = 0;  ///< Next free byte in it.
+    size_t mUsed = 0;
+    size_t mCapacity = 0;
+    uint64_t mSystemAllocations = 0;
+};
+
+/**
+ * Standard allocator drawing from an Arena, so that containers of scratch
+ * data can live in one. Memory is given back only by the arena's reset():
+ * a vector that grows leaves its previous buffers behind, so reserve what is
+ * known up front. Without an arena it falls back to the general allocator.
+ */
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    ArenaAllocator() = default;
+    explicit ArenaAllocator(Arena* arena) : mArena(arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : mArena(other.arena()) {}
+
+    T* allocate(size_t count) {
+        return mArena ? mArena->allocateArray<T>(count) : static_cast<T*>(::operator new(count * sizeof(T)));
+    }
+
+    void deallocate(T* pointer, size_t) {
+        if (!mArena) {
+            ::operator delete(pointer);
+        }
+    }
+
+    Arena* arena() const { return mArena; }
+
+private:
+    Arena* mArena = nullptr;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+    return a.arena() == b.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+    return a.arena() != b.arena();
+}
+
+/**
+ * Vector of scratch data, in an arena if it is given one.
+ */
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+}
@@ -0,0 +1,39 @@
+//
+//  ArrayView.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <cstddef>
+
+namespace rsr {
+
+/**
+ * Read-only view of a contiguous array owned elsewhere, such as a collection's
+ * feature storage or a mapped collection file.
+ */
+template <typename T>
+class ArrayView {
+public:
+    ArrayView() = default;
+    ArrayView(const T* data, size_t size) : mData(data), mSize(size) {}
+
+    const T* data() const { return mData; }
+    size_t size() const { return mSize; }
+    bool empty() const { return mSize == 0; }
+
+    const T& operator[](size_t i) const { return mData[i]; }
+    const T* begin() const { return mData; }
+    const T* end() const { return mData + mSize; }
+
+    ArrayView sub(size_t offset, size_t count) const { return ArrayView(mData + offset, count); }
+
+private:
+    const T* mData = nullptr;
+    size_t mSize = 0;
+};
+
+}
@@ -0,0 +1,80 @@
+//
+//  Bundle.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rsr/Collection.h"
+#include "rsr/ErrorCodes.h"
+
+namespace rsr {
+
+/**
+ * Name of the manifest file of an unpacked collection bundle.
+ */
+extern const char* const kBundleManifestName;
+
+/**
+ * Build a collection from an unpacked collection bundle, the portable
+ * counterpart of addCollectionFromBundle:. The directory holds a tab
+ * separated manifest, collection.tsv:
+ *
+ *     collection  <uuid>  <name>
+ *     <item uuid> <image uuid> <image file> [<item name> [<url> [<custom>]]]
+ *     ...
+ *
+ * Image files are binary PGM (P5) or PPM (P6) with 8 bit samples, relative
+ * to the directory. Every reference image is decoded and its features
+ * extracted, which is what makes bundles slow to load; convert them once to
+ * a collection file with Collection::write and open that instead.
+ *
+ * @param onProgress Called with the fraction of images processed, if given.
+ * @return SUCCESS, COLLECTION_NOT_FOUND without a manifest,
+ * COLLECTION_MISSING_FILES if an image file cannot be read,
+ * COLLECTION_INVALID for a malformed manifest or image.
+ */
+ErrorCode loadCollectionBundle(const std::string& directory, std::unique_ptr<Collection>& collection,
+                               const std::function<void(float)>& onProgress = nullptr);
+
+struct BundleOptions {
+    int parserThreads = 1;  ///< Threads decoding images and extracting features while the caller inflates; 0 parses inline.
+};
+
+/**
+ * Build a collection straight from a zipped bundle, with the layout of
+ * loadCollectionBundle at any directory level of the archive. Entries are
+ * inflated in memory as the archive is read and handed to parser threads,
+ * so extraction overlaps inflating and nothing is written to disk. A damaged
+ * entry stops the load as soon as it is reached.
+ *
+ * @param onProgress Called on the calling thread with the fraction of the archive processed, if given.
+ * @return SUCCESS, COLLECTION_NOT_FOUND if the archive cannot be opened,
+ * COLLECTION_MANAGER_EXTRACT_ERROR for a damaged or unsupported archive,
+ * COLLECTION_MISSING_FILES without a manifest or with an image missing,
+ * COLLECTION_INVALID for a malformed manifest or image.
+ */
+ErrorCode loadCollectionBundleZip(const std::string& zipPath, std::unique_ptr<Collection>& collection,
+                                  const std::function<void(float)>& onProgress = nullptr,
+                                  const BundleOptions& options = BundleOptions());
+
+/**
+ * Decode a binary PGM or PPM image.
+ * @return SUCCESS, COLLECTION_MISSING_FILES if it cannot be read or COLLECTION_INVALID.
+ */
+ErrorCode readNetpbmImage(const std::string& path, QueryImage& image);
+
+/**
+ * Decode a binary PGM or PPM image held in memory.
+ * @return SUCCESS or COLLECTION_INVALID.
+ */
+ErrorCode decodeNetpbmImage(const std::vector<uint8_t>& bytes, QueryImage& image);
+
+}
@@ -0,0 +1,158 @@
+//
+//  Collection.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rsr/AlignedAllocator.h"
+#include "rsr/ArrayView.h"
+#include "rsr/ErrorCodes.h"
+#include "rsr/Features.h"
+#include "rsr/QueryImage.h"
+
+namespace rsr {
+
+struct IndexOptions;
+
+/**
+ * An Item represents an object in a collection, the counterpart of CraftARItem.
+ */
+struct Item {
+    std::string uuid;
+    std::string name;
+    std::string url;
+    std::string custom;
+};
+
+/**
+ * One reference image of an item with its extracted features,
+ * the counterpart of CraftARImage.
+ */
+struct ReferenceImage {
+    std::string uuid;
+    int itemIndex = -1;
+    int width = 0;
+    int height = 0;
+    uint32_t firstFeature = 0;  ///< Offset of the features in Collection::keypoints() and descriptors().
+    ArrayView<Keypoint> keypoints;
+    ArrayView<Descriptor> descriptors;
+};
+
+/**
+ * Set of items and their reference images that searches are matched against,
+ * the counterpart of CraftAROnDeviceCollection.
+ * A collection is built once and then shared read-only by OnDeviceIR.
+ * The features of all reference images are stored contiguously as parallel
+ * arrays (keypoints, descriptor rows and the image owning each feature),
+ * either in memory or in a mapped collection file, starting on a cache line
+ * so that matching streams through them in order.
+ */
+class Collection {
+public:
+    Collection(std::string uuid, std::string name,
+               const ExtractorOptions& extractorOptions = referenceExtractorOptions());
+
+    // Reference images view the collection's feature storage.
+    Collection(const Collection&) = delete;
+    Collection& operator=(const Collection&) = delete;
+
+    /**
+     * Open a collection file written by write(). The file is mapped read-only:
+     * only the item and image records are read here, features and the stored
+     * index are paged in by the first searches that touch them.
+     * @return SUCCESS, COLLECTION_NOT_FOUND if the file cannot be opened,
+     * COLLECTION_INVALID if it is damaged, COLLECTION_BUNDLE_VERSION_IS_OLD or
+     * COLLECTION_BUNDLE_SDK_VERSION_IS_OLD if its format version is not this one.
+     */
+    static ErrorCode open(const std::string& path, std::shared_ptr<const Collection>& collection);
+
+    /**
+     * Write the collection file format, with an index prebuilt for indexOptions
+     * so that setCollection with the same options does not have to build it.
+     * @return SUCCESS or COLLECTION_MANAGER_EXTRACT_ERROR if the file cannot be written.
+     */
+    ErrorCode write(const std::string& path, const IndexOptions& indexOptions) const;
+
+    /**
+     * Extractor settings used for reference images: a larger feature budget
+     * than queries, since references are extracted once.
+     */
+    static ExtractorOptions referenceExtractorOptions();
+
+    const std::string& uuid() const { return mUUID; }
+    const std::string& name() const { return mName; }
+
+    /**
+     * Add a reference image for an item, extracting its features.
+     * The item is created on first use of its uuid.
+     * @return SUCCESS, COLLECTION_INVALID_ITEM for an empty uuid or the extractor error.
+     */
+    ErrorCode addImage(const Item& item, const std::string& imageUUID, const QueryImage& image);
+
+    /**
+     * Add a reference image whose features were already extracted.
+     * @return SUCCESS, COLLECTION_INVALID_ITEM, or COLLECTION_INVALID for a mapped collection.
+     */
+    ErrorCode addImageFeatures(const Item& item, const std::string& imageUUID, FeatureSet features);
+
+    const std::vector<Item>& items() const { return mItems; }
+    const std::vector<ReferenceImage>& images() const { return mImages; }
+
+    /**
+     * Features of all reference images, in image order.
+     */
+    ArrayView<Keypoint> keypoints() const { return mKeypoints; }
+    ArrayView<Descriptor> descriptors() const { return mDescriptors; }
+
+    /**
+     * Index in images() of the image each feature belongs to, in feature order.
+     */
+    ArrayView<uint32_t> featureImages() const { return mFeatureImages; }
+
+    /**
+     * Persistent form of the index stored in the collection file; empty otherwise.
+     */
+    ArrayView<uint8_t> storedIndex() const { return mStoredIndex; }
+
+    bool isMapped() const { return mMapping != nullptr; }
+
+    /**
+     * Get a list of the uuids of the items in this collection.
+     */
+    std::vector<std::string> listItems() const;
+
+    /**
+     * Get an item.
+     * @return The item or nullptr (error set to COLLECTION_ITEM_NOT_FOUND).
+     */
+    const Item* getItem(const std::string& itemUUID, ErrorCode* error = nullptr) const;
+
+private:
+    int itemIndexFor(const Item& item);
+    void updateViews();
+
+    std::string mUUID;
+    std::string mName;
+    FeatureExtractor mExtractor;
+    std::vector<Item> mItems;
+    std::vector<ReferenceImage> mImages;
+
+    CacheAlignedVector<Keypoint> mKeypointStorage;
+    CacheAlignedVector<Descriptor> mDescriptorStorage;
+    CacheAlignedVector<uint32_t> mFeatureImageStorage;
+    ArrayView<Keypoint> mKeypoints;
+    ArrayView<Descriptor> mDescriptors;
+    ArrayView<uint32_t> mFeatureImages;
+    ArrayView<uint8_t> mStoredIndex;
+    std::shared_ptr<const void> mMapping;  ///< Unmaps the collection file when released.
+};
+
+}
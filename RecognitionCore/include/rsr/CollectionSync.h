@@ -0,0 +1,112 @@
+//
+//  CollectionSync.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "rsr/Collection.h"
+#include "rsr/DescriptorIndex.h"
+#include "rsr/ErrorCodes.h"
+#include "rsr/OnDeviceIR.h"
+
+namespace rsr {
+
+struct ManifestEntry {
+    std::string itemUUID;
+    uint64_t contentHash = 0;  ///< Hash of the item's sync record: its fields, images and features.
+};
+
+/**
+ * What a collection holds, item by item, as a sync server publishes it.
+ * The text form is tab separated like a bundle manifest:
+ *
+ *     collection  <uuid>  <name>
+ *     <item uuid> <content hash, 16 hex digits>
+ *     ...
+ */
+struct CollectionManifest {
+    std::string uuid;
+    std::string name;
+    std::vector<ManifestEntry> items;  ///< In collection order.
+
+    /**
+     * Hash every item of a collection. Reads all of its features.
+     */
+    static CollectionManifest describe(const Collection& collection);
+
+    std::string serialize() const;
+
+    /**
+     * @return SUCCESS or COLLECTION_MANAGER_SYNC_ERROR for malformed text.
+     */
+    static ErrorCode parse(const std::string& text, CollectionManifest& manifest);
+};
+
+/**
+ * Append the sync records of some items of a collection, the reply a sync
+ * server sends for them. Uuids the collection does not have are skipped.
+ */
+void serializeItems(const Collection& collection, const std::vector<std::string>& itemUUIDs, std::string& payload);
+
+/**
+ * Outcome of a sync, with the counts syncWithOnDone: reports.
+ */
+struct SyncReport {
+    int itemDownloads = 0;   ///< Items fetched because they were new or had changed.
+    int downloadErrors = 0;  ///< Items that could not be fetched or failed their hash; a previous version stays loaded.
+    int itemsUnchanged = 0;
+    int itemsRemoved = 0;
+    size_t bytesDownloaded = 0;
+};
+
+/**
+ * Keeps one collection of an OnDeviceIR in step with a sync server, the
+ * portable counterpart of syncWithOnDone:. The server publishes a manifest
+ * at <server>/manifest and item records at <server>/items?ids=<uuid>,...;
+ * only items whose content hash differs from the loaded copy are fetched.
+ * The updated collection reuses the features of unchanged items and replaces
+ * the loaded one through OnDeviceIR::updateCollection, so searches keep being
+ * served from the previous version until it is ready.
+ *
+ * One sync runs at a time per instance.
+ */
+class CollectionSync {
+public:
+    /**
+     * @param indexOptions Index for the collection if the first sync is what loads it.
+     */
+    CollectionSync(OnDeviceIR& onDeviceIR, std::string serverURL, const IndexOptions& indexOptions = IndexOptions());
+
+    /**
+     * Fetch the manifest and bring the loaded collection up to date. A
+     * collection that is not loaded yet is downloaded whole and set, active
+     * if no other collection is.
+     * @param onProgress Called with the fraction of changed items fetched, if given.
+     * @return SUCCESS, also when some items failed to download (see the report),
+     * or COLLECTION_MANAGER_SYNC_ERROR if the manifest could not be fetched.
+     */
+    ErrorCode sync(SyncReport& report, const std::function<void(float)>& onProgress = nullptr);
+
+private:
+    const std::unordered_map<std::string, uint64_t>& localHashes(const std::shared_ptr<const Collection>& collection);
+
+    OnDeviceIR& mOnDeviceIR;
+    std::string mServerURL;
+    IndexOptions mIndexOptions;
+
+    // Content hashes of the collection last synced, so they are not recomputed every time.
+    std::weak_ptr<const Collection> mHashedCollection;
+    std::unordered_map<std::string, uint64_t> mHashes;
+};
+
+}
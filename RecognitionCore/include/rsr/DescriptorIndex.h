@@ -0,0 +1,100 @@
+//
+//  DescriptorIndex.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <climits>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "rsr/Arena.h"
+#include "rsr/Collection.h"
+#include "rsr/Features.h"
+#include "rsr/Simd.h"
+
+namespace rsr {
+
+/**
+ * How nearest reference descriptors are looked up during matching.
+ */
+enum class IndexType {
+    EXACT,  ///< Brute force over every reference descriptor. Cost grows linearly with the collection.
+    LSH,    ///< Multi-table locality sensitive hashing on sampled descriptor bits. Sub-linear, approximate.
+};
+
+struct IndexOptions {
+    IndexType type = IndexType::EXACT;
+    int lshTables = 8;      ///< Independent hash tables; more tables raise recall and memory.
+    int lshKeyBits = 16;    ///< Sampled bits per key; more bits make buckets smaller.
+    bool lshMultiProbe = true;  ///< Also probe the buckets whose key differs by one bit.
+};
+
+/**
+ * Best and second best reference descriptor found for one query descriptor.
+ */
+struct NearestNeighbours {
+    int best = INT_MAX;
+    int second = INT_MAX;
+    int image = -1;      ///< Index in Collection::images() of the best match.
+    int reference = -1;  ///< Index of the best match within that image.
+};
+
+/**
+ * Brute force update of the two nearest neighbours of a query with
+ * references [0, count), in one pass. Gives the same result as comparing them
+ * one by one in order, whatever the level.
+ * @param image Recorded in neighbours when one of these references becomes the best.
+ * @param firstReference Index within the image of references[0].
+ * @param level Instruction set; falls back to scalar if not supported.
+ */
+void nearestTwo(const Descriptor& query, const Descriptor* references, size_t count, int image, int firstReference,
+                NearestNeighbours& neighbours, SimdLevel level = bestSimdLevel());
+
+/**
+ * Nearest neighbour search structure over the descriptors of a collection.
+ * An index refers to the collection it was built from and must not outlive it.
+ * Lookups are const and may run concurrently.
+ */
+class DescriptorIndex {
+public:
+    virtual ~DescriptorIndex() = default;
+
+    virtual IndexType type() const = 0;
+
+    /**
+     * Finds the two nearest reference descriptors of each query descriptor.
+     * @param neighbours Resized to queries.size().
+     */
+    void search(const std::vector<const Descriptor*>& queries, std::vector<NearestNeighbours>& neighbours) const {
+        neighbours.resize(queries.size());
+        search(queries.data(), queries.size(), neighbours.data());
+    }
+
+    /**
+     * Same as above for count queries.
+     * @param neighbours Receives count entries.
+     * @param scratch Arena for working buffers, or null for the general allocator.
+     */
+    virtual void search(const Descriptor* const* queries, size_t count, NearestNeighbours* neighbours,
+                        Arena* scratch = nullptr) const = 0;
+
+    /**
+     * Persistent form of the index, stored in collection files. Empty for
+     * indexes that have nothing to precompute.
+     */
+    virtual void serialize(std::vector<uint8_t>& data) const { data.clear(); }
+
+    /**
+     * Build the index selected in options for a collection. A mapped
+     * collection whose stored index was built with the same options uses it
+     * in place instead.
+     */
+    static std::unique_ptr<DescriptorIndex> create(const Collection& collection, const IndexOptions& options);
+};
+
+}
@@ -0,0 +1,95 @@
+//
+//  DuplicateFrameGate.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "rsr/ErrorCodes.h"
+#include "rsr/FrameSketch.h"
+#include "rsr/ImagePyramid.h"
+#include "rsr/OnDeviceIR.h"
+#include "rsr/SearchResult.h"
+#include "rsr/VideoFrame.h"
+
+namespace rsr {
+
+struct FrameGateOptions {
+    double maxDistance = 4.0;  ///< FrameSketch distance up to which a frame counts as the one last searched.
+    int maxReuses = 30;        ///< Frames answered from one search before searching again anyway; 0 never forces one.
+};
+
+struct FrameGateCounters {
+    uint64_t frames = 0;
+    uint64_t searched = 0;
+    uint64_t reused = 0;  ///< Frames answered with the results of the last search.
+};
+
+/**
+ * Sits in front of finder-mode searches and skips frames that look the same
+ * as the last one searched, such as those of a car waiting at a light,
+ * answering them with that search's results instead. Frames are compared by
+ * FrameSketch against the frame last searched, not the previous one, so slow
+ * drift still adds up to a new search.
+ *
+ * Not thread-safe: use one gate per frame stream.
+ */
+class DuplicateFrameGate {
+public:
+    explicit DuplicateFrameGate(const FrameGateOptions& options = FrameGateOptions());
+
+    /**
+     * Search the frame on the active collection unless it duplicates the
+     * frame last searched, in which case results get that search's results.
+     * @param reused Set to whether the results were reused, if given.
+     * @return The search error, or SUCCESS for reused results.
+     */
+    ErrorCode search(OnDeviceIR& onDeviceIR, const VideoFrame& frame, std::vector<SearchResult>& results,
+                     bool* reused = nullptr);
+
+    /**
+     * Same as above for a frame whose pyramid is shared with other stages;
+     * searches go through OnDeviceIR::searchWithPyramid.
+     */
+    ErrorCode search(OnDeviceIR& onDeviceIR, const ImagePyramid& pyramid, std::vector<SearchResult>& results,
+                     bool* reused = nullptr);
+
+    /**
+     * For searches made elsewhere, e.g. in the cloud: whether a frame needs
+     * a search. If not, lastResults() answers it.
+     */
+    bool shouldSearch(const VideoFrame& frame);
+    bool shouldSearch(const ImagePyramid& pyramid);
+
+    /**
+     * Store the results of the search shouldSearch asked for. A failed search
+     * need not be recorded: the previous results keep answering their frame.
+     */
+    void recordResults(const std::vector<SearchResult>& results);
+
+    const std::vector<SearchResult>& lastResults() const { return mResults; }
+
+    /**
+     * Forget the last search, e.g. after the active collection changed.
+     */
+    void reset();
+
+    const FrameGateCounters& counters() const { return mCounters; }
+
+private:
+    bool shouldSearchSketch(const FrameSketch& sketch);
+
+    FrameGateOptions mOptions;
+    FrameSketch mCandidate;    ///< Sketch of the frame shouldSearch last let through.
+    FrameSketch mReference;    ///< Sketch of the frame whose results are held.
+    std::vector<SearchResult> mResults;
+    int mReuses = 0;
+    FrameGateCounters mCounters;
+};
+
+}
@@ -0,0 +1,58 @@
+//
+//  ErrorCodes.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+namespace rsr {
+
+/**
+ * Error identifying the problem.
+ * Values keep the numbering of CraftARErrorCodes so they can be passed
+ * straight through to a CraftARError on the iOS side. SUCCESS has no
+ * counterpart in the SDK, where errors are reported through a separate block.
+ */
+enum class ErrorCode : int {
+    SUCCESS = -1,
+
+    UNKNOWN_ERROR = 0,
+    INTERNAL_ERROR,
+
+    // COLLECTION MANAGER
+    COLLECTION_MANAGER_EXTRACT_ERROR,
+    COLLECTION_MANAGER_DELETE_ERROR,
+    COLLECTION_MANAGER_INVALID_PARAMS,
+    COLLECTION_MANAGER_SYNC_ERROR,
+
+    // COLLECTIONS
+    COLLECTION_NOT_FOUND,
+    COLLECTION_MISSING_FILES,
+    COLLECTION_INVALID,
+    COLLECTION_INVALID_ITEM,
+    COLLECTION_ITEM_NOT_FOUND,
+    COLLECTION_BUNDLE_VERSION_IS_OLD,
+    COLLECTION_BUNDLE_SDK_VERSION_IS_OLD,
+
+    // On-Device Image Recognition
+    ON_DEVICE_IR_COLLECTION_NOT_FOUND,
+    ON_DEVICE_IR_NO_ACTIVE_COLLECTION,
+
+    // Image Recognition Errors
+    SEARCH_ERROR_IMAGE_NO_DETAILS,
+    SEARCH_ERROR_IMAGE_TOO_SMALL,
+    SEARCH_ERROR_READING_FILE,
+    SEARCH_ERROR_IMAGE_HAS_TRANSPARENCY,
+
+    // Outside the SDK's numbering, which goes on with service errors.
+    SEARCH_CANCELLED = 1000,  ///< A queued search that was dropped before it ran.
+};
+
+/**
+ * Returns the enumerator name of an error code, e.g. "SEARCH_ERROR_IMAGE_TOO_SMALL".
+ */
+const char* errorCodeName(ErrorCode code);
+
+}
@@ -0,0 +1,122 @@
+//
+//  Features.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "rsr/Arena.h"
+#include "rsr/ErrorCodes.h"
+#include "rsr/Image.h"
+#include "rsr/ImagePyramid.h"
+
+namespace rsr {
+
+/**
+ * Detected interest point. Coordinates are in pixels of the image passed to
+ * the extractor, whatever resolution the detection actually ran at.
+ */
+struct Keypoint {
+    float x = 0.0f;
+    float y = 0.0f;
+    float scale = 1.0f;     ///< Pyramid scale the point was found at, relative to the input image.
+    float angle = 0.0f;     ///< Dominant orientation in radians.
+    float response = 0.0f;  ///< Corner strength, higher is better.
+};
+
+/**
+ * 256-bit binary (steered BRIEF) descriptor.
+ */
+struct Descriptor {
+    uint64_t bits[4] = {0, 0, 0, 0};
+};
+
+/**
+ * Number of differing bits between two descriptors.
+ */
+int hammingDistance(const Descriptor& a, const Descriptor& b);
+
+/**
+ * Keypoints and their descriptors for one image. keypoints[i] is described by descriptors[i].
+ */
+struct FeatureSet {
+    std::vector<Keypoint> keypoints;
+    std::vector<Descriptor> descriptors;
+    int width = 0;                ///< Size of the image the features were extracted from.
+    int height = 0;
+    float processingScale = 1.0f; ///< Input pixels per pixel of the resolution detection ran at.
+
+    size_t size() const { return keypoints.size(); }
+
+    /**
+     * Empty the set but keep its capacity, so a reused set stops allocating.
+     */
+    void clear() {
+        keypoints.clear();
+        descriptors.clear();
+        width = 0;
+        height = 0;
+        processingScale = 1.0f;
+    }
+};
+
+struct ExtractorOptions {
+    int maxFeatures = 500;       ///< Strongest features kept over all pyramid levels.
+    int fastThreshold = 20;      ///< Intensity difference for the FAST segment test.
+    int pyramidLevels = 4;
+    float pyramidScale = 1.4f;   ///< Size ratio between consecutive pyramid levels.
+    int maxDimension = 640;      ///< Larger images are reduced before detection.
+    int minDimension = 64;       ///< Smaller images fail with SEARCH_ERROR_IMAGE_TOO_SMALL.
+    int minFeatures = 10;        ///< Fewer features fail with SEARCH_ERROR_IMAGE_NO_DETAILS.
+};
+
+/**
+ * Detects oriented FAST corners over a scale pyramid and describes them with
+ * rotation-steered BRIEF tests. Stateless after construction, so one instance
+ * can be shared by concurrent searches.
+ */
+class FeatureExtractor {
+public:
+    explicit FeatureExtractor(const ExtractorOptions& options = ExtractorOptions());
+
+    const ExtractorOptions& options() const { return mOptions; }
+
+    /**
+     * Power of two (at most 4) by which an image of that size can be reduced
+     * while staying at or above the working resolution. Callers that convert
+     * from BGRA use it to reduce during the conversion.
+     */
+    int reductionFactor(int width, int height) const;
+
+    /**
+     * Extract features from a luminance image.
+     * @param inputScale Original pixels per pixel of image, if the caller already
+     * reduced it. Keypoints and sizes are reported in original pixels.
+     * @return SUCCESS, SEARCH_ERROR_IMAGE_TOO_SMALL or SEARCH_ERROR_IMAGE_NO_DETAILS.
+     */
+    ErrorCode extract(const GrayImage& image, FeatureSet& features, int inputScale = 1) const;
+
+    /**
+     * Extract features from the levels of a frame pyramid, which may be
+     * shared with other stages. It should be built with pyramidOptions();
+     * otherwise a matching one is built from its reduced image.
+     * @param scratch Arena for the per-level buffers, or null for the general allocator.
+     */
+    ErrorCode extract(const ImagePyramid& pyramid, FeatureSet& features, Arena* scratch = nullptr) const;
+
+    /**
+     * Pyramid levels this extractor detects on.
+     */
+    PyramidOptions pyramidOptions() const;
+
+private:
+    ExtractorOptions mOptions;
+};
+
+}
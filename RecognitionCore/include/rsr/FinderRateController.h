@@ -0,0 +1,114 @@
+//
+//  FinderRateController.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <cstdint>
+
+namespace rsr {
+
+struct RateControllerOptions {
+    double minRate = 1.0;             ///< Searches per second never gone below.
+    double maxRate = 30.0;            ///< Camera frame rate on device, the search budget for cloud.
+    int workers = 1;                  ///< Searches that can run at once; on device, one per core.
+    double targetUtilization = 0.8;   ///< Share of the workers kept busy; the rest absorbs latency spikes.
+    double cpuReserve = 0.15;         ///< CPU share left to other work; 0 ignores CPU headroom (cloud).
+    double hysteresis = 0.10;         ///< Relative change ignored, so the rate does not flap.
+    double increasePerSecond = 8.0;   ///< Fastest climb, in searches per second per second.
+    double latencySmoothing = 0.25;   ///< Weight of a new sample in the latency average.
+
+    /**
+     * On-device finder mode: up to the camera rate, one search per worker.
+     */
+    static RateControllerOptions onDevice(double cameraFps, int workers);
+
+    /**
+     * Cloud finder mode: up to a budget of searches per second, the cap
+     * setMaxSearchesPerSecond: sets, with a few requests in flight.
+     */
+    static RateControllerOptions cloud(double maxSearchesPerSecond);
+};
+
+/**
+ * Decides which finder frames are searched. The rate follows the measured
+ * end-to-end latency: with L seconds per search and W workers, W / L searches
+ * per second keep every worker busy without queueing (Little's law), and the
+ * controller aims at targetUtilization of that. On device it also keeps
+ * cpuReserve of the CPU free: the share it may use is its own estimated
+ * utilization, rate * L / W, plus the measured headroom, minus the reserve,
+ * so other work taking the CPU lowers the rate in proportion. Decreases
+ * apply at once, increases ramp up, and changes inside the hysteresis band
+ * are ignored. No more than workers + 1 searches are ever in flight.
+ *
+ * Times are seconds on any monotonic clock. Not thread-safe: call it from
+ * the thread that handles frames and search completions, or under a lock.
+ */
+class FinderRateController {
+public:
+    explicit FinderRateController(const RateControllerOptions& options = RateControllerOptions());
+
+    /**
+     * Call for every camera frame.
+     * @return true if this frame should be searched; it then counts as in flight.
+     */
+    bool shouldSubmit(double now);
+
+    /**
+     * Report a finished search submitted after shouldSubmit returned true.
+     * @param latencySeconds From submission to result, queueing included.
+     */
+    void onSearchCompleted(double now, double latencySeconds);
+
+    /**
+     * Report a search submitted after shouldSubmit returned true that gave
+     * no result: cancelled, e.g. replaced by a newer finder frame before it
+     * started, or failed. It must be called for each of them, or the slot
+     * stays in flight and once workers + 1 are lost no frame is searched.
+     * OnDeviceIR::searchAsync reports a FINDER search a newer one cancelled
+     * by calling its onDone with SEARCH_CANCELLED. Its latency is not sampled.
+     */
+    void onSearchDropped(double now);
+
+    /**
+     * Report the fraction of CPU time left idle, e.g. from CpuHeadroomProbe.
+     */
+    void onCpuHeadroom(double now, double headroom);
+
+    double rate() const { return mRate; }
+    double smoothedLatency() const { return mLatency; }
+    int inFlight() const { return mInFlight; }
+
+private:
+    double desiredRate() const;
+    void adjust(double now, double desired);
+
+    RateControllerOptions mOptions;
+    double mRate;
+    double mLatency = 0.0;  ///< Smoothed end-to-end latency; 0 until the first sample.
+    double mHeadroom = 1.0;
+    double mNextSubmit = 0.0;
+    double mLastAdjust = -1.0;
+    int mInFlight = 0;
+};
+
+/**
+ * Measures the share of CPU time the whole system left idle between two
+ * calls, from /proc/stat on Linux. Elsewhere it always reports 1.
+ */
+class CpuHeadroomProbe {
+public:
+    /**
+     * @return Idle fraction since the previous call, 1 on the first call.
+     */
+    double sample();
+
+private:
+    uint64_t mIdle = 0;
+    uint64_t mTotal = 0;
+};
+
+}
@@ -0,0 +1,139 @@
+//
+//  FrameBufferPool.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "rsr/VideoFrame.h"
+
+namespace rsr {
+
+struct FramePoolOptions {
+    int maxOutstanding = 4;  ///< Buffers that may be held at once, wrapped ones included; requests beyond fail.
+};
+
+struct FramePoolCounters {
+    uint64_t acquired = 0;     ///< Buffers handed out, wrapped ones included.
+    uint64_t refused = 0;      ///< Requests turned down because maxOutstanding buffers were held.
+    uint64_t allocations = 0;  ///< Times pooled pixels had to be allocated or grown; stays put once sizes settle.
+    int outstanding = 0;       ///< Buffers held now.
+};
+
+/**
+ * Reference-counted handle to a frame from a FrameBufferPool. Copies share
+ * the frame; it goes back to the pool when the last copy is destroyed or
+ * reset, on whichever thread that happens. Handles can be passed freely
+ * between threads, but one handle must not be used by two threads at once.
+ */
+class FrameBuffer {
+public:
+    FrameBuffer() = default;
+    FrameBuffer(const FrameBuffer& other);
+    FrameBuffer(FrameBuffer&& other) noexcept : mBuffer(other.mBuffer) { other.mBuffer = nullptr; }
+    FrameBuffer& operator=(FrameBuffer other) noexcept;
+    ~FrameBuffer() { reset(); }
+
+    explicit operator bool() const { return mBuffer != nullptr; }
+
+    /**
+     * The frame, valid as long as any handle to it is. Invalid for an empty handle.
+     */
+    VideoFrame frame() const;
+
+    /**
+     * Writable pixels of a pooled buffer, rows of exactly 4 * width bytes;
+     * null for an empty handle or a wrapped frame. Fill them before sharing
+     * the handle with another thread.
+     */
+    uint8_t* pixels() const;
+
+    /**
+     * Handles sharing this frame, this one included.
+     */
+    int useCount() const;
+
+    /**
+     * Drop this handle's reference.
+     */
+    void reset();
+
+private:
+    friend class FrameBufferPool;
+    struct Buffer;
+
+    explicit FrameBuffer(Buffer* buffer) : mBuffer(buffer) {}
+
+    Buffer* mBuffer = nullptr;
+};
+
+/**
+ * Frames that outlive the camera callback. A VideoFrame may only be read
+ * inside processVideoFrameWithBlock:, so handing one to another thread used
+ * to mean copying it into a QueryImage. The pool instead gives out
+ * FrameBuffers that capture, preprocessing and search threads can hold as
+ * long as they need:
+ *
+ * - wrap() keeps memory owned elsewhere, typically a retained CVPixelBuffer,
+ *   without copying it, and releases it once the last handle is gone.
+ * - acquire() and copy() give out pooled pixels, recycled instead of freed,
+ *   for when the camera buffer cannot be kept.
+ *
+ * At most maxOutstanding frames are held at once, so a stalled consumer
+ * cannot starve the camera of buffers: requests beyond the cap return an
+ * empty handle and the frame is dropped. Nothing ever blocks.
+ *
+ * The pool may be used from any thread and destroyed while frames are held;
+ * they stay valid until released.
+ */
+class FrameBufferPool {
+public:
+    explicit FrameBufferPool(const FramePoolOptions& options = FramePoolOptions());
+    ~FrameBufferPool();
+
+    FrameBufferPool(const FrameBufferPool&) = delete;
+    FrameBufferPool& operator=(const FrameBufferPool&) = delete;
+
+    /**
+     * A pooled, uninitialized buffer for a BGRA frame of that size.
+     * @return An empty handle at the cap or for an empty size.
+     */
+    FrameBuffer acquire(int width, int height);
+
+    /**
+     * A pooled buffer holding a copy of the frame, without row padding.
+     * @return An empty handle at the cap or for an invalid frame.
+     */
+    FrameBuffer copy(const VideoFrame& frame);
+
+    /**
+     * Share memory owned elsewhere without copying it. The frame must stay
+     * valid until release is called, on the thread dropping the last handle.
+     * @param release Called once no handle remains, e.g. to release the
+     * CVPixelBuffer retained for it; also called if the frame is refused.
+     * @return An empty handle at the cap or for an invalid frame.
+     */
+    FrameBuffer wrap(const VideoFrame& frame, std::function<void()> release);
+
+    /**
+     * Snapshot of the counters; may be read from any thread.
+     */
+    FramePoolCounters counters() const;
+
+private:
+    friend class FrameBuffer;
+    struct State;
+
+    FrameBuffer::Buffer* take(size_t bytes);
+
+    std::shared_ptr<State> mState;  ///< Shared with held buffers, so they can return after the pool is gone.
+};
+
+}
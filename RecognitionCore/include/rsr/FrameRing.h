@@ -0,0 +1,87 @@
+//
+//  FrameRing.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "rsr/VideoFrame.h"
+
+namespace rsr {
+
+struct FrameRingCounters {
+    uint64_t published = 0;    ///< Frames handed over by the producer.
+    uint64_t consumed = 0;     ///< Frames taken by the consumer.
+    uint64_t dropped = 0;      ///< Frames replaced by a newer one before the consumer took them.
+    uint64_t allocations = 0;  ///< Times a pooled buffer had to grow; stays put once frames keep their size.
+    int depth = 0;             ///< Frames waiting for the consumer: 0 or 1.
+};
+
+/**
+ * Hands camera frames from the capture thread (didReceivePreviewFrame:) to
+ * the thread running searches, keeping only the newest one. Three pooled
+ * buffers rotate between the producer, the consumer and a shared slot that
+ * is swapped with a single atomic exchange, so neither side ever waits for
+ * the other: a frame the recognizer had no time for is dropped in favour of
+ * the next, and the recognizer always starts on the freshest frame.
+ *
+ * Exactly one thread may publish and one thread may acquire.
+ */
+class FrameRing {
+public:
+    FrameRing() = default;
+
+    FrameRing(const FrameRing&) = delete;
+    FrameRing& operator=(const FrameRing&) = delete;
+
+    /**
+     * Producer side. Copies the frame into a pooled buffer, without row
+     * padding, and makes it the latest. Never blocks.
+     * @return Sequence number of the frame, counting from 1.
+     */
+    uint64_t publish(const VideoFrame& frame);
+
+    /**
+     * Consumer side. Takes the latest frame if one arrived since the last call.
+     * @param frame Receives a view of the pooled buffer, valid until the next acquireLatest.
+     * @param sequence Receives the frame's sequence number, if given.
+     * @return false if no new frame was published.
+     */
+    bool acquireLatest(VideoFrame& frame, uint64_t* sequence = nullptr);
+
+    /**
+     * Snapshot of the counters; may be read from any thread.
+     */
+    FrameRingCounters counters() const;
+
+private:
+    struct Slot {
+        std::vector<uint8_t> pixels;
+        int width = 0;
+        int height = 0;
+        uint64_t sequence = 0;
+    };
+
+    // Low bits: index of the slot in the shared position; kFresh: not taken by the consumer yet.
+    static constexpr uint32_t kIndexMask = 3;
+    static constexpr uint32_t kFresh = 4;
+
+    Slot mSlots[3];
+
+    // Producer and consumer state on separate cache lines so they do not false-share.
+    alignas(64) std::atomic<uint32_t> mShared{0};
+    alignas(64) uint32_t mBack = 1;
+    std::atomic<uint64_t> mPublished{0};
+    std::atomic<uint64_t> mDropped{0};
+    std::atomic<uint64_t> mAllocations{0};
+    alignas(64) uint32_t mFront = 2;
+    std::atomic<uint64_t> mConsumed{0};
+};
+
+}
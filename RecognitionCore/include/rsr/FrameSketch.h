@@ -0,0 +1,43 @@
+//
+//  FrameSketch.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "rsr/ImagePyramid.h"
+#include "rsr/VideoFrame.h"
+
+namespace rsr {
+
+/**
+ * 16 x 16 luminance sketch of a frame, used to tell near-duplicate frames
+ * apart. Each cell is the mean of a 4 x 4 pixel block at the cell centre,
+ * so computing it reads 4096 pixels whatever the frame size.
+ */
+struct FrameSketch {
+    static constexpr int kSize = 16;
+    std::array<uint8_t, kSize * kSize> cells{};
+    bool valid = false;
+
+    static FrameSketch of(const VideoFrame& frame);
+
+    /**
+     * Nearly the same sketch (cells off by about 1 on average) from the
+     * reduced image of a frame pyramid, for stages that share one. Compare
+     * sketches of one kind only.
+     */
+    static FrameSketch of(const ImagePyramid& pyramid);
+
+    /**
+     * Mean absolute difference of the cells, 0 to 255; 255 if either is invalid.
+     */
+    double distance(const FrameSketch& other) const;
+};
+
+}
@@ -0,0 +1,72 @@
+//
+//  Geometry.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "rsr/Arena.h"
+
+namespace rsr {
+
+struct Point2f {
+    float x = 0.0f;
+    float y = 0.0f;
+};
+
+/**
+ * 3x3 planar projective transform, row-major.
+ */
+struct Homography {
+    double h[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+
+    Point2f map(const Point2f& p) const;
+};
+
+/**
+ * Least-squares homography mapping src[i] onto dst[i] (normalized DLT).
+ * @return false if fewer than 4 points are given or the system is degenerate.
+ */
+bool fitHomography(const Point2f* src, const Point2f* dst, int count, Homography& homography);
+
+struct RansacOptions {
+    float threshold = 3.0f;   ///< Maximum reprojection error of an inlier, in dst pixels.
+    int maxIterations = 500;
+    uint32_t seed = 0x9E3779B9u;
+    /**
+     * Probability of having drawn at least one all-inlier sample at which to
+     * stop: after each better model the iteration bound drops to what its
+     * inlier ratio needs. 0 always runs maxIterations.
+     */
+    float confidence = 0.0f;
+    /**
+     * Correspondences are sorted best first: draw the samples from the best
+     * ones, widening to all of them by maxIterations (PROSAC).
+     */
+    bool progressive = false;
+    const std::atomic<bool>* cancel = nullptr;  ///< Once set, the estimation stops and finds nothing.
+};
+
+/**
+ * Robust homography estimation with RANSAC followed by a refit on the inliers.
+ * @param inliers Receives one flag per correspondence.
+ * @return Number of inliers of the returned model, 0 if none was found.
+ */
+int findHomographyRansac(const std::vector<Point2f>& src, const std::vector<Point2f>& dst,
+                         const RansacOptions& options, Homography& homography, std::vector<uint8_t>& inliers);
+
+/**
+ * Same as above on count correspondences.
+ * @param inliers Receives count flags.
+ * @param scratch Arena for the working buffers, or null for the general allocator.
+ */
+int findHomographyRansac(const Point2f* src, const Point2f* dst, int count, const RansacOptions& options,
+                         Homography& homography, uint8_t* inliers, Arena* scratch = nullptr);
+
+}
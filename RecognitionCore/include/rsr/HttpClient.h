@@ -0,0 +1,50 @@
+//
+//  HttpClient.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "rsr/ErrorCodes.h"
+
+namespace rsr {
+
+/// Default limit on a reply body; a sync reply of 64 items is well below it.
+constexpr size_t kMaxHttpBodySize = size_t(256) << 20;
+
+/**
+ * Fetch a plain http:// URL with a single HTTP/1.1 GET, one connection per
+ * request. This is the portable stand-in for the platform networking stack
+ * used by collection sync; TLS, redirects and chunked replies are not supported.
+ * @param body Receives the response body of a 200 reply.
+ * @param timeoutMs Limit on connecting and on each read or write.
+ * @param maxBodySize Larger replies fail as soon as their Content-Length or
+ * the bytes received show it, rather than being buffered.
+ * @return SUCCESS or COLLECTION_MANAGER_SYNC_ERROR.
+ */
+ErrorCode httpGet(const std::string& url, std::string& body, int timeoutMs = 10000,
+                  size_t maxBodySize = kMaxHttpBodySize);
+
+/**
+ * Take the body out of a complete HTTP/1.1 response as httpGet receives it.
+ * @return SUCCESS for a 200 reply with its whole body, COLLECTION_MANAGER_SYNC_ERROR
+ * for other statuses, chunked replies and bodies shorter than their Content-Length.
+ */
+ErrorCode parseHttpResponse(const std::string& response, std::string& body);
+
+/**
+ * Percent-encode everything but the unreserved characters of RFC 3986.
+ */
+std::string urlEncode(const std::string& text);
+
+/**
+ * Undo urlEncode; malformed escapes are kept as they are.
+ */
+std::string urlDecode(const std::string& text);
+
+}
@@ -0,0 +1,79 @@
+//
+//  Image.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace rsr {
+
+/**
+ * 8-bit luminance image with its own storage. Rows are tightly packed.
+ */
+struct GrayImage {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> pixels;
+
+    GrayImage() = default;
+    GrayImage(int w, int h) : width(w), height(h), pixels(static_cast<size_t>(w) * h) {}
+
+    bool empty() const { return width <= 0 || height <= 0; }
+    uint8_t* row(int y) { return pixels.data() + static_cast<size_t>(y) * width; }
+    const uint8_t* row(int y) const { return pixels.data() + static_cast<size_t>(y) * width; }
+    uint8_t at(int x, int y) const { return pixels[static_cast<size_t>(y) * width + x]; }
+};
+
+/**
+ * Read-only view of tightly packed 8-bit luminance pixels owned elsewhere,
+ * such as a GrayImage or a level of an ImagePyramid.
+ */
+struct GrayView {
+    const uint8_t* pixels = nullptr;
+    int width = 0;
+    int height = 0;
+
+    GrayView() = default;
+    GrayView(const uint8_t* p, int w, int h) : pixels(p), width(w), height(h) {}
+    GrayView(const GrayImage& image) : pixels(image.pixels.data()), width(image.width), height(image.height) {}
+
+    bool empty() const { return width <= 0 || height <= 0; }
+    const uint8_t* row(int y) const { return pixels + static_cast<size_t>(y) * width; }
+    uint8_t at(int x, int y) const { return pixels[static_cast<size_t>(y) * width + x]; }
+};
+
+/**
+ * Converts a BGRA buffer (the VideoFrame layout) to luminance.
+ * @param bgraBytes First byte of the top row.
+ * @param bytesPerRow Row stride of the source, at least 4 * width.
+ */
+GrayImage convertBGRAToGray(const uint8_t* bgraBytes, int width, int height, int bytesPerRow);
+
+/**
+ * Resamples an image to the given size with bilinear interpolation.
+ */
+GrayImage resizeBilinear(const GrayView& src, int width, int height);
+
+/**
+ * Same as above, writing a tightly packed width x height image to dst.
+ * @param columns Scratch space for 3 * width ints.
+ */
+void resizeBilinear(const GrayView& src, int width, int height, uint8_t* dst, int32_t* columns);
+
+/**
+ * Shrinks an image by an integer factor averaging factor x factor blocks.
+ */
+GrayImage downscaleBox(const GrayView& src, int factor);
+
+/**
+ * Same as above, writing a tightly packed (width / factor) x (height / factor) image to dst.
+ */
+void downscaleBox(const GrayView& src, int factor, uint8_t* dst);
+
+}
@@ -0,0 +1,111 @@
+//
+//  ImagePyramid.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "rsr/Arena.h"
+#include "rsr/Image.h"
+#include "rsr/VideoFrame.h"
+
+namespace rsr {
+
+struct PyramidOptions {
+    int maxDimension = 640;  ///< Level 0 is brought down to this size on its longest side if larger.
+    float scale = 1.4f;      ///< Size ratio between consecutive levels.
+};
+
+/**
+ * Scale pyramid of one frame, built once and shared by every stage that
+ * looks at the frame: feature extraction reads its levels in order, the sign
+ * tracker every second one (about an octave apart), and frame sketches the
+ * first. The frame is reduced straight from BGRA with the vectorized
+ * reduceBGRAToGray kernels; further levels are resampled from level 0 the
+ * first time they are asked for, so a stage only pays for the levels it uses.
+ *
+ * All levels live in one Arena that is rewound, not freed, by the next
+ * build: once a pyramid has seen a frame of some size, building it again
+ * for frames of that size allocates nothing. Keep one pyramid per frame
+ * stream or worker thread.
+ *
+ * Not thread-safe, including level(): levels are built on demand.
+ */
+class ImagePyramid {
+public:
+    ImagePyramid() = default;
+    ImagePyramid(const ImagePyramid&) = delete;
+    ImagePyramid& operator=(const ImagePyramid&) = delete;
+
+    /**
+     * Start the pyramid of a new frame, reduced by an integer factor first.
+     * Views of the previous frame's levels become invalid.
+     */
+    void build(const VideoFrame& frame, int factor, const PyramidOptions& options = PyramidOptions());
+
+    /**
+     * Start the pyramid of an image already in luminance. The image is not
+     * copied and must outlive the use of the pyramid.
+     * @param inputScale Original pixels per pixel of image, if the caller already reduced it.
+     */
+    void build(const GrayView& image, int inputScale = 1, const PyramidOptions& options = PyramidOptions());
+
+    bool empty() const { return mLevels.empty(); }
+    const PyramidOptions& options() const { return mOptions; }
+
+    int inputWidth() const { return mInputWidth; }    ///< Size of the input covered by the reduced image.
+    int inputHeight() const { return mInputHeight; }
+
+    /**
+     * Levels down to 1 pixel in either dimension; level(i) for i at least
+     * this is empty.
+     */
+    int levelCount() const { return static_cast<int>(mLevels.size()); }
+
+    /**
+     * Level index, built on first use: level 0 scaled by 1 / scale^index,
+     * sizes rounded to the nearest pixel.
+     */
+    GrayView level(int index) const;
+
+    /**
+     * Input pixels per pixel of a level, horizontally.
+     */
+    float inputScale(int index) const;
+
+    /**
+     * The frame after the integer reduction, before any resampling. Level 0
+     * is this image unless it was larger than maxDimension.
+     */
+    GrayView reduced() const { return mReduced; }
+
+    size_t bytes() const { return mArena.capacity() + mReducedStorage.pixels.capacity(); }
+    uint64_t systemAllocations() const { return mArena.systemAllocations(); }
+
+private:
+    struct Level {
+        int width = 0;
+        int height = 0;
+        const uint8_t* pixels = nullptr;  ///< Null until built.
+    };
+
+    void layout(int inputScale);
+    void buildLevel(int index) const;
+
+    PyramidOptions mOptions;
+    int mInputWidth = 0;
+    int mInputHeight = 0;
+    GrayImage mReducedStorage;   ///< Reused between frames.
+    GrayView mReduced;
+    int mBaseFactor = 0;         ///< Box reduction from mReduced to level 0, 0 if resampled.
+    mutable std::vector<Level> mLevels;
+    mutable Arena mArena{256 * 1024};
+};
+
+}
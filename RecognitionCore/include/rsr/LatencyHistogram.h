@@ -0,0 +1,58 @@
+//
+//  LatencyHistogram.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace rsr {
+
+/**
+ * Distribution of durations with a bounded relative error, in the manner of
+ * HdrHistogram: values are counted in microseconds, exactly below 32 us and
+ * in 32 linear buckets per power of two above, so any percentile is within
+ * about 3% of the true value, from 1 us to over an hour. Recording is a few
+ * relaxed atomic increments, so any number of threads may record while
+ * others read; a read taken meanwhile may miss the values being recorded.
+ */
+class LatencyHistogram {
+public:
+    LatencyHistogram() = default;
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    void record(double ms);
+
+    uint64_t count() const { return mCount.load(std::memory_order_relaxed); }
+    double mean() const;  ///< In milliseconds, like the rest.
+    double max() const { return mMaxUs.load(std::memory_order_relaxed) / 1000.0; }
+
+    /**
+     * Smallest recorded value at least p percent (0-100) of the values are
+     * at or below, rounded to its bucket. 0 if nothing was recorded.
+     */
+    double percentile(double p) const;
+
+    void reset();
+
+private:
+    static constexpr int kSubBits = 5;
+    static constexpr int kSubBuckets = 1 << kSubBits;
+    static constexpr int kOctaves = 32;
+    static constexpr int kBuckets = kSubBuckets * (kOctaves - kSubBits + 1);
+
+    static int bucketOf(uint64_t us);
+    static uint64_t highestIn(int bucket);
+
+    std::atomic<uint64_t> mBuckets[kBuckets] = {};
+    std::atomic<uint64_t> mCount{0};
+    std::atomic<uint64_t> mSumUs{0};
+    std::atomic<uint64_t> mMaxUs{0};
+};
+
+}
@@ -0,0 +1,120 @@
+//
+//  Matcher.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <vector>
+
+#include "rsr/Arena.h"
+#include "rsr/Collection.h"
+#include "rsr/DescriptorIndex.h"
+#include "rsr/Features.h"
+#include "rsr/Geometry.h"
+#include "rsr/SearchResult.h"
+#include "rsr/SearchScheduler.h"
+
+namespace rsr {
+
+struct MatcherOptions {
+    float ratio = 0.8f;                  ///< Lowe ratio between the best and second best distance.
+    int maxDistance = 64;                ///< Hamming distance above which a match is discarded.
+    int minMatches = 8;                  ///< Matches an image needs to be verified.
+    int maxCandidates = 5;               ///< Images with most matches that go to verification.
+    int minInliers = 10;                 ///< Homography inliers needed to report a result.
+    float reprojectionThreshold = 3.0f;  ///< In pixels of the query working resolution.
+    int ransacIterations = 500;          ///< Upper bound; see ransacConfidence.
+    float ransacConfidence = 0.995f;     ///< Stops RANSAC early once this sure of its model; 0 never does.
+    bool progressiveSampling = false;    ///< Draws RANSAC samples from the closest matches first (PROSAC).
+    /**
+     * Inliers that settle a search: once a candidate verifies with this many,
+     * candidates with fewer votes are no longer verified, or stop verifying.
+     * 0 verifies all candidates.
+     */
+    int confidentInliers = 0;
+    int verifyThreads = 0;               ///< Candidates verified at once; 0 uses every scheduler worker.
+};
+
+/**
+ * Reference images a query voted for, with their correspondences: the
+ * outcome of matching, before geometric verification.
+ */
+struct MatchCandidates {
+    struct Candidate {
+        int image = 0;     ///< Index in Collection::images().
+        size_t first = 0;  ///< Its correspondences start at referencePoints[first] and queryPoints[first],
+                           ///< closest descriptors first with progressiveSampling.
+        int count = 0;
+    };
+
+    explicit MatchCandidates(Arena* scratch = nullptr)
+        : images(ArenaAllocator<Candidate>(scratch)), referencePoints(ArenaAllocator<Point2f>(scratch)),
+          queryPoints(ArenaAllocator<Point2f>(scratch)) {}
+
+    ArenaVector<Candidate> images;          ///< Most votes first.
+    ArenaVector<Point2f> referencePoints;   ///< In pixels of the reference image.
+    ArenaVector<Point2f> queryPoints;       ///< In pixels of the query.
+
+    void clear();
+};
+
+/**
+ * Matches query features against a collection: nearest neighbour search with
+ * a ratio test, voting per reference image and homography verification of
+ * the best voted images.
+ */
+class Matcher {
+public:
+    explicit Matcher(const MatcherOptions& options = MatcherOptions());
+
+    const MatcherOptions& options() const { return mOptions; }
+
+    /**
+     * @param results Receives one result per recognized item, best score first.
+     * @param index Index built from collection; brute force search when null.
+     * @param scratch Arena for the working buffers, or null for the general allocator.
+     */
+    void match(const FeatureSet& query, const Collection& collection, std::vector<SearchResult>& results,
+               const DescriptorIndex* index = nullptr, Arena* scratch = nullptr) const;
+
+    /**
+     * First half of match(): nearest neighbour search, ratio test and voting.
+     * @param candidates Receives the best voted images, reused if it has capacity.
+     */
+    void findCandidates(const FeatureSet& query, const Collection& collection, MatchCandidates& candidates,
+                        const DescriptorIndex* index = nullptr, Arena* scratch = nullptr) const;
+
+    /**
+     * Second half of match(): homography verification of the candidates.
+     * Results are the same whether the candidates are verified one after the
+     * other or at once: a confident candidate only drops those with fewer votes.
+     * @param results Receives one result per recognized item, best score first.
+     * @param scheduler Verifies several candidates at once on its workers; one at a time when null.
+     *        With a scratch arena, the parts on workers use an arena each worker keeps.
+     * @param priority Of the parts run on the scheduler.
+     */
+    void verify(const FeatureSet& query, const Collection& collection, const MatchCandidates& candidates,
+                std::vector<SearchResult>& results, Arena* scratch = nullptr, SearchScheduler* scheduler = nullptr,
+                SearchPriority priority = SearchPriority::API) const;
+
+    /**
+     * Match several queries with one index lookup. With the exact index the
+     * reference descriptors are visited in cache-sized blocks and each block is
+     * compared with every query before moving on, so the collection is streamed
+     * from memory once per call instead of once per query.
+     * @param results Resized to queries.size(); results[i] belongs to queries[i].
+     * @param index Index built from collection; brute force search when null.
+     * @param scratch Arena for the working buffers, or null for the general allocator.
+     */
+    void matchBatch(const std::vector<const FeatureSet*>& queries, const Collection& collection,
+                    std::vector<std::vector<SearchResult>>& results, const DescriptorIndex* index = nullptr,
+                    Arena* scratch = nullptr) const;
+
+private:
+    MatcherOptions mOptions;
+};
+
+}
@@ -0,0 +1,308 @@
+//
+//  OnDeviceIR.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "rsr/Collection.h"
+#include "rsr/DescriptorIndex.h"
+#include "rsr/ErrorCodes.h"
+#include "rsr/Features.h"
+#include "rsr/FrameBufferPool.h"
+#include "rsr/Matcher.h"
+#include "rsr/QueryImage.h"
+#include "rsr/SearchResult.h"
+#include "rsr/SearchScheduler.h"
+#include "rsr/SearchStats.h"
+#include "rsr/VideoFrame.h"
+
+namespace rsr {
+
+/**
+ * One image of a batch search. The frame is read in place and must stay
+ * valid until searchWithImages returns.
+ */
+struct SearchRequest {
+    VideoFrame frame;
+    long requestCode = 0;
+};
+
+/**
+ * Outcome of one image of a batch search, keyed by its request code.
+ */
+struct BatchSearchResult {
+    long requestCode = 0;
+    ErrorCode error = ErrorCode::SUCCESS;
+    std::vector<SearchResult> results;
+};
+
+/**
+ * Static prior of where in the frame signs are looked for. Regions are given
+ * as fractions of the frame width and height so one prior fits any camera
+ * resolution. With no regions the whole frame is searched.
+ */
+struct SearchPrior {
+    struct Region {
+        float left = 0.0f;
+        float top = 0.0f;
+        float right = 1.0f;
+        float bottom = 1.0f;
+    };
+
+    std::vector<Region> regions;
+
+    /**
+     * Dashcam prior for right-hand traffic: the right 60% and the upper 70%
+     * of the frame, where roadside and overhead signs are.
+     */
+    static SearchPrior roadSigns();
+
+    /**
+     * The regions in pixels of a frame of that size.
+     */
+    std::vector<FrameRect> rectsFor(int width, int height) const;
+};
+
+/**
+ * Scratch memory used by one search, as reported to a ScratchObserver.
+ */
+struct ScratchUsage {
+    size_t peakBytes = 0;            ///< Arena bytes the search had in use at most, alignment padding included.
+    size_t arenaBytes = 0;           ///< Bytes the thread's arena holds.
+    size_t pyramidBytes = 0;         ///< Bytes the thread's image pyramid holds.
+    uint64_t systemAllocations = 0;  ///< Chunks the thread's arena has requested since it was created.
+};
+
+/**
+ * Called on the thread that ran a search, right after it, with its scratch usage.
+ */
+using ScratchObserver = std::function<void(const ScratchUsage& usage)>;
+
+/**
+ * Called on a scheduler worker with the outcome of an asynchronous search.
+ */
+using SearchCallback = std::function<void(ErrorCode error, std::vector<SearchResult> results)>;
+
+/**
+ * The OnDeviceIR class performs visual search queries on collections loaded
+ * in memory. It is the portable counterpart of CraftAROnDeviceIR.
+ * searchWithImage and searchWithVideoFrame run synchronously on the calling
+ * thread and may be issued concurrently; searchAsync and batch searches run
+ * on a work-stealing SearchScheduler whose workers are owned by this object.
+ */
+class OnDeviceIR {
+public:
+    explicit OnDeviceIR(const ExtractorOptions& extractorOptions = ExtractorOptions(),
+                        const MatcherOptions& matcherOptions = MatcherOptions(),
+                        const SchedulerOptions& schedulerOptions = SchedulerOptions());
+
+    /**
+     * Sets a collection for On Device Image Recognition and builds its
+     * descriptor index. The exact index suits collections of a few hundred
+     * images; larger ones should use IndexType::LSH.
+     * @param setActive Whether to select this collection as the active for searches.
+     * @param indexOptions Index used to search this collection.
+     */
+    void setCollection(std::shared_ptr<const Collection> collection, bool setActive = true,
+                       const IndexOptions& indexOptions = IndexOptions());
+
+    /**
+     * Sets one of the loaded collections as active.
+     * @return ON_DEVICE_IR_COLLECTION_NOT_FOUND if no collection with that uuid was set.
+     */
+    ErrorCode setActiveCollection(const std::string& collectionUUID);
+
+    /**
+     * Unloads a collection. If it was the active one, searches fail with
+     * ON_DEVICE_IR_NO_ACTIVE_COLLECTION until another is set.
+     * Searches already running keep their reference to it until they finish.
+     */
+    void unloadCollection(const std::string& collectionUUID);
+
+    /**
+     * Replaces a loaded collection with an updated version of it, found by
+     * uuid, and indexes it with the options it was set with. It stays active
+     * if it was; searches keep using the previous version until the new one
+     * and its index are ready, and those already running finish on it.
+     * @return ON_DEVICE_IR_COLLECTION_NOT_FOUND if no collection with that uuid was set.
+     */
+    ErrorCode updateCollection(std::shared_ptr<const Collection> collection);
+
+    std::shared_ptr<const Collection> activeCollection() const;
+
+    /**
+     * @return The loaded collection with that uuid, or nullptr.
+     */
+    std::shared_ptr<const Collection> getCollection(const std::string& collectionUUID) const;
+
+    /**
+     * Perform an Image Recognition search on the active collection.
+     * @param results Receives the SearchResults, best score first.
+     * @return SUCCESS or the reason the search could not take place.
+     */
+    ErrorCode searchWithImage(const QueryImage& image, std::vector<SearchResult>& results);
+
+    /**
+     * Perform an Image Recognition search reading the frame pixels in place.
+     * Nothing is copied or retained: the frame only has to stay valid until
+     * this call returns, so it can be issued from processVideoFrameWithBlock:.
+     * @param results Receives the SearchResults, best score first.
+     * @return SUCCESS or the reason the search could not take place.
+     */
+    ErrorCode searchWithVideoFrame(const VideoFrame& frame, std::vector<SearchResult>& results);
+
+    /**
+     * Search only some regions of the frame, in place like the above.
+     * Features are extracted from each region at the resolution a whole-frame
+     * search would use, so the cost scales with the area searched, and
+     * bounding boxes are reported in frame pixels. Regions should not
+     * overlap. The search prior does not apply.
+     * @param regions Rectangles in frame pixels; empty searches the whole frame.
+     * @return SUCCESS if at least one region could be searched, otherwise the
+     * error of the first region.
+     */
+    ErrorCode searchWithVideoFrame(const VideoFrame& frame, const std::vector<FrameRect>& regions,
+                                   std::vector<SearchResult>& results);
+
+    /**
+     * Perform an Image Recognition search on a frame pyramid that other
+     * stages (tracking, duplicate detection) share, e.g. one built with
+     * extractor().pyramidOptions() and reductionFactor. The search prior
+     * does not apply.
+     * @return SUCCESS or the reason the search could not take place.
+     */
+    ErrorCode searchWithPyramid(const ImagePyramid& pyramid, std::vector<SearchResult>& results);
+
+    /**
+     * Queue a search on the scheduler; the image is kept until it has run.
+     * Searches run by priority, so a SINGLE_SHOT picture overtakes queued
+     * finder frames. A FINDER search cancels the FINDER search still waiting
+     * from before, if any: a frame that has gone stale is not searched late.
+     * @param onDone Called on a worker once the search has run. A FINDER search
+     * cancelled by a newer one calls it instead with SEARCH_CANCELLED and no
+     * results, on the thread queueing the newer one, so a FinderRateController
+     * can count it with onSearchDropped. Not called when the returned task is
+     * cancelled, since whoever cancels it knows.
+     * @return The queued task, which can be cancelled or waited on.
+     */
+    std::shared_ptr<SearchTask> searchAsync(QueryImage image, SearchPriority priority, SearchCallback onDone);
+
+    /**
+     * Queue a search on a pooled frame, as above. The frame is not copied:
+     * the task holds the handle until it has run or is cancelled, then the
+     * buffer goes back to its pool.
+     */
+    std::shared_ptr<SearchTask> searchAsync(FrameBuffer frame, SearchPriority priority, SearchCallback onDone);
+
+    /**
+     * Perform Image Recognition searches for a batch of images on the
+     * scheduler. Features are extracted in parallel, then the queries are
+     * matched against the active collection in one pass per part instead of
+     * one per image. The calling thread takes part and blocks until done.
+     * @param results Receives one entry per request, in request order, with
+     * its request code and its own error.
+     * @param threadCount Parts the batch is split into; 0 uses one per scheduler worker.
+     * @return SUCCESS if the batch ran, ON_DEVICE_IR_NO_ACTIVE_COLLECTION otherwise.
+     */
+    ErrorCode searchWithImages(const std::vector<SearchRequest>& requests, std::vector<BatchSearchResult>& results,
+                               int threadCount = 0, SearchPriority priority = SearchPriority::API);
+
+    /**
+     * Restrict every following search that is not given its own regions,
+     * single images and batches included, to the regions of the prior.
+     * An empty prior (the default) searches whole frames.
+     */
+    void setSearchPrior(const SearchPrior& prior);
+
+    SearchPrior searchPrior() const;
+
+    /**
+     * Every thread that searches, scheduler workers and callers alike, keeps
+     * an Arena that all scratch memory of a search comes from (corner scores,
+     * blurred levels, match lists, RANSAC buffers) and rewinds it when the
+     * search ends, along with a reused image pyramid and feature set. Once a
+     * thread has searched a frame of some size, searching another one makes
+     * no allocation besides the results.
+     * With an observer set, each search then reports how much of the arena
+     * it used; a batch reports once per image extracted and once per
+     * matching part. Pass null to stop.
+     */
+    void setScratchObserver(ScratchObserver observer);
+
+    /**
+     * Returns the number of searches that are being processed, queued ones included.
+     */
+    int getCurrentSearchCount() const { return mSearchCount.load(); }
+
+    /**
+     * Latency of every search by stage and count of searches by outcome,
+     * pipelined ones included. Batch searches time preprocessing and
+     * extraction per image but match all images at once, so their matching
+     * is not recorded. On by default; see SearchStats::setEnabled.
+     */
+    SearchStats& stats() { return mStats; }
+    const SearchStats& stats() const { return mStats; }
+
+    /**
+     * stats().snapshot() along with the current search count.
+     */
+    SearchStatsSnapshot statsSnapshot() const;
+
+    const FeatureExtractor& extractor() const { return mExtractor; }
+    const Matcher& matcher() const { return mMatcher; }
+    const SearchScheduler& scheduler() const { return mScheduler; }
+
+private:
+    friend class SearchPipeline;
+
+    // Held together so that an index never outlives its collection.
+    struct LoadedCollection {
+        std::shared_ptr<const Collection> collection;
+        std::shared_ptr<const DescriptorIndex> index;
+        IndexOptions indexOptions;
+    };
+
+    struct SearchScratch;
+    class ScratchScope;
+
+    LoadedCollection activeLoadedCollection() const;
+    ErrorCode searchFrame(const VideoFrame& frame, std::vector<SearchResult>& results);  ///< Not counted.
+    std::shared_ptr<SearchTask> submitSearch(SearchPriority priority, std::function<VideoFrame()> frame,
+                                             SearchCallback onDone);
+    ErrorCode extractFrame(const VideoFrame& frame, SearchScratch& scratch, FeatureSet& features,
+                           StageTimer& timer) const;
+    ErrorCode extractRegions(const VideoFrame& frame, const std::vector<FrameRect>& regions, SearchScratch& scratch,
+                             FeatureSet& features, StageTimer& timer) const;
+    void matchFeatures(const FeatureSet& features, const LoadedCollection& active, std::vector<SearchResult>& results,
+                       SearchScratch& scratch, StageTimer& timer);
+
+    FeatureExtractor mExtractor;
+    Matcher mMatcher;
+
+    mutable std::mutex mMutex;
+    std::map<std::string, LoadedCollection> mCollections;
+    LoadedCollection mActiveCollection;
+    std::atomic<int> mSearchCount{0};
+    SearchStats mStats;
+    std::shared_ptr<SearchTask> mPendingFinder;  ///< Latest FINDER search, guarded by mMutex.
+    std::shared_ptr<const SearchCallback> mPendingFinderDone;  ///< Its onDone, kept until the next one; mMutex.
+    std::shared_ptr<const SearchPrior> mPrior;   ///< Guarded by mMutex; null searches whole frames.
+    std::shared_ptr<const ScratchObserver> mScratchObserver;  ///< Guarded by mMutex.
+    std::atomic<bool> mReportScratch{false};     ///< Whether mScratchObserver is set, read without the lock.
+
+    // Last, so that queued searches finish before the members they use are destroyed.
+    SearchScheduler mScheduler;
+};
+
+}
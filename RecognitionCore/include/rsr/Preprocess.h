@@ -0,0 +1,37 @@
+//
+//  Preprocess.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include "rsr/Image.h"
+#include "rsr/Simd.h"
+#include "rsr/VideoFrame.h"
+
+namespace rsr {
+
+/**
+ * Fused luminance conversion and box reduction of a BGRA frame, the first
+ * stage of every frame search. Each output pixel is the mean luminance of a
+ * factor x factor block, with luminance 0.114 B + 0.587 G + 0.299 R in 8-bit
+ * fixed point; partial blocks at the right and bottom edges are dropped.
+ *
+ * Factors 1, 2 and 4 have vectorized kernels that produce exactly the same
+ * output as the scalar one; other factors always run scalar.
+ *
+ * @param gray Receives a (width / factor) x (height / factor) image. Its
+ * storage is reused when the size does not change, so keeping one GrayImage
+ * per camera stream avoids an allocation per frame.
+ */
+void reduceBGRAToGray(const VideoFrame& frame, int factor, GrayImage& gray);
+
+/**
+ * Same as above with a forced instruction set, for benchmarks and checks.
+ * Falls back to scalar if the level is not supported.
+ */
+void reduceBGRAToGray(const VideoFrame& frame, int factor, GrayImage& gray, SimdLevel level);
+
+}
@@ -0,0 +1,62 @@
+//
+//  QueryImage.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "rsr/Image.h"
+#include "rsr/VideoFrame.h"
+
+namespace rsr {
+
+/**
+ * Image used for recognition queries, the counterpart of CraftARQueryImage.
+ * It keeps its own copy of the BGRA pixels, so it may outlive the buffer it
+ * was created from (e.g. the bytes handed out by processVideoFrameWithBlock:).
+ */
+class QueryImage {
+public:
+    QueryImage() = default;
+
+    /**
+     * Copy a BGRA buffer shaped like a VideoFrame.
+     * @param bgraBytes First byte of the top row.
+     * @param bytesPerRow Row stride of the source, at least 4 * width.
+     */
+    QueryImage(const uint8_t* bgraBytes, int width, int height, int bytesPerRow);
+
+    /**
+     * Copy the pixels of a camera frame, the counterpart of initWithVideoFrame:.
+     */
+    explicit QueryImage(const VideoFrame& frame);
+
+    int width() const { return mWidth; }
+    int height() const { return mHeight; }
+    int bytesPerRow() const { return mBytesPerRow; }
+    const uint8_t* bgraBytes() const { return mPixels.data(); }
+    bool empty() const { return mPixels.empty(); }
+
+    /**
+     * View of the owned pixels, valid as long as this image is alive and unmodified.
+     */
+    VideoFrame view() const { return VideoFrame{mPixels.data(), mWidth, mHeight, mBytesPerRow}; }
+
+    /**
+     * Luminance version of the image, as used by the feature extractor.
+     */
+    GrayImage toGray() const;
+
+private:
+    int mWidth = 0;
+    int mHeight = 0;
+    int mBytesPerRow = 0;
+    std::vector<uint8_t> mPixels;
+};
+
+}
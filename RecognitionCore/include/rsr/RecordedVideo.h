@@ -0,0 +1,109 @@
+//
+//  RecordedVideo.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "rsr/ErrorCodes.h"
+#include "rsr/FrameBufferPool.h"
+
+namespace rsr {
+
+enum class RecordingFormat {
+    RAW_BGRA,  ///< Headerless BGRA frames back to back, as the camera delivers them.
+    Y4M,       ///< YUV4MPEG2, as written by ffmpeg -f yuv4mpegpipe.
+};
+
+/**
+ * Frame size and rate of a recording. A Y4M file carries its own; a raw
+ * BGRA file has no header and must be described.
+ */
+struct RecordingInfo {
+    RecordingFormat format = RecordingFormat::RAW_BGRA;
+    int width = 0;
+    int height = 0;
+    double fps = 30.0;
+};
+
+/**
+ * Reads the frames of a recording front to back into pooled BGRA buffers,
+ * so they reach the search path in the form camera frames do. Y4M files
+ * with 4:2:0, 4:2:2, 4:4:4 or monochrome 8-bit planes are converted with
+ * BT.601, in full range for C420jpeg or COLORRANGE=FULL and studio range
+ * otherwise.
+ */
+class RecordedVideo {
+public:
+    /**
+     * @param poolOptions Pool of the frames handed out; at its cap next() waits for none and fails instead.
+     */
+    explicit RecordedVideo(const FramePoolOptions& poolOptions = FramePoolOptions());
+    ~RecordedVideo();
+
+    RecordedVideo(const RecordedVideo&) = delete;
+    RecordedVideo& operator=(const RecordedVideo&) = delete;
+
+    /**
+     * @param raw Size and rate of a raw BGRA file; ignored for Y4M, which is
+     * recognized by its signature.
+     * @return SUCCESS, or SEARCH_ERROR_READING_FILE if the file cannot be
+     * opened, its header is not understood, or the frame size is missing or
+     * above 16384 pixels on a side.
+     */
+    ErrorCode open(const std::string& path, const RecordingInfo& raw = RecordingInfo());
+
+    const RecordingInfo& info() const { return mInfo; }
+
+    /**
+     * Read the next frame.
+     * @param frame Receives the frame, or an empty buffer at the end of the
+     * file or if the pool had no buffer to spare, in which case the frame is
+     * skipped as a camera would drop it.
+     * @return SUCCESS, or SEARCH_ERROR_READING_FILE for a damaged file, in
+     * which case reading cannot continue.
+     */
+    ErrorCode next(FrameBuffer& frame);
+
+    /**
+     * Frames read so far, skipped ones included; the index of the next one.
+     */
+    uint64_t frameIndex() const { return mFrameIndex; }
+
+    /**
+     * Whether next() has reached the end of the file.
+     */
+    bool finished() const { return mFinished; }
+
+    /**
+     * Go back to the first frame.
+     */
+    ErrorCode rewind();
+
+    const FrameBufferPool& pool() const { return mPool; }
+
+private:
+    enum class Chroma { MONO, C420, C422, C444 };
+
+    ErrorCode readY4mHeader();
+    void convertYuv(uint8_t* bgra) const;
+
+    FrameBufferPool mPool;
+    FILE* mFile = nullptr;
+    RecordingInfo mInfo;
+    long mDataStart = 0;  ///< Offset of the first frame.
+    Chroma mChroma = Chroma::C420;
+    bool mFullRange = false;
+    std::vector<uint8_t> mPlanes;  ///< One Y4M frame as read, before conversion.
+    uint64_t mFrameIndex = 0;
+    bool mFinished = false;
+};
+
+}
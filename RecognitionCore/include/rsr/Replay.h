@@ -0,0 +1,103 @@
+//
+//  Replay.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "rsr/ErrorCodes.h"
+#include "rsr/SearchStats.h"
+
+namespace rsr {
+
+class OnDeviceIR;
+class RecordedVideo;
+
+enum class ReplayPacing {
+    REAL_TIME,            ///< At the recording's own frame rate.
+    FIXED_RATE,           ///< At ReplayOptions::rate frames per second.
+    AS_FAST_AS_POSSIBLE,  ///< Each frame as soon as the previous one has been searched; none is dropped.
+};
+
+struct ReplayOptions {
+    ReplayPacing pacing = ReplayPacing::REAL_TIME;
+    double rate = 30.0;       ///< Frames per second with FIXED_RATE.
+    bool pipeline = false;    ///< Search through a SearchPipeline instead of finder searchAsync.
+    uint64_t maxFrames = 0;   ///< Stop after that many frames of the recording; 0 plays it all.
+};
+
+/**
+ * Frames first to last, inclusive, in which an item should be recognized.
+ */
+struct ReplayLabel {
+    uint64_t firstFrame = 0;
+    uint64_t lastFrame = 0;
+    std::string itemUUID;
+};
+
+/**
+ * Read labels from a text file, one per line as "<first frame> <last frame>
+ * <item uuid>"; blank lines and lines starting with # are skipped.
+ * @return SUCCESS or SEARCH_ERROR_READING_FILE.
+ */
+ErrorCode loadReplayLabels(const std::string& path, std::vector<ReplayLabel>& labels);
+
+/**
+ * What a replay did with the frames of a recording and how the searches went.
+ * Latencies are in milliseconds, from the frame's delivery to its result.
+ */
+struct ReplayReport {
+    uint64_t frames = 0;       ///< Frames of the recording played.
+    uint64_t delivered = 0;    ///< Frames handed to the search path.
+    uint64_t late = 0;         ///< Frames dropped because reading them fell behind the pacing.
+    uint64_t refused = 0;      ///< Frames dropped because searches still held every frame buffer.
+    uint64_t searched = 0;     ///< Delivered frames searched; the others were superseded by newer ones.
+    uint64_t withResults = 0;  ///< Searched frames with at least one result.
+    uint64_t labeled = 0;      ///< Searched frames inside a label.
+    uint64_t correct = 0;      ///< Labeled frames whose top result is the labeled item.
+    uint64_t wrong = 0;        ///< Frames whose top result is another item, or any item outside the labels.
+    double seconds = 0.0;      ///< From the first frame to the last result.
+    double latencyMean = 0.0;
+    double latencyP50 = 0.0;
+    double latencyP90 = 0.0;
+    double latencyP99 = 0.0;
+    double latencyMax = 0.0;
+    SearchStatsSnapshot stats;  ///< The OnDeviceIR's stats over the replay.
+
+    double framesPerSecond() const { return seconds > 0.0 ? searched / seconds : 0.0; }
+
+    /**
+     * Share of labeled frames recognized correctly, or without labels of
+     * searched frames with any result.
+     */
+    double recognitionRate() const;
+
+    /**
+     * The report as a single line of JSON, with the stats snapshot under "stats".
+     */
+    std::string toJson() const;
+};
+
+/**
+ * Play a recording into the search path the way the camera feeds it. Paced
+ * replays deliver each frame when it is due and drop it if reading it made
+ * the replay fall more than a frame behind; frames are then searched as
+ * finder frames with searchAsync, so a frame still waiting when the next one
+ * arrives is superseded, or submitted to a SearchPipeline. Frames come from
+ * the video's pool, so a search path that holds on to too many of them sees
+ * frames refused, as a camera out of buffers would. The OnDeviceIR's stats
+ * are reset first so that the report covers the replay alone. Playing
+ * starts from the video's current frame; labels count from the first.
+ * @param labels Ground truth for the recognition rate; may be empty.
+ * @return SUCCESS, or the error reading the recording; the report then covers the frames before it.
+ */
+ErrorCode replayRecording(OnDeviceIR& onDeviceIR, RecordedVideo& video, const ReplayOptions& options,
+                          const std::vector<ReplayLabel>& labels, ReplayReport& report);
+
+}
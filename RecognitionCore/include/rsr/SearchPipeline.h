@@ -0,0 +1,198 @@
+//
+//  SearchPipeline.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "rsr/Arena.h"
+#include "rsr/ErrorCodes.h"
+#include "rsr/FrameBufferPool.h"
+#include "rsr/LatencyHistogram.h"
+#include "rsr/SearchResult.h"
+
+namespace rsr {
+
+class OnDeviceIR;
+
+/**
+ * Stages of a SearchPipeline, in the order a frame goes through them.
+ */
+enum class PipelineStage {
+    PREPROCESS = 0,  ///< Reduce the frame to luminance; the frame is released after it.
+    EXTRACT = 1,     ///< Build the pyramid levels and extract features.
+    MATCH = 2,       ///< Nearest neighbour search and voting.
+    VERIFY = 3,      ///< Homography verification of the voted images.
+    DISPATCH = 4,    ///< Call back with the results.
+};
+
+constexpr int kPipelineStageCount = 5;
+
+const char* pipelineStageName(PipelineStage stage);
+
+struct PipelineOptions {
+    int extractWorkers = 1;  ///< Threads of the extraction stage.
+    int matchWorkers = 1;    ///< Threads of the matching stage.
+    int verifyWorkers = 1;   ///< Threads of the verification stage.
+    int queueDepth = 2;      ///< Frames that may wait in front of each stage.
+};
+
+struct PipelineCounters {
+    uint64_t submitted = 0;  ///< Frames accepted by submit.
+    uint64_t dropped = 0;    ///< Frames replaced by a newer one before preprocessing started.
+    uint64_t completed = 0;  ///< Frames dispatched, failed ones included.
+    uint64_t failed = 0;     ///< Frames dispatched with an error.
+    int inFlight = 0;        ///< Frames submitted and not yet dispatched.
+};
+
+/**
+ * Called on the dispatch thread for each frame, in the order frames finish.
+ * @param sequence The number submit returned for the frame.
+ */
+using PipelineCallback =
+    std::function<void(uint64_t sequence, ErrorCode error, const std::vector<SearchResult>& results)>;
+
+/**
+ * The on-device search split into stages that run concurrently on frames in
+ * succession, each on its own thread(s) and fed by a bounded queue. While
+ * one frame is verified the next is matched and a third extracted, so the
+ * frame rate is bound by the slowest stage instead of the sum of them all.
+ * Results are the same as searchWithVideoFrame's for the same frame when no
+ * search prior is set; the pipeline always searches whole frames.
+ *
+ * A stage waits when the queue in front of the next one is full, so queues
+ * hold at most queueDepth frames each; when the queue of frames waiting for
+ * preprocessing is full, submit drops the oldest of them for the new frame
+ * instead, so it never blocks a camera thread unless asked to. Frames,
+ * pyramids and features live in jobs that are recycled, so a running
+ * pipeline allocates nothing per frame besides the results.
+ *
+ * Every stage records how long frames waited for it and how long it took
+ * them, so the bottleneck can be read off latency() and wait(). Stage times,
+ * the wait for preprocessing and outcomes also go to the OnDeviceIR's stats.
+ *
+ * Frames are searched in the collection active when they are preprocessed.
+ * Frames count in the OnDeviceIR's getCurrentSearchCount until dispatched.
+ * Destroying the pipeline finishes the frames already submitted.
+ */
+class SearchPipeline {
+public:
+    /**
+     * Start the stage threads.
+     * @param onDeviceIR Extractor, matcher and collections to use; must outlive the pipeline.
+     */
+    SearchPipeline(OnDeviceIR& onDeviceIR, PipelineCallback onResult,
+                   const PipelineOptions& options = PipelineOptions());
+    ~SearchPipeline();
+
+    SearchPipeline(const SearchPipeline&) = delete;
+    SearchPipeline& operator=(const SearchPipeline&) = delete;
+
+    /**
+     * Queue a frame for preprocessing; the pipeline holds it until then.
+     * @param wait Wait for room instead of dropping the oldest waiting frame,
+     * for sources that must not lose frames, such as recordings.
+     * @return The frame's sequence number, counting from 1.
+     */
+    uint64_t submit(FrameBuffer frame, bool wait = false);
+
+    /**
+     * Block until every frame submitted so far has been dispatched.
+     */
+    void drain();
+
+    /**
+     * Time frames spent in a stage, in milliseconds.
+     */
+    const LatencyHistogram& latency(PipelineStage stage) const { return mStages[static_cast<int>(stage)].latency; }
+
+    /**
+     * Time frames waited in the queue in front of a stage.
+     */
+    const LatencyHistogram& wait(PipelineStage stage) const { return mStages[static_cast<int>(stage)].wait; }
+
+    /**
+     * Clear every stage's latency() and wait(), to leave out a warm-up.
+     */
+    void resetLatencies();
+
+    PipelineCounters counters() const;
+
+    const PipelineOptions& options() const { return mOptions; }
+
+private:
+    struct Job;
+
+    // Bounded queue of jobs in front of a stage.
+    class JobQueue {
+    public:
+        void setCapacity(size_t capacity) { mCapacity = capacity; }
+
+        /**
+         * @return false if the queue was closed.
+         */
+        bool push(Job* job);
+
+        /**
+         * Push without waiting; if full, the oldest job is taken out to make room.
+         * @return The job taken out, or null.
+         */
+        Job* pushReplacingOldest(Job* job);
+
+        /**
+         * @return The next job, or null once the queue is closed and empty.
+         */
+        Job* pop();
+
+        Job* tryPop();
+
+        void close();
+
+    private:
+        std::mutex mMutex;
+        std::condition_variable mNotEmpty;
+        std::condition_variable mNotFull;
+        std::vector<Job*> mJobs;  ///< Oldest first.
+        size_t mCapacity = 1;
+        bool mClosed = false;
+    };
+
+    struct Stage {
+        JobQueue queue;
+        std::vector<std::thread> workers;
+        std::atomic<int> running{0};
+        LatencyHistogram latency;
+        LatencyHistogram wait;
+    };
+
+    void runStage(PipelineStage stage);
+    bool process(PipelineStage stage, Job& job, Arena& scratch);
+    void recycle(Job* job);
+    void finish(Job* job);
+
+    OnDeviceIR& mOnDeviceIR;
+    PipelineCallback mOnResult;
+    PipelineOptions mOptions;
+    Stage mStages[kPipelineStageCount];
+
+    std::vector<std::unique_ptr<Job>> mJobs;
+    JobQueue mFree;  ///< Jobs not in use; holds them all, so pushes never wait.
+
+    mutable std::mutex mMutex;
+    std::condition_variable mDrained;
+    uint64_t mNextSequence = 1;  ///< Guarded by mMutex, like the counters.
+    PipelineCounters mCounters;
+};
+
+}
@@ -0,0 +1,100 @@
+//
+//  SearchRequestQueue.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+#include "rsr/FrameSketch.h"
+#include "rsr/QueryImage.h"
+#include "rsr/VideoFrame.h"
+
+namespace rsr {
+
+struct RequestQueueOptions {
+    size_t depth = 2;                  ///< Requests waiting to be sent; the oldest is dropped beyond it.
+    double deadlineSeconds = 1.5;      ///< A request not sent by then is discarded; 0 never expires.
+    double coalesceDistance = 6.0;     ///< FrameSketch distance under which frames count as the same; 0 disables.
+};
+
+struct RequestQueueCounters {
+    uint64_t enqueued = 0;   ///< Requests pushed, coalesced ones included.
+    uint64_t sent = 0;       ///< Requests handed to the sender.
+    uint64_t dropped = 0;    ///< Oldest requests dropped because the queue was full.
+    uint64_t expired = 0;    ///< Requests discarded because their deadline passed before sending.
+    uint64_t coalesced = 0;  ///< Frames folded into a near-duplicate waiting or in-flight request.
+    int depth = 0;           ///< Requests waiting now.
+};
+
+/**
+ * Search requests waiting to be sent, the bounded counterpart of the cloud
+ * controller's mAccumulateSearches queue: a slow connection cannot build a
+ * backlog whose results would arrive too late to matter for a moving vehicle.
+ *
+ * - At most depth requests wait; pushing onto a full queue drops the oldest.
+ * - Every request has a deadline and is discarded, not sent, once it passes.
+ * - A frame nearly identical to the newest waiting request replaces its
+ *   image instead of queueing behind it, and one nearly identical to the
+ *   request last sent is dropped since that search already covers it.
+ *
+ * Any number of threads may push; one or more senders pop.
+ */
+class SearchRequestQueue {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Request {
+        uint64_t id = 0;               ///< Order of arrival, counting from 1.
+        QueryImage image;
+        Clock::time_point enqueuedAt;  ///< When the first frame folded into this request arrived.
+        Clock::time_point deadline;
+        int frames = 1;                ///< Frames coalesced into this request, itself included.
+    };
+
+    explicit SearchRequestQueue(const RequestQueueOptions& options = RequestQueueOptions());
+
+    /**
+     * Queue a search for a frame. The pixels are copied only if it is queued.
+     * @return false if it was coalesced into the request last sent.
+     */
+    bool push(const VideoFrame& frame);
+
+    /**
+     * Take the oldest request still within its deadline, discarding expired ones.
+     * @param timeoutMs Time to wait for one; 0 returns at once.
+     * @return false on timeout or once the queue is closed and empty.
+     */
+    bool pop(Request& request, int timeoutMs = 0);
+
+    /**
+     * Wake waiting senders and refuse further requests.
+     */
+    void close();
+
+    RequestQueueCounters counters() const;
+
+private:
+    struct Entry {
+        Request request;
+        FrameSketch sketch;
+    };
+
+    RequestQueueOptions mOptions;
+    mutable std::mutex mMutex;
+    std::condition_variable mAvailable;
+    std::deque<Entry> mEntries;
+    FrameSketch mLastSent;
+    uint64_t mNextId = 1;
+    bool mClosed = false;
+    RequestQueueCounters mCounters;
+};
+
+}
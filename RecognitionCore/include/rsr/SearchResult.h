@@ -0,0 +1,48 @@
+//
+//  SearchResult.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <string>
+
+#include "rsr/Collection.h"
+
+namespace rsr {
+
+/**
+ * Corners of a matched reference image in query image pixels.
+ */
+struct BoundingBox {
+    float topLeftX = 0.0f;
+    float topLeftY = 0.0f;
+    float topRightX = 0.0f;
+    float topRightY = 0.0f;
+    float bottomLeftX = 0.0f;
+    float bottomLeftY = 0.0f;
+    float bottomRightX = 0.0f;
+    float bottomRightY = 0.0f;
+};
+
+/**
+ * A SearchResult holds the information about an item found in a visual
+ * search query, the counterpart of CraftARSearchResult: the item, the image
+ * matched, the score and the bounding box in the query image.
+ */
+struct SearchResult {
+    Item item;
+    std::string matchedImageUUID;
+
+    /**
+     * Fraction of the smaller of the two feature sets (query or reference)
+     * explained by the fitted homography, in [0, 1].
+     */
+    float score = 0.0f;
+
+    BoundingBox matchBoundingBox;
+};
+
+}
@@ -0,0 +1,143 @@
+//
+//  SearchScheduler.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rsr {
+
+/**
+ * Order in which queued searches run; higher first.
+ */
+enum class SearchPriority : int {
+    FINDER = 0,       ///< Frames of finder mode; a newer one makes a waiting one stale.
+    API = 1,          ///< Searches requested by the application.
+    SINGLE_SHOT = 2,  ///< A picture the user is waiting on.
+};
+
+constexpr int kSearchPriorityCount = 3;
+
+struct SchedulerOptions {
+    int workerCount = 0;      ///< Worker threads; 0 uses one per hardware thread.
+    bool pinWorkers = false;  ///< Bind worker i to core i where the platform allows it.
+};
+
+struct SchedulerCounters {
+    uint64_t executed = 0;   ///< Tasks run by workers or by threads waiting on them.
+    uint64_t stolen = 0;     ///< Tasks a worker took from another worker's queue.
+    uint64_t cancelled = 0;  ///< Cancelled tasks dropped from the queues.
+    int queued = 0;          ///< Tasks waiting in the worker queues, cancelled ones included until dropped.
+};
+
+/**
+ * A unit of work queued on a SearchScheduler.
+ */
+class SearchTask {
+public:
+    enum class State { PENDING, RUNNING, DONE, CANCELLED };
+
+    SearchTask(SearchPriority priority, std::function<void()> work);
+
+    SearchTask(const SearchTask&) = delete;
+    SearchTask& operator=(const SearchTask&) = delete;
+
+    /**
+     * Keep the task from running if it has not started yet.
+     * @return true if it will not run.
+     */
+    bool cancel();
+
+    /**
+     * Block until the task has run or was cancelled.
+     */
+    void wait();
+
+    State state() const { return mState.load(); }
+    SearchPriority priority() const { return mPriority; }
+
+private:
+    friend class SearchScheduler;
+
+    bool tryStart();
+    void runClaimed();
+    void settle(State state);
+    void reuse(SearchPriority priority, std::function<void()> work);  ///< Pending again, once settled.
+
+    SearchPriority mPriority;
+    std::function<void()> mWork;  ///< Released once the task has run or was cancelled.
+    std::atomic<State> mState{State::PENDING};
+    std::mutex mMutex;
+    std::condition_variable mSettled;
+};
+
+/**
+ * Work-stealing thread pool that runs searches. Every worker has a queue per
+ * priority: it takes its own oldest task first and, when it has nothing of a
+ * priority, steals the oldest task of that priority from another worker, so
+ * a higher priority task anywhere runs before a lower one. Tasks submitted
+ * from a worker go to that worker's queue, the others round-robin.
+ *
+ * Destroying the scheduler runs the tasks still queued, then joins the workers.
+ */
+class SearchScheduler {
+public:
+    explicit SearchScheduler(const SchedulerOptions& options = SchedulerOptions());
+    ~SearchScheduler();
+
+    SearchScheduler(const SearchScheduler&) = delete;
+    SearchScheduler& operator=(const SearchScheduler&) = delete;
+
+    std::shared_ptr<SearchTask> submit(SearchPriority priority, std::function<void()> work);
+
+    /**
+     * Run work(0..parts-1) in parallel and return when all parts are done.
+     * Part 0 runs on the calling thread, which then runs any part no worker
+     * has started yet, so it is safe to call from a worker. The part tasks are
+     * reused by later runs on the same thread and scheduler, which then do not
+     * allocate them.
+     */
+    void run(int parts, SearchPriority priority, const std::function<void(int part)>& work);
+
+    int workerCount() const { return static_cast<int>(mWorkers.size()); }
+
+    SchedulerCounters counters() const;
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<std::shared_ptr<SearchTask>> queues[kSearchPriorityCount];
+        std::thread thread;
+    };
+
+    void enqueue(const std::shared_ptr<SearchTask>& task);
+    void workerLoop(int index, bool pin);
+    std::shared_ptr<SearchTask> findTask(int index);
+    void execute(SearchTask& task);
+
+    std::vector<std::unique_ptr<Worker>> mWorkers;
+    std::atomic<unsigned> mNextWorker{0};
+
+    std::mutex mSleepMutex;
+    std::condition_variable mWake;
+    std::atomic<int> mQueued{0};
+    bool mStopping = false;
+
+    std::atomic<uint64_t> mExecuted{0};
+    std::atomic<uint64_t> mStolen{0};
+    std::atomic<uint64_t> mCancelled{0};
+};
+
+}
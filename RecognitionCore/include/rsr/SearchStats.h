@@ -0,0 +1,139 @@
+//
+//  SearchStats.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "rsr/ErrorCodes.h"
+#include "rsr/LatencyHistogram.h"
+
+namespace rsr {
+
+/**
+ * Stages a search is timed in, in the order it goes through them.
+ */
+enum class SearchStage {
+    QUEUE_WAIT = 0,  ///< Asynchronous and pipelined searches: from submission to the start of the search.
+    PREPROCESS = 1,  ///< Reading the frame into the reduced luminance pyramid.
+    EXTRACT = 2,     ///< Corner detection and descriptors.
+    MATCH = 3,       ///< Nearest neighbour search and voting.
+    VERIFY = 4,      ///< Homography verification of the voted images.
+    CALLBACK = 5,    ///< The completion callback of an asynchronous or pipelined search.
+};
+
+constexpr int kSearchStageCount = 6;
+
+/**
+ * Returns the stage's name in snapshots, e.g. "queue_wait".
+ */
+const char* searchStageName(SearchStage stage);
+
+/**
+ * Summary of one stage's histogram, in milliseconds.
+ */
+struct StageSnapshot {
+    uint64_t count = 0;
+    double mean = 0.0;
+    double p50 = 0.0;
+    double p90 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+};
+
+/**
+ * Everything SearchStats recorded up to some point.
+ */
+struct SearchStatsSnapshot {
+    StageSnapshot stages[kSearchStageCount];
+    std::map<ErrorCode, uint64_t> outcomes;  ///< Searches finished, by result; codes never seen are left out.
+    int searchesInProgress = 0;              ///< getCurrentSearchCount() when the snapshot was taken.
+
+    const StageSnapshot& stage(SearchStage s) const { return stages[static_cast<int>(s)]; }
+
+    /**
+     * The snapshot as a single line of JSON, stages and outcomes keyed by name:
+     * {"searches_in_progress":0,"stages":{"queue_wait":{"count":..,"mean_ms":..,
+     * "p50_ms":..,"p90_ms":..,"p99_ms":..,"max_ms":..},..},"outcomes":{"SUCCESS":..}}
+     */
+    std::string toJson() const;
+};
+
+/**
+ * Latency histograms per search stage and outcome counters per error code.
+ * Recording takes a few relaxed atomic operations and no lock, so stats are
+ * meant to stay on in production; snapshots may be taken at any time from
+ * any thread.
+ */
+class SearchStats {
+public:
+    SearchStats() = default;
+    SearchStats(const SearchStats&) = delete;
+    SearchStats& operator=(const SearchStats&) = delete;
+
+    /**
+     * While disabled nothing is recorded and searches read no clock for it.
+     */
+    void setEnabled(bool enabled) { mEnabled.store(enabled, std::memory_order_relaxed); }
+    bool enabled() const { return mEnabled.load(std::memory_order_relaxed); }
+
+    void record(SearchStage stage, double ms) { mStages[static_cast<int>(stage)].record(ms); }
+
+    /**
+     * Count finished searches with that result.
+     */
+    void countOutcome(ErrorCode error, uint64_t searches = 1);
+
+    const LatencyHistogram& latency(SearchStage stage) const { return mStages[static_cast<int>(stage)]; }
+
+    SearchStatsSnapshot snapshot() const;
+
+    void reset();
+
+private:
+    // SUCCESS and every SDK error, indexed by value + 1, then SEARCH_CANCELLED in the last slot.
+    static constexpr int kCancelledOutcome = static_cast<int>(ErrorCode::SEARCH_ERROR_IMAGE_HAS_TRANSPARENCY) + 2;
+    static constexpr int kOutcomeCount = kCancelledOutcome + 1;
+
+    static int outcomeIndex(ErrorCode error);
+
+    std::atomic<bool> mEnabled{true};
+    LatencyHistogram mStages[kSearchStageCount];
+    std::atomic<uint64_t> mOutcomes[kOutcomeCount] = {};
+};
+
+/**
+ * Times the stages of one search as they follow each other: each lap charges
+ * the time since the previous one to a stage, and stages lapped several
+ * times, such as the regions of a frame, are recorded once with their sum
+ * when the timer goes out of scope. With null or disabled stats it reads no
+ * clock at all.
+ */
+class StageTimer {
+public:
+    explicit StageTimer(SearchStats* stats);
+    ~StageTimer();
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+    void lap(SearchStage stage);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    SearchStats* mStats;  ///< Null when not timing.
+    Clock::time_point mLast;
+    double mMs[kSearchStageCount] = {};
+    bool mLapped[kSearchStageCount] = {};
+};
+
+}
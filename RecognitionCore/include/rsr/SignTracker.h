@@ -0,0 +1,143 @@
+//
+//  SignTracker.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "rsr/ErrorCodes.h"
+#include "rsr/Geometry.h"
+#include "rsr/Image.h"
+#include "rsr/ImagePyramid.h"
+#include "rsr/OnDeviceIR.h"
+#include "rsr/SearchResult.h"
+#include "rsr/VideoFrame.h"
+
+namespace rsr {
+
+struct TrackingOptions {
+    int refreshFrames = 15;     ///< Frames followed by tracking before recognition runs again; 0 never refreshes.
+    int maxPoints = 64;         ///< Corners followed per sign.
+    int minPoints = 10;         ///< Fewer corners agreeing on the motion of a sign count as track loss.
+    int windowRadius = 5;       ///< Half size of the Lucas-Kanade window, in working pixels.
+    int pyramidLevels = 3;      ///< Levels tracked on: every second level of the frame pyramid.
+    int maxDimension = 640;     ///< Working size of the pyramids built for frames given as VideoFrame.
+    float maxResidual = 14.0f;  ///< Mean absolute window difference above which a corner is dropped.
+};
+
+/**
+ * Follows recognized signs from frame to frame with pyramidal Lucas-Kanade
+ * optical flow, on every second level of an ImagePyramid: its own, or one
+ * shared with the other stages that look at the frame. Each sign is seeded
+ * with the strongest corners (minimum eigenvalue of the structure tensor)
+ * inside its match bounding box; every new frame the corners are tracked
+ * from the previous one, a homography is fitted to them with RANSAC and the
+ * box corners are moved with it. Corners that disagree with the motion are
+ * dropped, and the box is seeded again when fewer than half are left.
+ *
+ * Not thread-safe: use one tracker per frame stream.
+ */
+class SignTracker {
+public:
+    explicit SignTracker(const TrackingOptions& options = TrackingOptions());
+
+    /**
+     * Start following the signs inside the boxes, in frame pixels.
+     * @return false, with nothing tracked, if a box has too few corners to follow.
+     */
+    bool start(const VideoFrame& frame, const std::vector<BoundingBox>& boxes);
+
+    /**
+     * Same as above, on the pyramid of the frame, which need not outlive the call.
+     */
+    bool start(const ImagePyramid& pyramid, const std::vector<BoundingBox>& boxes);
+
+    /**
+     * Follow the signs into the next frame of the stream.
+     * @param boxes Receives the box of every sign, in the order given to start.
+     * @return false, with nothing tracked any more, if a sign was lost.
+     */
+    bool track(const VideoFrame& frame, std::vector<BoundingBox>& boxes);
+
+    /**
+     * Same as above, on the pyramid of the frame. It must be built with the
+     * same options and reduction as the pyramids before it.
+     */
+    bool track(const ImagePyramid& pyramid, std::vector<BoundingBox>& boxes);
+
+    bool isTracking() const { return !mTargets.empty(); }
+
+    void reset();
+
+private:
+    struct Target {
+        std::vector<Point2f> points;  ///< Corners in level 0 pixels of the previous frame.
+        Point2f box[4];               ///< Box clockwise from the top left, in level 0 pixels.
+    };
+
+    const ImagePyramid& ownPyramid(const VideoFrame& frame);
+    std::vector<GrayView> trackingLevels(const ImagePyramid& pyramid) const;
+    void keep(const std::vector<GrayView>& levels);
+    void seed(Target& target, const GrayView& image) const;
+
+    TrackingOptions mOptions;
+    ImagePyramid mPyramid;             ///< For frames given as VideoFrame.
+    std::vector<GrayImage> mPrevious;  ///< Tracking levels of the previous frame, copied.
+    std::vector<Target> mTargets;
+};
+
+struct TrackedSearchCounters {
+    uint64_t frames = 0;
+    uint64_t searches = 0;
+    uint64_t tracked = 0;  ///< Frames answered by moving the boxes of the last results.
+    uint64_t losses = 0;   ///< Frames on which a track was lost.
+};
+
+/**
+ * Finder-mode searches that only run recognition when they have to: after a
+ * search finds signs, the following frames move their match bounding boxes
+ * with a SignTracker at camera rate, and a full search runs again every
+ * refreshFrames frames or as soon as a sign is lost. A refresh that finds
+ * nothing while the track still holds keeps the track once. Each frame is
+ * reduced into one ImagePyramid that tracking and search both read; the
+ * whole frame is searched, whatever the search prior.
+ *
+ * Not thread-safe: use one per frame stream.
+ */
+class TrackedSearch {
+public:
+    explicit TrackedSearch(const TrackingOptions& options = TrackingOptions());
+
+    /**
+     * Answer a frame, by tracking if possible and by a search on the active
+     * collection otherwise.
+     * @param searched Set to whether recognition ran for this frame, if given.
+     * @return The search error, or SUCCESS for tracked results.
+     */
+    ErrorCode process(OnDeviceIR& onDeviceIR, const VideoFrame& frame, std::vector<SearchResult>& results,
+                      bool* searched = nullptr);
+
+    /**
+     * Drop the tracks, e.g. after the active collection changed.
+     */
+    void reset();
+
+    const TrackedSearchCounters& counters() const { return mCounters; }
+
+private:
+    TrackingOptions mOptions;
+    SignTracker mTracker;
+    ImagePyramid mPyramid;  ///< Of the current frame, shared by tracking and search.
+    std::vector<SearchResult> mResults;
+    std::vector<BoundingBox> mBoxes;
+    int mSinceSearch = 0;
+    bool mMissedRefresh = false;  ///< The last refresh found nothing and the track was kept.
+    TrackedSearchCounters mCounters;
+};
+
+}
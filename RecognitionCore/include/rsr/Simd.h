@@ -0,0 +1,33 @@
+//
+//  Simd.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+namespace rsr {
+
+/**
+ * Instruction set used by a vectorized kernel.
+ */
+enum class SimdLevel {
+    SCALAR,
+    SSE41,
+    AVX2,
+    AVX512,  ///< AVX-512F with VPOPCNTDQ. Kernels without an AVX-512 version run their AVX2 one.
+    NEON,
+};
+
+/**
+ * Best level supported by both this build and the CPU it runs on.
+ * Detected once, on first use.
+ */
+SimdLevel bestSimdLevel();
+
+bool isSimdLevelSupported(SimdLevel level);
+
+const char* simdLevelName(SimdLevel level);
+
+}
@@ -0,0 +1,66 @@
+//
+//  VideoFrame.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <cstdint>
+
+namespace rsr {
+
+/**
+ * Rectangle of frame pixels.
+ */
+struct FrameRect {
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+
+    bool isEmpty() const { return width <= 0 || height <= 0; }
+};
+
+/**
+ * Non-owning view of a BGRA camera frame, shaped like the SDK's VideoFrame.
+ *
+ * Lifetime: the view never copies or retains the pixels. It is only valid
+ * while the buffer it points to is, which for a camera frame means inside
+ * the processVideoFrameWithBlock: block:
+ *
+ *     [image processVideoFrameWithBlock:^(VideoFrame* frame, unsigned char* bgraBytes) {
+ *         rsr::VideoFrame view{bgraBytes, (int)frame.width, (int)frame.height, (int)frame.bytesPerRow};
+ *         onDeviceIR.searchWithVideoFrame(view, results);
+ *     }];
+ *
+ * Anything that needs the pixels after the block returns must either keep
+ * the camera buffer alive through FrameBufferPool::wrap, or copy them into a
+ * pooled FrameBuffer or a QueryImage.
+ */
+struct VideoFrame {
+    const uint8_t* bgraBytes = nullptr;
+    int width = 0;
+    int height = 0;
+    int bytesPerRow = 0;  ///< May include row padding, at least 4 * width.
+
+    bool isValid() const { return bgraBytes != nullptr && width > 0 && height > 0 && bytesPerRow >= 4 * width; }
+
+    /**
+     * View of part of this frame, sharing its pixels and row stride. The
+     * rectangle is clipped to the frame; an empty view results if nothing is left.
+     */
+    VideoFrame crop(const FrameRect& rect) const {
+        const int x0 = rect.x < 0 ? 0 : rect.x;
+        const int y0 = rect.y < 0 ? 0 : rect.y;
+        const int x1 = rect.x + rect.width > width ? width : rect.x + rect.width;
+        const int y1 = rect.y + rect.height > height ? height : rect.y + rect.height;
+        if (!isValid() || x1 <= x0 || y1 <= y0) {
+            return VideoFrame{nullptr, 0, 0, 0};
+        }
+        return VideoFrame{bgraBytes + static_cast<long>(y0) * bytesPerRow + 4 * x0, x1 - x0, y1 - y0, bytesPerRow};
+    }
+};
+
+}
@@ -0,0 +1,72 @@
+//
+//  ZipStream.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "rsr/ErrorCodes.h"
+
+namespace rsr {
+
+/**
+ * Reads the entries of a zip archive front to back from their local headers,
+ * inflating each one in memory. The central directory is never needed, so
+ * every entry can be used as soon as it has been read and nothing is written
+ * to disk. Stored and deflated entries are supported; encrypted and ZIP64
+ * archives are not.
+ */
+class ZipStreamReader {
+public:
+    ZipStreamReader() = default;
+    ~ZipStreamReader();
+
+    ZipStreamReader(const ZipStreamReader&) = delete;
+    ZipStreamReader& operator=(const ZipStreamReader&) = delete;
+
+    /**
+     * @return SUCCESS or COLLECTION_NOT_FOUND if the archive cannot be opened.
+     */
+    ErrorCode open(const std::string& path);
+
+    /**
+     * Read and inflate the next file entry; directory entries are skipped.
+     * @param name Receives the entry path, or an empty string at the end of the archive.
+     * @param contents Receives the uncompressed bytes; its storage is reused.
+     * @return SUCCESS, or COLLECTION_MANAGER_EXTRACT_ERROR for a damaged or
+     * unsupported archive, an entry said to be larger than 1 GB included, in
+     * which case reading cannot continue.
+     */
+    ErrorCode next(std::string& name, std::vector<uint8_t>& contents);
+
+    /**
+     * Fraction of the archive bytes consumed so far.
+     */
+    float progress() const;
+
+private:
+    bool fill(size_t count);
+    void consume(size_t count) { mBegin += count; mConsumed += count; }
+    size_t available() const { return mEnd - mBegin; }
+    const uint8_t* data() const { return mBuffer.data() + mBegin; }
+
+    ErrorCode inflateEntry(uint32_t expectedSize, std::vector<uint8_t>& contents);
+    ErrorCode copyEntry(uint32_t size, std::vector<uint8_t>& contents);
+
+    FILE* mFile = nullptr;
+    uint64_t mSize = 0;
+    uint64_t mConsumed = 0;
+    std::vector<uint8_t> mBuffer;
+    size_t mBegin = 0;
+    size_t mEnd = 0;
+    bool mFinished = false;
+};
+
+}
@@ -0,0 +1,63 @@
+//
+//  Arena.cpp
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "rsr/Arena.h"
+
+#include <algorithm>
+
+namespace rsr {
+
+Arena::Arena(size_t chunkBytes) : mChunkBytes(std::max<size_t>(chunkBytes, kDefaultAlignment)) {}
+
+void Arena::addChunk(size_t bytes) {
+    Chunk chunk;
+    chunk.memory.reset(new uint8_t[bytes]);
+    chunk.size = bytes;
+    mChunks.push_back(std::move(chunk));
+    mCapacity += bytes;
+    ++mSystemAllocations;
+}
+
+void* Arena::allocate(size_t bytes, size_t alignment) {
+    bytes = std::max<size_t>(bytes, 1);
+    for (;;) {
+        if (mChunk < mChunks.size()) {
+            const Chunk& chunk = mChunks[mChunk];
+            const uintptr_t base = reinterpret_cast<uintptr_t>(chunk.memory.get());
+            const uintptr_t aligned = (base + mOffset + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+            const size_t end = aligned - base + bytes;
+            if (end <= chunk.size) {
+                mUsed += end - mOffset;
+                mOffset = end;
+                return reinterpret_cast<void*>(aligned);
+            }
+            if (mChunk + 1 < mChunks.size()) {
+                ++mChunk;
+                mOffset = 0;
+                continue;
+            }
+        }
+        // Grow geometrically so a large workload settles in a few chunks.
+        addChunk(std::max({mChunkBytes, mCapacity, bytes + alignment}));
+        mChunk = mChunks.size() - 1;
+        mOffset = 0;
+    }
+}
+
+void Arena::reset() {
+    if (mChunks.size() > 1) {
+        const size_t total = mCapacity;
+        mChunks.clear();
+        mCapacity = 0;
+        addChunk(total);
+    }
+    mChunk = 0;
+    mOffset = 0;
+    mUsed = 0;
+}
+
+}
@@ -0,0 +1,391 @@
+//
+//  Bundle.cpp
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "rsr/Bundle.h"
+
+#include <cctype>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "rsr/ZipStream.h"
+
+namespace rsr {
+
+const char* const kBundleManifestName = "collection.tsv";
+
+namespace {
+
+constexpr size_t kQueuedEntriesPerParser = 4;
+
+bool readFile(const std::string& path, std::vector<uint8_t>& bytes) {
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    bytes.clear();
+    uint8_t buffer[65536];
+    size_t n;
+    while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        bytes.insert(bytes.end(), buffer, buffer + n);
+    }
+    const bool ok = !std::ferror(file);
+    std::fclose(file);
+    return ok;
+}
+
+// Next header number, skipping whitespace and comments; -1 if there is none.
+int readHeaderNumber(const std::vector<uint8_t>& bytes, size_t& pos) {
+    while (pos < bytes.size()) {
+        if (bytes[pos] == '#') {
+            while (pos < bytes.size() && bytes[pos] != '\n') {
+                ++pos;
+            }
+        } else if (std::isspace(bytes[pos])) {
+            ++pos;
+        } else {
+            break;
+        }
+    }
+    if (pos >= bytes.size() || !std::isdigit(bytes[pos])) {
+        return -1;
+    }
+    long value = 0;
+    while (pos < bytes.size() && std::isdigit(bytes[pos]) && value < 1000000) {
+        value = value * 10 + (bytes[pos++] - '0');
+    }
+    return static_cast<int>(value);
+}
+
+std::vector<std::string> splitTabs(const std::string& line) {
+    std::vector<std::string> fields;
+    size_t begin = 0;
+    for (;;) {
+        const size_t end = line.find('\t', begin);
+        fields.push_back(line.substr(begin, end == std::string::npos ? std::string::npos : end - begin));
+        if (end == std::string::npos) {
+            return fields;
+        }
+        begin = end + 1;
+    }
+}
+
+struct Manifest {
+    std::string uuid;
+    std::string name;
+    std::vector<std::vector<std::string>> entries;  ///< Item uuid, image uuid, image file, then optional fields.
+};
+
+ErrorCode parseManifest(std::istream& in, Manifest& manifest) {
+    std::string line;
+    if (!std::getline(in, line)) {
+        return ErrorCode::COLLECTION_INVALID;
+    }
+    const std::vector<std::string> head = splitTabs(line);
+    if (head.size() < 3 || head[0] != "collection" || head[1].empty()) {
+        return ErrorCode::COLLECTION_INVALID;
+    }
+    manifest.uuid = head[1];
+    manifest.name = head[2];
+    manifest.entries.clear();
+    while (std::getline(in, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        manifest.entries.push_back(splitTabs(line));
+        if (manifest.entries.back().size() < 3) {
+            return ErrorCode::COLLECTION_INVALID;
+        }
+    }
+    return ErrorCode::SUCCESS;
+}
+
+Item manifestItem(const std::vector<std::string>& fields) {
+    Item item;
+    item.uuid = fields[0];
+    item.name = fields.size() > 3 ? fields[3] : std::string();
+    item.url = fields.size() > 4 ? fields[4] : std::string();
+    item.custom = fields.size() > 5 ? fields[5] : std::string();
+    return item;
+}
+
+bool endsWith(const std::string& s, const std::string& suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Archive entries handed from the inflating thread to the parsing threads.
+// Bounded, so inflating never runs far ahead and holds the bundle in memory.
+class EntryQueue {
+public:
+    explicit EntryQueue(size_t capacity) : mCapacity(capacity) {}
+
+    // Returns false if the queue was closed while waiting.
+    bool push(std::string name, std::vector<uint8_t> contents) {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mNotFull.wait(lock, [this] { return mEntries.size() < mCapacity || mClosed; });
+        if (mClosed) {
+            return false;
+        }
+        mEntries.emplace_back(std::move(name), std::move(contents));
+        mNotEmpty.notify_one();
+        return true;
+    }
+
+    // Returns false once the queue is closed and drained.
+    bool pop(std::string& name, std::vector<uint8_t>& contents) {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mNotEmpty.wait(lock, [this] { return !mEntries.empty() || mClosed; });
+        if (mEntries.empty()) {
+            return false;
+        }
+        name = std::move(mEntries.front().first);
+        contents = std::move(mEntries.front().second);
+        mEntries.pop_front();
+        mNotFull.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mClosed = true;
+        mNotEmpty.notify_all();
+        mNotFull.notify_all();
+    }
+
+private:
+    size_t mCapacity;
+    std::mutex mMutex;
+    std::condition_variable mNotEmpty;
+    std::condition_variable mNotFull;
+    std::deque<std::pair<std::string, std::vector<uint8_t>>> mEntries;
+    bool mClosed = false;
+};
+
+// What the parsing threads made of the archive entries, keyed by entry name.
+class ParsedBundle {
+public:
+    ParsedBundle() : mExtractor(Collection::referenceExtractorOptions()) {}
+
+    void parse(const std::string& name, const std::vector<uint8_t>& contents) {
+        if (endsWith(name, kBundleManifestName)) {
+            std::istringstream text(std::string(contents.begin(), contents.end()));
+            Manifest manifest;
+            const ErrorCode error = parseManifest(text, manifest);
+            std::lock_guard<std::mutex> lock(mMutex);
+            mManifestDirectory = name.substr(0, name.size() - std::strlen(kBundleManifestName));
+            mManifest = std::move(manifest);
+            mHaveManifest = true;
+            setError(error);
+            return;
+        }
+        if (!endsWith(name, ".ppm") && !endsWith(name, ".pgm")) {
+            return;
+        }
+        QueryImage image;
+        FeatureSet features;
+        ErrorCode error = decodeNetpbmImage(contents, image);
+        if (error == ErrorCode::SUCCESS) {
+            error = mExtractor.extract(image.toGray(), features);
+        }
+        std::lock_guard<std::mutex> lock(mMutex);
+        mImages[name] = std::move(features);
+        setError(error);
+    }
+
+    void fail(ErrorCode error) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        setError(error);
+    }
+
+    bool failed() const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mError != ErrorCode::SUCCESS;
+    }
+
+    // Called once every entry has been parsed.
+    ErrorCode assemble(std::unique_ptr<Collection>& collection) {
+        if (mError != ErrorCode::SUCCESS) {
+            return mError;
+        }
+        if (!mHaveManifest) {
+            return ErrorCode::COLLECTION_MISSING_FILES;
+        }
+        std::unique_ptr<Collection> loaded(new Collection(mManifest.uuid, mManifest.name));
+        for (const std::vector<std::string>& fields : mManifest.entries) {
+            auto image = mImages.find(mManifestDirectory + fields[2]);
+            if (image == mImages.end()) {
+                return ErrorCode::COLLECTION_MISSING_FILES;
+            }
+            const ErrorCode error = loaded->addImageFeatures(manifestItem(fields), fields[1], image->second);
+            if (error != ErrorCode::SUCCESS) {
+                return error;
+            }
+        }
+        collection = std::move(loaded);
+        return ErrorCode::SUCCESS;
+    }
+
+private:
+    void setError(ErrorCode error) {
+        if (mError == ErrorCode::SUCCESS) {
+            mError = error;
+        }
+    }
+
+    FeatureExtractor mExtractor;
+    mutable std::mutex mMutex;
+    ErrorCode mError = ErrorCode::SUCCESS;
+    bool mHaveManifest = false;
+    Manifest mManifest;
+    std::string mManifestDirectory;
+    std::map<std::string, FeatureSet> mImages;
+};
+
+}
+
+ErrorCode readNetpbmImage(const std::string& path, QueryImage& image) {
+    std::vector<uint8_t> bytes;
+    if (!readFile(path, bytes)) {
+        return ErrorCode::COLLECTION_MISSING_FILES;
+    }
+    return decodeNetpbmImage(bytes, image);
+}
+
+ErrorCode decodeNetpbmImage(const std::vector<uint8_t>& bytes, QueryImage& image) {
+    if (bytes.size() < 2 || bytes[0] != 'P' || (bytes[1] != '5' && bytes[1] != '6')) {
+        return ErrorCode::COLLECTION_INVALID;
+    }
+    const int channels = bytes[1] == '5' ? 1 : 3;
+    size_t pos = 2;
+    const int width = readHeaderNumber(bytes, pos);
+    const int height = readHeaderNumber(bytes, pos);
+    const int maxValue = readHeaderNumber(bytes, pos);
+    // A single whitespace character separates the header from the samples.
+    ++pos;
+    if (width <= 0 || height <= 0 || maxValue != 255 ||
+        pos + static_cast<size_t>(width) * height * channels > bytes.size()) {
+        return ErrorCode::COLLECTION_INVALID;
+    }
+
+    std::vector<uint8_t> bgra(static_cast<size_t>(width) * height * 4);
+    const uint8_t* in = bytes.data() + pos;
+    for (size_t i = 0; i < static_cast<size_t>(width) * height; ++i, in += channels) {
+        uint8_t* out = bgra.data() + i * 4;
+        out[0] = in[channels - 1];
+        out[1] = in[channels == 3 ? 1 : 0];
+        out[2] = in[0];
+        out[3] = 255;
+    }
+    image = QueryImage(bgra.data(), width, height, width * 4);
+    return ErrorCode::SUCCESS;
+}
+
+ErrorCode loadCollectionBundle(const std::string& directory, std::unique_ptr<Collection>& collection,
+                               const std::function<void(float)>& onProgress) {
+    collection.reset();
+    std::ifstream manifest(directory + "/" + kBundleManifestName);
+    if (!manifest) {
+        return ErrorCode::COLLECTION_NOT_FOUND;
+    }
+
+    Manifest parsed;
+    const ErrorCode error = parseManifest(manifest, parsed);
+    if (error != ErrorCode::SUCCESS) {
+        return error;
+    }
+    const std::vector<std::vector<std::string>>& entries = parsed.entries;
+
+    std::unique_ptr<Collection> loaded(new Collection(parsed.uuid, parsed.name));
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const std::vector<std::string>& fields = entries[i];
+        QueryImage image;
+        ErrorCode error = readNetpbmImage(directory + "/" + fields[2], image);
+        if (error == ErrorCode::SUCCESS) {
+            error = loaded->addImage(manifestItem(fields), fields[1], image);
+        }
+        if (error != ErrorCode::SUCCESS) {
+            return error;
+        }
+        if (onProgress) {
+            onProgress(static_cast<float>(i + 1) / entries.size());
+        }
+    }
+    collection = std::move(loaded);
+    return ErrorCode::SUCCESS;
+}
+
+ErrorCode loadCollectionBundleZip(const std::string& zipPath, std::unique_ptr<Collection>& collection,
+                                  const std::function<void(float)>& onProgress, const BundleOptions& options) {
+    collection.reset();
+    ZipStreamReader reader;
+    const ErrorCode openError = reader.open(zipPath);
+    if (openError != ErrorCode::SUCCESS) {
+        return openError;
+    }
+
+    // The calling thread inflates; the parser threads decode images and extract
+    // features from the entries already inflated.
+    ParsedBundle parsed;
+    EntryQueue queue(kQueuedEntriesPerParser * std::max(1, options.parserThreads));
+    std::vector<std::thread> parsers;
+    for (int t = 0; t < options.parserThreads; ++t) {
+        parsers.emplace_back([&parsed, &queue] {
+            std::string name;
+            std::vector<uint8_t> contents;
+            while (queue.pop(name, contents)) {
+                parsed.parse(name, contents);
+                if (parsed.failed()) {
+                    queue.close();
+                }
+            }
+        });
+    }
+
+    std::string name;
+    std::vector<uint8_t> contents;
+    for (;;) {
+        const ErrorCode error = reader.next(name, contents);
+        if (error != ErrorCode::SUCCESS) {
+            parsed.fail(error);
+            break;
+        }
+        if (name.empty()) {
+            break;
+        }
+        if (parsers.empty()) {
+            parsed.parse(name, contents);
+        } else if (!queue.push(std::move(name), std::move(contents))) {
+            break;
+        }
+        if (parsed.failed()) {
+            break;
+        }
+        if (onProgress) {
+            // Parsing lags inflating; 1 is only reported once the collection is complete.
+            onProgress(std::min(reader.progress(), 0.99f));
+        }
+    }
+    queue.close();
+    for (std::thread& parser : parsers) {
+        parser.join();
+    }
+
+    const ErrorCode error = parsed.assemble(collection);
+    if (error == ErrorCode::SUCCESS && onProgress) {
+        onProgress(1.0f);
+    }
+    return error;
+}
+
+}
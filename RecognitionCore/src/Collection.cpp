@@ -0,0 +1,108 @@
+//
+//  Collection.cpp
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "rsr/Collection.h"
+
+#include <utility>
+
+namespace rsr {
+
+Collection::Collection(std::string uuid, std::string name, const ExtractorOptions& extractorOptions)
+    : mUUID(std::move(uuid)), mName(std::move(name)), mExtractor(extractorOptions) {}
+
+ExtractorOptions Collection::referenceExtractorOptions() {
+    ExtractorOptions options;
+    options.maxFeatures = 800;
+    options.pyramidLevels = 5;
+    return options;
+}
+
+ErrorCode Collection::addImage(const Item& item, const std::string& imageUUID, const QueryImage& image) {
+    if (item.uuid.empty()) {
+        return ErrorCode::COLLECTION_INVALID_ITEM;
+    }
+    FeatureSet features;
+    const ErrorCode error = mExtractor.extract(image.toGray(), features);
+    if (error != ErrorCode::SUCCESS) {
+        return error;
+    }
+    return addImageFeatures(item, imageUUID, std::move(features));
+}
+
+ErrorCode Collection::addImageFeatures(const Item& item, const std::string& imageUUID, FeatureSet features) {
+    if (isMapped()) {
+        return ErrorCode::COLLECTION_INVALID;
+    }
+    if (item.uuid.empty() || features.keypoints.size() != features.descriptors.size()) {
+        return ErrorCode::COLLECTION_INVALID_ITEM;
+    }
+    ReferenceImage reference;
+    reference.uuid = imageUUID;
+    reference.itemIndex = itemIndexFor(item);
+    reference.width = features.width;
+    reference.height = features.height;
+    reference.firstFeature = static_cast<uint32_t>(mDescriptorStorage.size());
+    mKeypointStorage.insert(mKeypointStorage.end(), features.keypoints.begin(), features.keypoints.end());
+    mDescriptorStorage.insert(mDescriptorStorage.end(), features.descriptors.begin(), features.descriptors.end());
+    mFeatureImageStorage.insert(mFeatureImageStorage.end(), features.size(), static_cast<uint32_t>(mImages.size()));
+    reference.keypoints = ArrayView<Keypoint>(nullptr, features.keypoints.size());
+    reference.descriptors = ArrayView<Descriptor>(nullptr, features.descriptors.size());
+    mImages.push_back(std::move(reference));
+    updateViews();
+    return ErrorCode::SUCCESS;
+}
+
+std::vector<std::string> Collection::listItems() const {
+    std::vector<std::string> uuids;
+    uuids.reserve(mItems.size());
+    for (const Item& item : mItems) {
+        uuids.push_back(item.uuid);
+    }
+    return uuids;
+}
+
+const Item* Collection::getItem(const std::string& itemUUID, ErrorCode* error) const {
+    for (const Item& item : mItems) {
+        if (item.uuid == itemUUID) {
+            if (error) {
+                *error = ErrorCode::SUCCESS;
+            }
+            return &item;
+        }
+    }
+    if (error) {
+        *error = ErrorCode::COLLECTION_ITEM_NOT_FOUND;
+    }
+    return nullptr;
+}
+
+int Collection::itemIndexFor(const Item& item) {
+    for (size_t i = 0; i < mItems.size(); ++i) {
+        if (mItems[i].uuid == item.uuid) {
+            return static_cast<int>(i);
+        }
+    }
+    mItems.push_back(item);
+    return static_cast<int>(mItems.size() - 1);
+}
+
+void Collection::updateViews() {
+    const bool moved = mDescriptors.data() != mDescriptorStorage.data() || mKeypoints.data() != mKeypointStorage.data();
+    mKeypoints = ArrayView<Keypoint>(mKeypointStorage.data(), mKeypointStorage.size());
+    mDescriptors = ArrayView<Descriptor>(mDescriptorStorage.data(), mDescriptorStorage.size());
+    mFeatureImages = ArrayView<uint32_t>(mFeatureImageStorage.data(), mFeatureImageStorage.size());
+    // The storage only moves when it grows past its capacity, so rebasing
+    // every image is amortized over the images added since the last move.
+    const size_t first = moved ? 0 : mImages.size() - 1;
+    for (size_t i = first; i < mImages.size(); ++i) {
+        ReferenceImage& image = mImages[i];
+        image.keypoints = mKeypoints.sub(image.firstFeature, image.keypoints.size());
+        image.descriptors = mDescriptors.sub(image.firstFeature, image.descriptors.size());
+    }
+}
+
+}
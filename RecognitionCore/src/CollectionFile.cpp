@@ -0,0 +1,278 @@
+//
+//  CollectionFile.cpp
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "rsr/Collection.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+#include "rsr/DescriptorIndex.h"
+
+namespace rsr {
+
+namespace {
+
+// Collection file layout: a header, then each section starting on a page
+// boundary so that features and index can be used straight from the mapping,
+// with the same cache line alignment as features built in memory.
+// Values are stored in the byte order of the device, which is little endian
+// on every platform we ship.
+constexpr uint32_t kMagic = 0x43525352;  // "RSRC"
+constexpr uint32_t kVersion = 2;
+// Largest page size we run on (arm64 iOS); also a multiple of 4 KB pages.
+constexpr uint64_t kSectionAlignment = 16384;
+static_assert(kSectionAlignment % kCacheLineSize == 0, "Mapped features must start on a cache line");
+
+enum Section {
+    STRINGS,
+    ITEMS,
+    IMAGES,
+    KEYPOINTS,
+    DESCRIPTORS,
+    OWNERS,  ///< Index of the image owning each feature.
+    INDEX,
+    SECTION_COUNT
+};
+
+struct StringRef {
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct SectionEntry {
+    uint64_t offset;
+    uint64_t size;
+};
+
+struct FileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t itemCount;
+    uint32_t imageCount;
+    uint64_t featureCount;
+    StringRef uuid;
+    StringRef name;
+    SectionEntry sections[SECTION_COUNT];
+};
+
+struct ItemRecord {
+    StringRef uuid;
+    StringRef name;
+    StringRef url;
+    StringRef custom;
+};
+
+struct ImageRecord {
+    StringRef uuid;
+    int32_t itemIndex;
+    int32_t width;
+    int32_t height;
+    uint32_t firstFeature;
+    uint32_t featureCount;
+};
+
+static_assert(std::is_trivially_copyable<Keypoint>::value && sizeof(Keypoint) == 20,
+              "Keypoint layout is part of the collection file format");
+static_assert(std::is_trivially_copyable<Descriptor>::value && sizeof(Descriptor) == 32,
+              "Descriptor layout is part of the collection file format");
+
+class StringTable {
+public:
+    StringRef add(const std::string& s) {
+        StringRef ref{static_cast<uint32_t>(mBytes.size()), static_cast<uint32_t>(s.size())};
+        mBytes.insert(mBytes.end(), s.begin(), s.end());
+        return ref;
+    }
+    const std::vector<uint8_t>& bytes() const { return mBytes; }
+
+private:
+    std::vector<uint8_t> mBytes;
+};
+
+template <typename T>
+void appendRecord(std::vector<uint8_t>& section, const T& record) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&record);
+    section.insert(section.end(), bytes, bytes + sizeof(T));
+}
+
+bool validString(const StringRef& ref, const SectionEntry& strings) {
+    return uint64_t(ref.offset) + ref.length <= strings.size;
+}
+
+}
+
+ErrorCode Collection::write(const std::string& path, const IndexOptions& indexOptions) const {
+    StringTable strings;
+    FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = kMagic;
+    header.version = kVersion;
+    header.itemCount = static_cast<uint32_t>(mItems.size());
+    header.imageCount = static_cast<uint32_t>(mImages.size());
+    header.featureCount = mDescriptors.size();
+    header.uuid = strings.add(mUUID);
+    header.name = strings.add(mName);
+
+    std::vector<uint8_t> sections[SECTION_COUNT];
+    for (const Item& item : mItems) {
+        appendRecord(sections[ITEMS],
+                     ItemRecord{strings.add(item.uuid), strings.add(item.name), strings.add(item.url),
+                                strings.add(item.custom)});
+    }
+    for (const ReferenceImage& image : mImages) {
+        appendRecord(sections[IMAGES],
+                     ImageRecord{strings.add(image.uuid), image.itemIndex, image.width, image.height,
+                                 image.firstFeature, static_cast<uint32_t>(image.descriptors.size())});
+    }
+    sections[STRINGS] = strings.bytes();
+    const uint8_t* keypoints = reinterpret_cast<const uint8_t*>(mKeypoints.data());
+    sections[KEYPOINTS].assign(keypoints, keypoints + mKeypoints.size() * sizeof(Keypoint));
+    const uint8_t* descriptors = reinterpret_cast<const uint8_t*>(mDescriptors.data());
+    sections[DESCRIPTORS].assign(descriptors, descriptors + mDescriptors.size() * sizeof(Descriptor));
+    const uint8_t* owners = reinterpret_cast<const uint8_t*>(mFeatureImages.data());
+    sections[OWNERS].assign(owners, owners + mFeatureImages.size() * sizeof(uint32_t));
+    DescriptorIndex::create(*this, indexOptions)->serialize(sections[INDEX]);
+
+    uint64_t offset = sizeof(header);
+    for (int s = 0; s < SECTION_COUNT; ++s) {
+        offset = (offset + kSectionAlignment - 1) / kSectionAlignment * kSectionAlignment;
+        header.sections[s].offset = offset;
+        header.sections[s].size = sections[s].size();
+        offset += sections[s].size();
+    }
+
+    // Written next to the destination and renamed, so a reader never maps a partial file.
+    const std::string temporary = path + ".tmp";
+    FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (!file) {
+        return ErrorCode::COLLECTION_MANAGER_EXTRACT_ERROR;
+    }
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+    uint64_t written = sizeof(header);
+    const std::vector<uint8_t> padding(kSectionAlignment, 0);
+    for (int s = 0; s < SECTION_COUNT && ok; ++s) {
+        const uint64_t gap = header.sections[s].offset - written;
+        // An empty section, such as the index of an exact search, may have no data to point to.
+        ok = std::fwrite(padding.data(), 1, gap, file) == gap &&
+             (sections[s].empty() ||
+              std::fwrite(sections[s].data(), 1, sections[s].size(), file) == sections[s].size());
+        written = header.sections[s].offset + sections[s].size();
+    }
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return ErrorCode::COLLECTION_MANAGER_EXTRACT_ERROR;
+    }
+    return ErrorCode::SUCCESS;
+}
+
+ErrorCode Collection::open(const std::string& path, std::shared_ptr<const Collection>& collection) {
+    collection.reset();
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return ErrorCode::COLLECTION_NOT_FOUND;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(FileHeader))) {
+        ::close(fd);
+        return ErrorCode::COLLECTION_INVALID;
+    }
+    const size_t size = static_cast<size_t>(info.st_size);
+    void* address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        return ErrorCode::COLLECTION_NOT_FOUND;
+    }
+    std::shared_ptr<const void> mapping(address, [size](const void* p) { munmap(const_cast<void*>(p), size); });
+    const uint8_t* base = static_cast<const uint8_t*>(address);
+
+    FileHeader header;
+    std::memcpy(&header, base, sizeof(header));
+    if (header.magic != kMagic) {
+        return ErrorCode::COLLECTION_INVALID;
+    }
+    if (header.version < kVersion) {
+        return ErrorCode::COLLECTION_BUNDLE_VERSION_IS_OLD;
+    }
+    if (header.version > kVersion) {
+        return ErrorCode::COLLECTION_BUNDLE_SDK_VERSION_IS_OLD;
+    }
+    for (const SectionEntry& section : header.sections) {
+        if (section.offset % kSectionAlignment != 0 || section.offset > size || section.size > size - section.offset) {
+            return ErrorCode::COLLECTION_INVALID;
+        }
+    }
+    const SectionEntry& strings = header.sections[STRINGS];
+    if (header.sections[ITEMS].size != uint64_t(header.itemCount) * sizeof(ItemRecord) ||
+        header.sections[IMAGES].size != uint64_t(header.imageCount) * sizeof(ImageRecord) ||
+        header.sections[KEYPOINTS].size != header.featureCount * sizeof(Keypoint) ||
+        header.sections[DESCRIPTORS].size != header.featureCount * sizeof(Descriptor) ||
+        header.sections[OWNERS].size != header.featureCount * sizeof(uint32_t) ||
+        header.featureCount > UINT32_MAX || !validString(header.uuid, strings) || !validString(header.name, strings)) {
+        return ErrorCode::COLLECTION_INVALID;
+    }
+
+    const char* text = reinterpret_cast<const char*>(base + strings.offset);
+    auto string = [text](const StringRef& ref) { return std::string(text + ref.offset, ref.length); };
+
+    std::shared_ptr<Collection> mapped(new Collection(string(header.uuid), string(header.name)));
+    mapped->mItems.reserve(header.itemCount);
+    for (uint32_t i = 0; i < header.itemCount; ++i) {
+        ItemRecord record;
+        std::memcpy(&record, base + header.sections[ITEMS].offset + i * sizeof(record), sizeof(record));
+        if (!validString(record.uuid, strings) || !validString(record.name, strings) ||
+            !validString(record.url, strings) || !validString(record.custom, strings)) {
+            return ErrorCode::COLLECTION_INVALID;
+        }
+        mapped->mItems.push_back({string(record.uuid), string(record.name), string(record.url), string(record.custom)});
+    }
+
+    mapped->mKeypoints = ArrayView<Keypoint>(
+        reinterpret_cast<const Keypoint*>(base + header.sections[KEYPOINTS].offset), header.featureCount);
+    mapped->mDescriptors = ArrayView<Descriptor>(
+        reinterpret_cast<const Descriptor*>(base + header.sections[DESCRIPTORS].offset), header.featureCount);
+    mapped->mFeatureImages = ArrayView<uint32_t>(
+        reinterpret_cast<const uint32_t*>(base + header.sections[OWNERS].offset), header.featureCount);
+    mapped->mStoredIndex = ArrayView<uint8_t>(base + header.sections[INDEX].offset, header.sections[INDEX].size);
+
+    // Images must tile the feature arrays in order, which the indexes rely on.
+    mapped->mImages.resize(header.imageCount);
+    uint64_t nextFeature = 0;
+    for (uint32_t i = 0; i < header.imageCount; ++i) {
+        ImageRecord record;
+        std::memcpy(&record, base + header.sections[IMAGES].offset + i * sizeof(record), sizeof(record));
+        if (!validString(record.uuid, strings) || record.itemIndex < 0 ||
+            record.itemIndex >= static_cast<int32_t>(header.itemCount) || record.firstFeature != nextFeature ||
+            uint64_t(record.firstFeature) + record.featureCount > header.featureCount) {
+            return ErrorCode::COLLECTION_INVALID;
+        }
+        nextFeature = uint64_t(record.firstFeature) + record.featureCount;
+        ReferenceImage& image = mapped->mImages[i];
+        image.uuid = string(record.uuid);
+        image.itemIndex = record.itemIndex;
+        image.width = record.width;
+        image.height = record.height;
+        image.firstFeature = record.firstFeature;
+        image.keypoints = mapped->mKeypoints.sub(record.firstFeature, record.featureCount);
+        image.descriptors = mapped->mDescriptors.sub(record.firstFeature, record.featureCount);
+    }
+    if (nextFeature != header.featureCount) {
+        return ErrorCode::COLLECTION_INVALID;
+    }
+    mapped->mMapping = std::move(mapping);
+    collection = std::move(mapped);
+    return ErrorCode::SUCCESS;
+}
+
+}
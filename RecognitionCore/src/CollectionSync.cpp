@@ -0,0 +1,385 @@
+//
+//  CollectionSync.cpp
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "rsr/CollectionSync.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <unordered_set>
+#include <utility>
+
+#include "rsr/HttpClient.h"
+
+namespace rsr {
+
+namespace {
+
+constexpr uint32_t kItemRecordMagic = 0x49525352;  // "RSRI"
+// Items asked for per request: keeps URLs short while avoiding a round trip per item.
+constexpr size_t kItemsPerRequest = 64;
+
+uint64_t fnv1a(const char* data, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+template<typename T>
+void appendPod(std::string& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+void appendArray(std::string& out, ArrayView<T> values) {
+    out.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+
+void appendString(std::string& out, const std::string& text) {
+    appendPod(out, static_cast<uint32_t>(text.size()));
+    out += text;
+}
+
+// Record layout, host byte order like the collection file:
+//   u32 magic, item uuid/name/url/custom, u32 image count, then per image
+//   uuid, i32 width, i32 height, u32 feature count, keypoints, descriptors.
+// Strings are a u32 length and the bytes. The content hash is taken over the record.
+void appendItemRecord(const Collection& collection, int itemIndex, const std::vector<int>& imageIndices,
+                      std::string& out) {
+    const Item& item = collection.items()[itemIndex];
+    appendPod(out, kItemRecordMagic);
+    appendString(out, item.uuid);
+    appendString(out, item.name);
+    appendString(out, item.url);
+    appendString(out, item.custom);
+    appendPod(out, static_cast<uint32_t>(imageIndices.size()));
+    for (const int imageIndex : imageIndices) {
+        const ReferenceImage& image = collection.images()[imageIndex];
+        appendString(out, image.uuid);
+        appendPod(out, static_cast<int32_t>(image.width));
+        appendPod(out, static_cast<int32_t>(image.height));
+        appendPod(out, static_cast<uint32_t>(image.descriptors.size()));
+        appendArray(out, image.keypoints);
+        appendArray(out, image.descriptors);
+    }
+}
+
+// Images of every item, in collection order.
+std::vector<std::vector<int>> imagesByItem(const Collection& collection) {
+    std::vector<std::vector<int>> images(collection.items().size());
+    for (size_t i = 0; i < collection.images().size(); ++i) {
+        images[collection.images()[i].itemIndex].push_back(static_cast<int>(i));
+    }
+    return images;
+}
+
+struct ReceivedImage {
+    std::string uuid;
+    FeatureSet features;
+};
+
+struct ReceivedItem {
+    Item item;
+    std::vector<ReceivedImage> images;
+    uint64_t contentHash = 0;
+};
+
+class RecordReader {
+public:
+    explicit RecordReader(const std::string& payload) : mPayload(payload) {}
+
+    bool finished() const { return mOffset == mPayload.size(); }
+    size_t offset() const { return mOffset; }
+
+    template<typename T>
+    bool readPod(T& value) {
+        if (mPayload.size() - mOffset < sizeof(T)) {
+            return false;
+        }
+        std::memcpy(&value, mPayload.data() + mOffset, sizeof(T));
+        mOffset += sizeof(T);
+        return true;
+    }
+
+    template<typename T>
+    bool readArray(std::vector<T>& values, uint32_t count) {
+        if ((mPayload.size() - mOffset) / sizeof(T) < count) {
+            return false;
+        }
+        values.resize(count);
+        std::memcpy(values.data(), mPayload.data() + mOffset, count * sizeof(T));
+        mOffset += count * sizeof(T);
+        return true;
+    }
+
+    bool readString(std::string& text) {
+        uint32_t length = 0;
+        if (!readPod(length) || mPayload.size() - mOffset < length) {
+            return false;
+        }
+        text.assign(mPayload, mOffset, length);
+        mOffset += length;
+        return true;
+    }
+
+private:
+    const std::string& mPayload;
+    size_t mOffset = 0;
+};
+
+bool readItemRecord(const std::string& payload, RecordReader& reader, ReceivedItem& received) {
+    const size_t start = reader.offset();
+    uint32_t magic = 0;
+    uint32_t imageCount = 0;
+    if (!reader.readPod(magic) || magic != kItemRecordMagic || !reader.readString(received.item.uuid) ||
+        !reader.readString(received.item.name) || !reader.readString(received.item.url) ||
+        !reader.readString(received.item.custom) || !reader.readPod(imageCount)) {
+        return false;
+    }
+    received.images.clear();
+    for (uint32_t i = 0; i < imageCount; ++i) {
+        ReceivedImage image;
+        int32_t width = 0;
+        int32_t height = 0;
+        uint32_t featureCount = 0;
+        if (!reader.readString(image.uuid) || !reader.readPod(width) || !reader.readPod(height) ||
+            !reader.readPod(featureCount) || !reader.readArray(image.features.keypoints, featureCount) ||
+            !reader.readArray(image.features.descriptors, featureCount)) {
+            return false;
+        }
+        image.features.width = width;
+        image.features.height = height;
+        received.images.push_back(std::move(image));
+    }
+    received.contentHash = fnv1a(payload.data() + start, reader.offset() - start);
+    return true;
+}
+
+// Adds an item of the loaded collection to the updated one, reusing its features.
+ErrorCode copyItem(const Collection& from, int itemIndex, const std::vector<int>& imageIndices, Collection& to) {
+    const Item& item = from.items()[itemIndex];
+    for (const int imageIndex : imageIndices) {
+        const ReferenceImage& image = from.images()[imageIndex];
+        FeatureSet features;
+        features.keypoints.assign(image.keypoints.begin(), image.keypoints.end());
+        features.descriptors.assign(image.descriptors.begin(), image.descriptors.end());
+        features.width = image.width;
+        features.height = image.height;
+        const ErrorCode error = to.addImageFeatures(item, image.uuid, std::move(features));
+        if (error != ErrorCode::SUCCESS) {
+            return error;
+        }
+    }
+    return ErrorCode::SUCCESS;
+}
+
+}
+
+CollectionManifest CollectionManifest::describe(const Collection& collection) {
+    CollectionManifest manifest;
+    manifest.uuid = collection.uuid();
+    manifest.name = collection.name();
+    const std::vector<std::vector<int>> images = imagesByItem(collection);
+    std::string record;
+    for (size_t i = 0; i < collection.items().size(); ++i) {
+        record.clear();
+        appendItemRecord(collection, static_cast<int>(i), images[i], record);
+        manifest.items.push_back({collection.items()[i].uuid, fnv1a(record.data(), record.size())});
+    }
+    return manifest;
+}
+
+std::string CollectionManifest::serialize() const {
+    std::string text = "collection\t" + uuid + "\t" + name + "\n";
+    char hash[17];
+    for (const ManifestEntry& entry : items) {
+        std::snprintf(hash, sizeof(hash), "%016" PRIx64, entry.contentHash);
+        text += entry.itemUUID + "\t" + hash + "\n";
+    }
+    return text;
+}
+
+ErrorCode CollectionManifest::parse(const std::string& text, CollectionManifest& manifest) {
+    manifest = CollectionManifest();
+    std::istringstream lines(text);
+    std::string line;
+    if (!std::getline(lines, line) || line.compare(0, 11, "collection\t") != 0) {
+        return ErrorCode::COLLECTION_MANAGER_SYNC_ERROR;
+    }
+    const size_t nameStart = line.find('\t', 11);
+    manifest.uuid = line.substr(11, nameStart - 11);
+    if (nameStart != std::string::npos) {
+        manifest.name = line.substr(nameStart + 1);
+    }
+    if (manifest.uuid.empty()) {
+        return ErrorCode::COLLECTION_MANAGER_SYNC_ERROR;
+    }
+    while (std::getline(lines, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        const size_t tab = line.find('\t');
+        char* end = nullptr;
+        ManifestEntry entry;
+        if (tab == 0 || tab == std::string::npos || line.size() - tab - 1 != 16) {
+            return ErrorCode::COLLECTION_MANAGER_SYNC_ERROR;
+        }
+        entry.itemUUID = line.substr(0, tab);
+        entry.contentHash = std::strtoull(line.c_str() + tab + 1, &end, 16);
+        if (end != line.c_str() + line.size()) {
+            return ErrorCode::COLLECTION_MANAGER_SYNC_ERROR;
+        }
+        manifest.items.push_back(std::move(entry));
+    }
+    return ErrorCode::SUCCESS;
+}
+
+void serializeItems(const Collection& collection, const std::vector<std::string>& itemUUIDs, std::string& payload) {
+    std::unordered_map<std::string, int> itemIndices;
+    for (size_t i = 0; i < collection.items().size(); ++i) {
+        itemIndices.emplace(collection.items()[i].uuid, static_cast<int>(i));
+    }
+    const std::vector<std::vector<int>> images = imagesByItem(collection);
+    for (const std::string& uuid : itemUUIDs) {
+        const auto it = itemIndices.find(uuid);
+        if (it != itemIndices.end()) {
+            appendItemRecord(collection, it->second, images[it->second], payload);
+        }
+    }
+}
+
+CollectionSync::CollectionSync(OnDeviceIR& onDeviceIR, std::string serverURL, const IndexOptions& indexOptions)
+    : mOnDeviceIR(onDeviceIR), mServerURL(std::move(serverURL)), mIndexOptions(indexOptions) {
+    while (!mServerURL.empty() && mServerURL.back() == '/') {
+        mServerURL.pop_back();
+    }
+}
+
+const std::unordered_map<std::string, uint64_t>& CollectionSync::localHashes(
+    const std::shared_ptr<const Collection>& collection) {
+    if (mHashedCollection.lock() != collection) {
+        mHashes.clear();
+        if (collection) {
+            for (const ManifestEntry& entry : CollectionManifest::describe(*collection).items) {
+                mHashes.emplace(entry.itemUUID, entry.contentHash);
+            }
+        }
+        mHashedCollection = collection;
+    }
+    return mHashes;
+}
+
+ErrorCode CollectionSync::sync(SyncReport& report, const std::function<void(float)>& onProgress) {
+    report = SyncReport();
+    std::string body;
+    CollectionManifest remote;
+    ErrorCode error = httpGet(mServerURL + "/manifest", body);
+    if (error == ErrorCode::SUCCESS) {
+        report.bytesDownloaded += body.size();
+        error = CollectionManifest::parse(body, remote);
+    }
+    if (error != ErrorCode::SUCCESS) {
+        return error;
+    }
+
+    const std::shared_ptr<const Collection> current = mOnDeviceIR.getCollection(remote.uuid);
+    const std::unordered_map<std::string, uint64_t>& hashes = localHashes(current);
+    std::vector<std::string> changed;
+    std::unordered_set<std::string> remoteItems;
+    for (const ManifestEntry& entry : remote.items) {
+        remoteItems.insert(entry.itemUUID);
+        const auto it = hashes.find(entry.itemUUID);
+        if (it != hashes.end() && it->second == entry.contentHash) {
+            ++report.itemsUnchanged;
+        } else {
+            changed.push_back(entry.itemUUID);
+        }
+    }
+    for (const auto& local : hashes) {
+        report.itemsRemoved += remoteItems.count(local.first) == 0;
+    }
+    const bool renamed = current && current->name() != remote.name;
+    if (current && changed.empty() && report.itemsRemoved == 0 && !renamed) {
+        return ErrorCode::SUCCESS;
+    }
+
+    std::unordered_map<std::string, ReceivedItem> received;
+    for (size_t first = 0; first < changed.size(); first += kItemsPerRequest) {
+        const size_t last = std::min(changed.size(), first + kItemsPerRequest);
+        std::string url = mServerURL + "/items?ids=";
+        for (size_t i = first; i < last; ++i) {
+            url += (i == first ? "" : ",") + urlEncode(changed[i]);
+        }
+        if (httpGet(url, body) == ErrorCode::SUCCESS) {
+            report.bytesDownloaded += body.size();
+            RecordReader reader(body);
+            ReceivedItem item;
+            // A damaged record makes the rest of the reply unreadable; what was read stays good.
+            while (!reader.finished() && readItemRecord(body, reader, item)) {
+                received[item.item.uuid] = std::move(item);
+            }
+        }
+        if (onProgress) {
+            onProgress(static_cast<float>(last) / changed.size());
+        }
+    }
+
+    std::unordered_map<std::string, int> currentItems;
+    std::vector<std::vector<int>> currentImages;
+    if (current) {
+        for (size_t i = 0; i < current->items().size(); ++i) {
+            currentItems.emplace(current->items()[i].uuid, static_cast<int>(i));
+        }
+        currentImages = imagesByItem(*current);
+    }
+    auto updated = std::make_shared<Collection>(remote.uuid, remote.name);
+    std::unordered_map<std::string, uint64_t> updatedHashes;
+    for (const ManifestEntry& entry : remote.items) {
+        const auto fetched = received.find(entry.itemUUID);
+        const auto local = currentItems.find(entry.itemUUID);
+        const bool wanted = hashes.count(entry.itemUUID) == 0 || hashes.at(entry.itemUUID) != entry.contentHash;
+        if (wanted && fetched != received.end() && fetched->second.contentHash == entry.contentHash) {
+            ++report.itemDownloads;
+            for (ReceivedImage& image : fetched->second.images) {
+                error = updated->addImageFeatures(fetched->second.item, image.uuid, std::move(image.features));
+                if (error != ErrorCode::SUCCESS) {
+                    return ErrorCode::COLLECTION_MANAGER_SYNC_ERROR;
+                }
+            }
+            updatedHashes[entry.itemUUID] = entry.contentHash;
+            continue;
+        }
+        if (wanted) {
+            ++report.downloadErrors;
+        }
+        if (local != currentItems.end()) {
+            error = copyItem(*current, local->second, currentImages[local->second], *updated);
+            if (error != ErrorCode::SUCCESS) {
+                return ErrorCode::COLLECTION_MANAGER_SYNC_ERROR;
+            }
+            updatedHashes[entry.itemUUID] = hashes.at(entry.itemUUID);
+        }
+    }
+
+    std::shared_ptr<const Collection> result = std::move(updated);
+    if (!current) {
+        mOnDeviceIR.setCollection(result, !mOnDeviceIR.activeCollection(), mIndexOptions);
+    } else if (mOnDeviceIR.updateCollection(result) != ErrorCode::SUCCESS) {
+        // Unloaded while syncing: leave it unloaded.
+        return ErrorCode::SUCCESS;
+    }
+    mHashedCollection = result;
+    mHashes = std::move(updatedHashes);
+    return ErrorCode::SUCCESS;
+}
+
+}
@@ -0,0 +1,381 @@
+//
+//  DescriptorIndex.cpp
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "rsr/DescriptorIndex.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+#include "simd/HammingKernels.h"
+
+namespace rsr {
+
+namespace {
+
+// Reference descriptors compared against all queries before moving on:
+// 256 descriptors are 8 KB, which stays in L1 while the queries stream past.
+constexpr size_t kReferenceBlock = 256;
+
+inline void consider(NearestNeighbours& n, int distance, int image, int reference) {
+    if (distance < n.best) {
+        n.second = n.best;
+        n.best = distance;
+        n.image = image;
+        n.reference = reference;
+    } else if (distance < n.second) {
+        n.second = distance;
+    }
+}
+
+// Neighbours found with reference set to a feature number of the whole
+// collection get the image owning it and the reference within that image.
+// Owners are read from the collection file unchecked, so a damaged one that
+// names a missing image, or one not holding the feature, drops the
+// neighbours rather than pointing past the image's features.
+void toImageReference(const Collection& collection, NearestNeighbours& n) {
+    if (n.reference >= 0) {
+        const uint32_t image = collection.featureImages()[static_cast<size_t>(n.reference)];
+        if (image >= collection.images().size()) {
+            n = NearestNeighbours();
+            return;
+        }
+        const ReferenceImage& owner = collection.images()[image];
+        const uint32_t feature = static_cast<uint32_t>(n.reference);
+        if (feature < owner.firstFeature || feature - owner.firstFeature >= owner.descriptors.size()) {
+            n = NearestNeighbours();
+            return;
+        }
+        n.image = static_cast<int>(image);
+        n.reference = static_cast<int>(feature - owner.firstFeature);
+    }
+}
+
+}
+
+namespace detail {
+
+void nearestTwoScalar(const Descriptor& query, const Descriptor* references, size_t count, int image,
+                      int firstReference, NearestNeighbours& neighbours) {
+    for (size_t r = 0; r < count; ++r) {
+        consider(neighbours, hammingDistance(query, references[r]), image, firstReference + static_cast<int>(r));
+    }
+}
+
+void mergeLanes(const int* best, const int* second, const int* index, int lanes, int image,
+                NearestNeighbours& neighbours) {
+    // The lanes' own best, the lowest index winning ties as it would have been seen first.
+    int laneBest = INT_MAX;
+    int laneSecond = INT_MAX;
+    int laneIndex = -1;
+    for (int l = 0; l < lanes; ++l) {
+        if (best[l] < laneBest || (best[l] == laneBest && index[l] < laneIndex)) {
+            laneSecond = std::min(laneSecond, laneBest);
+            laneBest = best[l];
+            laneIndex = index[l];
+        } else {
+            laneSecond = std::min(laneSecond, best[l]);
+        }
+        laneSecond = std::min(laneSecond, second[l]);
+    }
+    if (laneBest < neighbours.best) {
+        neighbours.second = std::min(neighbours.best, laneSecond);
+        neighbours.best = laneBest;
+        neighbours.image = image;
+        neighbours.reference = laneIndex;
+    } else {
+        neighbours.second = std::min(neighbours.second, laneBest);
+    }
+}
+
+}
+
+void nearestTwo(const Descriptor& query, const Descriptor* references, size_t count, int image, int firstReference,
+                NearestNeighbours& neighbours, SimdLevel level) {
+    if (isSimdLevelSupported(level)) {
+        switch (level) {
+#if defined(RSR_HAVE_X86_KERNELS)
+            case SimdLevel::AVX512:
+                detail::nearestTwoAVX512(query, references, count, image, firstReference, neighbours);
+                return;
+            case SimdLevel::AVX2:
+                detail::nearestTwoAVX2(query, references, count, image, firstReference, neighbours);
+                return;
+#endif
+#if defined(RSR_HAVE_NEON_KERNELS)
+            case SimdLevel::NEON:
+                detail::nearestTwoNEON(query, references, count, image, firstReference, neighbours);
+                return;
+#endif
+            default:
+                break;
+        }
+    }
+    detail::nearestTwoScalar(query, references, count, image, firstReference, neighbours);
+}
+
+namespace {
+
+class ExactIndex : public DescriptorIndex {
+public:
+    explicit ExactIndex(const Collection& collection) : mCollection(collection) {}
+
+    IndexType type() const override { return IndexType::EXACT; }
+
+    using DescriptorIndex::search;
+
+    // Streams through the descriptor rows of all images as one array, so
+    // that small images do not cut the kernels' runs short, then turns the
+    // feature numbers of the best matches into image and reference.
+    void search(const Descriptor* const* queries, size_t count, NearestNeighbours* neighbours,
+                Arena*) const override {
+        std::fill(neighbours, neighbours + count, NearestNeighbours());
+        const ArrayView<Descriptor> references = mCollection.descriptors();
+        const SimdLevel level = bestSimdLevel();
+        for (size_t blockBegin = 0; blockBegin < references.size(); blockBegin += kReferenceBlock) {
+            const size_t blockSize = std::min(references.size() - blockBegin, kReferenceBlock);
+            for (size_t q = 0; q < count; ++q) {
+                nearestTwo(*queries[q], references.data() + blockBegin, blockSize, 0, static_cast<int>(blockBegin),
+                           neighbours[q], level);
+            }
+        }
+        for (size_t q = 0; q < count; ++q) {
+            toImageReference(mCollection, neighbours[q]);
+        }
+    }
+
+private:
+    const Collection& mCollection;
+};
+
+// Persistent layout of the LSH index: this header, then for each table the
+// sampled bit positions (padded to 4 bytes), the bucket start offsets and
+// the bucket entries.
+struct LshHeader {
+    uint32_t magic;
+    uint32_t tables;
+    uint32_t keyBits;
+    uint32_t featureCount;
+};
+
+constexpr uint32_t kLshMagic = 0x3148534C;  // "LSH1"
+constexpr int kMaxKeyBits = 24;
+// Most evenly split descriptor bits that keys are sampled from.
+constexpr int kBalancedBits = 128;
+
+size_t paddedKeyBits(uint32_t keyBits) {
+    return (keyBits + 3) & ~size_t(3);
+}
+
+size_t lshTableBytes(uint32_t keyBits, uint32_t featureCount) {
+    return paddedKeyBits(keyBits) + ((size_t(1) << keyBits) + 1 + featureCount) * sizeof(uint32_t);
+}
+
+// Bit sampling LSH for Hamming space: each table hashes a descriptor to the
+// values of a fixed random subset of its bits, so descriptors within a small
+// Hamming distance collide in at least one table with high probability.
+// Buckets are stored CSR-style: entries sorted by key plus a start offset per
+// key, in one block that is either owned or part of a mapped collection file.
+class LshIndex : public DescriptorIndex {
+public:
+    LshIndex(const Collection& collection, bool multiProbe) : mCollection(collection), mMultiProbe(multiProbe) {}
+
+    IndexType type() const override { return IndexType::LSH; }
+
+    void build(const IndexOptions& options) {
+        LshHeader header;
+        header.magic = kLshMagic;
+        header.tables = static_cast<uint32_t>(std::max(1, options.lshTables));
+        header.keyBits = static_cast<uint32_t>(std::max(1, std::min(options.lshKeyBits, kMaxKeyBits)));
+        header.featureCount = static_cast<uint32_t>(mCollection.descriptors().size());
+        const size_t buckets = size_t(1) << header.keyBits;
+
+        mOwned.assign(sizeof(header) + header.tables * lshTableBytes(header.keyBits, header.featureCount), 0);
+        std::memcpy(mOwned.data(), &header, sizeof(header));
+        uint8_t* out = mOwned.data() + sizeof(header);
+
+        // Extracted descriptors have many bits that are nearly always set or
+        // clear, and keys made of those put most descriptors in a few buckets.
+        // Keys are sampled from the bits closest to an even split instead.
+        const ArrayView<Descriptor> descriptors = mCollection.descriptors();
+        std::vector<uint32_t> ones(256, 0);
+        for (const Descriptor& d : descriptors) {
+            for (int b = 0; b < 256; ++b) {
+                ones[b] += static_cast<uint32_t>((d.bits[b >> 6] >> (b & 63)) & 1u);
+            }
+        }
+        uint8_t positions[256];
+        for (int b = 0; b < 256; ++b) {
+            positions[b] = static_cast<uint8_t>(b);
+        }
+        const int64_t half = header.featureCount / 2;
+        std::stable_sort(positions, positions + 256, [&ones, half](uint8_t a, uint8_t b) {
+            return std::llabs(ones[a] - half) < std::llabs(ones[b] - half);
+        });
+        const int pool = std::max<int>(kBalancedBits, header.keyBits);
+
+        std::mt19937 rng(0x5EEDu);
+        std::vector<uint32_t> keys(header.featureCount);
+        std::vector<uint32_t> fill(buckets);
+        for (uint32_t t = 0; t < header.tables; ++t) {
+            std::shuffle(positions, positions + pool, rng);
+            uint8_t* bits = out;
+            std::memcpy(bits, positions, header.keyBits);
+            out += paddedKeyBits(header.keyBits);
+            uint32_t* bucketStart = reinterpret_cast<uint32_t*>(out);
+            out += (buckets + 1) * sizeof(uint32_t);
+            uint32_t* entries = reinterpret_cast<uint32_t*>(out);
+            out += header.featureCount * sizeof(uint32_t);
+
+            for (uint32_t id = 0; id < header.featureCount; ++id) {
+                keys[id] = key(bits, header.keyBits, descriptors[id]);
+                ++bucketStart[keys[id] + 1];
+            }
+            for (size_t b = 0; b < buckets; ++b) {
+                bucketStart[b + 1] += bucketStart[b];
+            }
+            std::copy(bucketStart, bucketStart + buckets, fill.begin());
+            for (uint32_t id = 0; id < header.featureCount; ++id) {
+                entries[fill[keys[id]]++] = id;
+            }
+        }
+        attach(ArrayView<uint8_t>(mOwned.data(), mOwned.size()));
+    }
+
+    // Uses tables laid out as serialize() writes them. Searches index the
+    // collection with the bucket ranges and entries, so a table whose offsets
+    // go backwards or whose entries are not features is refused.
+    bool attach(ArrayView<uint8_t> data) {
+        LshHeader header;
+        if (data.size() < sizeof(header)) {
+            return false;
+        }
+        std::memcpy(&header, data.data(), sizeof(header));
+        if (header.magic != kLshMagic || header.tables == 0 || header.keyBits == 0 ||
+            header.keyBits > kMaxKeyBits || header.featureCount != mCollection.descriptors().size() ||
+            data.size() != sizeof(header) + header.tables * lshTableBytes(header.keyBits, header.featureCount)) {
+            return false;
+        }
+        const size_t buckets = size_t(1) << header.keyBits;
+        std::vector<Table> tables(header.tables);
+        const uint8_t* in = data.data() + sizeof(header);
+        for (Table& table : tables) {
+            table.bits = in;
+            in += paddedKeyBits(header.keyBits);
+            table.bucketStart = reinterpret_cast<const uint32_t*>(in);
+            in += (buckets + 1) * sizeof(uint32_t);
+            table.entries = reinterpret_cast<const uint32_t*>(in);
+            in += header.featureCount * sizeof(uint32_t);
+            if (table.bucketStart[buckets] != header.featureCount) {
+                return false;
+            }
+            for (size_t b = 0; b < buckets; ++b) {
+                if (table.bucketStart[b] > table.bucketStart[b + 1]) {
+                    return false;
+                }
+            }
+            for (uint32_t e = 0; e < header.featureCount; ++e) {
+                if (table.entries[e] >= header.featureCount) {
+                    return false;
+                }
+            }
+        }
+        mTables = std::move(tables);
+        mKeyBits = static_cast<int>(header.keyBits);
+        mData = data;
+        return true;
+    }
+
+    bool matches(const IndexOptions& options) const {
+        return static_cast<int>(mTables.size()) == std::max(1, options.lshTables) &&
+               mKeyBits == std::max(1, std::min(options.lshKeyBits, kMaxKeyBits));
+    }
+
+    void serialize(std::vector<uint8_t>& data) const override {
+        data.assign(mData.begin(), mData.end());
+    }
+
+    using DescriptorIndex::search;
+
+    void search(const Descriptor* const* queries, size_t count, NearestNeighbours* neighbours,
+                Arena* scratch) const override {
+        std::fill(neighbours, neighbours + count, NearestNeighbours());
+        const ArrayView<Descriptor> references = mCollection.descriptors();
+        ArenaVector<uint32_t> candidates{ArenaAllocator<uint32_t>(scratch)};
+        for (size_t q = 0; q < count; ++q) {
+            const Descriptor& query = *queries[q];
+            candidates.clear();
+            for (const Table& table : mTables) {
+                const uint32_t k = key(table.bits, mKeyBits, query);
+                collect(table, k, candidates);
+                if (mMultiProbe) {
+                    for (int bit = 0; bit < mKeyBits; ++bit) {
+                        collect(table, k ^ (1u << bit), candidates);
+                    }
+                }
+            }
+            // A descriptor found in several tables must only count once, or it
+            // would also be its own second best and fail the ratio test.
+            std::sort(candidates.begin(), candidates.end());
+            candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+            NearestNeighbours& n = neighbours[q];
+            for (uint32_t id : candidates) {
+                consider(n, hammingDistance(query, references[id]), 0, static_cast<int>(id));
+            }
+            toImageReference(mCollection, n);
+        }
+    }
+
+private:
+    struct Table {
+        const uint8_t* bits = nullptr;
+        const uint32_t* bucketStart = nullptr;
+        const uint32_t* entries = nullptr;
+    };
+
+    static uint32_t key(const uint8_t* bits, int keyBits, const Descriptor& d) {
+        uint32_t k = 0;
+        for (int i = 0; i < keyBits; ++i) {
+            const int b = bits[i];
+            k |= static_cast<uint32_t>((d.bits[b >> 6] >> (b & 63)) & 1u) << i;
+        }
+        return k;
+    }
+
+    static void collect(const Table& table, uint32_t k, ArenaVector<uint32_t>& candidates) {
+        candidates.insert(candidates.end(), table.entries + table.bucketStart[k],
+                          table.entries + table.bucketStart[k + 1]);
+    }
+
+    const Collection& mCollection;
+    bool mMultiProbe;
+    int mKeyBits = 0;
+    std::vector<Table> mTables;
+    std::vector<uint8_t> mOwned;  ///< Tables built in memory; empty when they live in the collection file.
+    ArrayView<uint8_t> mData;
+};
+
+}
+
+std::unique_ptr<DescriptorIndex> DescriptorIndex::create(const Collection& collection, const IndexOptions& options) {
+    switch (options.type) {
+        case IndexType::LSH: {
+            std::unique_ptr<LshIndex> index(new LshIndex(collection, options.lshMultiProbe));
+            if (!index->attach(collection.storedIndex()) || !index->matches(options)) {
+                index->build(options);
+            }
+            return std::unique_ptr<DescriptorIndex>(std::move(index));
+        }
+        case IndexType::EXACT:
+            break;
+    }
+    return std::unique_ptr<DescriptorIndex>(new ExactIndex(collection));
+}
+
+}
@@ -0,0 +1,83 @@
+//
+//  DuplicateFrameGate.cpp
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "rsr/DuplicateFrameGate.h"
+
+namespace rsr {
+
+DuplicateFrameGate::DuplicateFrameGate(const FrameGateOptions& options) : mOptions(options) {}
+
+ErrorCode DuplicateFrameGate::search(OnDeviceIR& onDeviceIR, const VideoFrame& frame,
+                                     std::vector<SearchResult>& results, bool* reused) {
+    const bool needed = shouldSearch(frame);
+    if (reused) {
+        *reused = !needed;
+    }
+    if (!needed) {
+        results = mResults;
+        return ErrorCode::SUCCESS;
+    }
+    const ErrorCode error = onDeviceIR.searchWithVideoFrame(frame, results);
+    if (error == ErrorCode::SUCCESS) {
+        recordResults(results);
+    }
+    return error;
+}
+
+ErrorCode DuplicateFrameGate::search(OnDeviceIR& onDeviceIR, const ImagePyramid& pyramid,
+                                     std::vector<SearchResult>& results, bool* reused) {
+    const bool needed = shouldSearch(pyramid);
+    if (reused) {
+        *reused = !needed;
+    }
+    if (!needed) {
+        results = mResults;
+        return ErrorCode::SUCCESS;
+    }
+    const ErrorCode error = onDeviceIR.searchWithPyramid(pyramid, results);
+    if (error == ErrorCode::SUCCESS) {
+        recordResults(results);
+    }
+    return error;
+}
+
+bool DuplicateFrameGate::shouldSearch(const VideoFrame& frame) {
+    return shouldSearchSketch(FrameSketch::of(frame));
+}
+
+bool DuplicateFrameGate::shouldSearch(const ImagePyramid& pyramid) {
+    return shouldSearchSketch(FrameSketch::of(pyramid));
+}
+
+bool DuplicateFrameGate::shouldSearchSketch(const FrameSketch& sketch) {
+    ++mCounters.frames;
+    const bool forced = mOptions.maxReuses > 0 && mReuses >= mOptions.maxReuses;
+    // An invalid reference (nothing recorded yet) is at distance 255 from everything.
+    if (!forced && sketch.distance(mReference) <= mOptions.maxDistance) {
+        ++mReuses;
+        ++mCounters.reused;
+        return false;
+    }
+    mCandidate = sketch;
+    ++mCounters.searched;
+    return true;
+}
+
+void DuplicateFrameGate::recordResults(const std::vector<SearchResult>& results) {
+    mReference = mCandidate;
+    mResults = results;
+    mReuses = 0;
+}
+
+void DuplicateFrameGate::reset() {
+    mCandidate = FrameSketch();
+    mReference = FrameSketch();
+    mResults.clear();
+    mReuses = 0;
+}
+
+}
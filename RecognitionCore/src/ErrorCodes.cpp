@@ -0,0 +1,39 @@
+//
+//  ErrorCodes.cpp
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "rsr/ErrorCodes.h"
+
+namespace rsr {
+
+const char* errorCodeName(ErrorCode code) {
+    switch (code) {
+        case ErrorCode::SUCCESS: return "SUCCESS";
+        case ErrorCode::UNKNOWN_ERROR: return "UNKNOWN_ERROR";
+        case ErrorCode::INTERNAL_ERROR: return "INTERNAL_ERROR";
+        case ErrorCode::COLLECTION_MANAGER_EXTRACT_ERROR: return "COLLECTION_MANAGER_EXTRACT_ERROR";
+        case ErrorCode::COLLECTION_MANAGER_DELETE_ERROR: return "COLLECTION_MANAGER_DELETE_ERROR";
+        case ErrorCode::COLLECTION_MANAGER_INVALID_PARAMS: return "COLLECTION_MANAGER_INVALID_PARAMS";
+        case ErrorCode::COLLECTION_MANAGER_SYNC_ERROR: return "COLLECTION_MANAGER_SYNC_ERROR";
+        case ErrorCode::COLLECTION_NOT_FOUND: return "COLLECTION_NOT_FOUND";
+        case ErrorCode::COLLECTION_MISSING_FILES: return "COLLECTION_MISSING_FILES";
+        case ErrorCode::COLLECTION_INVALID: return "COLLECTION_INVALID";
+        case ErrorCode::COLLECTION_INVALID_ITEM: return "COLLECTION_INVALID_ITEM";
+        case ErrorCode::COLLECTION_ITEM_NOT_FOUND: return "COLLECTION_ITEM_NOT_FOUND";
+        case ErrorCode::COLLECTION_BUNDLE_VERSION_IS_OLD: return "COLLECTION_BUNDLE_VERSION_IS_OLD";
+        case ErrorCode::COLLECTION_BUNDLE_SDK_VERSION_IS_OLD: return "COLLECTION_BUNDLE_SDK_VERSION_IS_OLD";
+        case ErrorCode::ON_DEVICE_IR_COLLECTION_NOT_FOUND: return "ON_DEVICE_IR_COLLECTION_NOT_FOUND";
+        case ErrorCode::ON_DEVICE_IR_NO_ACTIVE_COLLECTION: return "ON_DEVICE_IR_NO_ACTIVE_COLLECTION";
+        case ErrorCode::SEARCH_ERROR_IMAGE_NO_DETAILS: return "SEARCH_ERROR_IMAGE_NO_DETAILS";
+        case ErrorCode::SEARCH_ERROR_IMAGE_TOO_SMALL: return "SEARCH_ERROR_IMAGE_TOO_SMALL";
+        case ErrorCode::SEARCH_ERROR_READING_FILE: return "SEARCH_ERROR_READING_FILE";
+        case ErrorCode::SEARCH_ERROR_IMAGE_HAS_TRANSPARENCY: return "SEARCH_ERROR_IMAGE_HAS_TRANSPARENCY";
+        case ErrorCode::SEARCH_CANCELLED: return "SEARCH_CANCELLED";
+    }
+    return "UNKNOWN_ERROR";
+}
+
+}
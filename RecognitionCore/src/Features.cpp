@@ -0,0 +1,382 @@
+//
+//  Features.cpp
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "rsr/Features.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace rsr {
+
+namespace {
+
+constexpr float kPi = 3.14159265358979f;
+
+// Distance kept from the image border: BRIEF tests reach 13 * sqrt(2) pixels
+// once rotated and the orientation patch has a radius of 15.
+constexpr int kBorder = 20;
+constexpr int kOrientationRadius = 15;
+constexpr int kPatternPairs = 256;
+constexpr int kAngleBins = 30;
+
+struct TestPair {
+    int8_t x1, y1, x2, y2;
+};
+
+using Pattern = std::array<TestPair, kPatternPairs>;
+
+// Bresenham circle of radius 3 used by the FAST segment test, clockwise from the top.
+constexpr int kCircle[16][2] = {
+    {0, -3}, {1, -3}, {2, -2}, {3, -1}, {3, 0}, {3, 1}, {2, 2}, {1, 3},
+    {0, 3}, {-1, 3}, {-2, 2}, {-3, 1}, {-3, 0}, {-3, -1}, {-2, -2}, {-1, -3},
+};
+
+// BRIEF sampling pattern: pairs drawn from an isotropic Gaussian with
+// sigma = patch size / 5 (patch size 31), from a fixed seed so that reference
+// and query descriptors always agree.
+Pattern makeBasePattern() {
+    Pattern pattern;
+    uint32_t state = 0x2545F491u;
+    auto uniform = [&state]() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return (state >> 8) * (1.0f / 16777216.0f);
+    };
+    auto gaussian = [&uniform]() {
+        const float u1 = std::max(uniform(), 1e-7f);
+        const float u2 = uniform();
+        return std::sqrt(-2.0f * std::log(u1)) * std::cos(2.0f * kPi * u2);
+    };
+    auto sample = [&gaussian]() {
+        const float v = std::round(gaussian() * 31.0f / 5.0f);
+        return static_cast<int8_t>(std::max(-13.0f, std::min(13.0f, v)));
+    };
+    for (TestPair& pair : pattern) {
+        pair.x1 = sample();
+        pair.y1 = sample();
+        pair.x2 = sample();
+        pair.y2 = sample();
+    }
+    return pattern;
+}
+
+const std::array<Pattern, kAngleBins>& rotatedPatterns() {
+    static const std::array<Pattern, kAngleBins> patterns = [] {
+        const Pattern base = makeBasePattern();
+        std::array<Pattern, kAngleBins> rotated;
+        for (int bin = 0; bin < kAngleBins; ++bin) {
+            const float a = bin * 2.0f * kPi / kAngleBins;
+            const float c = std::cos(a);
+            const float s = std::sin(a);
+            for (int i = 0; i < kPatternPairs; ++i) {
+                const TestPair& p = base[i];
+                rotated[bin][i].x1 = static_cast<int8_t>(std::lround(c * p.x1 - s * p.y1));
+                rotated[bin][i].y1 = static_cast<int8_t>(std::lround(s * p.x1 + c * p.y1));
+                rotated[bin][i].x2 = static_cast<int8_t>(std::lround(c * p.x2 - s * p.y2));
+                rotated[bin][i].y2 = static_cast<int8_t>(std::lround(s * p.x2 + c * p.y2));
+            }
+        }
+        return rotated;
+    }();
+    return patterns;
+}
+
+// Half-width of each row of the orientation disc.
+const std::array<int, kOrientationRadius + 1>& orientationUMax() {
+    static const std::array<int, kOrientationRadius + 1> umax = [] {
+        std::array<int, kOrientationRadius + 1> u{};
+        for (int v = 0; v <= kOrientationRadius; ++v) {
+            u[v] = static_cast<int>(std::floor(std::sqrt(
+                static_cast<float>(kOrientationRadius * kOrientationRadius - v * v)) + 0.5f));
+        }
+        return u;
+    }();
+    return umax;
+}
+
+// Separable 5x5 box filter used to make the BRIEF tests robust to noise.
+// tmp and dst are resized to the image.
+GrayView boxBlur5(const GrayView& src, ArenaVector<uint8_t>& tmp, ArenaVector<uint8_t>& dst) {
+    const size_t size = static_cast<size_t>(src.width) * src.height;
+    tmp.resize(size);
+    dst.resize(size);
+    for (int y = 0; y < src.height; ++y) {
+        const uint8_t* in = src.row(y);
+        uint8_t* out = tmp.data() + static_cast<size_t>(y) * src.width;
+        for (int x = 0; x < src.width; ++x) {
+            int sum = 0;
+            for (int k = -2; k <= 2; ++k) {
+                sum += in[std::min(std::max(x + k, 0), src.width - 1)];
+            }
+            out[x] = static_cast<uint8_t>((sum + 2) / 5);
+        }
+    }
+    for (int y = 0; y < src.height; ++y) {
+        uint8_t* out = dst.data() + static_cast<size_t>(y) * src.width;
+        for (int x = 0; x < src.width; ++x) {
+            int sum = 0;
+            for (int k = -2; k <= 2; ++k) {
+                sum += tmp[static_cast<size_t>(std::min(std::max(y + k, 0), src.height - 1)) * src.width + x];
+            }
+            out[x] = static_cast<uint8_t>((sum + 2) / 5);
+        }
+    }
+    return GrayView{dst.data(), src.width, src.height};
+}
+
+// FAST-9 segment test. Returns 0 for non corners, otherwise the summed
+// contrast of the circle pixels beyond the threshold.
+int fastScore(const GrayView& image, int x, int y, int threshold, const int* offsets) {
+    const uint8_t* center = image.row(y) + x;
+    const int v = *center;
+    const int hi = v + threshold;
+    const int lo = v - threshold;
+
+    // A contiguous arc of 9 covers at least two of the four compass points.
+    int brightCompass = 0;
+    int darkCompass = 0;
+    for (int i = 0; i < 16; i += 4) {
+        const int p = center[offsets[i]];
+        brightCompass += p > hi;
+        darkCompass += p < lo;
+    }
+    if (brightCompass < 2 && darkCompass < 2) {
+        return 0;
+    }
+
+    uint32_t bright = 0;
+    uint32_t dark = 0;
+    int brightSum = 0;
+    int darkSum = 0;
+    for (int i = 0; i < 16; ++i) {
+        const int p = center[offsets[i]];
+        if (p > hi) {
+            bright |= 1u << i;
+            brightSum += p - hi;
+        } else if (p < lo) {
+            dark |= 1u << i;
+            darkSum += lo - p;
+        }
+    }
+    auto hasArc = [](uint32_t mask) {
+        uint32_t m = mask | (mask << 16);
+        uint32_t run = m;
+        for (int i = 1; i < 9; ++i) {
+            run &= m >> i;
+        }
+        return run != 0;
+    };
+    int score = 0;
+    if (hasArc(bright)) {
+        score = brightSum;
+    }
+    if (hasArc(dark)) {
+        score = std::max(score, darkSum);
+    }
+    return score;
+}
+
+struct Corner {
+    int x;
+    int y;
+    int score;
+};
+
+// scores is resized to the image.
+void detectCorners(const GrayView& image, int threshold, ArenaVector<int>& scores, ArenaVector<Corner>& corners) {
+    corners.clear();
+    if (image.width <= 2 * kBorder || image.height <= 2 * kBorder) {
+        return;
+    }
+    int offsets[16];
+    for (int i = 0; i < 16; ++i) {
+        offsets[i] = kCircle[i][1] * image.width + kCircle[i][0];
+    }
+
+    scores.assign(static_cast<size_t>(image.width) * image.height, 0);
+    for (int y = kBorder; y < image.height - kBorder; ++y) {
+        int* row = scores.data() + static_cast<size_t>(y) * image.width;
+        for (int x = kBorder; x < image.width - kBorder; ++x) {
+            row[x] = fastScore(image, x, y, threshold, offsets);
+        }
+    }
+
+    // 3x3 non-maximum suppression; ties go to the first pixel in raster order.
+    const int w = image.width;
+    for (int y = kBorder; y < image.height - kBorder; ++y) {
+        const int* row = scores.data() + static_cast<size_t>(y) * w;
+        for (int x = kBorder; x < w - kBorder; ++x) {
+            const int s = row[x];
+            if (s == 0) {
+                continue;
+            }
+            const int* above = row - w;
+            const int* below = row + w;
+            if (s > above[x - 1] && s > above[x] && s > above[x + 1] && s > row[x - 1] &&
+                s >= row[x + 1] && s >= below[x - 1] && s >= below[x] && s >= below[x + 1]) {
+                corners.push_back({x, y, s});
+            }
+        }
+    }
+}
+
+float intensityCentroidAngle(const GrayView& image, int x, int y) {
+    const auto& umax = orientationUMax();
+    const int step = image.width;
+    const uint8_t* center = image.row(y) + x;
+    int m01 = 0;
+    int m10 = 0;
+    for (int u = -kOrientationRadius; u <= kOrientationRadius; ++u) {
+        m10 += u * center[u];
+    }
+    for (int v = 1; v <= kOrientationRadius; ++v) {
+        int vSum = 0;
+        const int d = umax[v];
+        for (int u = -d; u <= d; ++u) {
+            const int below = center[u + v * step];
+            const int above = center[u - v * step];
+            vSum += below - above;
+            m10 += u * (below + above);
+        }
+        m01 += v * vSum;
+    }
+    return std::atan2(static_cast<float>(m01), static_cast<float>(m10));
+}
+
+Descriptor describe(const GrayView& blurred, int x, int y, float angle) {
+    float a = angle;
+    if (a < 0.0f) {
+        a += 2.0f * kPi;
+    }
+    const int bin = static_cast<int>(std::lround(a * kAngleBins / (2.0f * kPi))) % kAngleBins;
+    const Pattern& pattern = rotatedPatterns()[bin];
+    const int step = blurred.width;
+    const uint8_t* center = blurred.row(y) + x;
+
+    Descriptor descriptor;
+    for (int i = 0; i < kPatternPairs; ++i) {
+        const TestPair& t = pattern[i];
+        const int p1 = center[t.y1 * step + t.x1];
+        const int p2 = center[t.y2 * step + t.x2];
+        if (p1 < p2) {
+            descriptor.bits[i >> 6] |= uint64_t(1) << (i & 63);
+        }
+    }
+    return descriptor;
+}
+
+}
+
+int hammingDistance(const Descriptor& a, const Descriptor& b) {
+    return __builtin_popcountll(a.bits[0] ^ b.bits[0]) + __builtin_popcountll(a.bits[1] ^ b.bits[1]) +
+           __builtin_popcountll(a.bits[2] ^ b.bits[2]) + __builtin_popcountll(a.bits[3] ^ b.bits[3]);
+}
+
+FeatureExtractor::FeatureExtractor(const ExtractorOptions& options) : mOptions(options) {
+    // Build the lookup tables up front rather than inside the first search.
+    rotatedPatterns();
+    orientationUMax();
+}
+
+int FeatureExtractor::reductionFactor(int width, int height) const {
+    const int longest = std::max(width, height);
+    int factor = 1;
+    while (factor < 4 && longest / (factor * 2) >= mOptions.maxDimension) {
+        factor *= 2;
+    }
+    return factor;
+}
+
+PyramidOptions FeatureExtractor::pyramidOptions() const {
+    PyramidOptions options;
+    options.maxDimension = mOptions.maxDimension;
+    options.scale = mOptions.pyramidScale;
+    return options;
+}
+
+ErrorCode FeatureExtractor::extract(const GrayImage& image, FeatureSet& features, int inputScale) const {
+    ImagePyramid pyramid;
+    pyramid.build(image, inputScale, pyramidOptions());
+    return extract(pyramid, features);
+}
+
+ErrorCode FeatureExtractor::extract(const ImagePyramid& pyramid, FeatureSet& features, Arena* scratch) const {
+    const PyramidOptions& options = pyramid.options();
+    if (options.maxDimension != mOptions.maxDimension || options.scale != mOptions.pyramidScale) {
+        // Built for someone else's levels: rebuild from the reduced image.
+        ImagePyramid own;
+        const GrayView reduced = pyramid.reduced();
+        own.build(reduced, reduced.empty() ? 1 : pyramid.inputWidth() / reduced.width, pyramidOptions());
+        return extract(own, features, scratch);
+    }
+
+    features.clear();
+    features.width = pyramid.inputWidth();
+    features.height = pyramid.inputHeight();
+
+    if (pyramid.empty() || std::min(features.width, features.height) < mOptions.minDimension) {
+        return ErrorCode::SEARCH_ERROR_IMAGE_TOO_SMALL;
+    }
+    const GrayView base = pyramid.level(0);
+    features.processingScale = static_cast<float>(features.width) / base.width;
+
+    // Spread the feature budget over the levels proportionally to their area.
+    const int levels = std::max(1, mOptions.pyramidLevels);
+    const float areaRatio = 1.0f / (mOptions.pyramidScale * mOptions.pyramidScale);
+    float areaSum = 0.0f;
+    for (int l = 0; l < levels; ++l) {
+        areaSum += std::pow(areaRatio, static_cast<float>(l));
+    }
+
+    // Sized by level 0; smaller levels reuse the buffers.
+    ArenaVector<int> scores{ArenaAllocator<int>(scratch)};
+    ArenaVector<Corner> corners{ArenaAllocator<Corner>(scratch)};
+    ArenaVector<uint8_t> blurTmp{ArenaAllocator<uint8_t>(scratch)};
+    ArenaVector<uint8_t> blurred{ArenaAllocator<uint8_t>(scratch)};
+    for (int l = 0; l < levels; ++l) {
+        if (l > 0 && (l >= pyramid.levelCount() || pyramid.level(l).width <= 2 * kBorder + 8 ||
+                      pyramid.level(l).height <= 2 * kBorder + 8)) {
+            break;
+        }
+        const GrayView level = pyramid.level(l);
+        const int quota = static_cast<int>(std::ceil(
+            mOptions.maxFeatures * std::pow(areaRatio, static_cast<float>(l)) / areaSum));
+
+        detectCorners(level, mOptions.fastThreshold, scores, corners);
+        if (corners.empty()) {
+            continue;
+        }
+        if (static_cast<int>(corners.size()) > quota) {
+            std::nth_element(corners.begin(), corners.begin() + quota, corners.end(),
+                             [](const Corner& a, const Corner& b) { return a.score > b.score; });
+            corners.resize(quota);
+        }
+
+        const GrayView blur = boxBlur5(level, blurTmp, blurred);
+        const float toInputX = features.processingScale * base.width / level.width;
+        const float toInputY = static_cast<float>(features.height) / level.height;
+        for (const Corner& c : corners) {
+            Keypoint kp;
+            kp.x = c.x * toInputX;
+            kp.y = c.y * toInputY;
+            kp.scale = toInputX;
+            kp.angle = intensityCentroidAngle(level, c.x, c.y);
+            kp.response = static_cast<float>(c.score);
+            features.keypoints.push_back(kp);
+            features.descriptors.push_back(describe(blur, c.x, c.y, kp.angle));
+        }
+    }
+
+    if (static_cast<int>(features.size()) < mOptions.minFeatures) {
+        return ErrorCode::SEARCH_ERROR_IMAGE_NO_DETAILS;
+    }
+    return ErrorCode::SUCCESS;
+}
+
+}
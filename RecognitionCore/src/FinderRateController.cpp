@@ -0,0 +1,123 @@
+//
+//  FinderRateController.cpp
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "rsr/FinderRateController.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace rsr {
+
+RateControllerOptions RateControllerOptions::onDevice(double cameraFps, int workers) {
+    RateControllerOptions options;
+    options.maxRate = cameraFps;
+    options.workers = std::max(1, workers);
+    return options;
+}
+
+RateControllerOptions RateControllerOptions::cloud(double maxSearchesPerSecond) {
+    RateControllerOptions options;
+    options.minRate = std::min(0.5, maxSearchesPerSecond);
+    options.maxRate = maxSearchesPerSecond;
+    // Round trips are mostly waiting on the network: keep a few requests in flight.
+    options.workers = 4;
+    options.increasePerSecond = 0.5;
+    options.cpuReserve = 0.0;
+    return options;
+}
+
+FinderRateController::FinderRateController(const RateControllerOptions& options)
+    : mOptions(options), mRate(options.minRate) {}
+
+bool FinderRateController::shouldSubmit(double now) {
+    if (now < mNextSubmit || mInFlight > mOptions.workers) {
+        return false;
+    }
+    // Pace from the previous slot, but never bank more than half a missed slot.
+    const double interval = 1.0 / mRate;
+    mNextSubmit = std::max(mNextSubmit + interval, now + 0.5 * interval);
+    ++mInFlight;
+    return true;
+}
+
+void FinderRateController::onSearchCompleted(double now, double latencySeconds) {
+    mInFlight = std::max(0, mInFlight - 1);
+    mLatency = mLatency == 0.0 ? latencySeconds : mLatency + mOptions.latencySmoothing * (latencySeconds - mLatency);
+    if (mLatency > 0.0) {
+        adjust(now, desiredRate());
+    }
+}
+
+void FinderRateController::onSearchDropped(double) {
+    mInFlight = std::max(0, mInFlight - 1);
+}
+
+void FinderRateController::onCpuHeadroom(double now, double headroom) {
+    mHeadroom = headroom;
+    if (mLatency > 0.0 && mOptions.cpuReserve > 0.0) {
+        adjust(now, desiredRate());
+    }
+}
+
+double FinderRateController::desiredRate() const {
+    double share = mOptions.targetUtilization;
+    if (mOptions.cpuReserve > 0.0) {
+        // The measured headroom already excludes our own searches: add them back.
+        const double own = std::min(1.0, mRate * mLatency / mOptions.workers);
+        share = std::min(share, std::max(0.0, mHeadroom + own - mOptions.cpuReserve));
+    }
+    return share * mOptions.workers / mLatency;
+}
+
+void FinderRateController::adjust(double now, double desired) {
+    desired = std::min(mOptions.maxRate, std::max(mOptions.minRate, desired));
+    const double elapsed = mLastAdjust < 0.0 ? 0.0 : now - mLastAdjust;
+    if (desired < mRate * (1.0 - mOptions.hysteresis)) {
+        // Back off at once, but only once per search time: the searches still
+        // in flight were submitted at the old rate and report the same overload.
+        if (mLastAdjust >= 0.0 && elapsed < mLatency) {
+            return;
+        }
+        mRate = desired;
+    } else if (desired > mRate * (1.0 + mOptions.hysteresis) || (desired == mOptions.maxRate && mRate < desired)) {
+        mRate = std::min(desired, mRate + mOptions.increasePerSecond * elapsed);
+    } else {
+        return;
+    }
+    mLastAdjust = now;
+}
+
+double CpuHeadroomProbe::sample() {
+#ifdef __linux__
+    FILE* stat = std::fopen("/proc/stat", "r");
+    if (!stat) {
+        return 1.0;
+    }
+    unsigned long long user = 0, nice = 0, system = 0, idle = 0, iowait = 0, irq = 0, softirq = 0, steal = 0;
+    const int fields = std::fscanf(stat, "cpu %llu %llu %llu %llu %llu %llu %llu %llu", &user, &nice, &system, &idle,
+                                   &iowait, &irq, &softirq, &steal);
+    std::fclose(stat);
+    if (fields < 4) {
+        return 1.0;
+    }
+    const uint64_t idleTime = idle + iowait;
+    const uint64_t total = user + nice + system + idle + iowait + irq + softirq + steal;
+    const bool first = mTotal == 0;
+    const uint64_t idleDelta = idleTime - mIdle;
+    const uint64_t totalDelta = total - mTotal;
+    mIdle = idleTime;
+    mTotal = total;
+    if (first || totalDelta == 0) {
+        return 1.0;
+    }
+    return static_cast<double>(idleDelta) / totalDelta;
+#else
+    return 1.0;
+#endif
+}
+
+}
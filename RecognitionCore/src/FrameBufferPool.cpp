@@ -0,0 +1,174 @@
+//
+//  FrameBufferPool.cpp
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "rsr/FrameBufferPool.h"
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace rsr {
+
+struct FrameBuffer::Buffer {
+    std::atomic<int> references{0};
+    VideoFrame frame;
+    std::vector<uint8_t> storage;                      ///< Pooled pixels, kept while the buffer is idle.
+    std::function<void()> release;                     ///< Set for wrapped frames.
+    std::shared_ptr<FrameBufferPool::State> pool;      ///< Set while held.
+};
+
+struct FrameBufferPool::State {
+    FramePoolOptions options;
+    mutable std::mutex mutex;
+    std::vector<std::unique_ptr<FrameBuffer::Buffer>> buffers;  ///< Every buffer made, at most maxOutstanding.
+    std::vector<FrameBuffer::Buffer*> idle;
+    FramePoolCounters counters;
+
+    void recycle(FrameBuffer::Buffer* buffer) {
+        std::lock_guard<std::mutex> lock(mutex);
+        idle.push_back(buffer);
+        --counters.outstanding;
+    }
+};
+
+FrameBuffer::FrameBuffer(const FrameBuffer& other) : mBuffer(other.mBuffer) {
+    if (mBuffer) {
+        mBuffer->references.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+FrameBuffer& FrameBuffer::operator=(FrameBuffer other) noexcept {
+    std::swap(mBuffer, other.mBuffer);
+    return *this;
+}
+
+VideoFrame FrameBuffer::frame() const {
+    return mBuffer ? mBuffer->frame : VideoFrame();
+}
+
+uint8_t* FrameBuffer::pixels() const {
+    return mBuffer && !mBuffer->release ? mBuffer->storage.data() : nullptr;
+}
+
+int FrameBuffer::useCount() const {
+    return mBuffer ? mBuffer->references.load(std::memory_order_relaxed) : 0;
+}
+
+void FrameBuffer::reset() {
+    Buffer* buffer = mBuffer;
+    mBuffer = nullptr;
+    // Acquire-release so the last holder sees every other holder's use finished.
+    if (!buffer || buffer->references.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        return;
+    }
+    std::function<void()> release = std::move(buffer->release);
+    buffer->release = nullptr;
+    buffer->frame = VideoFrame();
+    // Holding the pool state here keeps it alive through recycle() even if
+    // the pool is gone and this was the last buffer out.
+    const std::shared_ptr<FrameBufferPool::State> pool = std::move(buffer->pool);
+    if (release) {
+        release();
+    }
+    pool->recycle(buffer);
+}
+
+FrameBufferPool::FrameBufferPool(const FramePoolOptions& options) : mState(std::make_shared<State>()) {
+    mState->options = options;
+}
+
+FrameBufferPool::~FrameBufferPool() = default;
+
+FrameBuffer::Buffer* FrameBufferPool::take(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mState->mutex);
+    if (mState->counters.outstanding >= mState->options.maxOutstanding) {
+        ++mState->counters.refused;
+        return nullptr;
+    }
+    FrameBuffer::Buffer* buffer = nullptr;
+    if (mState->idle.empty()) {
+        mState->buffers.emplace_back(new FrameBuffer::Buffer);
+        buffer = mState->buffers.back().get();
+    } else {
+        // Prefer a buffer that already holds enough pixels.
+        size_t chosen = mState->idle.size() - 1;
+        for (size_t i = 0; i < mState->idle.size(); ++i) {
+            if (mState->idle[i]->storage.capacity() >= bytes) {
+                chosen = i;
+                break;
+            }
+        }
+        buffer = mState->idle[chosen];
+        mState->idle[chosen] = mState->idle.back();
+        mState->idle.pop_back();
+    }
+    if (buffer->storage.capacity() < bytes) {
+        ++mState->counters.allocations;
+    }
+    ++mState->counters.acquired;
+    ++mState->counters.outstanding;
+    buffer->references.store(1, std::memory_order_relaxed);
+    buffer->pool = mState;
+    return buffer;
+}
+
+FrameBuffer FrameBufferPool::acquire(int width, int height) {
+    if (width <= 0 || height <= 0) {
+        return FrameBuffer();
+    }
+    const size_t bytes = static_cast<size_t>(width) * height * 4;
+    FrameBuffer::Buffer* buffer = take(bytes);
+    if (!buffer) {
+        return FrameBuffer();
+    }
+    buffer->storage.resize(bytes);
+    buffer->frame = VideoFrame{buffer->storage.data(), width, height, width * 4};
+    return FrameBuffer(buffer);
+}
+
+FrameBuffer FrameBufferPool::copy(const VideoFrame& frame) {
+    if (!frame.isValid()) {
+        return FrameBuffer();
+    }
+    FrameBuffer copied = acquire(frame.width, frame.height);
+    uint8_t* pixels = copied.pixels();
+    if (!pixels) {
+        return copied;
+    }
+    const size_t rowBytes = static_cast<size_t>(frame.width) * 4;
+    if (static_cast<size_t>(frame.bytesPerRow) == rowBytes) {
+        std::memcpy(pixels, frame.bgraBytes, rowBytes * frame.height);
+    } else {
+        for (int y = 0; y < frame.height; ++y) {
+            std::memcpy(pixels + y * rowBytes, frame.bgraBytes + static_cast<size_t>(y) * frame.bytesPerRow, rowBytes);
+        }
+    }
+    return copied;
+}
+
+FrameBuffer FrameBufferPool::wrap(const VideoFrame& frame, std::function<void()> release) {
+    FrameBuffer::Buffer* buffer = frame.isValid() ? take(0) : nullptr;
+    if (!buffer) {
+        if (release) {
+            release();
+        }
+        return FrameBuffer();
+    }
+    buffer->frame = frame;
+    // Never empty, so that pixels() can tell a wrapped frame from a pooled one.
+    buffer->release = release ? std::move(release) : [] {};
+    return FrameBuffer(buffer);
+}
+
+FramePoolCounters FrameBufferPool::counters() const {
+    std::lock_guard<std::mutex> lock(mState->mutex);
+    return mState->counters;
+}
+
+}
@@ -0,0 +1,72 @@
+//
+//  FrameRing.cpp
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "rsr/FrameRing.h"
+
+#include <cstring>
+
+namespace rsr {
+
+uint64_t FrameRing::publish(const VideoFrame& frame) {
+    Slot& slot = mSlots[mBack];
+    const size_t rowBytes = static_cast<size_t>(frame.width) * 4;
+    const size_t size = frame.isValid() ? rowBytes * frame.height : 0;
+    if (slot.pixels.capacity() < size) {
+        mAllocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    slot.pixels.resize(size);
+    if (size > 0) {
+        if (static_cast<size_t>(frame.bytesPerRow) == rowBytes) {
+            std::memcpy(slot.pixels.data(), frame.bgraBytes, size);
+        } else {
+            for (int y = 0; y < frame.height; ++y) {
+                const uint8_t* row = frame.bgraBytes + static_cast<size_t>(y) * frame.bytesPerRow;
+                std::memcpy(slot.pixels.data() + y * rowBytes, row, rowBytes);
+            }
+        }
+    }
+    slot.width = size > 0 ? frame.width : 0;
+    slot.height = size > 0 ? frame.height : 0;
+    slot.sequence = mPublished.load(std::memory_order_relaxed) + 1;
+
+    // Release publishes the pixels; acquire takes back whichever buffer the consumer left.
+    const uint32_t previous = mShared.exchange(mBack | kFresh, std::memory_order_acq_rel);
+    mBack = previous & kIndexMask;
+    if (previous & kFresh) {
+        mDropped.fetch_add(1, std::memory_order_relaxed);
+    }
+    mPublished.store(slot.sequence, std::memory_order_relaxed);
+    return slot.sequence;
+}
+
+bool FrameRing::acquireLatest(VideoFrame& frame, uint64_t* sequence) {
+    if ((mShared.load(std::memory_order_relaxed) & kFresh) == 0) {
+        return false;
+    }
+    const uint32_t previous = mShared.exchange(mFront, std::memory_order_acq_rel);
+    mFront = previous & kIndexMask;
+    mConsumed.fetch_add(1, std::memory_order_relaxed);
+
+    const Slot& slot = mSlots[mFront];
+    frame = VideoFrame{slot.pixels.data(), slot.width, slot.height, slot.width * 4};
+    if (sequence) {
+        *sequence = slot.sequence;
+    }
+    return true;
+}
+
+FrameRingCounters FrameRing::counters() const {
+    FrameRingCounters counters;
+    counters.published = mPublished.load(std::memory_order_relaxed);
+    counters.consumed = mConsumed.load(std::memory_order_relaxed);
+    counters.dropped = mDropped.load(std::memory_order_relaxed);
+    counters.allocations = mAllocations.load(std::memory_order_relaxed);
+    counters.depth = (mShared.load(std::memory_order_relaxed) & kFresh) ? 1 : 0;
+    return counters;
+}
+
+}
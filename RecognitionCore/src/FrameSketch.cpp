@@ -0,0 +1,76 @@
+//
+//  FrameSketch.cpp
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "rsr/FrameSketch.h"
+
+#include <cstdlib>
+
+namespace rsr {
+
+FrameSketch FrameSketch::of(const VideoFrame& frame) {
+    FrameSketch sketch;
+    if (!frame.isValid() || frame.width < kSize * 4 || frame.height < kSize * 4) {
+        return sketch;
+    }
+    for (int cy = 0; cy < kSize; ++cy) {
+        const int y0 = (2 * cy + 1) * frame.height / (2 * kSize) - 2;
+        for (int cx = 0; cx < kSize; ++cx) {
+            const int x0 = (2 * cx + 1) * frame.width / (2 * kSize) - 2;
+            // Same weights and rounding as reduceBGRAToGray with a factor of 4.
+            uint32_t sum = 0;
+            for (int y = y0; y < y0 + 4; ++y) {
+                const uint8_t* p = frame.bgraBytes + static_cast<size_t>(y) * frame.bytesPerRow + x0 * 4;
+                for (int x = 0; x < 4; ++x, p += 4) {
+                    sum += 29 * p[0] + 150 * p[1] + 77 * p[2];
+                }
+            }
+            sketch.cells[cy * kSize + cx] = static_cast<uint8_t>((sum + 16 * 128) / (16 * 256));
+        }
+    }
+    sketch.valid = true;
+    return sketch;
+}
+
+FrameSketch FrameSketch::of(const ImagePyramid& pyramid) {
+    FrameSketch sketch;
+    const GrayView image = pyramid.reduced();
+    if (image.empty() || pyramid.inputWidth() < kSize * 4 || pyramid.inputHeight() < kSize * 4) {
+        return sketch;
+    }
+    // Each reduced pixel already averages factor x factor frame pixels.
+    const int factor = pyramid.inputWidth() / image.width;
+    const int block = factor >= 4 ? 1 : 4 / factor;
+    for (int cy = 0; cy < kSize; ++cy) {
+        const int y0 = ((2 * cy + 1) * pyramid.inputHeight() / (2 * kSize) - 2) / factor;
+        for (int cx = 0; cx < kSize; ++cx) {
+            const int x0 = ((2 * cx + 1) * pyramid.inputWidth() / (2 * kSize) - 2) / factor;
+            int sum = 0;
+            for (int y = y0; y < y0 + block; ++y) {
+                const uint8_t* p = image.row(y) + x0;
+                for (int x = 0; x < block; ++x) {
+                    sum += p[x];
+                }
+            }
+            sketch.cells[cy * kSize + cx] = static_cast<uint8_t>(sum / (block * block));
+        }
+    }
+    sketch.valid = true;
+    return sketch;
+}
+
+double FrameSketch::distance(const FrameSketch& other) const {
+    if (!valid || !other.valid) {
+        return 255.0;
+    }
+    int sum = 0;
+    for (size_t i = 0; i < cells.size(); ++i) {
+        sum += std::abs(cells[i] - other.cells[i]);
+    }
+    return static_cast<double>(sum) / cells.size();
+}
+
+}
@@ -0,0 +1,310 @@
+//
+//  Geometry.cpp
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "rsr/Geometry.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace rsr {
+
+namespace {
+
+constexpr int kRefineRounds = 4;
+
+struct Normalization {
+    double cx = 0.0;
+    double cy = 0.0;
+    double s = 1.0;
+};
+
+// Hartley normalization: centroid at the origin, mean distance sqrt(2).
+Normalization normalization(const Point2f* points, int count) {
+    Normalization n;
+    for (int i = 0; i < count; ++i) {
+        n.cx += points[i].x;
+        n.cy += points[i].y;
+    }
+    n.cx /= count;
+    n.cy /= count;
+    double meanDistance = 0.0;
+    for (int i = 0; i < count; ++i) {
+        meanDistance += std::hypot(points[i].x - n.cx, points[i].y - n.cy);
+    }
+    meanDistance /= count;
+    n.s = meanDistance > 1e-9 ? std::sqrt(2.0) / meanDistance : 1.0;
+    return n;
+}
+
+// Solves the n x n system in place (augmented matrix with n + 1 columns).
+bool solve(double* a, int n, double* x) {
+    const int cols = n + 1;
+    for (int c = 0; c < n; ++c) {
+        int pivot = c;
+        for (int r = c + 1; r < n; ++r) {
+            if (std::fabs(a[r * cols + c]) > std::fabs(a[pivot * cols + c])) {
+                pivot = r;
+            }
+        }
+        if (std::fabs(a[pivot * cols + c]) < 1e-12) {
+            return false;
+        }
+        if (pivot != c) {
+            for (int k = 0; k < cols; ++k) {
+                std::swap(a[c * cols + k], a[pivot * cols + k]);
+            }
+        }
+        for (int r = c + 1; r < n; ++r) {
+            const double f = a[r * cols + c] / a[c * cols + c];
+            for (int k = c; k < cols; ++k) {
+                a[r * cols + k] -= f * a[c * cols + k];
+            }
+        }
+    }
+    for (int r = n - 1; r >= 0; --r) {
+        double sum = a[r * cols + n];
+        for (int k = r + 1; k < n; ++k) {
+            sum -= a[r * cols + k] * x[k];
+        }
+        x[r] = sum / a[r * cols + r];
+    }
+    return true;
+}
+
+double triangleArea(const Point2f& a, const Point2f& b, const Point2f& c) {
+    return 0.5 * std::fabs((b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y));
+}
+
+bool isDegenerateSample(const Point2f* p) {
+    const double minArea = 1.0;
+    return triangleArea(p[0], p[1], p[2]) < minArea || triangleArea(p[0], p[1], p[3]) < minArea ||
+           triangleArea(p[0], p[2], p[3]) < minArea || triangleArea(p[1], p[2], p[3]) < minArea;
+}
+
+int countInliers(const Point2f* src, const Point2f* dst, int n, const Homography& homography, float threshold,
+                 uint8_t* inliers) {
+    const float t2 = threshold * threshold;
+    int count = 0;
+    for (int i = 0; i < n; ++i) {
+        const Point2f p = homography.map(src[i]);
+        const float dx = p.x - dst[i].x;
+        const float dy = p.y - dst[i].y;
+        inliers[i] = dx * dx + dy * dy <= t2;
+        count += inliers[i];
+    }
+    return count;
+}
+
+// Refits the model on its inliers, up to rounds times while that gains inliers,
+// and keeps each refit that explains at least as much.
+void refineOnInliers(const Point2f* src, const Point2f* dst, int n, float threshold, int rounds, Homography& best,
+                     int& bestCount, uint8_t* inliers, uint8_t* mask, ArenaVector<Point2f>& inSrc,
+                     ArenaVector<Point2f>& inDst) {
+    for (int round = 0; round < rounds; ++round) {
+        inSrc.clear();
+        inDst.clear();
+        for (int i = 0; i < n; ++i) {
+            if (inliers[i]) {
+                inSrc.push_back(src[i]);
+                inDst.push_back(dst[i]);
+            }
+        }
+        Homography refined;
+        if (!fitHomography(inSrc.data(), inDst.data(), static_cast<int>(inSrc.size()), refined)) {
+            return;
+        }
+        const int count = countInliers(src, dst, n, refined, threshold, mask);
+        if (count < bestCount) {
+            return;
+        }
+        const bool grew = count > bestCount;
+        bestCount = count;
+        best = refined;
+        std::copy(mask, mask + n, inliers);
+        if (!grew) {
+            return;
+        }
+    }
+}
+
+}
+
+Point2f Homography::map(const Point2f& p) const {
+    const double w = h[6] * p.x + h[7] * p.y + h[8];
+    const double iw = std::fabs(w) > 1e-12 ? 1.0 / w : 0.0;
+    Point2f out;
+    out.x = static_cast<float>((h[0] * p.x + h[1] * p.y + h[2]) * iw);
+    out.y = static_cast<float>((h[3] * p.x + h[4] * p.y + h[5]) * iw);
+    return out;
+}
+
+bool fitHomography(const Point2f* src, const Point2f* dst, int count, Homography& homography) {
+    if (count < 4) {
+        return false;
+    }
+    const Normalization ns = normalization(src, count);
+    const Normalization nd = normalization(dst, count);
+
+    // Normal equations of the 2n x 8 DLT system with h33 = 1.
+    double ata[8 * 9] = {0};
+    for (int i = 0; i < count; ++i) {
+        const double x = (src[i].x - ns.cx) * ns.s;
+        const double y = (src[i].y - ns.cy) * ns.s;
+        const double u = (dst[i].x - nd.cx) * nd.s;
+        const double v = (dst[i].y - nd.cy) * nd.s;
+        const double rows[2][9] = {
+            {x, y, 1, 0, 0, 0, -x * u, -y * u, u},
+            {0, 0, 0, x, y, 1, -x * v, -y * v, v},
+        };
+        for (const auto& r : rows) {
+            for (int a = 0; a < 8; ++a) {
+                if (r[a] == 0.0) {
+                    continue;
+                }
+                for (int b = 0; b < 9; ++b) {
+                    ata[a * 9 + b] += r[a] * r[b];
+                }
+            }
+        }
+    }
+    double hn[9];
+    if (!solve(ata, 8, hn)) {
+        return false;
+    }
+    hn[8] = 1.0;
+
+    // H = Tdst^-1 * Hn * Tsrc
+    const double tsrc[9] = {ns.s, 0, -ns.s * ns.cx, 0, ns.s, -ns.s * ns.cy, 0, 0, 1};
+    const double tdstInv[9] = {1.0 / nd.s, 0, nd.cx, 0, 1.0 / nd.s, nd.cy, 0, 0, 1};
+    double tmp[9];
+    double out[9];
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 3; ++c) {
+            tmp[r * 3 + c] = hn[r * 3] * tsrc[c] + hn[r * 3 + 1] * tsrc[3 + c] + hn[r * 3 + 2] * tsrc[6 + c];
+        }
+    }
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 3; ++c) {
+            out[r * 3 + c] = tdstInv[r * 3] * tmp[c] + tdstInv[r * 3 + 1] * tmp[3 + c] + tdstInv[r * 3 + 2] * tmp[6 + c];
+        }
+    }
+    if (std::fabs(out[8]) < 1e-12) {
+        return false;
+    }
+    for (int i = 0; i < 9; ++i) {
+        homography.h[i] = out[i] / out[8];
+    }
+    return true;
+}
+
+int findHomographyRansac(const std::vector<Point2f>& src, const std::vector<Point2f>& dst,
+                         const RansacOptions& options, Homography& homography, std::vector<uint8_t>& inliers) {
+    const int n = static_cast<int>(std::min(src.size(), dst.size()));
+    inliers.assign(n, 0);
+    return findHomographyRansac(src.data(), dst.data(), n, options, homography, inliers.data());
+}
+
+int findHomographyRansac(const Point2f* src, const Point2f* dst, int n, const RansacOptions& options,
+                         Homography& homography, uint8_t* inliers, Arena* scratch) {
+    std::fill(inliers, inliers + n, 0);
+    if (n < 4) {
+        return 0;
+    }
+
+    uint32_t state = options.seed ? options.seed : 1u;
+    auto next = [&state](int bound) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return static_cast<int>(state % static_cast<uint32_t>(bound));
+    };
+
+    // PROSAC (Chum and Matas): samples come from the pool of the best correspondences,
+    // which grows on a schedule that reaches all n after maxIterations samples. Each
+    // sample includes the newest member of the pool, until the pool is complete.
+    int pool = options.progressive ? 4 : n;
+    double poolSamples = options.maxIterations;
+    for (int i = 0; i < 4; ++i) {
+        poolSamples *= static_cast<double>(4 - i) / (n - i);
+    }
+    int poolGrowsAt = 1;
+
+    int bestCount = 0;
+    int iterations = options.maxIterations;
+    Homography best;
+    ArenaVector<uint8_t> mask(n, 0, ArenaAllocator<uint8_t>(scratch));
+    ArenaVector<Point2f> inSrc{ArenaAllocator<Point2f>(scratch)};
+    ArenaVector<Point2f> inDst{ArenaAllocator<Point2f>(scratch)};
+    Point2f s[4];
+    Point2f d[4];
+    for (int iteration = 1; iteration <= iterations && bestCount < n; ++iteration) {
+        if (options.cancel && options.cancel->load(std::memory_order_relaxed)) {
+            std::fill(inliers, inliers + n, 0);
+            return 0;
+        }
+        if (pool < n && iteration == poolGrowsAt) {
+            ++pool;
+            const double grown = poolSamples * pool / (pool - 4);
+            poolGrowsAt += std::max(1, static_cast<int>(std::ceil(grown - poolSamples)));
+            poolSamples = grown;
+        }
+        const bool withNewest = options.progressive && poolGrowsAt >= iteration;
+        int idx[4];
+        for (int k = 0; k < 4; ++k) {
+            bool unique;
+            do {
+                idx[k] = withNewest ? (k == 0 ? pool - 1 : next(pool - 1)) : next(pool);
+                unique = true;
+                for (int j = 0; j < k; ++j) {
+                    unique &= idx[j] != idx[k];
+                }
+            } while (!unique);
+            s[k] = src[idx[k]];
+            d[k] = dst[idx[k]];
+        }
+        if (isDegenerateSample(s) || isDegenerateSample(d)) {
+            continue;
+        }
+        Homography candidate;
+        if (!fitHomography(s, d, 4, candidate)) {
+            continue;
+        }
+        const int count = countInliers(src, dst, n, candidate, options.threshold, mask.data());
+        if (count > bestCount) {
+            bestCount = count;
+            best = candidate;
+            std::copy(mask.begin(), mask.end(), inliers);
+            if (options.confidence > 0.0f) {
+                // The bound trusts the best model to be as good as its sample allows:
+                // refine it first, or a sample of noisy inliers would stop the search short.
+                refineOnInliers(src, dst, n, options.threshold, kRefineRounds, best, bestCount, inliers, mask.data(),
+                                inSrc, inDst);
+                const double ratio = static_cast<double>(bestCount) / n;
+                const double allInliers = ratio * ratio * ratio * ratio;
+                if (allInliers >= 1.0 - 1e-9) {
+                    break;
+                }
+                const double needed = std::log(1.0 - options.confidence) / std::log(1.0 - allInliers);
+                if (needed < iterations) {
+                    iterations = std::max(iteration, static_cast<int>(std::ceil(needed)));
+                }
+            }
+        }
+    }
+    if (bestCount < 4) {
+        std::fill(inliers, inliers + n, 0);
+        return 0;
+    }
+
+    // Refit on all inliers and keep the refined model if it explains at least as much.
+    refineOnInliers(src, dst, n, options.threshold, options.confidence > 0.0f ? kRefineRounds : 1, best, bestCount,
+                    inliers, mask.data(), inSrc, inDst);
+    homography = best;
+    return bestCount;
+}
+
+}
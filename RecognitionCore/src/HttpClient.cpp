@@ -0,0 +1,248 @@
+//
+//  HttpClient.cpp
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "rsr/HttpClient.h"
+
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+namespace rsr {
+
+namespace {
+
+// Larger header blocks are treated as a broken server rather than buffered.
+constexpr size_t kMaxHeaderSize = 64 * 1024;
+
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+struct ParsedURL {
+    std::string host;
+    std::string port = "80";
+    std::string path = "/";
+};
+
+bool parseURL(const std::string& url, ParsedURL& parsed) {
+    static const char kScheme[] = "http://";
+    if (url.compare(0, sizeof(kScheme) - 1, kScheme) != 0) {
+        return false;
+    }
+    const size_t hostStart = sizeof(kScheme) - 1;
+    const size_t pathStart = url.find('/', hostStart);
+    const std::string authority = url.substr(hostStart, pathStart - hostStart);
+    if (pathStart != std::string::npos) {
+        parsed.path = url.substr(pathStart);
+    }
+    const size_t colon = authority.rfind(':');
+    if (colon != std::string::npos) {
+        parsed.host = authority.substr(0, colon);
+        parsed.port = authority.substr(colon + 1);
+    } else {
+        parsed.host = authority;
+    }
+    return !parsed.host.empty() && !parsed.port.empty();
+}
+
+// Value of a header in the header block, matched case-insensitively; empty if absent.
+std::string headerValue(const std::string& headers, const char* name) {
+    const size_t nameLength = std::strlen(name);
+    size_t lineStart = headers.find("\r\n");
+    while (lineStart != std::string::npos && lineStart < headers.size()) {
+        lineStart += 2;
+        const size_t lineEnd = headers.find("\r\n", lineStart);
+        const std::string line = headers.substr(lineStart, lineEnd - lineStart);
+        if (line.size() > nameLength && line[nameLength] == ':' &&
+            std::equal(name, name + nameLength, line.begin(),
+                       [](char a, char b) {
+                           return std::tolower(static_cast<unsigned char>(a)) ==
+                                  std::tolower(static_cast<unsigned char>(b));
+                       })) {
+            const size_t valueStart = line.find_first_not_of(' ', nameLength + 1);
+            return valueStart == std::string::npos ? std::string() : line.substr(valueStart);
+        }
+        lineStart = lineEnd;
+    }
+    return std::string();
+}
+
+class Socket {
+public:
+    ~Socket() {
+        if (mFd >= 0) {
+            close(mFd);
+        }
+    }
+
+    bool connect(const ParsedURL& url, int timeoutMs) {
+        addrinfo hints;
+        std::memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* addresses = nullptr;
+        if (getaddrinfo(url.host.c_str(), url.port.c_str(), &hints, &addresses) != 0) {
+            return false;
+        }
+        timeval timeout;
+        timeout.tv_sec = timeoutMs / 1000;
+        timeout.tv_usec = (timeoutMs % 1000) * 1000;
+        for (addrinfo* address = addresses; address && mFd < 0; address = address->ai_next) {
+            mFd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+            if (mFd < 0) {
+                continue;
+            }
+            // Also bounds connect() on Linux and the BSDs.
+            setsockopt(mFd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            setsockopt(mFd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+#ifdef SO_NOSIGPIPE
+            const int one = 1;
+            setsockopt(mFd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+            if (::connect(mFd, address->ai_addr, address->ai_addrlen) != 0) {
+                close(mFd);
+                mFd = -1;
+            }
+        }
+        freeaddrinfo(addresses);
+        return mFd >= 0;
+    }
+
+    bool sendAll(const std::string& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            const ssize_t n = send(mFd, data.data() + sent, data.size() - sent, kSendFlags);
+            if (n <= 0) {
+                return false;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    // Reads until the peer closes the connection; fails once the headers or
+    // the body grow past what may be buffered, the Content-Length if given.
+    bool receiveAll(std::string& data, size_t maxBodySize) {
+        char buffer[64 * 1024];
+        size_t limit = kMaxHeaderSize;
+        bool sized = false;
+        for (;;) {
+            const ssize_t n = recv(mFd, buffer, sizeof(buffer), 0);
+            if (n == 0) {
+                return true;
+            }
+            if (n < 0) {
+                return false;
+            }
+            const size_t searchFrom = data.size() < 3 ? 0 : data.size() - 3;
+            data.append(buffer, static_cast<size_t>(n));
+            if (!sized) {
+                const size_t headerEnd = data.find("\r\n\r\n", searchFrom);
+                if (headerEnd != std::string::npos) {
+                    sized = true;
+                    const std::string contentLength = headerValue(data.substr(0, headerEnd), "Content-Length");
+                    const unsigned long long length =
+                        contentLength.empty() ? maxBodySize : std::strtoull(contentLength.c_str(), nullptr, 10);
+                    if (length > maxBodySize) {
+                        return false;
+                    }
+                    const size_t headerSize = headerEnd + 4;
+                    limit = length > SIZE_MAX - headerSize ? SIZE_MAX : headerSize + static_cast<size_t>(length);
+                }
+            }
+            if (data.size() > limit) {
+                return false;
+            }
+        }
+    }
+
+private:
+    int mFd = -1;
+};
+
+}
+
+ErrorCode httpGet(const std::string& url, std::string& body, int timeoutMs, size_t maxBodySize) {
+    body.clear();
+    ParsedURL parsed;
+    Socket socket;
+    if (!parseURL(url, parsed) || !socket.connect(parsed, timeoutMs)) {
+        return ErrorCode::COLLECTION_MANAGER_SYNC_ERROR;
+    }
+    const std::string request = "GET " + parsed.path + " HTTP/1.1\r\nHost: " + parsed.host +
+                                "\r\nAccept-Encoding: identity\r\nConnection: close\r\n\r\n";
+    std::string response;
+    if (!socket.sendAll(request) || !socket.receiveAll(response, maxBodySize)) {
+        return ErrorCode::COLLECTION_MANAGER_SYNC_ERROR;
+    }
+    return parseHttpResponse(response, body);
+}
+
+ErrorCode parseHttpResponse(const std::string& response, std::string& body) {
+    body.clear();
+    const size_t headerEnd = response.find("\r\n\r\n");
+    if (headerEnd == std::string::npos || response.compare(0, 5, "HTTP/") != 0) {
+        return ErrorCode::COLLECTION_MANAGER_SYNC_ERROR;
+    }
+    const std::string headers = response.substr(0, headerEnd);
+    const size_t statusStart = headers.find(' ');
+    if (statusStart == std::string::npos || std::atoi(headers.c_str() + statusStart + 1) != 200 ||
+        !headerValue(headers, "Transfer-Encoding").empty()) {
+        return ErrorCode::COLLECTION_MANAGER_SYNC_ERROR;
+    }
+    body = response.substr(headerEnd + 4);
+    const std::string contentLength = headerValue(headers, "Content-Length");
+    if (!contentLength.empty() && std::strtoull(contentLength.c_str(), nullptr, 10) != body.size()) {
+        // Connection dropped mid-body.
+        body.clear();
+        return ErrorCode::COLLECTION_MANAGER_SYNC_ERROR;
+    }
+    return ErrorCode::SUCCESS;
+}
+
+std::string urlEncode(const std::string& text) {
+    static const char kHex[] = "0123456789ABCDEF";
+    std::string encoded;
+    encoded.reserve(text.size());
+    for (const char c : text) {
+        const unsigned char byte = static_cast<unsigned char>(c);
+        if (std::isalnum(byte) || c == '-' || c == '_' || c == '.' || c == '~') {
+            encoded += c;
+        } else {
+            encoded += '%';
+            encoded += kHex[byte >> 4];
+            encoded += kHex[byte & 15];
+        }
+    }
+    return encoded;
+}
+
+std::string urlDecode(const std::string& text) {
+    std::string decoded;
+    decoded.reserve(text.size());
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '%' && i + 2 < text.size() && std::isxdigit(static_cast<unsigned char>(text[i + 1])) &&
+            std::isxdigit(static_cast<unsigned char>(text[i + 2]))) {
+            decoded += static_cast<char>(std::strtol(text.substr(i + 1, 2).c_str(), nullptr, 16));
+            i += 2;
+        } else {
+            decoded += text[i];
+        }
+    }
+    return decoded;
+}
+
+}
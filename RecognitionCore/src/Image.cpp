@@ -0,0 +1,109 @@
+//
+//  Image.cpp
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "rsr/Image.h"
+
+#include <algorithm>
+
+#include "rsr/Preprocess.h"
+
+namespace rsr {
+
+GrayImage convertBGRAToGray(const uint8_t* bgraBytes, int width, int height, int bytesPerRow) {
+    GrayImage gray;
+    reduceBGRAToGray(VideoFrame{bgraBytes, width, height, bytesPerRow}, 1, gray);
+    return gray;
+}
+
+GrayImage resizeBilinear(const GrayView& src, int width, int height) {
+    GrayImage dst(width, height);
+    if (src.empty() || width <= 0 || height <= 0) {
+        return dst;
+    }
+    std::vector<int32_t> columns(3 * static_cast<size_t>(width));
+    resizeBilinear(src, width, height, dst.pixels.data(), columns.data());
+    return dst;
+}
+
+void resizeBilinear(const GrayView& src, int width, int height, uint8_t* dst, int32_t* columns) {
+    if (src.empty() || width <= 0 || height <= 0) {
+        return;
+    }
+    const float sx = static_cast<float>(src.width) / width;
+    const float sy = static_cast<float>(src.height) / height;
+    // Source columns and weights only depend on x: work them out once, not once per row.
+    int32_t* left = columns;
+    int32_t* right = columns + width;
+    int32_t* weights = columns + 2 * width;
+    for (int x = 0; x < width; ++x) {
+        float fx = (x + 0.5f) * sx - 0.5f;
+        fx = std::max(0.0f, std::min(fx, static_cast<float>(src.width - 1)));
+        left[x] = static_cast<int32_t>(fx);
+        right[x] = std::min(left[x] + 1, src.width - 1);
+        weights[x] = static_cast<int32_t>((fx - left[x]) * 256.0f);
+    }
+    for (int y = 0; y < height; ++y) {
+        float fy = (y + 0.5f) * sy - 0.5f;
+        fy = std::max(0.0f, std::min(fy, static_cast<float>(src.height - 1)));
+        const int y0 = static_cast<int>(fy);
+        const int y1 = std::min(y0 + 1, src.height - 1);
+        const int wy = static_cast<int>((fy - y0) * 256.0f);
+        const uint8_t* r0 = src.row(y0);
+        const uint8_t* r1 = src.row(y1);
+        uint8_t* out = dst + static_cast<size_t>(y) * width;
+        for (int x = 0; x < width; ++x) {
+            const int wx = weights[x];
+            const int top = r0[left[x]] * (256 - wx) + r0[right[x]] * wx;
+            const int bottom = r1[left[x]] * (256 - wx) + r1[right[x]] * wx;
+            out[x] = static_cast<uint8_t>((top * (256 - wy) + bottom * wy + (1 << 15)) >> 16);
+        }
+    }
+}
+
+GrayImage downscaleBox(const GrayView& src, int factor) {
+    if (factor <= 1) {
+        GrayImage copy(src.width, src.height);
+        std::copy(src.pixels, src.pixels + copy.pixels.size(), copy.pixels.begin());
+        return copy;
+    }
+    GrayImage dst(src.width / factor, src.height / factor);
+    downscaleBox(src, factor, dst.pixels.data());
+    return dst;
+}
+
+void downscaleBox(const GrayView& src, int factor, uint8_t* dst) {
+    const int width = src.width / factor;
+    const int height = src.height / factor;
+    if (factor == 2) {
+        // The common octave step, kept simple enough for the compiler to vectorize.
+        for (int y = 0; y < height; ++y) {
+            const uint8_t* in0 = src.row(2 * y);
+            const uint8_t* in1 = src.row(2 * y + 1);
+            uint8_t* out = dst + static_cast<size_t>(y) * width;
+            for (int x = 0; x < width; ++x) {
+                out[x] = static_cast<uint8_t>((in0[2 * x] + in0[2 * x + 1] + in1[2 * x] + in1[2 * x + 1] + 2) >> 2);
+            }
+        }
+        return;
+    }
+    const int area = factor * factor;
+    for (int y = 0; y < height; ++y) {
+        uint8_t* out = dst + static_cast<size_t>(y) * width;
+        for (int x = 0; x < width; ++x) {
+            int sum = 0;
+            for (int dy = 0; dy < factor; ++dy) {
+                const uint8_t* in = src.row(y * factor + dy) + x * factor;
+                for (int dx = 0; dx < factor; ++dx) {
+                    sum += in[dx];
+                }
+            }
+            out[x] = static_cast<uint8_t>((sum + area / 2) / area);
+        }
+    }
+}
+
+}
@@ -0,0 +1,105 @@
+//
+//  ImagePyramid.cpp
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "rsr/ImagePyramid.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "rsr/Preprocess.h"
+
+namespace rsr {
+
+void ImagePyramid::build(const VideoFrame& frame, int factor, const PyramidOptions& options) {
+    mOptions = options;
+    factor = std::max(1, factor);
+    reduceBGRAToGray(frame, factor, mReducedStorage);
+    mReduced = mReducedStorage;
+    layout(factor);
+}
+
+void ImagePyramid::build(const GrayView& image, int inputScale, const PyramidOptions& options) {
+    mOptions = options;
+    mReduced = image;
+    layout(std::max(1, inputScale));
+}
+
+void ImagePyramid::layout(int inputScale) {
+    mArena.reset();
+    mLevels.clear();
+    mBaseFactor = 0;
+    mInputWidth = mReduced.width * inputScale;
+    mInputHeight = mReduced.height * inputScale;
+    if (mReduced.empty()) {
+        return;
+    }
+
+    // Level 0: the reduced image, brought down to the working resolution if larger.
+    Level base;
+    const int longest = std::max(mReduced.width, mReduced.height);
+    if (longest > mOptions.maxDimension) {
+        const float ratio = static_cast<float>(longest) / mOptions.maxDimension;
+        const int factor = static_cast<int>(ratio);
+        mBaseFactor = ratio == static_cast<float>(factor) ? factor : 0;
+        if (mBaseFactor) {
+            base.width = mReduced.width / factor;
+            base.height = mReduced.height / factor;
+        } else {
+            base.width = static_cast<int>(mReduced.width / ratio);
+            base.height = static_cast<int>(mReduced.height / ratio);
+        }
+    } else {
+        base.width = mReduced.width;
+        base.height = mReduced.height;
+        base.pixels = mReduced.pixels;
+    }
+    mLevels.push_back(base);
+
+    for (int index = 1;; ++index) {
+        const float s = std::pow(mOptions.scale, static_cast<float>(index));
+        Level level;
+        level.width = static_cast<int>(std::lround(base.width / s));
+        level.height = static_cast<int>(std::lround(base.height / s));
+        if (level.width < 1 || level.height < 1 || mOptions.scale <= 1.0f) {
+            break;
+        }
+        mLevels.push_back(level);
+    }
+}
+
+void ImagePyramid::buildLevel(int index) const {
+    Level& level = mLevels[index];
+    uint8_t* pixels = mArena.allocateArray<uint8_t>(static_cast<size_t>(level.width) * level.height);
+    const GrayView source = index == 0 ? mReduced : this->level(0);
+    if (index == 0 && mBaseFactor) {
+        downscaleBox(source, mBaseFactor, pixels);
+    } else {
+        int32_t* columns = mArena.allocateArray<int32_t>(3 * static_cast<size_t>(level.width));
+        resizeBilinear(source, level.width, level.height, pixels, columns);
+    }
+    level.pixels = pixels;
+}
+
+GrayView ImagePyramid::level(int index) const {
+    if (index < 0 || index >= levelCount()) {
+        return GrayView();
+    }
+    if (!mLevels[index].pixels) {
+        buildLevel(index);
+    }
+    const Level& level = mLevels[index];
+    return GrayView(level.pixels, level.width, level.height);
+}
+
+float ImagePyramid::inputScale(int index) const {
+    if (index < 0 || index >= levelCount()) {
+        return 0.0f;
+    }
+    return static_cast<float>(mInputWidth) / mLevels[index].width;
+}
+
+}
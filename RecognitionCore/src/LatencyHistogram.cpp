@@ -0,0 +1,83 @@
+//
+//  LatencyHistogram.cpp
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "rsr/LatencyHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace rsr {
+
+int LatencyHistogram::bucketOf(uint64_t us) {
+    if (us < static_cast<uint64_t>(kSubBuckets)) {
+        return static_cast<int>(us);
+    }
+    const int msb = 63 - __builtin_clzll(us);
+    if (msb >= kOctaves) {
+        return kBuckets - 1;
+    }
+    const int shift = msb - kSubBits;
+    return kSubBuckets * (shift + 1) + static_cast<int>(us >> shift) - kSubBuckets;
+}
+
+uint64_t LatencyHistogram::highestIn(int bucket) {
+    if (bucket < kSubBuckets) {
+        return static_cast<uint64_t>(bucket);
+    }
+    const int shift = bucket / kSubBuckets - 1;
+    const uint64_t lowest = static_cast<uint64_t>(bucket % kSubBuckets + kSubBuckets) << shift;
+    return lowest + (uint64_t(1) << shift) - 1;
+}
+
+void LatencyHistogram::record(double ms) {
+    const uint64_t us = ms > 0.0 ? static_cast<uint64_t>(std::llround(ms * 1000.0)) : 0;
+    mBuckets[bucketOf(us)].fetch_add(1, std::memory_order_relaxed);
+    mCount.fetch_add(1, std::memory_order_relaxed);
+    mSumUs.fetch_add(us, std::memory_order_relaxed);
+    uint64_t max = mMaxUs.load(std::memory_order_relaxed);
+    while (us > max && !mMaxUs.compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+    }
+}
+
+double LatencyHistogram::mean() const {
+    const uint64_t n = count();
+    return n == 0 ? 0.0 : mSumUs.load(std::memory_order_relaxed) / 1000.0 / n;
+}
+
+double LatencyHistogram::percentile(double p) const {
+    uint64_t total = 0;
+    for (const std::atomic<uint64_t>& bucket : mBuckets) {
+        total += bucket.load(std::memory_order_relaxed);
+    }
+    if (total == 0) {
+        return 0.0;
+    }
+    const double clamped = p < 0.0 ? 0.0 : (p > 100.0 ? 100.0 : p);
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(clamped / 100.0 * total)));
+    uint64_t seen = 0;
+    for (int b = 0; b < kBuckets; ++b) {
+        seen += mBuckets[b].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            // The bucket's top can exceed the largest value actually recorded.
+            const uint64_t us = highestIn(b);
+            const uint64_t max = mMaxUs.load(std::memory_order_relaxed);
+            return (us < max ? us : max) / 1000.0;
+        }
+    }
+    return max();
+}
+
+void LatencyHistogram::reset() {
+    for (std::atomic<uint64_t>& bucket : mBuckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    mCount.store(0, std::memory_order_relaxed);
+    mSumUs.store(0, std::memory_order_relaxed);
+    mMaxUs.store(0, std::memory_order_relaxed);
+}
+
+}
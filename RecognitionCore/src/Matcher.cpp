@@ -0,0 +1,334 @@
+//
+//  Matcher.cpp
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "rsr/Matcher.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#include "rsr/Geometry.h"
+
+namespace rsr {
+
+namespace {
+
+struct Match {
+    int query;
+    int reference;
+    int distance;
+};
+
+// The projected reference outline must be a convex, non-mirrored quad.
+bool isPlausibleBox(const Point2f (&quad)[4]) {
+    float sign = 0.0f;
+    for (int i = 0; i < 4; ++i) {
+        const Point2f& a = quad[i];
+        const Point2f& b = quad[(i + 1) % 4];
+        const Point2f& c = quad[(i + 2) % 4];
+        const float cross = (b.x - a.x) * (c.y - b.y) - (b.y - a.y) * (c.x - b.x);
+        if (cross == 0.0f || (sign != 0.0f && (cross > 0.0f) != (sign > 0.0f))) {
+            return false;
+        }
+        sign = cross;
+    }
+    // Clockwise in image coordinates (y down) means the image was not mirrored.
+    return sign > 0.0f;
+}
+
+// Votes the ratio-tested matches of one query per reference image and keeps
+// the correspondences of the best voted images.
+void collectCandidates(const MatcherOptions& options, const FeatureSet& query, const Collection& collection,
+                       const NearestNeighbours* neighbours, MatchCandidates& candidates, Arena* scratch) {
+    candidates.clear();
+    const std::vector<ReferenceImage>& images = collection.images();
+    auto accepted = [&options](const NearestNeighbours& n) {
+        return n.image >= 0 && n.best <= options.maxDistance && n.best < options.ratio * n.second;
+    };
+
+    // Matches grouped by image in one array, in query order within an image:
+    // those of image i are matches[first[i]] to matches[first[i + 1]].
+    ArenaVector<int> first(images.size() + 1, 0, ArenaAllocator<int>(scratch));
+    for (size_t q = 0; q < query.descriptors.size(); ++q) {
+        if (accepted(neighbours[q])) {
+            ++first[neighbours[q].image + 1];
+        }
+    }
+    for (size_t i = 0; i < images.size(); ++i) {
+        first[i + 1] += first[i];
+    }
+    ArenaVector<Match> matches(first.back(), Match(), ArenaAllocator<Match>(scratch));
+    ArenaVector<int> fill(first.begin(), first.end() - 1, ArenaAllocator<int>(scratch));
+    for (size_t q = 0; q < query.descriptors.size(); ++q) {
+        const NearestNeighbours& n = neighbours[q];
+        if (accepted(n)) {
+            matches[fill[n.image]++] = {static_cast<int>(q), n.reference, n.best};
+        }
+    }
+    auto matchCount = [&first](int i) { return first[i + 1] - first[i]; };
+    auto closer = [](const Match& a, const Match& b) { return a.distance < b.distance; };
+
+    ArenaVector<int> voted{ArenaAllocator<int>(scratch)};
+    for (size_t i = 0; i < images.size(); ++i) {
+        if (matchCount(static_cast<int>(i)) >= options.minMatches) {
+            voted.push_back(static_cast<int>(i));
+        }
+    }
+    std::sort(voted.begin(), voted.end(), [&matchCount](int a, int b) { return matchCount(a) > matchCount(b); });
+    if (static_cast<int>(voted.size()) > options.maxCandidates) {
+        voted.resize(options.maxCandidates);
+    }
+
+    size_t total = 0;
+    for (int imageIndex : voted) {
+        total += matchCount(imageIndex);
+    }
+    candidates.images.reserve(voted.size());
+    candidates.referencePoints.reserve(total);
+    candidates.queryPoints.reserve(total);
+    for (int imageIndex : voted) {
+        const ReferenceImage& image = images[imageIndex];
+        MatchCandidates::Candidate candidate;
+        candidate.image = imageIndex;
+        candidate.first = candidates.referencePoints.size();
+        candidate.count = matchCount(imageIndex);
+        if (options.progressiveSampling) {
+            std::stable_sort(matches.begin() + first[imageIndex], matches.begin() + first[imageIndex + 1], closer);
+        }
+        for (int k = 0; k < candidate.count; ++k) {
+            const Match& m = matches[first[imageIndex] + k];
+            candidates.referencePoints.push_back({image.keypoints[m.reference].x, image.keypoints[m.reference].y});
+            candidates.queryPoints.push_back({query.keypoints[m.query].x, query.keypoints[m.query].y});
+        }
+        candidates.images.push_back(candidate);
+    }
+}
+
+struct Verified {
+    int inliers = 0;  ///< 0 if the candidate was rejected, or not verified.
+    Point2f quad[4];  ///< Reference outline in the query.
+};
+
+// Fits a homography to the correspondences of one candidate and checks the reference outline it projects.
+void verifyCandidate(const MatcherOptions& options, const RansacOptions& ransac, const ReferenceImage& image,
+                     const MatchCandidates& candidates, const MatchCandidates::Candidate& candidate,
+                     Verified& verified, Arena* scratch) {
+    ArenaVector<uint8_t> inliers(candidate.count, 0, ArenaAllocator<uint8_t>(scratch));
+    Homography homography;
+    const int inlierCount =
+        findHomographyRansac(candidates.referencePoints.data() + candidate.first,
+                             candidates.queryPoints.data() + candidate.first, candidate.count, ransac, homography,
+                             inliers.data(), scratch);
+    if (inlierCount < options.minInliers) {
+        return;
+    }
+
+    const float w = static_cast<float>(image.width);
+    const float h = static_cast<float>(image.height);
+    const Point2f quad[4] = {
+        homography.map({0.0f, 0.0f}), homography.map({w, 0.0f}),
+        homography.map({w, h}), homography.map({0.0f, h}),
+    };
+    if (!isPlausibleBox(quad)) {
+        return;
+    }
+    verified.inliers = inlierCount;
+    std::copy(quad, quad + 4, verified.quad);
+}
+
+// Verifies the candidates with a homography each, best score first.
+void verifyCandidates(const MatcherOptions& options, const FeatureSet& query, const Collection& collection,
+                      const MatchCandidates& candidates, std::vector<SearchResult>& results, Arena* scratch,
+                      SearchScheduler* scheduler, SearchPriority priority) {
+    results.clear();
+    const std::vector<ReferenceImage>& images = collection.images();
+    const size_t count = candidates.images.size();
+
+    RansacOptions ransac;
+    ransac.threshold = options.reprojectionThreshold * query.processingScale;
+    ransac.maxIterations = options.ransacIterations;
+    ransac.confidence = options.ransacConfidence;
+    ransac.progressive = options.progressiveSampling;
+
+    // A confident candidate makes those after it in vote order moot: they are
+    // skipped, or cancelled if already being verified. Only the first confident
+    // one counts, so the outcome does not depend on which finishes first.
+    ArenaVector<Verified> verified(count, Verified(), ArenaAllocator<Verified>(scratch));
+    ArenaVector<std::atomic<bool>> cancelled(count, ArenaAllocator<std::atomic<bool>>(scratch));
+    std::atomic<size_t> firstConfident{count};
+    auto verifyOne = [&](size_t k, Arena* arena) {
+        if (k > firstConfident.load(std::memory_order_acquire)) {
+            return;
+        }
+        const MatchCandidates::Candidate& candidate = candidates.images[k];
+        RansacOptions own = ransac;
+        own.cancel = &cancelled[k];
+        verifyCandidate(options, own, images[candidate.image], candidates, candidate, verified[k], arena);
+        if (options.confidentInliers > 0 && verified[k].inliers >= options.confidentInliers) {
+            size_t current = firstConfident.load();
+            while (k < current && !firstConfident.compare_exchange_weak(current, k)) {
+            }
+            for (size_t later = k + 1; later < count; ++later) {
+                cancelled[later].store(true, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    int parts = 1;
+    if (scheduler && count > 1) {
+        parts = options.verifyThreads > 0 ? options.verifyThreads : scheduler->workerCount();
+        parts = std::max(1, std::min(parts, static_cast<int>(count)));
+    }
+    if (parts > 1) {
+        // Parts pull the candidate with most votes not taken yet. Those on
+        // workers allocate from an arena of their thread, rewound after each
+        // part: parts do not nest, and it keeps its chunks for the next search.
+        std::atomic<size_t> next{0};
+        auto verifyPart = [&](int part) {
+            thread_local Arena partScratch(64 * 1024);
+            Arena* arena = part == 0 || !scratch ? scratch : &partScratch;
+            for (size_t k = next++; k < count; k = next++) {
+                verifyOne(k, arena);
+            }
+            if (arena != scratch) {
+                arena->reset();
+            }
+        };
+        // Passed by a single reference, which std::function stores without allocating.
+        scheduler->run(parts, priority, [&verifyPart](int part) { verifyPart(part); });
+    } else {
+        for (size_t k = 0; k < count; ++k) {
+            verifyOne(k, scratch);
+        }
+    }
+
+    const size_t last = std::min(count, firstConfident.load() + 1);
+    for (size_t k = 0; k < last; ++k) {
+        if (verified[k].inliers == 0) {
+            continue;
+        }
+        const ReferenceImage& image = images[candidates.images[k].image];
+        const Point2f* quad = verified[k].quad;
+        SearchResult result;
+        result.item = collection.items()[image.itemIndex];
+        result.matchedImageUUID = image.uuid;
+        const size_t smaller = std::min(query.descriptors.size(), image.descriptors.size());
+        result.score = std::min(1.0f, static_cast<float>(verified[k].inliers) / static_cast<float>(smaller));
+        result.matchBoundingBox.topLeftX = quad[0].x;
+        result.matchBoundingBox.topLeftY = quad[0].y;
+        result.matchBoundingBox.topRightX = quad[1].x;
+        result.matchBoundingBox.topRightY = quad[1].y;
+        result.matchBoundingBox.bottomRightX = quad[2].x;
+        result.matchBoundingBox.bottomRightY = quad[2].y;
+        result.matchBoundingBox.bottomLeftX = quad[3].x;
+        result.matchBoundingBox.bottomLeftY = quad[3].y;
+
+        // Several reference images of one item: report the item once, with its best image.
+        auto sameItem = std::find_if(results.begin(), results.end(), [&result](const SearchResult& r) {
+            return r.item.uuid == result.item.uuid;
+        });
+        if (sameItem == results.end()) {
+            results.push_back(std::move(result));
+        } else if (sameItem->score < result.score) {
+            *sameItem = std::move(result);
+        }
+    }
+
+    std::sort(results.begin(), results.end(),
+              [](const SearchResult& a, const SearchResult& b) { return a.score > b.score; });
+}
+
+// Looks up the descriptors of all queries with one index search. The
+// neighbours of query i start at neighbours[firstDescriptor[i]].
+// @return false if there was nothing to look up.
+bool lookUp(const FeatureSet* const* queries, size_t count, const Collection& collection,
+            const DescriptorIndex* index, ArenaVector<NearestNeighbours>& neighbours,
+            ArenaVector<size_t>& firstDescriptor, Arena* scratch) {
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        total += queries[i]->descriptors.size();
+    }
+    if (collection.images().empty() || total == 0) {
+        return false;
+    }
+    ArenaVector<const Descriptor*> descriptors{ArenaAllocator<const Descriptor*>(scratch)};
+    descriptors.reserve(total);
+    firstDescriptor.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        firstDescriptor.push_back(descriptors.size());
+        for (const Descriptor& d : queries[i]->descriptors) {
+            descriptors.push_back(&d);
+        }
+    }
+
+    std::unique_ptr<DescriptorIndex> exact;
+    if (index == nullptr) {
+        exact = DescriptorIndex::create(collection, IndexOptions());
+        index = exact.get();
+    }
+    neighbours.resize(total);
+    index->search(descriptors.data(), total, neighbours.data(), scratch);
+    return true;
+}
+
+}
+
+void MatchCandidates::clear() {
+    images.clear();
+    referencePoints.clear();
+    queryPoints.clear();
+}
+
+Matcher::Matcher(const MatcherOptions& options) : mOptions(options) {}
+
+void Matcher::match(const FeatureSet& query, const Collection& collection, std::vector<SearchResult>& results,
+                    const DescriptorIndex* index, Arena* scratch) const {
+    MatchCandidates candidates(scratch);
+    findCandidates(query, collection, candidates, index, scratch);
+    verify(query, collection, candidates, results, scratch);
+}
+
+void Matcher::findCandidates(const FeatureSet& query, const Collection& collection, MatchCandidates& candidates,
+                             const DescriptorIndex* index, Arena* scratch) const {
+    const FeatureSet* queries[1] = {&query};
+    ArenaVector<NearestNeighbours> neighbours{ArenaAllocator<NearestNeighbours>(scratch)};
+    ArenaVector<size_t> firstDescriptor{ArenaAllocator<size_t>(scratch)};
+    if (!lookUp(queries, 1, collection, index, neighbours, firstDescriptor, scratch)) {
+        candidates.clear();
+        return;
+    }
+    collectCandidates(mOptions, query, collection, neighbours.data(), candidates, scratch);
+}
+
+void Matcher::verify(const FeatureSet& query, const Collection& collection, const MatchCandidates& candidates,
+                     std::vector<SearchResult>& results, Arena* scratch, SearchScheduler* scheduler,
+                     SearchPriority priority) const {
+    verifyCandidates(mOptions, query, collection, candidates, results, scratch, scheduler, priority);
+}
+
+void Matcher::matchBatch(const std::vector<const FeatureSet*>& queries, const Collection& collection,
+                         std::vector<std::vector<SearchResult>>& results, const DescriptorIndex* index,
+                         Arena* scratch) const {
+    results.resize(queries.size());
+    for (std::vector<SearchResult>& r : results) {
+        r.clear();
+    }
+    ArenaVector<NearestNeighbours> neighbours{ArenaAllocator<NearestNeighbours>(scratch)};
+    ArenaVector<size_t> firstDescriptor{ArenaAllocator<size_t>(scratch)};
+    if (!lookUp(queries.data(), queries.size(), collection, index, neighbours, firstDescriptor, scratch)) {
+        return;
+    }
+    MatchCandidates candidates(scratch);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        collectCandidates(mOptions, *queries[i], collection, neighbours.data() + firstDescriptor[i], candidates,
+                          scratch);
+        verifyCandidates(mOptions, *queries[i], collection, candidates, results[i], scratch, nullptr,
+                         SearchPriority::API);
+    }
+}
+
+}
@@ -0,0 +1,498 @@
+//
+//  OnDeviceIR.cpp
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "rsr/OnDeviceIR.h"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+namespace rsr {
+
+namespace {
+
+// Keeps getCurrentSearchCount() accurate on every return path.
+class SearchCountScope {
+public:
+    explicit SearchCountScope(std::atomic<int>& count, int searches = 1) : mCount(count), mSearches(searches) {
+        mCount += mSearches;
+    }
+    ~SearchCountScope() { mCount -= mSearches; }
+
+private:
+    std::atomic<int>& mCount;
+    int mSearches;
+};
+
+double elapsedMs(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+// Snaps a rectangle outwards to the reduction blocks, clamped to the frame,
+// so a region sees the same reduced pixels as a whole-frame search does there.
+FrameRect alignToBlocks(const FrameRect& rect, int factor, int width, int height) {
+    const int x0 = std::max(0, rect.x) / factor * factor;
+    const int y0 = std::max(0, rect.y) / factor * factor;
+    const int x1 = std::min(width, (rect.x + rect.width + factor - 1) / factor * factor);
+    const int y1 = std::min(height, (rect.y + rect.height + factor - 1) / factor * factor);
+    FrameRect aligned;
+    aligned.x = x0;
+    aligned.y = y0;
+    aligned.width = x1 - x0;
+    aligned.height = y1 - y0;
+    return aligned;
+}
+
+}
+
+// Everything a search needs only while it runs, kept per thread so that
+// searches reuse its storage instead of allocating per frame.
+struct OnDeviceIR::SearchScratch {
+    ImagePyramid pyramid;
+    Arena arena{1024 * 1024};
+    FeatureSet features;  ///< Query features of a single search.
+    FeatureSet part;      ///< Features of one region, before they join the query.
+    int depth = 0;        ///< Open ScratchScopes; the arena is rewound when the last one closes.
+};
+
+// Lends the thread's scratch to a search, then reports and rewinds its arena.
+class OnDeviceIR::ScratchScope {
+public:
+    explicit ScratchScope(const OnDeviceIR& owner) : mOwner(owner), mScratch(threadScratch()) { ++mScratch.depth; }
+
+    ~ScratchScope() {
+        if (--mScratch.depth > 0) {
+            return;
+        }
+        if (mOwner.mReportScratch.load(std::memory_order_relaxed)) {
+            std::shared_ptr<const ScratchObserver> observer;
+            {
+                std::lock_guard<std::mutex> lock(mOwner.mMutex);
+                observer = mOwner.mScratchObserver;
+            }
+            if (observer) {
+                ScratchUsage usage;
+                usage.peakBytes = mScratch.arena.used();
+                usage.arenaBytes = mScratch.arena.capacity();
+                usage.pyramidBytes = mScratch.pyramid.bytes();
+                usage.systemAllocations = mScratch.arena.systemAllocations();
+                (*observer)(usage);
+            }
+        }
+        mScratch.arena.reset();
+    }
+
+    SearchScratch& operator*() const { return mScratch; }
+    SearchScratch* operator->() const { return &mScratch; }
+
+private:
+    static SearchScratch& threadScratch() {
+        thread_local SearchScratch scratch;
+        return scratch;
+    }
+
+    const OnDeviceIR& mOwner;
+    SearchScratch& mScratch;
+};
+
+SearchPrior SearchPrior::roadSigns() {
+    SearchPrior prior;
+    SearchPrior::Region region;
+    region.left = 0.4f;
+    region.bottom = 0.7f;
+    prior.regions.push_back(region);
+    return prior;
+}
+
+std::vector<FrameRect> SearchPrior::rectsFor(int width, int height) const {
+    std::vector<FrameRect> rects;
+    for (const Region& region : regions) {
+        FrameRect rect;
+        rect.x = static_cast<int>(region.left * width);
+        rect.y = static_cast<int>(region.top * height);
+        rect.width = static_cast<int>(region.right * width + 0.5f) - rect.x;
+        rect.height = static_cast<int>(region.bottom * height + 0.5f) - rect.y;
+        rects.push_back(rect);
+    }
+    return rects;
+}
+
+OnDeviceIR::OnDeviceIR(const ExtractorOptions& extractorOptions, const MatcherOptions& matcherOptions,
+                       const SchedulerOptions& schedulerOptions)
+    : mExtractor(extractorOptions), mMatcher(matcherOptions), mScheduler(schedulerOptions) {}
+
+void OnDeviceIR::setCollection(std::shared_ptr<const Collection> collection, bool setActive,
+                               const IndexOptions& indexOptions) {
+    if (!collection) {
+        return;
+    }
+    // Built outside the lock: indexing a large collection must not stall searches.
+    LoadedCollection loaded;
+    loaded.index = DescriptorIndex::create(*collection, indexOptions);
+    loaded.indexOptions = indexOptions;
+    loaded.collection = std::move(collection);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (setActive) {
+        mActiveCollection = loaded;
+    }
+    mCollections[loaded.collection->uuid()] = std::move(loaded);
+}
+
+ErrorCode OnDeviceIR::updateCollection(std::shared_ptr<const Collection> collection) {
+    if (!collection) {
+        return ErrorCode::ON_DEVICE_IR_COLLECTION_NOT_FOUND;
+    }
+    IndexOptions indexOptions;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mCollections.find(collection->uuid());
+        if (it == mCollections.end()) {
+            return ErrorCode::ON_DEVICE_IR_COLLECTION_NOT_FOUND;
+        }
+        indexOptions = it->second.indexOptions;
+    }
+    // Indexed while the previous version keeps serving searches.
+    LoadedCollection loaded;
+    loaded.index = DescriptorIndex::create(*collection, indexOptions);
+    loaded.indexOptions = indexOptions;
+    loaded.collection = std::move(collection);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mCollections.find(loaded.collection->uuid());
+    if (it == mCollections.end()) {
+        return ErrorCode::ON_DEVICE_IR_COLLECTION_NOT_FOUND;
+    }
+    if (mActiveCollection.collection == it->second.collection) {
+        mActiveCollection = loaded;
+    }
+    it->second = std::move(loaded);
+    return ErrorCode::SUCCESS;
+}
+
+ErrorCode OnDeviceIR::setActiveCollection(const std::string& collectionUUID) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mCollections.find(collectionUUID);
+    if (it == mCollections.end()) {
+        return ErrorCode::ON_DEVICE_IR_COLLECTION_NOT_FOUND;
+    }
+    mActiveCollection = it->second;
+    return ErrorCode::SUCCESS;
+}
+
+void OnDeviceIR::unloadCollection(const std::string& collectionUUID) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mActiveCollection.collection && mActiveCollection.collection->uuid() == collectionUUID) {
+        mActiveCollection = LoadedCollection();
+    }
+    mCollections.erase(collectionUUID);
+}
+
+std::shared_ptr<const Collection> OnDeviceIR::activeCollection() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mActiveCollection.collection;
+}
+
+std::shared_ptr<const Collection> OnDeviceIR::getCollection(const std::string& collectionUUID) const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mCollections.find(collectionUUID);
+    return it == mCollections.end() ? nullptr : it->second.collection;
+}
+
+OnDeviceIR::LoadedCollection OnDeviceIR::activeLoadedCollection() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mActiveCollection;
+}
+
+ErrorCode OnDeviceIR::searchWithImage(const QueryImage& image, std::vector<SearchResult>& results) {
+    return searchWithVideoFrame(image.view(), results);
+}
+
+ErrorCode OnDeviceIR::searchWithVideoFrame(const VideoFrame& frame, std::vector<SearchResult>& results) {
+    SearchCountScope scope(mSearchCount);
+    return searchFrame(frame, results);
+}
+
+ErrorCode OnDeviceIR::searchFrame(const VideoFrame& frame, std::vector<SearchResult>& results) {
+    results.clear();
+
+    const LoadedCollection active = activeLoadedCollection();
+    if (!active.collection) {
+        mStats.countOutcome(ErrorCode::ON_DEVICE_IR_NO_ACTIVE_COLLECTION);
+        return ErrorCode::ON_DEVICE_IR_NO_ACTIVE_COLLECTION;
+    }
+
+    StageTimer timer(&mStats);
+    ScratchScope scratch(*this);
+    const ErrorCode error = extractFrame(frame, *scratch, scratch->features, timer);
+    if (error == ErrorCode::SUCCESS) {
+        matchFeatures(scratch->features, active, results, *scratch, timer);
+    }
+    mStats.countOutcome(error);
+    return error;
+}
+
+ErrorCode OnDeviceIR::searchWithVideoFrame(const VideoFrame& frame, const std::vector<FrameRect>& regions,
+                                           std::vector<SearchResult>& results) {
+    SearchCountScope scope(mSearchCount);
+    results.clear();
+
+    const LoadedCollection active = activeLoadedCollection();
+    if (!active.collection) {
+        mStats.countOutcome(ErrorCode::ON_DEVICE_IR_NO_ACTIVE_COLLECTION);
+        return ErrorCode::ON_DEVICE_IR_NO_ACTIVE_COLLECTION;
+    }
+
+    StageTimer timer(&mStats);
+    ScratchScope scratch(*this);
+    const ErrorCode error = extractRegions(frame, regions, *scratch, scratch->features, timer);
+    if (error == ErrorCode::SUCCESS) {
+        matchFeatures(scratch->features, active, results, *scratch, timer);
+    }
+    mStats.countOutcome(error);
+    return error;
+}
+
+ErrorCode OnDeviceIR::searchWithPyramid(const ImagePyramid& pyramid, std::vector<SearchResult>& results) {
+    SearchCountScope scope(mSearchCount);
+    results.clear();
+
+    const LoadedCollection active = activeLoadedCollection();
+    if (!active.collection) {
+        mStats.countOutcome(ErrorCode::ON_DEVICE_IR_NO_ACTIVE_COLLECTION);
+        return ErrorCode::ON_DEVICE_IR_NO_ACTIVE_COLLECTION;
+    }
+
+    StageTimer timer(&mStats);
+    ScratchScope scratch(*this);
+    const ErrorCode error = mExtractor.extract(pyramid, scratch->features, &scratch->arena);
+    timer.lap(SearchStage::EXTRACT);
+    if (error == ErrorCode::SUCCESS) {
+        matchFeatures(scratch->features, active, results, *scratch, timer);
+    }
+    mStats.countOutcome(error);
+    return error;
+}
+
+std::shared_ptr<SearchTask> OnDeviceIR::searchAsync(QueryImage image, SearchPriority priority, SearchCallback onDone) {
+    auto owned = std::make_shared<QueryImage>(std::move(image));
+    return submitSearch(priority, [owned] { return owned->view(); }, std::move(onDone));
+}
+
+std::shared_ptr<SearchTask> OnDeviceIR::searchAsync(FrameBuffer frame, SearchPriority priority,
+                                                    SearchCallback onDone) {
+    return submitSearch(priority, [frame] { return frame.frame(); }, std::move(onDone));
+}
+
+std::shared_ptr<SearchTask> OnDeviceIR::submitSearch(SearchPriority priority, std::function<VideoFrame()> frame,
+                                                     SearchCallback onDone) {
+    // Counted from now, and released with the task's work whether it runs or is cancelled.
+    auto scope = std::make_shared<SearchCountScope>(mSearchCount);
+    const auto submitted = std::chrono::steady_clock::now();
+    // Shared with mPendingFinderDone, which reports the search if a newer one cancels it.
+    auto done = std::make_shared<const SearchCallback>(std::move(onDone));
+    std::shared_ptr<SearchTask> task = mScheduler.submit(
+        priority, [this, scope, submitted, frame = std::move(frame), done] {
+            const SearchCallback& onDone = *done;
+            const bool timed = mStats.enabled();
+            if (timed) {
+                mStats.record(SearchStage::QUEUE_WAIT, elapsedMs(submitted));
+            }
+            std::vector<SearchResult> results;
+            // Counted by scope from submission on, so not again for the search itself.
+            const ErrorCode error = searchFrame(frame(), results);
+            if (onDone) {
+                const auto called = std::chrono::steady_clock::now();
+                onDone(error, std::move(results));
+                if (timed) {
+                    mStats.record(SearchStage::CALLBACK, elapsedMs(called));
+                }
+            }
+        });
+    if (priority == SearchPriority::FINDER) {
+        std::shared_ptr<SearchTask> stale;
+        std::shared_ptr<const SearchCallback> staleDone;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            stale = std::move(mPendingFinder);
+            staleDone = std::move(mPendingFinderDone);
+            mPendingFinder = task;
+            mPendingFinderDone = done;
+        }
+        // Only a search this cancels is reported: one the caller cancelled is not pending anymore.
+        if (stale && stale->state() == SearchTask::State::PENDING && stale->cancel()) {
+            mStats.countOutcome(ErrorCode::SEARCH_CANCELLED);
+            if (*staleDone) {
+                (*staleDone)(ErrorCode::SEARCH_CANCELLED, std::vector<SearchResult>());
+            }
+        }
+    }
+    return task;
+}
+
+ErrorCode OnDeviceIR::searchWithImages(const std::vector<SearchRequest>& requests,
+                                       std::vector<BatchSearchResult>& results, int threadCount,
+                                       SearchPriority priority) {
+    SearchCountScope scope(mSearchCount, static_cast<int>(requests.size()));
+    results.assign(requests.size(), BatchSearchResult());
+    for (size_t i = 0; i < requests.size(); ++i) {
+        results[i].requestCode = requests[i].requestCode;
+    }
+
+    const LoadedCollection active = activeLoadedCollection();
+    if (!active.collection) {
+        mStats.countOutcome(ErrorCode::ON_DEVICE_IR_NO_ACTIVE_COLLECTION, requests.size());
+        return ErrorCode::ON_DEVICE_IR_NO_ACTIVE_COLLECTION;
+    }
+    if (requests.empty()) {
+        return ErrorCode::SUCCESS;
+    }
+    if (threadCount <= 0) {
+        threadCount = mScheduler.workerCount();
+    }
+    threadCount = std::min(threadCount, static_cast<int>(requests.size()));
+
+    // Extraction: parts pull the next unprocessed image.
+    std::vector<FeatureSet> features(requests.size());
+    std::atomic<size_t> next{0};
+    mScheduler.run(threadCount, priority, [&](int) {
+        for (size_t i = next++; i < requests.size(); i = next++) {
+            StageTimer timer(&mStats);
+            ScratchScope scratch(*this);
+            results[i].error = extractFrame(requests[i].frame, *scratch, features[i], timer);
+            mStats.countOutcome(results[i].error);
+        }
+    });
+
+    // Matching: each part takes a contiguous share of the queries and
+    // matches it in a single pass over the collection.
+    std::vector<size_t> extracted;
+    for (size_t i = 0; i < requests.size(); ++i) {
+        if (results[i].error == ErrorCode::SUCCESS) {
+            extracted.push_back(i);
+        }
+    }
+    const int matchThreads = std::max(1, std::min(threadCount, static_cast<int>(extracted.size())));
+    mScheduler.run(matchThreads, priority, [&](int worker) {
+        const size_t begin = extracted.size() * worker / matchThreads;
+        const size_t end = extracted.size() * (worker + 1) / matchThreads;
+        std::vector<const FeatureSet*> queries;
+        for (size_t k = begin; k < end; ++k) {
+            queries.push_back(&features[extracted[k]]);
+        }
+        std::vector<std::vector<SearchResult>> matched;
+        ScratchScope scratch(*this);
+        mMatcher.matchBatch(queries, *active.collection, matched, active.index.get(), &scratch->arena);
+        for (size_t k = begin; k < end; ++k) {
+            results[extracted[k]].results = std::move(matched[k - begin]);
+        }
+    });
+    return ErrorCode::SUCCESS;
+}
+
+void OnDeviceIR::setSearchPrior(const SearchPrior& prior) {
+    std::shared_ptr<const SearchPrior> shared = prior.regions.empty() ? nullptr : std::make_shared<SearchPrior>(prior);
+    std::lock_guard<std::mutex> lock(mMutex);
+    mPrior = std::move(shared);
+}
+
+SearchPrior OnDeviceIR::searchPrior() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mPrior ? *mPrior : SearchPrior();
+}
+
+SearchStatsSnapshot OnDeviceIR::statsSnapshot() const {
+    SearchStatsSnapshot snapshot = mStats.snapshot();
+    snapshot.searchesInProgress = getCurrentSearchCount();
+    return snapshot;
+}
+
+void OnDeviceIR::setScratchObserver(ScratchObserver observer) {
+    std::shared_ptr<const ScratchObserver> shared =
+        observer ? std::make_shared<ScratchObserver>(std::move(observer)) : nullptr;
+    std::lock_guard<std::mutex> lock(mMutex);
+    mReportScratch = shared != nullptr;
+    mScratchObserver = std::move(shared);
+}
+
+ErrorCode OnDeviceIR::extractFrame(const VideoFrame& frame, SearchScratch& scratch, FeatureSet& features,
+                                   StageTimer& timer) const {
+    std::shared_ptr<const SearchPrior> prior;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        prior = mPrior;
+    }
+    if (prior) {
+        return extractRegions(frame, prior->rectsFor(frame.width, frame.height), scratch, features, timer);
+    }
+    return extractRegions(frame, std::vector<FrameRect>(), scratch, features, timer);
+}
+
+ErrorCode OnDeviceIR::extractRegions(const VideoFrame& frame, const std::vector<FrameRect>& regions,
+                                     SearchScratch& scratch, FeatureSet& features, StageTimer& timer) const {
+    if (!frame.isValid()) {
+        return ErrorCode::SEARCH_ERROR_IMAGE_TOO_SMALL;
+    }
+    // The BGRA pixels are only read here, straight into a reduced luminance plane.
+    // Regions are reduced by the factor of the whole frame, so signs keep the
+    // scale they would have in a whole-frame search.
+    const int factor = mExtractor.reductionFactor(frame.width, frame.height);
+    if (regions.empty()) {
+        scratch.pyramid.build(frame, factor, mExtractor.pyramidOptions());
+        timer.lap(SearchStage::PREPROCESS);
+        const ErrorCode error = mExtractor.extract(scratch.pyramid, features, &scratch.arena);
+        timer.lap(SearchStage::EXTRACT);
+        return error;
+    }
+
+    features.clear();
+    features.width = frame.width;
+    features.height = frame.height;
+    ErrorCode firstError = ErrorCode::SUCCESS;
+    bool extracted = false;
+    FeatureSet& part = scratch.part;
+    for (const FrameRect& region : regions) {
+        const FrameRect aligned = alignToBlocks(region, factor, frame.width, frame.height);
+        const VideoFrame view = frame.crop(aligned);
+        ErrorCode error = ErrorCode::SEARCH_ERROR_IMAGE_TOO_SMALL;
+        if (view.isValid()) {
+            scratch.pyramid.build(view, factor, mExtractor.pyramidOptions());
+            timer.lap(SearchStage::PREPROCESS);
+            error = mExtractor.extract(scratch.pyramid, part, &scratch.arena);
+            timer.lap(SearchStage::EXTRACT);
+        }
+        if (error != ErrorCode::SUCCESS) {
+            if (firstError == ErrorCode::SUCCESS) {
+                firstError = error;
+            }
+            continue;
+        }
+        for (Keypoint keypoint : part.keypoints) {
+            keypoint.x += aligned.x;
+            keypoint.y += aligned.y;
+            features.keypoints.push_back(keypoint);
+        }
+        features.descriptors.insert(features.descriptors.end(), part.descriptors.begin(), part.descriptors.end());
+        features.processingScale = std::max(extracted ? features.processingScale : 0.0f, part.processingScale);
+        extracted = true;
+    }
+    return extracted ? ErrorCode::SUCCESS : firstError;
+}
+
+void OnDeviceIR::matchFeatures(const FeatureSet& features, const LoadedCollection& active,
+                               std::vector<SearchResult>& results, SearchScratch& scratch, StageTimer& timer) {
+    // Matcher::match in two halves, timed apart. The candidates are verified
+    // on the workers too, ahead of searches still waiting: this one is further along.
+    MatchCandidates candidates(&scratch.arena);
+    mMatcher.findCandidates(features, *active.collection, candidates, active.index.get(), &scratch.arena);
+    timer.lap(SearchStage::MATCH);
+    mMatcher.verify(features, *active.collection, candidates, results, &scratch.arena, &mScheduler,
+                    SearchPriority::SINGLE_SHOT);
+    timer.lap(SearchStage::VERIFY);
+}
+
+}
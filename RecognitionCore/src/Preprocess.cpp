@@ -0,0 +1,81 @@
+//
+//  Preprocess.cpp
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "rsr/Preprocess.h"
+
+#include "simd/PreprocessKernels.h"
+
+namespace rsr {
+
+namespace detail {
+
+void reduceRowScalar(const VideoFrame& frame, int factor, int y, int xBegin, GrayImage& gray) {
+    const uint32_t area = static_cast<uint32_t>(factor * factor);
+    const uint32_t bias = area * 128;
+    const uint32_t divisor = area * 256;
+    uint8_t* out = gray.row(y);
+    for (int x = xBegin; x < gray.width; ++x) {
+        uint32_t sum = 0;
+        for (int dy = 0; dy < factor; ++dy) {
+            const uint8_t* p = frame.bgraBytes + static_cast<size_t>(y * factor + dy) * frame.bytesPerRow +
+                               static_cast<size_t>(x) * factor * 4;
+            for (int dx = 0; dx < factor; ++dx, p += 4) {
+                sum += kWeightB * p[0] + kWeightG * p[1] + kWeightR * p[2];
+            }
+        }
+        out[x] = static_cast<uint8_t>((sum + bias) / divisor);
+    }
+}
+
+}
+
+void reduceBGRAToGray(const VideoFrame& frame, int factor, GrayImage& gray) {
+    reduceBGRAToGray(frame, factor, gray, bestSimdLevel());
+}
+
+void reduceBGRAToGray(const VideoFrame& frame, int factor, GrayImage& gray, SimdLevel level) {
+    if (factor < 1) {
+        factor = 1;
+    }
+    const int width = frame.isValid() ? frame.width / factor : 0;
+    const int height = frame.isValid() ? frame.height / factor : 0;
+    if (gray.width != width || gray.height != height) {
+        gray.width = width;
+        gray.height = height;
+        gray.pixels.resize(static_cast<size_t>(width) * height);
+    }
+    if (width == 0 || height == 0) {
+        return;
+    }
+
+    const bool vectorizable = factor == 1 || factor == 2 || factor == 4;
+    if (vectorizable && isSimdLevelSupported(level)) {
+        switch (level) {
+#if defined(RSR_HAVE_X86_KERNELS)
+            case SimdLevel::AVX512:
+            case SimdLevel::AVX2:
+                detail::reduceBGRAToGrayAVX2(frame, factor, gray);
+                return;
+            case SimdLevel::SSE41:
+                detail::reduceBGRAToGraySSE41(frame, factor, gray);
+                return;
+#endif
+#if defined(RSR_HAVE_NEON_KERNELS)
+            case SimdLevel::NEON:
+                detail::reduceBGRAToGrayNEON(frame, factor, gray);
+                return;
+#endif
+            default:
+                break;
+        }
+    }
+    for (int y = 0; y < height; ++y) {
+        detail::reduceRowScalar(frame, factor, y, 0, gray);
+    }
+}
+
+}
@@ -0,0 +1,34 @@
+//
+//  QueryImage.cpp
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "rsr/QueryImage.h"
+
+#include <cstring>
+
+namespace rsr {
+
+QueryImage::QueryImage(const uint8_t* bgraBytes, int width, int height, int bytesPerRow)
+    : mWidth(width), mHeight(height), mBytesPerRow(width * 4) {
+    if (bgraBytes == nullptr || width <= 0 || height <= 0 || bytesPerRow < width * 4) {
+        mWidth = mHeight = mBytesPerRow = 0;
+        return;
+    }
+    mPixels.resize(static_cast<size_t>(mBytesPerRow) * height);
+    for (int y = 0; y < height; ++y) {
+        std::memcpy(mPixels.data() + static_cast<size_t>(y) * mBytesPerRow,
+                    bgraBytes + static_cast<size_t>(y) * bytesPerRow, static_cast<size_t>(mBytesPerRow));
+    }
+}
+
+QueryImage::QueryImage(const VideoFrame& frame)
+    : QueryImage(frame.bgraBytes, frame.width, frame.height, frame.bytesPerRow) {}
+
+GrayImage QueryImage::toGray() const {
+    return convertBGRAToGray(mPixels.data(), mWidth, mHeight, mBytesPerRow);
+}
+
+}
@@ -0,0 +1,271 @@
+//
+//  RecordedVideo.cpp
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "rsr/RecordedVideo.h"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace rsr {
+
+namespace {
+
+const char kY4mSignature[] = "YUV4MPEG2 ";
+// Longer header or frame lines are treated as damage.
+constexpr size_t kMaxLine = 4096;
+// Larger frames are treated as damage too, so that sizes in pixels and bytes stay well within int.
+constexpr int kMaxDimension = 16384;
+
+bool isValidSize(int width, int height) {
+    return width > 0 && height > 0 && width <= kMaxDimension && height <= kMaxDimension;
+}
+
+// Reads up to and without the newline. @return false at the end of the file or past kMaxLine.
+bool readLine(FILE* file, std::string& line) {
+    line.clear();
+    for (int c = std::fgetc(file); c != '\n'; c = std::fgetc(file)) {
+        if (c == EOF || line.size() >= kMaxLine) {
+            return false;
+        }
+        line.push_back(static_cast<char>(c));
+    }
+    return true;
+}
+
+uint8_t clampByte(int value) {
+    return static_cast<uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+}
+
+RecordedVideo::RecordedVideo(const FramePoolOptions& poolOptions) : mPool(poolOptions) {}
+
+RecordedVideo::~RecordedVideo() {
+    if (mFile) {
+        std::fclose(mFile);
+    }
+}
+
+ErrorCode RecordedVideo::open(const std::string& path, const RecordingInfo& raw) {
+    if (mFile) {
+        std::fclose(mFile);
+    }
+    mFile = std::fopen(path.c_str(), "rb");
+    if (!mFile) {
+        return ErrorCode::SEARCH_ERROR_READING_FILE;
+    }
+    mFrameIndex = 0;
+    mFinished = false;
+
+    char signature[sizeof(kY4mSignature) - 1];
+    const size_t read = std::fread(signature, 1, sizeof(signature), mFile);
+    std::fseek(mFile, 0, SEEK_SET);
+    ErrorCode error = ErrorCode::SUCCESS;
+    if (read == sizeof(signature) && std::memcmp(signature, kY4mSignature, sizeof(signature)) == 0) {
+        error = readY4mHeader();
+    } else {
+        mInfo = raw;
+        mInfo.format = RecordingFormat::RAW_BGRA;
+        if (!isValidSize(mInfo.width, mInfo.height)) {
+            error = ErrorCode::SEARCH_ERROR_READING_FILE;
+        }
+    }
+    if (error != ErrorCode::SUCCESS) {
+        std::fclose(mFile);
+        mFile = nullptr;
+        return error;
+    }
+    if (mInfo.fps <= 0.0) {
+        mInfo.fps = 30.0;
+    }
+    mDataStart = std::ftell(mFile);
+    return ErrorCode::SUCCESS;
+}
+
+ErrorCode RecordedVideo::readY4mHeader() {
+    std::string line;
+    if (!readLine(mFile, line)) {
+        return ErrorCode::SEARCH_ERROR_READING_FILE;
+    }
+    mInfo = RecordingInfo();
+    mInfo.format = RecordingFormat::Y4M;
+    mChroma = Chroma::C420;
+    mFullRange = false;
+    // Parameters are single letters followed by their value, separated by spaces.
+    size_t begin = sizeof(kY4mSignature) - 1;
+    while (begin < line.size()) {
+        size_t end = line.find(' ', begin);
+        if (end == std::string::npos) {
+            end = line.size();
+        }
+        const std::string token = line.substr(begin, end - begin);
+        begin = end + 1;
+        if (token.empty()) {
+            continue;
+        }
+        const std::string value = token.substr(1);
+        switch (token[0]) {
+            case 'W': mInfo.width = std::atoi(value.c_str()); break;
+            case 'H': mInfo.height = std::atoi(value.c_str()); break;
+            case 'F': {
+                const size_t colon = value.find(':');
+                const double numerator = std::atof(value.c_str());
+                const double denominator = colon == std::string::npos ? 1.0 : std::atof(value.c_str() + colon + 1);
+                mInfo.fps = denominator > 0.0 ? numerator / denominator : 0.0;
+                break;
+            }
+            case 'C':
+                if (value == "mono") {
+                    mChroma = Chroma::MONO;
+                } else if (value == "422") {
+                    mChroma = Chroma::C422;
+                } else if (value == "444") {
+                    mChroma = Chroma::C444;
+                } else if (value == "420" || value == "420jpeg" || value == "420mpeg2" || value == "420paldv") {
+                    mChroma = Chroma::C420;
+                    mFullRange = mFullRange || value == "420jpeg";
+                } else {
+                    // Higher bit depths and alpha planes.
+                    return ErrorCode::SEARCH_ERROR_READING_FILE;
+                }
+                break;
+            case 'X':
+                if (value == "COLORRANGE=FULL") {
+                    mFullRange = true;
+                }
+                break;
+            default: break;
+        }
+    }
+    return isValidSize(mInfo.width, mInfo.height) ? ErrorCode::SUCCESS : ErrorCode::SEARCH_ERROR_READING_FILE;
+}
+
+ErrorCode RecordedVideo::next(FrameBuffer& frame) {
+    frame = FrameBuffer();
+    if (!mFile) {
+        return ErrorCode::SEARCH_ERROR_READING_FILE;
+    }
+    if (mFinished) {
+        return ErrorCode::SUCCESS;
+    }
+    const size_t width = static_cast<size_t>(mInfo.width);
+    const size_t height = static_cast<size_t>(mInfo.height);
+
+    if (mInfo.format == RecordingFormat::RAW_BGRA) {
+        const size_t bytes = width * height * 4;
+        FrameBuffer buffer = mPool.acquire(mInfo.width, mInfo.height);
+        if (!buffer) {
+            // Skipped, if there is a frame left to skip.
+            if (std::fgetc(mFile) == EOF) {
+                mFinished = true;
+                return ErrorCode::SUCCESS;
+            }
+            if (std::fseek(mFile, static_cast<long>(bytes) - 1, SEEK_CUR) != 0) {
+                return ErrorCode::SEARCH_ERROR_READING_FILE;
+            }
+            ++mFrameIndex;
+            return ErrorCode::SUCCESS;
+        }
+        const size_t read = std::fread(buffer.pixels(), 1, bytes, mFile);
+        if (read == 0) {
+            mFinished = true;
+            return ErrorCode::SUCCESS;
+        }
+        if (read < bytes) {
+            return ErrorCode::SEARCH_ERROR_READING_FILE;
+        }
+        ++mFrameIndex;
+        frame = std::move(buffer);
+        return ErrorCode::SUCCESS;
+    }
+
+    std::string line;
+    if (!readLine(mFile, line)) {
+        if (line.empty() && std::feof(mFile)) {
+            mFinished = true;
+            return ErrorCode::SUCCESS;
+        }
+        return ErrorCode::SEARCH_ERROR_READING_FILE;
+    }
+    if (line.compare(0, 5, "FRAME") != 0) {
+        return ErrorCode::SEARCH_ERROR_READING_FILE;
+    }
+    size_t chromaWidth = 0;
+    size_t chromaHeight = 0;
+    switch (mChroma) {
+        case Chroma::MONO: break;
+        case Chroma::C420: chromaWidth = (width + 1) / 2; chromaHeight = (height + 1) / 2; break;
+        case Chroma::C422: chromaWidth = (width + 1) / 2; chromaHeight = height; break;
+        case Chroma::C444: chromaWidth = width; chromaHeight = height; break;
+    }
+    mPlanes.resize(width * height + 2 * chromaWidth * chromaHeight);
+    if (std::fread(mPlanes.data(), 1, mPlanes.size(), mFile) != mPlanes.size()) {
+        return ErrorCode::SEARCH_ERROR_READING_FILE;
+    }
+    ++mFrameIndex;
+    frame = mPool.acquire(mInfo.width, mInfo.height);
+    if (frame) {
+        convertYuv(frame.pixels());
+    }
+    return ErrorCode::SUCCESS;
+}
+
+void RecordedVideo::convertYuv(uint8_t* bgra) const {
+    const int width = mInfo.width;
+    const int height = mInfo.height;
+    const uint8_t* luma = mPlanes.data();
+    if (mChroma == Chroma::MONO) {
+        for (int i = 0; i < width * height; ++i) {
+            const int y = mFullRange ? luma[i] : (298 * (luma[i] - 16) + 128) >> 8;
+            const uint8_t v = clampByte(y);
+            bgra[i * 4 + 0] = v;
+            bgra[i * 4 + 1] = v;
+            bgra[i * 4 + 2] = v;
+            bgra[i * 4 + 3] = 255;
+        }
+        return;
+    }
+    const int shiftX = mChroma == Chroma::C444 ? 0 : 1;
+    const int shiftY = mChroma == Chroma::C420 ? 1 : 0;
+    const int chromaWidth = (width + shiftX) >> shiftX;
+    const int chromaHeight = (height + shiftY) >> shiftY;
+    const uint8_t* cb = luma + static_cast<size_t>(width) * height;
+    const uint8_t* cr = cb + static_cast<size_t>(chromaWidth) * chromaHeight;
+
+    // BT.601 in 8.8 fixed point.
+    const int yScale = mFullRange ? 256 : 298;
+    const int yOffset = mFullRange ? 0 : 16;
+    const int crToR = mFullRange ? 359 : 409;
+    const int cbToG = mFullRange ? 88 : 100;
+    const int crToG = mFullRange ? 183 : 208;
+    const int cbToB = mFullRange ? 454 : 516;
+    for (int row = 0; row < height; ++row) {
+        const uint8_t* lumaRow = luma + static_cast<size_t>(row) * width;
+        const size_t chromaRow = static_cast<size_t>(row >> shiftY) * chromaWidth;
+        uint8_t* out = bgra + static_cast<size_t>(row) * width * 4;
+        for (int x = 0; x < width; ++x) {
+            const int y = yScale * (lumaRow[x] - yOffset) + 128;
+            const int u = cb[chromaRow + (x >> shiftX)] - 128;
+            const int v = cr[chromaRow + (x >> shiftX)] - 128;
+            out[x * 4 + 0] = clampByte((y + cbToB * u) >> 8);
+            out[x * 4 + 1] = clampByte((y - cbToG * u - crToG * v) >> 8);
+            out[x * 4 + 2] = clampByte((y + crToR * v) >> 8);
+            out[x * 4 + 3] = 255;
+        }
+    }
+}
+
+ErrorCode RecordedVideo::rewind() {
+    if (!mFile || std::fseek(mFile, mDataStart, SEEK_SET) != 0) {
+        return ErrorCode::SEARCH_ERROR_READING_FILE;
+    }
+    mFrameIndex = 0;
+    mFinished = false;
+    return ErrorCode::SUCCESS;
+}
+
+}
@@ -0,0 +1,236 @@
+//
+//  Replay.cpp
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "rsr/Replay.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <utility>
+
+#include "rsr/LatencyHistogram.h"
+#include "rsr/OnDeviceIR.h"
+#include "rsr/RecordedVideo.h"
+#include "rsr/SearchPipeline.h"
+
+namespace rsr {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double elapsedMs(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+// Results as they come back on search threads, against the labels.
+class Tally {
+public:
+    struct Delivery {
+        uint64_t frame = 0;
+        Clock::time_point at;
+    };
+
+    explicit Tally(const std::vector<ReplayLabel>& labels) : mLabels(labels) {}
+
+    // Pipelined frames are only known by their sequence number when they come back.
+    void remember(uint64_t sequence, const Delivery& delivery) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mDeliveries.size() < sequence) {
+            mDeliveries.resize(sequence);
+        }
+        mDeliveries[sequence - 1] = delivery;
+    }
+
+    Delivery recall(uint64_t sequence) const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return sequence - 1 < mDeliveries.size() ? mDeliveries[sequence - 1] : Delivery();
+    }
+
+    void add(const Delivery& delivery, const std::vector<SearchResult>& results) {
+        const Clock::time_point now = Clock::now();
+        mLatency.record(elapsedMs(delivery.at, now));
+        const ReplayLabel* label = nullptr;
+        for (const ReplayLabel& candidate : mLabels) {
+            if (delivery.frame >= candidate.firstFrame && delivery.frame <= candidate.lastFrame) {
+                label = &candidate;
+                break;
+            }
+        }
+        const bool matched = label && !results.empty() && results[0].item.uuid == label->itemUUID;
+        std::lock_guard<std::mutex> lock(mMutex);
+        ++mReport.searched;
+        mReport.withResults += !results.empty();
+        mReport.labeled += label != nullptr;
+        mReport.correct += matched;
+        mReport.wrong += !results.empty() && !matched;
+        mLastResult = now;
+    }
+
+    void fill(ReplayReport& report, Clock::time_point start) const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        report.searched = mReport.searched;
+        report.withResults = mReport.withResults;
+        report.labeled = mReport.labeled;
+        report.correct = mReport.correct;
+        report.wrong = mReport.wrong;
+        report.seconds = mReport.searched > 0 ? elapsedMs(start, mLastResult) / 1000.0 : 0.0;
+        report.latencyMean = mLatency.mean();
+        report.latencyP50 = mLatency.percentile(50);
+        report.latencyP90 = mLatency.percentile(90);
+        report.latencyP99 = mLatency.percentile(99);
+        report.latencyMax = mLatency.max();
+    }
+
+private:
+    const std::vector<ReplayLabel>& mLabels;
+    LatencyHistogram mLatency;
+    mutable std::mutex mMutex;
+    std::vector<Delivery> mDeliveries;  ///< By pipeline sequence number, from 1.
+    ReplayReport mReport;               ///< Only the counters of searched frames.
+    Clock::time_point mLastResult;
+};
+
+}
+
+ErrorCode loadReplayLabels(const std::string& path, std::vector<ReplayLabel>& labels) {
+    labels.clear();
+    std::ifstream file(path);
+    if (!file) {
+        return ErrorCode::SEARCH_ERROR_READING_FILE;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        const size_t start = line.find_first_not_of(" \t\r");
+        if (start == std::string::npos || line[start] == '#') {
+            continue;
+        }
+        std::istringstream fields(line);
+        ReplayLabel label;
+        if (!(fields >> label.firstFrame >> label.lastFrame >> label.itemUUID) || label.lastFrame < label.firstFrame) {
+            labels.clear();
+            return ErrorCode::SEARCH_ERROR_READING_FILE;
+        }
+        labels.push_back(std::move(label));
+    }
+    return ErrorCode::SUCCESS;
+}
+
+double ReplayReport::recognitionRate() const {
+    if (labeled > 0) {
+        return static_cast<double>(correct) / labeled;
+    }
+    return searched > 0 ? static_cast<double>(withResults) / searched : 0.0;
+}
+
+std::string ReplayReport::toJson() const {
+    char buffer[640];
+    std::snprintf(buffer, sizeof(buffer),
+                  "{\"frames\":%llu,\"delivered\":%llu,\"late\":%llu,\"refused\":%llu,\"searched\":%llu,"
+                  "\"with_results\":%llu,\"labeled\":%llu,\"correct\":%llu,\"wrong\":%llu,\"seconds\":%.3f,"
+                  "\"frames_per_second\":%.2f,\"recognition_rate\":%.4f,\"latency\":{\"mean_ms\":%.3f,"
+                  "\"p50_ms\":%.3f,\"p90_ms\":%.3f,\"p99_ms\":%.3f,\"max_ms\":%.3f},\"stats\":",
+                  static_cast<unsigned long long>(frames), static_cast<unsigned long long>(delivered),
+                  static_cast<unsigned long long>(late), static_cast<unsigned long long>(refused),
+                  static_cast<unsigned long long>(searched), static_cast<unsigned long long>(withResults),
+                  static_cast<unsigned long long>(labeled), static_cast<unsigned long long>(correct),
+                  static_cast<unsigned long long>(wrong), seconds, framesPerSecond(), recognitionRate(),
+                  latencyMean, latencyP50, latencyP90, latencyP99, latencyMax);
+    return buffer + stats.toJson() + "}";
+}
+
+ErrorCode replayRecording(OnDeviceIR& onDeviceIR, RecordedVideo& video, const ReplayOptions& options,
+                          const std::vector<ReplayLabel>& labels, ReplayReport& report) {
+    report = ReplayReport();
+    onDeviceIR.stats().reset();
+    Tally tally(labels);
+
+    std::unique_ptr<SearchPipeline> pipeline;
+    if (options.pipeline) {
+        auto onResult = [&tally](uint64_t sequence, ErrorCode, const std::vector<SearchResult>& results) {
+            tally.add(tally.recall(sequence), results);
+        };
+        pipeline.reset(new SearchPipeline(onDeviceIR, onResult));
+    }
+    std::vector<std::shared_ptr<SearchTask>> tasks;
+
+    const bool paced = options.pacing != ReplayPacing::AS_FAST_AS_POSSIBLE;
+    const double fps = options.pacing == ReplayPacing::FIXED_RATE ? options.rate : video.info().fps;
+    const Clock::duration interval =
+        std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(fps > 0.0 ? 1.0 / fps : 0.0));
+    const uint64_t first = video.frameIndex();
+    const Clock::time_point start = Clock::now();
+    ErrorCode error = ErrorCode::SUCCESS;
+    while (options.maxFrames == 0 || video.frameIndex() - first < options.maxFrames) {
+        const uint64_t index = video.frameIndex();
+        const Clock::time_point due = start + interval * static_cast<Clock::rep>(index - first);
+        if (paced) {
+            std::this_thread::sleep_until(due);
+        }
+        FrameBuffer frame;
+        error = video.next(frame);
+        if (error != ErrorCode::SUCCESS || video.finished()) {
+            break;
+        }
+        ++report.frames;
+        if (!frame) {
+            ++report.refused;
+            continue;
+        }
+        const Tally::Delivery delivery{index, Clock::now()};
+        if (paced && delivery.at > due + interval) {
+            ++report.late;
+            continue;
+        }
+        ++report.delivered;
+        if (pipeline) {
+            // Sequence numbers count submitted frames from 1.
+            tally.remember(report.delivered, delivery);
+            pipeline->submit(std::move(frame), !paced);
+            continue;
+        }
+        std::shared_ptr<SearchTask> task =
+            onDeviceIR.searchAsync(std::move(frame), SearchPriority::FINDER,
+                                   [&tally, delivery](ErrorCode error, std::vector<SearchResult> results) {
+                                       if (error != ErrorCode::SEARCH_CANCELLED) {
+                                           tally.add(delivery, results);
+                                       }
+                                   });
+        if (!paced) {
+            task->wait();
+            continue;
+        }
+        // Only searches still pending or running need to be waited for at the end.
+        if (tasks.size() >= 64) {
+            std::vector<std::shared_ptr<SearchTask>> pending;
+            for (std::shared_ptr<SearchTask>& waiting : tasks) {
+                const SearchTask::State state = waiting->state();
+                if (state == SearchTask::State::PENDING || state == SearchTask::State::RUNNING) {
+                    pending.push_back(std::move(waiting));
+                }
+            }
+            tasks.swap(pending);
+        }
+        tasks.push_back(std::move(task));
+    }
+
+    if (pipeline) {
+        pipeline->drain();
+    }
+    for (const std::shared_ptr<SearchTask>& task : tasks) {
+        task->wait();
+    }
+    tally.fill(report, start);
+    report.stats = onDeviceIR.statsSnapshot();
+    return error;
+}
+
+}
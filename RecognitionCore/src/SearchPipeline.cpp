@@ -0,0 +1,298 @@
+//
+//  SearchPipeline.cpp
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "rsr/SearchPipeline.h"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+#include "rsr/Features.h"
+#include "rsr/ImagePyramid.h"
+#include "rsr/Matcher.h"
+#include "rsr/OnDeviceIR.h"
+
+namespace rsr {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double elapsedMs(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+// Where each pipeline stage is reported in the OnDeviceIR's stats.
+const SearchStage kReportedAs[kPipelineStageCount] = {SearchStage::PREPROCESS, SearchStage::EXTRACT,
+                                                      SearchStage::MATCH, SearchStage::VERIFY, SearchStage::CALLBACK};
+
+}
+
+const char* pipelineStageName(PipelineStage stage) {
+    switch (stage) {
+        case PipelineStage::PREPROCESS: return "preprocess";
+        case PipelineStage::EXTRACT: return "extract";
+        case PipelineStage::MATCH: return "match";
+        case PipelineStage::VERIFY: return "verify";
+        case PipelineStage::DISPATCH: return "dispatch";
+    }
+    return "";
+}
+
+struct SearchPipeline::Job {
+    uint64_t sequence = 0;
+    FrameBuffer frame;
+    std::shared_ptr<const Collection> collection;  ///< Held from preprocessing to dispatch.
+    std::shared_ptr<const DescriptorIndex> index;
+    ImagePyramid pyramid;
+    FeatureSet features;
+    MatchCandidates candidates;
+    std::vector<SearchResult> results;
+    ErrorCode error = ErrorCode::SUCCESS;
+    Clock::time_point queuedAt;  ///< When the job entered its current queue.
+};
+
+bool SearchPipeline::JobQueue::push(Job* job) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mNotFull.wait(lock, [this] { return mJobs.size() < mCapacity || mClosed; });
+    if (mClosed) {
+        return false;
+    }
+    mJobs.push_back(job);
+    mNotEmpty.notify_one();
+    return true;
+}
+
+SearchPipeline::Job* SearchPipeline::JobQueue::pushReplacingOldest(Job* job) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    Job* replaced = nullptr;
+    if (mJobs.size() >= mCapacity) {
+        replaced = mJobs.front();
+        mJobs.erase(mJobs.begin());
+    }
+    mJobs.push_back(job);
+    mNotEmpty.notify_one();
+    return replaced;
+}
+
+SearchPipeline::Job* SearchPipeline::JobQueue::pop() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mNotEmpty.wait(lock, [this] { return !mJobs.empty() || mClosed; });
+    if (mJobs.empty()) {
+        return nullptr;
+    }
+    // A handful of jobs at most, so shifting them is cheaper than a deque's blocks.
+    Job* job = mJobs.front();
+    mJobs.erase(mJobs.begin());
+    mNotFull.notify_one();
+    return job;
+}
+
+SearchPipeline::Job* SearchPipeline::JobQueue::tryPop() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mJobs.empty()) {
+        return nullptr;
+    }
+    Job* job = mJobs.front();
+    mJobs.erase(mJobs.begin());
+    mNotFull.notify_one();
+    return job;
+}
+
+void SearchPipeline::JobQueue::close() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mClosed = true;
+    mNotEmpty.notify_all();
+    mNotFull.notify_all();
+}
+
+SearchPipeline::SearchPipeline(OnDeviceIR& onDeviceIR, PipelineCallback onResult, const PipelineOptions& options)
+    : mOnDeviceIR(onDeviceIR), mOnResult(std::move(onResult)), mOptions(options) {
+    mOptions.extractWorkers = std::max(1, mOptions.extractWorkers);
+    mOptions.matchWorkers = std::max(1, mOptions.matchWorkers);
+    mOptions.verifyWorkers = std::max(1, mOptions.verifyWorkers);
+    mOptions.queueDepth = std::max(1, mOptions.queueDepth);
+
+    const int workers[kPipelineStageCount] = {1, mOptions.extractWorkers, mOptions.matchWorkers,
+                                              mOptions.verifyWorkers, 1};
+    // Enough jobs for every queue to be full and every worker busy, plus the
+    // one submit holds while it replaces the oldest waiting frame.
+    size_t jobCount = static_cast<size_t>(mOptions.queueDepth) * kPipelineStageCount + 1;
+    for (int count : workers) {
+        jobCount += count;
+    }
+    mFree.setCapacity(jobCount);
+    for (size_t i = 0; i < jobCount; ++i) {
+        mJobs.emplace_back(new Job);
+        mFree.push(mJobs.back().get());
+    }
+
+    for (int s = 0; s < kPipelineStageCount; ++s) {
+        mStages[s].queue.setCapacity(static_cast<size_t>(mOptions.queueDepth));
+        mStages[s].running = workers[s];
+    }
+    for (int s = 0; s < kPipelineStageCount; ++s) {
+        for (int w = 0; w < workers[s]; ++w) {
+            mStages[s].workers.emplace_back(&SearchPipeline::runStage, this, static_cast<PipelineStage>(s));
+        }
+    }
+}
+
+SearchPipeline::~SearchPipeline() {
+    // Each stage closes the next once its queue is empty, so the frames
+    // already submitted flow through before the threads exit.
+    mStages[static_cast<int>(PipelineStage::PREPROCESS)].queue.close();
+    for (Stage& stage : mStages) {
+        for (std::thread& worker : stage.workers) {
+            worker.join();
+        }
+    }
+}
+
+uint64_t SearchPipeline::submit(FrameBuffer frame, bool wait) {
+    Job* job = mFree.pop();
+    job->frame = std::move(frame);
+    uint64_t sequence = 0;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        sequence = mNextSequence++;
+        ++mCounters.submitted;
+        ++mCounters.inFlight;
+    }
+    ++mOnDeviceIR.mSearchCount;
+    job->sequence = sequence;
+    job->queuedAt = Clock::now();
+
+    JobQueue& entrance = mStages[static_cast<int>(PipelineStage::PREPROCESS)].queue;
+    if (wait) {
+        entrance.push(job);
+        return sequence;
+    }
+    if (Job* replaced = entrance.pushReplacingOldest(job)) {
+        --mOnDeviceIR.mSearchCount;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            ++mCounters.dropped;
+            --mCounters.inFlight;
+            mDrained.notify_all();
+        }
+        recycle(replaced);
+    }
+    return sequence;
+}
+
+void SearchPipeline::drain() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mDrained.wait(lock, [this] { return mCounters.inFlight == 0; });
+}
+
+void SearchPipeline::resetLatencies() {
+    for (Stage& stage : mStages) {
+        stage.latency.reset();
+        stage.wait.reset();
+    }
+}
+
+PipelineCounters SearchPipeline::counters() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mCounters;
+}
+
+void SearchPipeline::runStage(PipelineStage stage) {
+    const int s = static_cast<int>(stage);
+    Stage& current = mStages[s];
+    Arena scratch(256 * 1024);
+    while (Job* job = current.queue.pop()) {
+        const Clock::time_point start = Clock::now();
+        current.wait.record(elapsedMs(job->queuedAt, start));
+        const bool succeeded = process(stage, *job, scratch);
+        scratch.reset();
+        const Clock::time_point end = Clock::now();
+        current.latency.record(elapsedMs(start, end));
+        SearchStats& stats = mOnDeviceIR.mStats;
+        if (stats.enabled()) {
+            // Waits between stages are the pipeline's own; only the first one is queueing.
+            if (stage == PipelineStage::PREPROCESS) {
+                stats.record(SearchStage::QUEUE_WAIT, elapsedMs(job->queuedAt, start));
+            }
+            stats.record(kReportedAs[s], elapsedMs(start, end));
+        }
+        if (stage == PipelineStage::DISPATCH) {
+            finish(job);
+            continue;
+        }
+        // A failed frame has nothing left to compute and goes straight to dispatch.
+        job->queuedAt = end;
+        mStages[succeeded ? s + 1 : static_cast<int>(PipelineStage::DISPATCH)].queue.push(job);
+    }
+    // Dispatch is closed last: the stages that may skip to it have all exited by then.
+    if (stage != PipelineStage::DISPATCH && --current.running == 0) {
+        mStages[s + 1].queue.close();
+    }
+}
+
+bool SearchPipeline::process(PipelineStage stage, Job& job, Arena& scratch) {
+    const FeatureExtractor& extractor = mOnDeviceIR.extractor();
+    switch (stage) {
+        case PipelineStage::PREPROCESS: {
+            job.error = ErrorCode::SUCCESS;
+            job.results.clear();
+            const OnDeviceIR::LoadedCollection active = mOnDeviceIR.activeLoadedCollection();
+            const VideoFrame frame = job.frame.frame();
+            if (!active.collection) {
+                job.error = ErrorCode::ON_DEVICE_IR_NO_ACTIVE_COLLECTION;
+            } else if (!frame.isValid()) {
+                job.error = ErrorCode::SEARCH_ERROR_IMAGE_TOO_SMALL;
+            } else {
+                job.collection = active.collection;
+                job.index = active.index;
+                job.pyramid.build(frame, extractor.reductionFactor(frame.width, frame.height),
+                                  extractor.pyramidOptions());
+            }
+            // The pyramid holds everything later stages read, so the camera buffer can go back now.
+            job.frame.reset();
+            return job.error == ErrorCode::SUCCESS;
+        }
+        case PipelineStage::EXTRACT:
+            job.error = extractor.extract(job.pyramid, job.features, &scratch);
+            return job.error == ErrorCode::SUCCESS;
+        case PipelineStage::MATCH:
+            mOnDeviceIR.matcher().findCandidates(job.features, *job.collection, job.candidates, job.index.get(),
+                                                 &scratch);
+            return true;
+        case PipelineStage::VERIFY:
+            mOnDeviceIR.matcher().verify(job.features, *job.collection, job.candidates, job.results, &scratch);
+            return true;
+        case PipelineStage::DISPATCH:
+            if (mOnResult) {
+                mOnResult(job.sequence, job.error, job.results);
+            }
+            return true;
+    }
+    return false;
+}
+
+void SearchPipeline::recycle(Job* job) {
+    job->frame.reset();
+    job->collection.reset();
+    job->index.reset();
+    mFree.push(job);
+}
+
+void SearchPipeline::finish(Job* job) {
+    const bool failed = job->error != ErrorCode::SUCCESS;
+    mOnDeviceIR.mStats.countOutcome(job->error);
+    recycle(job);
+    --mOnDeviceIR.mSearchCount;
+    std::lock_guard<std::mutex> lock(mMutex);
+    ++mCounters.completed;
+    mCounters.failed += failed;
+    --mCounters.inFlight;
+    mDrained.notify_all();
+}
+
+}
@@ -0,0 +1,109 @@
+//
+//  SearchRequestQueue.cpp
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "rsr/SearchRequestQueue.h"
+
+#include <utility>
+
+namespace rsr {
+
+SearchRequestQueue::SearchRequestQueue(const RequestQueueOptions& options) : mOptions(options) {
+    if (mOptions.depth == 0) {
+        mOptions.depth = 1;
+    }
+}
+
+bool SearchRequestQueue::push(const VideoFrame& frame) {
+    const Clock::time_point now = Clock::now();
+    const Clock::time_point deadline =
+        mOptions.deadlineSeconds > 0.0
+            ? now + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(mOptions.deadlineSeconds))
+            : Clock::time_point::max();
+    const FrameSketch sketch = FrameSketch::of(frame);
+    const bool coalescing = mOptions.coalesceDistance > 0.0;
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    if (mClosed) {
+        return false;
+    }
+    ++mCounters.enqueued;
+    uint64_t replaced = 0;
+    if (coalescing && !mEntries.empty()) {
+        if (sketch.distance(mEntries.back().sketch) < mOptions.coalesceDistance) {
+            replaced = mEntries.back().request.id;
+        }
+    } else if (coalescing && sketch.distance(mLastSent) < mOptions.coalesceDistance) {
+        ++mCounters.coalesced;
+        return false;
+    }
+    // The copy is the slow part: made without holding up senders.
+    lock.unlock();
+    QueryImage image(frame);
+    lock.lock();
+
+    if (replaced != 0 && !mEntries.empty() && mEntries.back().request.id == replaced) {
+        // Keep the place in line and the first arrival time; search the newest pixels.
+        Request& request = mEntries.back().request;
+        request.image = std::move(image);
+        request.deadline = deadline;
+        ++request.frames;
+        mEntries.back().sketch = sketch;
+        ++mCounters.coalesced;
+        return true;
+    }
+    Entry entry;
+    entry.request.id = mNextId++;
+    entry.request.image = std::move(image);
+    entry.request.enqueuedAt = now;
+    entry.request.deadline = deadline;
+    entry.sketch = sketch;
+    if (mEntries.size() >= mOptions.depth) {
+        mEntries.pop_front();
+        ++mCounters.dropped;
+    }
+    mEntries.push_back(std::move(entry));
+    mAvailable.notify_one();
+    return true;
+}
+
+bool SearchRequestQueue::pop(Request& request, int timeoutMs) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    const Clock::time_point giveUp = Clock::now() + std::chrono::milliseconds(timeoutMs);
+    for (;;) {
+        const Clock::time_point now = Clock::now();
+        while (!mEntries.empty() && mEntries.front().request.deadline <= now) {
+            mEntries.pop_front();
+            ++mCounters.expired;
+        }
+        if (!mEntries.empty()) {
+            request = std::move(mEntries.front().request);
+            mLastSent = mEntries.front().sketch;
+            mEntries.pop_front();
+            ++mCounters.sent;
+            return true;
+        }
+        if (mClosed || now >= giveUp) {
+            return false;
+        }
+        mAvailable.wait_until(lock, giveUp);
+    }
+}
+
+void SearchRequestQueue::close() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mClosed = true;
+    mAvailable.notify_all();
+}
+
+RequestQueueCounters SearchRequestQueue::counters() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    RequestQueueCounters counters = mCounters;
+    counters.depth = static_cast<int>(mEntries.size());
+    return counters;
+}
+
+}
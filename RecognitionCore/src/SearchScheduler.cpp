@@ -0,0 +1,252 @@
+//
+//  SearchScheduler.cpp
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "rsr/SearchScheduler.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <algorithm>
+#include <utility>
+
+namespace rsr {
+
+namespace {
+
+// Scheduler and worker index of the current thread, if it is a worker.
+thread_local const SearchScheduler* tScheduler = nullptr;
+thread_local int tWorkerIndex = -1;
+
+// Part tasks of run() on the current thread, reused once settled so that parts
+// run without allocating. Runs nest when a thread waiting for its parts runs
+// another task, so they take their tasks as a stack: the first inUse. A task
+// run by the caller stays queued on its scheduler until a worker drops it, so
+// tasks are only reused on the scheduler they were queued on: the pool starts
+// over when the thread runs parts on another one.
+struct PartTasks {
+    const SearchScheduler* scheduler = nullptr;
+    std::vector<std::shared_ptr<SearchTask>> tasks;
+    size_t inUse = 0;
+};
+
+thread_local PartTasks tPartTasks;
+
+void pinToCore(int core) {
+#ifdef __linux__
+    cpu_set_t cores;
+    CPU_ZERO(&cores);
+    CPU_SET(core % CPU_SETSIZE, &cores);
+    pthread_setaffinity_np(pthread_self(), sizeof(cores), &cores);
+#else
+    (void)core;
+#endif
+}
+
+}
+
+SearchTask::SearchTask(SearchPriority priority, std::function<void()> work)
+    : mPriority(priority), mWork(std::move(work)) {}
+
+bool SearchTask::tryStart() {
+    State expected = State::PENDING;
+    return mState.compare_exchange_strong(expected, State::RUNNING);
+}
+
+bool SearchTask::cancel() {
+    State expected = State::PENDING;
+    if (!mState.compare_exchange_strong(expected, State::CANCELLED)) {
+        return expected == State::CANCELLED;
+    }
+    settle(State::CANCELLED);
+    return true;
+}
+
+void SearchTask::runClaimed() {
+    mWork();
+    settle(State::DONE);
+}
+
+void SearchTask::settle(State state) {
+    // Whoever settles the task owns mWork: release what it captured before waking waiters.
+    mWork = nullptr;
+    std::lock_guard<std::mutex> lock(mMutex);
+    mState = state;
+    mSettled.notify_all();
+}
+
+void SearchTask::reuse(SearchPriority priority, std::function<void()> work) {
+    // A queue may still hold the task; the state, stored last, lets it run once.
+    mPriority = priority;
+    mWork = std::move(work);
+    mState = State::PENDING;
+}
+
+void SearchTask::wait() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mSettled.wait(lock, [this] {
+        const State state = mState.load();
+        return state == State::DONE || state == State::CANCELLED;
+    });
+}
+
+SearchScheduler::SearchScheduler(const SchedulerOptions& options) {
+    int workers = options.workerCount;
+    if (workers <= 0) {
+        workers = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    for (int i = 0; i < workers; ++i) {
+        mWorkers.push_back(std::unique_ptr<Worker>(new Worker()));
+    }
+    for (int i = 0; i < workers; ++i) {
+        mWorkers[i]->thread = std::thread(&SearchScheduler::workerLoop, this, i, options.pinWorkers);
+    }
+}
+
+SearchScheduler::~SearchScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mSleepMutex);
+        mStopping = true;
+    }
+    mWake.notify_all();
+    for (auto& worker : mWorkers) {
+        worker->thread.join();
+    }
+}
+
+std::shared_ptr<SearchTask> SearchScheduler::submit(SearchPriority priority, std::function<void()> work) {
+    auto task = std::make_shared<SearchTask>(priority, std::move(work));
+    enqueue(task);
+    return task;
+}
+
+void SearchScheduler::enqueue(const std::shared_ptr<SearchTask>& task) {
+    const int target = tScheduler == this ? tWorkerIndex
+                                          : static_cast<int>(mNextWorker++ % mWorkers.size());
+    {
+        Worker& worker = *mWorkers[target];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.queues[static_cast<int>(task->priority())].push_back(task);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mSleepMutex);
+        ++mQueued;
+    }
+    mWake.notify_one();
+}
+
+void SearchScheduler::run(int parts, SearchPriority priority, const std::function<void(int part)>& work) {
+    PartTasks& pool = tPartTasks;
+    if (pool.scheduler != this && pool.inUse == 0) {
+        pool.tasks.clear();
+        pool.scheduler = this;
+    }
+    // Nested in a run on another scheduler, whose tasks are still in use: fresh ones.
+    std::vector<std::shared_ptr<SearchTask>> fresh;
+    const bool pooled = pool.scheduler == this;
+    std::vector<std::shared_ptr<SearchTask>>& tasks = pooled ? pool.tasks : fresh;
+    const size_t first = pooled ? pool.inUse : 0;
+    const size_t end = first + static_cast<size_t>(std::max(0, parts - 1));
+    if (tasks.size() < end) {
+        tasks.resize(end);
+    }
+    if (pooled) {
+        pool.inUse = end;
+    }
+    for (int part = 1; part < parts; ++part) {
+        std::shared_ptr<SearchTask>& task = tasks[first + part - 1];
+        if (task) {
+            task->reuse(priority, [&work, part] { work(part); });
+        } else {
+            task = std::make_shared<SearchTask>(priority, [&work, part] { work(part); });
+        }
+        enqueue(task);
+    }
+    work(0);
+    for (size_t i = first; i < end; ++i) {
+        // Held by value: nested runs may grow the pool.
+        const std::shared_ptr<SearchTask> task = tasks[i];
+        if (task->tryStart()) {
+            execute(*task);
+        } else {
+            task->wait();
+        }
+    }
+    if (pooled) {
+        pool.inUse = first;
+    }
+}
+
+SchedulerCounters SearchScheduler::counters() const {
+    SchedulerCounters counters;
+    counters.executed = mExecuted.load();
+    counters.stolen = mStolen.load();
+    counters.cancelled = mCancelled.load();
+    counters.queued = mQueued.load();
+    return counters;
+}
+
+void SearchScheduler::workerLoop(int index, bool pin) {
+    tScheduler = this;
+    tWorkerIndex = index;
+    if (pin) {
+        pinToCore(index);
+    }
+    for (;;) {
+        if (std::shared_ptr<SearchTask> task = findTask(index)) {
+            --mQueued;
+            if (task->tryStart()) {
+                execute(*task);
+            } else if (task->state() == SearchTask::State::CANCELLED) {
+                ++mCancelled;
+            }
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mSleepMutex);
+        // Queued tasks are finished before stopping.
+        if (mStopping && mQueued == 0) {
+            return;
+        }
+        mWake.wait(lock, [this] { return mStopping || mQueued > 0; });
+    }
+}
+
+std::shared_ptr<SearchTask> SearchScheduler::findTask(int index) {
+    const int workers = static_cast<int>(mWorkers.size());
+    for (int priority = kSearchPriorityCount - 1; priority >= 0; --priority) {
+        {
+            Worker& own = *mWorkers[index];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            auto& queue = own.queues[priority];
+            if (!queue.empty()) {
+                std::shared_ptr<SearchTask> task = std::move(queue.front());
+                queue.pop_front();
+                return task;
+            }
+        }
+        for (int k = 1; k < workers; ++k) {
+            Worker& victim = *mWorkers[(index + k) % workers];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            auto& queue = victim.queues[priority];
+            if (!queue.empty()) {
+                std::shared_ptr<SearchTask> task = std::move(queue.front());
+                queue.pop_front();
+                ++mStolen;
+                return task;
+            }
+        }
+    }
+    return nullptr;
+}
+
+void SearchScheduler::execute(SearchTask& task) {
+    task.runClaimed();
+    ++mExecuted;
+}
+
+}
@@ -0,0 +1,137 @@
+//
+//  SearchStats.cpp
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "rsr/SearchStats.h"
+
+#include <cstdio>
+
+namespace rsr {
+
+namespace {
+
+void appendStage(std::string& json, const char* name, const StageSnapshot& stage) {
+    char buffer[256];
+    std::snprintf(buffer, sizeof(buffer),
+                  "\"%s\":{\"count\":%llu,\"mean_ms\":%.3f,\"p50_ms\":%.3f,\"p90_ms\":%.3f,\"p99_ms\":%.3f,"
+                  "\"max_ms\":%.3f}",
+                  name, static_cast<unsigned long long>(stage.count), stage.mean, stage.p50, stage.p90, stage.p99,
+                  stage.max);
+    json += buffer;
+}
+
+}
+
+const char* searchStageName(SearchStage stage) {
+    switch (stage) {
+        case SearchStage::QUEUE_WAIT: return "queue_wait";
+        case SearchStage::PREPROCESS: return "preprocess";
+        case SearchStage::EXTRACT: return "extract";
+        case SearchStage::MATCH: return "match";
+        case SearchStage::VERIFY: return "verify";
+        case SearchStage::CALLBACK: return "callback";
+    }
+    return "";
+}
+
+std::string SearchStatsSnapshot::toJson() const {
+    std::string json = "{\"searches_in_progress\":" + std::to_string(searchesInProgress) + ",\"stages\":{";
+    for (int s = 0; s < kSearchStageCount; ++s) {
+        if (s > 0) {
+            json += ',';
+        }
+        appendStage(json, searchStageName(static_cast<SearchStage>(s)), stages[s]);
+    }
+    json += "},\"outcomes\":{";
+    bool first = true;
+    for (const auto& outcome : outcomes) {
+        if (!first) {
+            json += ',';
+        }
+        first = false;
+        json += '"';
+        json += errorCodeName(outcome.first);
+        json += "\":" + std::to_string(outcome.second);
+    }
+    json += "}}";
+    return json;
+}
+
+int SearchStats::outcomeIndex(ErrorCode error) {
+    if (error == ErrorCode::SEARCH_CANCELLED) {
+        return kCancelledOutcome;
+    }
+    const int index = static_cast<int>(error) + 1;
+    return index >= 0 && index < kCancelledOutcome ? index : -1;
+}
+
+void SearchStats::countOutcome(ErrorCode error, uint64_t searches) {
+    const int index = outcomeIndex(error);
+    if (!enabled() || index < 0) {
+        return;
+    }
+    mOutcomes[index].fetch_add(searches, std::memory_order_relaxed);
+}
+
+SearchStatsSnapshot SearchStats::snapshot() const {
+    SearchStatsSnapshot snapshot;
+    for (int s = 0; s < kSearchStageCount; ++s) {
+        const LatencyHistogram& histogram = mStages[s];
+        StageSnapshot& stage = snapshot.stages[s];
+        stage.count = histogram.count();
+        stage.mean = histogram.mean();
+        stage.p50 = histogram.percentile(50);
+        stage.p90 = histogram.percentile(90);
+        stage.p99 = histogram.percentile(99);
+        stage.max = histogram.max();
+    }
+    for (int i = 0; i < kOutcomeCount; ++i) {
+        const uint64_t count = mOutcomes[i].load(std::memory_order_relaxed);
+        if (count > 0) {
+            snapshot.outcomes[i == kCancelledOutcome ? ErrorCode::SEARCH_CANCELLED : static_cast<ErrorCode>(i - 1)] = count;
+        }
+    }
+    return snapshot;
+}
+
+void SearchStats::reset() {
+    for (LatencyHistogram& histogram : mStages) {
+        histogram.reset();
+    }
+    for (std::atomic<uint64_t>& outcome : mOutcomes) {
+        outcome.store(0, std::memory_order_relaxed);
+    }
+}
+
+StageTimer::StageTimer(SearchStats* stats) : mStats(stats && stats->enabled() ? stats : nullptr) {
+    if (mStats) {
+        mLast = Clock::now();
+    }
+}
+
+StageTimer::~StageTimer() {
+    if (!mStats) {
+        return;
+    }
+    for (int s = 0; s < kSearchStageCount; ++s) {
+        if (mLapped[s]) {
+            mStats->record(static_cast<SearchStage>(s), mMs[s]);
+        }
+    }
+}
+
+void StageTimer::lap(SearchStage stage) {
+    if (!mStats) {
+        return;
+    }
+    const Clock::time_point now = Clock::now();
+    const int s = static_cast<int>(stage);
+    mMs[s] += std::chrono::duration<double, std::milli>(now - mLast).count();
+    mLapped[s] = true;
+    mLast = now;
+}
+
+}
@@ -0,0 +1,442 @@
+//
+//  SignTracker.cpp
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "rsr/SignTracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "rsr/Preprocess.h"
+
+namespace rsr {
+
+namespace {
+
+constexpr int kCellSize = 8;          ///< At most one seed corner per cell, in working pixels.
+constexpr int kMaxIterations = 10;
+constexpr float kMinStep = 0.03f;
+constexpr float kMinEigenvalue = 400.0f;  ///< Of the gradient structure tensor over a 5 x 5 window.
+constexpr float kRansacThreshold = 2.0f;
+
+// Bilinear sample with coordinates clamped to the image; pixel centres are at integer positions.
+float sample(const GrayView& image, float x, float y) {
+    x = std::min(std::max(x, 0.0f), image.width - 1.001f);
+    y = std::min(std::max(y, 0.0f), image.height - 1.001f);
+    const int x0 = static_cast<int>(x);
+    const int y0 = static_cast<int>(y);
+    const float fx = x - x0;
+    const float fy = y - y0;
+    const uint8_t* top = image.row(y0) + x0;
+    const uint8_t* bottom = top + image.width;
+    return (top[0] * (1 - fx) + top[1] * fx) * (1 - fy) + (bottom[0] * (1 - fx) + bottom[1] * fx) * fy;
+}
+
+bool insideQuad(const Point2f quad[4], float x, float y) {
+    bool inside = false;
+    for (int i = 0, j = 3; i < 4; j = i++) {
+        if ((quad[i].y > y) != (quad[j].y > y) &&
+            x < (quad[j].x - quad[i].x) * (y - quad[i].y) / (quad[j].y - quad[i].y) + quad[i].x) {
+            inside = !inside;
+        }
+    }
+    return inside;
+}
+
+double quadArea(const Point2f quad[4]) {
+    double area = 0.0;
+    for (int i = 0, j = 3; i < 4; j = i++) {
+        area += static_cast<double>(quad[j].x) * quad[i].y - static_cast<double>(quad[i].x) * quad[j].y;
+    }
+    return 0.5 * std::fabs(area);
+}
+
+// Pyramidal Lucas-Kanade for one point. Returns false if it could not be followed.
+bool trackPoint(const std::vector<GrayView>& previous, const std::vector<GrayView>& current, int radius,
+                float maxResidual, const Point2f& from, Point2f& to) {
+    const int side = 2 * radius + 1;
+    std::vector<float> templ(side * side);
+    std::vector<float> gx(side * side);
+    std::vector<float> gy(side * side);
+    float guessX = 0.0f;
+    float guessY = 0.0f;
+    for (int level = static_cast<int>(previous.size()) - 1; level >= 0; --level) {
+        const GrayView& prev = previous[level];
+        const GrayView& next = current[level];
+        const float scaleX = static_cast<float>(prev.width) / previous[0].width;
+        const float scaleY = static_cast<float>(prev.height) / previous[0].height;
+        const float px = from.x * scaleX;
+        const float py = from.y * scaleY;
+
+        double gxx = 0.0, gxy = 0.0, gyy = 0.0;
+        for (int dy = -radius, k = 0; dy <= radius; ++dy) {
+            for (int dx = -radius; dx <= radius; ++dx, ++k) {
+                const float x = px + dx;
+                const float y = py + dy;
+                templ[k] = sample(prev, x, y);
+                gx[k] = 0.5f * (sample(prev, x + 1, y) - sample(prev, x - 1, y));
+                gy[k] = 0.5f * (sample(prev, x, y + 1) - sample(prev, x, y - 1));
+                gxx += gx[k] * gx[k];
+                gxy += gx[k] * gy[k];
+                gyy += gy[k] * gy[k];
+            }
+        }
+        const double det = gxx * gyy - gxy * gxy;
+        if (det < 1e-3 * side * side) {
+            return false;
+        }
+
+        float vx = 0.0f;
+        float vy = 0.0f;
+        for (int iteration = 0; iteration < kMaxIterations; ++iteration) {
+            double bx = 0.0, by = 0.0;
+            for (int dy = -radius, k = 0; dy <= radius; ++dy) {
+                for (int dx = -radius; dx <= radius; ++dx, ++k) {
+                    const float diff = templ[k] - sample(next, px + guessX + vx + dx, py + guessY + vy + dy);
+                    bx += diff * gx[k];
+                    by += diff * gy[k];
+                }
+            }
+            const float stepX = static_cast<float>((gyy * bx - gxy * by) / det);
+            const float stepY = static_cast<float>((gxx * by - gxy * bx) / det);
+            vx += stepX;
+            vy += stepY;
+            if (stepX * stepX + stepY * stepY < kMinStep * kMinStep) {
+                break;
+            }
+        }
+        if (level > 0) {
+            guessX = (guessX + vx) * previous[level - 1].width / prev.width;
+            guessY = (guessY + vy) * previous[level - 1].height / prev.height;
+        } else {
+            guessX += vx;
+            guessY += vy;
+        }
+    }
+
+    to = {from.x + guessX, from.y + guessY};
+    const GrayView& next = current[0];
+    if (to.x < radius || to.y < radius || to.x > next.width - 1 - radius || to.y > next.height - 1 - radius) {
+        return false;
+    }
+    float residual = 0.0f;
+    for (int dy = -radius; dy <= radius; ++dy) {
+        for (int dx = -radius; dx <= radius; ++dx) {
+            residual += std::fabs(sample(previous[0], from.x + dx, from.y + dy) - sample(next, to.x + dx, to.y + dy));
+        }
+    }
+    return residual / (side * side) <= maxResidual;
+}
+
+}
+
+SignTracker::SignTracker(const TrackingOptions& options) : mOptions(options) {}
+
+std::vector<GrayView> SignTracker::trackingLevels(const ImagePyramid& pyramid) const {
+    // Every second level: about an octave apart with the usual scale of 1.4.
+    std::vector<GrayView> levels;
+    const int minSide = 4 * mOptions.windowRadius;
+    for (int index = 0; static_cast<int>(levels.size()) < std::max(1, mOptions.pyramidLevels); index += 2) {
+        const GrayView level = pyramid.level(index);
+        if (level.empty() || (index > 0 && std::min(level.width, level.height) < minSide)) {
+            break;
+        }
+        levels.push_back(level);
+    }
+    return levels;
+}
+
+void SignTracker::keep(const std::vector<GrayView>& levels) {
+    mPrevious.resize(levels.size());
+    for (size_t i = 0; i < levels.size(); ++i) {
+        mPrevious[i].width = levels[i].width;
+        mPrevious[i].height = levels[i].height;
+        mPrevious[i].pixels.assign(levels[i].pixels,
+                                   levels[i].pixels + static_cast<size_t>(levels[i].width) * levels[i].height);
+    }
+}
+
+const ImagePyramid& SignTracker::ownPyramid(const VideoFrame& frame) {
+    const int longest = std::max(frame.width, frame.height);
+    int factor = 1;
+    while (factor < 4 && longest / (factor * 2) >= mOptions.maxDimension) {
+        factor *= 2;
+    }
+    PyramidOptions options;
+    options.maxDimension = mOptions.maxDimension;
+    mPyramid.build(frame, factor, options);
+    return mPyramid;
+}
+
+void SignTracker::seed(Target& target, const GrayView& image) const {
+    const int border = mOptions.windowRadius + 2;
+    float minX = 1e9f, minY = 1e9f, maxX = -1e9f, maxY = -1e9f;
+    for (const Point2f& p : target.box) {
+        minX = std::min(minX, p.x);
+        minY = std::min(minY, p.y);
+        maxX = std::max(maxX, p.x);
+        maxY = std::max(maxY, p.y);
+    }
+    const int x0 = std::max(border, static_cast<int>(minX));
+    const int y0 = std::max(border, static_cast<int>(minY));
+    const int x1 = std::min(image.width - 1 - border, static_cast<int>(maxX));
+    const int y1 = std::min(image.height - 1 - border, static_cast<int>(maxY));
+    target.points.clear();
+    if (x1 <= x0 || y1 <= y0) {
+        return;
+    }
+
+    // Gradients over the box, then the smaller eigenvalue of the 5 x 5 structure tensor.
+    const int w = x1 - x0 + 1;
+    const int h = y1 - y0 + 1;
+    std::vector<float> ixx(w * h), ixy(w * h), iyy(w * h);
+    for (int y = 0; y < h; ++y) {
+        const uint8_t* row = image.row(y0 + y) + x0;
+        for (int x = 0; x < w; ++x) {
+            const float dx = 0.5f * (row[x + 1] - row[x - 1]);
+            const float dy = 0.5f * (row[x + image.width] - row[x - image.width]);
+            ixx[y * w + x] = dx * dx;
+            ixy[y * w + x] = dx * dy;
+            iyy[y * w + x] = dy * dy;
+        }
+    }
+    const int cellsX = (w + kCellSize - 1) / kCellSize;
+    const int cellsY = (h + kCellSize - 1) / kCellSize;
+    std::vector<std::pair<float, Point2f>> best(cellsX * cellsY, {0.0f, Point2f()});
+    for (int y = 2; y < h - 2; ++y) {
+        for (int x = 2; x < w - 2; ++x) {
+            if (!insideQuad(target.box, static_cast<float>(x0 + x), static_cast<float>(y0 + y))) {
+                continue;
+            }
+            float a = 0.0f, b = 0.0f, c = 0.0f;
+            for (int dy = -2; dy <= 2; ++dy) {
+                for (int dx = -2; dx <= 2; ++dx) {
+                    const int k = (y + dy) * w + x + dx;
+                    a += ixx[k];
+                    b += ixy[k];
+                    c += iyy[k];
+                }
+            }
+            const float response = 0.5f * (a + c - std::sqrt((a - c) * (a - c) + 4.0f * b * b));
+            std::pair<float, Point2f>& cell = best[(y / kCellSize) * cellsX + x / kCellSize];
+            if (response > kMinEigenvalue && response > cell.first) {
+                cell = {response, {static_cast<float>(x0 + x), static_cast<float>(y0 + y)}};
+            }
+        }
+    }
+    std::sort(best.begin(), best.end(),
+              [](const std::pair<float, Point2f>& l, const std::pair<float, Point2f>& r) { return l.first > r.first; });
+    for (const auto& cell : best) {
+        if (cell.first <= 0.0f || static_cast<int>(target.points.size()) >= mOptions.maxPoints) {
+            break;
+        }
+        target.points.push_back(cell.second);
+    }
+}
+
+bool SignTracker::start(const VideoFrame& frame, const std::vector<BoundingBox>& boxes) {
+    if (!frame.isValid()) {
+        reset();
+        return false;
+    }
+    return start(ownPyramid(frame), boxes);
+}
+
+bool SignTracker::start(const ImagePyramid& pyramid, const std::vector<BoundingBox>& boxes) {
+    reset();
+    if (pyramid.empty() || boxes.empty()) {
+        return false;
+    }
+    const std::vector<GrayView> levels = trackingLevels(pyramid);
+    const float scaleX = static_cast<float>(levels[0].width) / pyramid.inputWidth();
+    const float scaleY = static_cast<float>(levels[0].height) / pyramid.inputHeight();
+    for (const BoundingBox& box : boxes) {
+        Target target;
+        const Point2f corners[4] = {{box.topLeftX, box.topLeftY}, {box.topRightX, box.topRightY},
+                                    {box.bottomRightX, box.bottomRightY}, {box.bottomLeftX, box.bottomLeftY}};
+        for (int i = 0; i < 4; ++i) {
+            target.box[i] = {corners[i].x * scaleX - 0.5f, corners[i].y * scaleY - 0.5f};
+        }
+        seed(target, levels[0]);
+        if (static_cast<int>(target.points.size()) < mOptions.minPoints) {
+            reset();
+            return false;
+        }
+        mTargets.push_back(std::move(target));
+    }
+    keep(levels);
+    return true;
+}
+
+bool SignTracker::track(const VideoFrame& frame, std::vector<BoundingBox>& boxes) {
+    if (!isTracking() || !frame.isValid()) {
+        reset();
+        return false;
+    }
+    return track(ownPyramid(frame), boxes);
+}
+
+bool SignTracker::track(const ImagePyramid& pyramid, std::vector<BoundingBox>& boxes) {
+    if (!isTracking() || pyramid.empty()) {
+        reset();
+        return false;
+    }
+    const std::vector<GrayView> current = trackingLevels(pyramid);
+    std::vector<GrayView> previous(mPrevious.begin(), mPrevious.end());
+    if (current.size() != previous.size() || current[0].width != previous[0].width ||
+        current[0].height != previous[0].height) {
+        reset();
+        return false;
+    }
+
+    const GrayView& image = current[0];
+    const float toInputX = static_cast<float>(pyramid.inputWidth()) / image.width;
+    const float toInputY = static_cast<float>(pyramid.inputHeight()) / image.height;
+    RansacOptions ransac;
+    ransac.threshold = kRansacThreshold;
+    ransac.maxIterations = 200;
+    std::vector<Point2f> from;
+    std::vector<Point2f> to;
+    std::vector<uint8_t> inliers;
+    boxes.resize(mTargets.size());
+    for (size_t t = 0; t < mTargets.size(); ++t) {
+        Target& target = mTargets[t];
+        from.clear();
+        to.clear();
+        for (const Point2f& point : target.points) {
+            Point2f moved;
+            if (trackPoint(previous, current, mOptions.windowRadius, mOptions.maxResidual, point, moved)) {
+                from.push_back(point);
+                to.push_back(moved);
+            }
+        }
+        Homography motion;
+        if (static_cast<int>(from.size()) < mOptions.minPoints ||
+            findHomographyRansac(from, to, ransac, motion, inliers) < mOptions.minPoints) {
+            reset();
+            return false;
+        }
+
+        Point2f box[4];
+        for (int i = 0; i < 4; ++i) {
+            box[i] = motion.map(target.box[i]);
+        }
+        // A box that collapsed, blew up or left the frame is a lost sign, not a moved one.
+        const double area = quadArea(box);
+        const double previousArea = quadArea(target.box);
+        const bool visible = std::any_of(std::begin(box), std::end(box), [&](const Point2f& p) {
+            return p.x >= 0.0f && p.y >= 0.0f && p.x < image.width && p.y < image.height;
+        });
+        if (!visible || area < 0.5 * previousArea || area > 2.0 * previousArea) {
+            reset();
+            return false;
+        }
+        std::copy(std::begin(box), std::end(box), target.box);
+        target.points.clear();
+        for (size_t i = 0; i < to.size(); ++i) {
+            if (inliers[i]) {
+                target.points.push_back(to[i]);
+            }
+        }
+        if (static_cast<int>(target.points.size()) * 2 < mOptions.maxPoints) {
+            seed(target, image);
+            if (static_cast<int>(target.points.size()) < mOptions.minPoints) {
+                reset();
+                return false;
+            }
+        }
+
+        auto toFrame = [&](const Point2f& p) { return Point2f{(p.x + 0.5f) * toInputX, (p.y + 0.5f) * toInputY}; };
+        const Point2f topLeft = toFrame(box[0]);
+        const Point2f topRight = toFrame(box[1]);
+        const Point2f bottomRight = toFrame(box[2]);
+        const Point2f bottomLeft = toFrame(box[3]);
+        boxes[t] = {topLeft.x, topLeft.y, topRight.x, topRight.y,
+                    bottomLeft.x, bottomLeft.y, bottomRight.x, bottomRight.y};
+    }
+    keep(current);
+    return true;
+}
+
+void SignTracker::reset() {
+    mTargets.clear();
+}
+
+TrackedSearch::TrackedSearch(const TrackingOptions& options) : mOptions(options), mTracker(options) {}
+
+ErrorCode TrackedSearch::process(OnDeviceIR& onDeviceIR, const VideoFrame& frame, std::vector<SearchResult>& results,
+                                 bool* searched) {
+    ++mCounters.frames;
+    if (!frame.isValid()) {
+        reset();
+        return ErrorCode::SEARCH_ERROR_IMAGE_TOO_SMALL;
+    }
+    // One pyramid for the frame, read by both the tracker and the search.
+    const FeatureExtractor& extractor = onDeviceIR.extractor();
+    mPyramid.build(frame, extractor.reductionFactor(frame.width, frame.height), extractor.pyramidOptions());
+
+    bool tracking = false;
+    if (mTracker.isTracking()) {
+        tracking = mTracker.track(mPyramid, mBoxes);
+        if (tracking) {
+            for (size_t i = 0; i < mResults.size(); ++i) {
+                mResults[i].matchBoundingBox = mBoxes[i];
+            }
+        } else {
+            ++mCounters.losses;
+        }
+    }
+    if (searched) {
+        *searched = false;
+    }
+    if (tracking && (mOptions.refreshFrames <= 0 || mSinceSearch < mOptions.refreshFrames)) {
+        ++mSinceSearch;
+        ++mCounters.tracked;
+        results = mResults;
+        return ErrorCode::SUCCESS;
+    }
+
+    if (searched) {
+        *searched = true;
+    }
+    ++mCounters.searches;
+    mSinceSearch = 0;
+    const ErrorCode error = onDeviceIR.searchWithPyramid(mPyramid, results);
+    if (error != ErrorCode::SUCCESS) {
+        reset();
+        return error;
+    }
+    // A refresh can miss a sign it found before, e.g. under motion blur: a
+    // track that still holds survives one empty refresh, not two in a row.
+    if (results.empty() && tracking && !mMissedRefresh) {
+        mMissedRefresh = true;
+        ++mCounters.tracked;
+        results = mResults;
+        return error;
+    }
+    mMissedRefresh = false;
+    mResults = results;
+    mBoxes.clear();
+    for (const SearchResult& result : mResults) {
+        mBoxes.push_back(result.matchBoundingBox);
+    }
+    // Nothing found, or a sign too plain to follow: the next frame is searched again.
+    if (mBoxes.empty() || !mTracker.start(mPyramid, mBoxes)) {
+        mTracker.reset();
+    }
+    return error;
+}
+
+void TrackedSearch::reset() {
+    mTracker.reset();
+    mResults.clear();
+    mBoxes.clear();
+    mSinceSearch = 0;
+    mMissedRefresh = false;
+}
+
+}
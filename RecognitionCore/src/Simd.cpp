@@ -0,0 +1,59 @@
+//
+//  Simd.cpp
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "rsr/Simd.h"
+
+#include <initializer_list>
+
+namespace rsr {
+
+bool isSimdLevelSupported(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::SCALAR:
+            return true;
+#if defined(RSR_HAVE_X86_KERNELS)
+        case SimdLevel::SSE41:
+            return __builtin_cpu_supports("sse4.1");
+        case SimdLevel::AVX2:
+            return __builtin_cpu_supports("avx2");
+        case SimdLevel::AVX512:
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("avx512f") &&
+                   __builtin_cpu_supports("avx512vpopcntdq");
+#endif
+#if defined(RSR_HAVE_NEON_KERNELS)
+        case SimdLevel::NEON:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+SimdLevel bestSimdLevel() {
+    static const SimdLevel level = [] {
+        for (SimdLevel candidate : {SimdLevel::AVX512, SimdLevel::AVX2, SimdLevel::SSE41, SimdLevel::NEON}) {
+            if (isSimdLevelSupported(candidate)) {
+                return candidate;
+            }
+        }
+        return SimdLevel::SCALAR;
+    }();
+    return level;
+}
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::SCALAR: return "scalar";
+        case SimdLevel::SSE41: return "sse4.1";
+        case SimdLevel::AVX2: return "avx2";
+        case SimdLevel::AVX512: return "avx512";
+        case SimdLevel::NEON: return "neon";
+    }
+    return "unknown";
+}
+
+}
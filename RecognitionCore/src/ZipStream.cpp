@@ -0,0 +1,224 @@
+//
+//  ZipStream.cpp
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "rsr/ZipStream.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace rsr {
+
+namespace {
+
+constexpr uint32_t kLocalHeaderSignature = 0x04034b50;
+constexpr uint32_t kCentralHeaderSignature = 0x02014b50;
+constexpr uint32_t kEndOfCentralDirectorySignature = 0x06054b50;
+constexpr uint32_t kDataDescriptorSignature = 0x08074b50;
+constexpr size_t kLocalHeaderSize = 30;
+
+constexpr uint16_t kFlagEncrypted = 1 << 0;
+constexpr uint16_t kFlagDataDescriptor = 1 << 3;
+constexpr uint16_t kMethodStored = 0;
+constexpr uint16_t kMethodDeflated = 8;
+
+constexpr size_t kReadSize = 256 * 1024;
+// Larger entries are treated as damage rather than allocated.
+constexpr size_t kMaxEntrySize = size_t(1) << 30;
+// Header sizes are not trusted with more than this before the data backs them up.
+constexpr size_t kInitialEntryCapacity = 1024 * 1024;
+
+uint16_t read16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t read32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) |
+           (static_cast<uint32_t>(p[3]) << 24);
+}
+
+}
+
+ZipStreamReader::~ZipStreamReader() {
+    if (mFile) {
+        std::fclose(mFile);
+    }
+}
+
+ErrorCode ZipStreamReader::open(const std::string& path) {
+    if (mFile) {
+        std::fclose(mFile);
+    }
+    mFile = std::fopen(path.c_str(), "rb");
+    if (!mFile) {
+        return ErrorCode::COLLECTION_NOT_FOUND;
+    }
+    std::fseek(mFile, 0, SEEK_END);
+    const long size = std::ftell(mFile);
+    std::fseek(mFile, 0, SEEK_SET);
+    mSize = size > 0 ? static_cast<uint64_t>(size) : 0;
+    mConsumed = 0;
+    mBuffer.resize(kReadSize);
+    mBegin = 0;
+    mEnd = 0;
+    mFinished = false;
+    return ErrorCode::SUCCESS;
+}
+
+float ZipStreamReader::progress() const {
+    return mSize == 0 ? 0.0f : static_cast<float>(static_cast<double>(mConsumed) / mSize);
+}
+
+bool ZipStreamReader::fill(size_t count) {
+    if (available() >= count) {
+        return true;
+    }
+    if (!mFile) {
+        return false;
+    }
+    std::memmove(mBuffer.data(), data(), available());
+    mEnd = available();
+    mBegin = 0;
+    if (mBuffer.size() < count) {
+        mBuffer.resize(count);
+    }
+    while (mEnd < count) {
+        const size_t n = std::fread(mBuffer.data() + mEnd, 1, mBuffer.size() - mEnd, mFile);
+        if (n == 0) {
+            return false;
+        }
+        mEnd += n;
+    }
+    return true;
+}
+
+ErrorCode ZipStreamReader::next(std::string& name, std::vector<uint8_t>& contents) {
+    name.clear();
+    contents.clear();
+    while (!mFinished) {
+        if (!fill(4)) {
+            return ErrorCode::COLLECTION_MANAGER_EXTRACT_ERROR;
+        }
+        const uint32_t signature = read32(data());
+        if (signature == kCentralHeaderSignature || signature == kEndOfCentralDirectorySignature) {
+            // The central directory repeats what the local headers said.
+            mFinished = true;
+            mConsumed = mSize;
+            break;
+        }
+        if (signature != kLocalHeaderSignature || !fill(kLocalHeaderSize)) {
+            return ErrorCode::COLLECTION_MANAGER_EXTRACT_ERROR;
+        }
+        const uint8_t* header = data();
+        const uint16_t flags = read16(header + 6);
+        const uint16_t method = read16(header + 8);
+        uint32_t crc = read32(header + 14);
+        const uint32_t compressedSize = read32(header + 18);
+        const uint32_t uncompressedSize = read32(header + 22);
+        const uint16_t nameLength = read16(header + 26);
+        const uint16_t extraLength = read16(header + 28);
+        const bool deferredSizes = (flags & kFlagDataDescriptor) != 0;
+        if ((flags & kFlagEncrypted) || (method != kMethodStored && method != kMethodDeflated) ||
+            compressedSize > kMaxEntrySize || uncompressedSize > kMaxEntrySize ||
+            (deferredSizes && method == kMethodStored)) {
+            return ErrorCode::COLLECTION_MANAGER_EXTRACT_ERROR;
+        }
+        consume(kLocalHeaderSize);
+        if (!fill(size_t(nameLength) + extraLength)) {
+            return ErrorCode::COLLECTION_MANAGER_EXTRACT_ERROR;
+        }
+        name.assign(reinterpret_cast<const char*>(data()), nameLength);
+        consume(size_t(nameLength) + extraLength);
+
+        const ErrorCode error = method == kMethodStored ? copyEntry(compressedSize, contents)
+                                                        : inflateEntry(deferredSizes ? 0 : uncompressedSize, contents);
+        if (error != ErrorCode::SUCCESS) {
+            return error;
+        }
+        if (deferredSizes) {
+            // Optional signature, then crc, compressed and uncompressed size.
+            if (!fill(12)) {
+                return ErrorCode::COLLECTION_MANAGER_EXTRACT_ERROR;
+            }
+            const bool hasSignature = read32(data()) == kDataDescriptorSignature;
+            if (hasSignature && !fill(16)) {
+                return ErrorCode::COLLECTION_MANAGER_EXTRACT_ERROR;
+            }
+            crc = read32(data() + (hasSignature ? 4 : 0));
+            consume(hasSignature ? 16 : 12);
+        } else if (contents.size() != uncompressedSize) {
+            return ErrorCode::COLLECTION_MANAGER_EXTRACT_ERROR;
+        }
+        if (crc32(0L, contents.data(), static_cast<uInt>(contents.size())) != crc) {
+            return ErrorCode::COLLECTION_MANAGER_EXTRACT_ERROR;
+        }
+        if (!name.empty() && name.back() != '/') {
+            return ErrorCode::SUCCESS;
+        }
+    }
+    name.clear();
+    contents.clear();
+    return ErrorCode::SUCCESS;
+}
+
+ErrorCode ZipStreamReader::copyEntry(uint32_t size, std::vector<uint8_t>& contents) {
+    contents.clear();
+    contents.reserve(std::min<size_t>(size, kInitialEntryCapacity));
+    while (contents.size() < size) {
+        if (!fill(1)) {
+            return ErrorCode::COLLECTION_MANAGER_EXTRACT_ERROR;
+        }
+        const size_t n = std::min(available(), size - contents.size());
+        contents.insert(contents.end(), data(), data() + n);
+        consume(n);
+    }
+    return ErrorCode::SUCCESS;
+}
+
+ErrorCode ZipStreamReader::inflateEntry(uint32_t expectedSize, std::vector<uint8_t>& contents) {
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    // Negative window bits: raw deflate data without a zlib header.
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+        return ErrorCode::COLLECTION_MANAGER_EXTRACT_ERROR;
+    }
+    contents.resize(std::min<size_t>(std::max<size_t>(expectedSize, 64 * 1024), kInitialEntryCapacity));
+    size_t produced = 0;
+    int status = Z_OK;
+    while (status != Z_STREAM_END) {
+        if (available() == 0 && !fill(1)) {
+            break;
+        }
+        if (produced == contents.size()) {
+            if (contents.size() >= kMaxEntrySize) {
+                break;
+            }
+            contents.resize(contents.size() * 2);
+        }
+        stream.next_in = const_cast<Bytef*>(data());
+        stream.avail_in = static_cast<uInt>(std::min<size_t>(available(), UINT32_MAX));
+        stream.next_out = contents.data() + produced;
+        stream.avail_out = static_cast<uInt>(std::min<size_t>(contents.size() - produced, UINT32_MAX));
+        const uInt inputBefore = stream.avail_in;
+        const uInt outputBefore = stream.avail_out;
+        status = inflate(&stream, Z_NO_FLUSH);
+        consume(inputBefore - stream.avail_in);
+        produced += outputBefore - stream.avail_out;
+        if (status == Z_BUF_ERROR) {
+            // No progress possible with this input; more is read on the next turn.
+            status = Z_OK;
+        } else if (status != Z_OK && status != Z_STREAM_END) {
+            break;
+        }
+    }
+    inflateEnd(&stream);
+    contents.resize(produced);
+    return status == Z_STREAM_END ? ErrorCode::SUCCESS : ErrorCode::COLLECTION_MANAGER_EXTRACT_ERROR;
+}
+
+}
@@ -0,0 +1,83 @@
+//
+//  HammingAVX2.cpp
+//  RecognitionCore
+//
+//  Built with -mavx2; only called after the runtime CPU check.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "HammingKernels.h"
+
+#include <immintrin.h>
+
+namespace rsr {
+namespace detail {
+
+namespace {
+
+// Bits set in each byte, looked up a nibble at a time.
+inline __m256i popcountBytes(__m256i v) {
+    const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                           0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    const __m256i low = _mm256_shuffle_epi8(table, _mm256_and_si256(v, nibble));
+    const __m256i high = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+    return _mm256_add_epi8(low, high);
+}
+
+// Differing bits in each 64-bit quarter of the two descriptors.
+inline __m256i quarterDistances(__m256i query, const Descriptor& reference) {
+    const __m256i bits = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(reference.bits));
+    return _mm256_sad_epu8(popcountBytes(_mm256_xor_si256(query, bits)), _mm256_setzero_si256());
+}
+
+// Quarters 0+1 of a, of b, then quarters 2+3 of a, of b.
+inline __m256i halfDistances(__m256i a, __m256i b) {
+    return _mm256_add_epi64(_mm256_unpacklo_epi64(a, b), _mm256_unpackhi_epi64(a, b));
+}
+
+// Distances to 8 consecutive references, as int32 in the order 0 2 1 3 4 6 5 7.
+inline __m256i distances8(__m256i query, const Descriptor* references) {
+    __m256i halves[4];
+    for (int k = 0; k < 4; ++k) {
+        halves[k] = halfDistances(quarterDistances(query, references[2 * k]),
+                                  quarterDistances(query, references[2 * k + 1]));
+    }
+    const __m256i a = _mm256_or_si256(halves[0], _mm256_slli_epi64(halves[1], 32));
+    const __m256i b = _mm256_or_si256(halves[2], _mm256_slli_epi64(halves[3], 32));
+    return _mm256_add_epi32(_mm256_permute2x128_si256(a, b, 0x20), _mm256_permute2x128_si256(a, b, 0x31));
+}
+
+}
+
+void nearestTwoAVX2(const Descriptor& query, const Descriptor* references, size_t count, int image,
+                    int firstReference, NearestNeighbours& neighbours) {
+    const size_t vectorCount = count / 8 * 8;
+    if (vectorCount > 0) {
+        const __m256i q = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(query.bits));
+        __m256i best = _mm256_set1_epi32(INT_MAX);
+        __m256i second = best;
+        __m256i bestIndex = _mm256_set1_epi32(-1);
+        __m256i index = _mm256_add_epi32(_mm256_set1_epi32(firstReference), _mm256_setr_epi32(0, 2, 1, 3, 4, 6, 5, 7));
+        const __m256i step = _mm256_set1_epi32(8);
+        for (size_t r = 0; r < vectorCount; r += 8) {
+            const __m256i d = distances8(q, references + r);
+            const __m256i closer = _mm256_cmpgt_epi32(best, d);
+            second = _mm256_min_epi32(second, _mm256_max_epi32(best, d));
+            bestIndex = _mm256_blendv_epi8(bestIndex, index, closer);
+            best = _mm256_min_epi32(best, d);
+            index = _mm256_add_epi32(index, step);
+        }
+        alignas(32) int lanes[3][8];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes[0]), best);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes[1]), second);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes[2]), bestIndex);
+        mergeLanes(lanes[0], lanes[1], lanes[2], 8, image, neighbours);
+    }
+    nearestTwoScalar(query, references + vectorCount, count - vectorCount, image,
+                     firstReference + static_cast<int>(vectorCount), neighbours);
+}
+
+}
+}
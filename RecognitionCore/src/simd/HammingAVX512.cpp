@@ -0,0 +1,73 @@
+//
+//  HammingAVX512.cpp
+//  RecognitionCore
+//
+//  Built with -mavx512f -mavx512vpopcntdq; only called after the runtime CPU check.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "HammingKernels.h"
+
+#include <immintrin.h>
+
+namespace rsr {
+namespace detail {
+
+namespace {
+
+// Per 128-bit lane of two registers of two references each: quarters 0+1 of
+// the first register's reference, of the second's, then quarters 2+3.
+inline __m512i halfDistances(__m512i query, const Descriptor* a, const Descriptor* b) {
+    const __m512i x = _mm512_popcnt_epi64(_mm512_xor_si512(query, _mm512_loadu_si512(a)));
+    const __m512i y = _mm512_popcnt_epi64(_mm512_xor_si512(query, _mm512_loadu_si512(b)));
+    return _mm512_add_epi64(_mm512_unpacklo_epi64(x, y), _mm512_unpackhi_epi64(x, y));
+}
+
+// Distances to 16 consecutive references, as int32 in the order
+// 0 4 2 6 1 5 3 7, then the same for 8 to 15.
+inline __m512i distances16(__m512i query, const Descriptor* references) {
+    __m512i packed[2];
+    for (int k = 0; k < 2; ++k) {
+        const Descriptor* r = references + 8 * k;
+        const __m512i low = halfDistances(query, r, r + 2);
+        const __m512i high = halfDistances(query, r + 4, r + 6);
+        packed[k] = _mm512_or_si512(low, _mm512_slli_epi64(high, 32));
+    }
+    return _mm512_add_epi32(_mm512_shuffle_i64x2(packed[0], packed[1], _MM_SHUFFLE(2, 0, 2, 0)),
+                            _mm512_shuffle_i64x2(packed[0], packed[1], _MM_SHUFFLE(3, 1, 3, 1)));
+}
+
+}
+
+void nearestTwoAVX512(const Descriptor& query, const Descriptor* references, size_t count, int image,
+                      int firstReference, NearestNeighbours& neighbours) {
+    const size_t vectorCount = count / 16 * 16;
+    if (vectorCount > 0) {
+        const __m512i q = _mm512_broadcast_i64x4(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(query.bits)));
+        __m512i best = _mm512_set1_epi32(INT_MAX);
+        __m512i second = best;
+        __m512i bestIndex = _mm512_set1_epi32(-1);
+        __m512i index = _mm512_add_epi32(_mm512_set1_epi32(firstReference),
+                                         _mm512_setr_epi32(0, 4, 2, 6, 1, 5, 3, 7, 8, 12, 10, 14, 9, 13, 11, 15));
+        const __m512i step = _mm512_set1_epi32(16);
+        for (size_t r = 0; r < vectorCount; r += 16) {
+            const __m512i d = distances16(q, references + r);
+            const __mmask16 closer = _mm512_cmpgt_epi32_mask(best, d);
+            second = _mm512_min_epi32(second, _mm512_max_epi32(best, d));
+            bestIndex = _mm512_mask_mov_epi32(bestIndex, closer, index);
+            best = _mm512_min_epi32(best, d);
+            index = _mm512_add_epi32(index, step);
+        }
+        alignas(64) int lanes[3][16];
+        _mm512_store_si512(lanes[0], best);
+        _mm512_store_si512(lanes[1], second);
+        _mm512_store_si512(lanes[2], bestIndex);
+        mergeLanes(lanes[0], lanes[1], lanes[2], 16, image, neighbours);
+    }
+    nearestTwoScalar(query, references + vectorCount, count - vectorCount, image,
+                     firstReference + static_cast<int>(vectorCount), neighbours);
+}
+
+}
+}
@@ -0,0 +1,43 @@
+//
+//  HammingKernels.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <cstddef>
+
+#include "rsr/DescriptorIndex.h"
+
+namespace rsr {
+namespace detail {
+
+/**
+ * Scalar reference: compares the query with references [0, count) in order.
+ * Vectorized kernels call it for the references left over by their last full step.
+ */
+void nearestTwoScalar(const Descriptor& query, const Descriptor* references, size_t count, int image,
+                      int firstReference, NearestNeighbours& neighbours);
+
+/**
+ * Folds the per-lane best, second best and best index of a vectorized kernel
+ * into neighbours, as if the references had been compared one by one after
+ * those neighbours already saw. Lanes with a best of INT_MAX saw nothing.
+ */
+void mergeLanes(const int* best, const int* second, const int* index, int lanes, int image,
+                NearestNeighbours& neighbours);
+
+/**
+ * Vectorized kernels; same results as the scalar one, ties included.
+ */
+void nearestTwoAVX2(const Descriptor& query, const Descriptor* references, size_t count, int image,
+                    int firstReference, NearestNeighbours& neighbours);
+void nearestTwoAVX512(const Descriptor& query, const Descriptor* references, size_t count, int image,
+                      int firstReference, NearestNeighbours& neighbours);
+void nearestTwoNEON(const Descriptor& query, const Descriptor* references, size_t count, int image,
+                    int firstReference, NearestNeighbours& neighbours);
+
+}
+}
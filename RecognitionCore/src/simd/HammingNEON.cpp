@@ -0,0 +1,65 @@
+//
+//  HammingNEON.cpp
+//  RecognitionCore
+//
+//  AArch64 only; NEON is part of the baseline there so no runtime check is needed.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "HammingKernels.h"
+
+#include <arm_neon.h>
+
+namespace rsr {
+namespace detail {
+
+namespace {
+
+// Differing bits in each byte pair of the two descriptors (at most 16 per byte).
+inline uint8x16_t byteDistances(uint8x16_t queryLow, uint8x16_t queryHigh, const Descriptor& reference) {
+    const uint8_t* bits = reinterpret_cast<const uint8_t*>(reference.bits);
+    return vaddq_u8(vcntq_u8(veorq_u8(queryLow, vld1q_u8(bits))), vcntq_u8(veorq_u8(queryHigh, vld1q_u8(bits + 16))));
+}
+
+}
+
+void nearestTwoNEON(const Descriptor& query, const Descriptor* references, size_t count, int image,
+                    int firstReference, NearestNeighbours& neighbours) {
+    const size_t vectorCount = count / 4 * 4;
+    if (vectorCount > 0) {
+        const uint8_t* queryBits = reinterpret_cast<const uint8_t*>(query.bits);
+        const uint8x16_t queryLow = vld1q_u8(queryBits);
+        const uint8x16_t queryHigh = vld1q_u8(queryBits + 16);
+        uint32x4_t best = vdupq_n_u32(INT_MAX);
+        uint32x4_t second = best;
+        uint32x4_t bestIndex = vdupq_n_u32(static_cast<uint32_t>(-1));
+        const uint32_t offsets[4] = {0, 1, 2, 3};
+        uint32x4_t index = vaddq_u32(vdupq_n_u32(static_cast<uint32_t>(firstReference)), vld1q_u32(offsets));
+        const uint32x4_t step = vdupq_n_u32(4);
+        for (size_t r = 0; r < vectorCount; r += 4) {
+            // Two rounds of pairwise byte sums leave four bytes per reference, then widen and add.
+            const uint8x16_t sums =
+                vpaddq_u8(vpaddq_u8(byteDistances(queryLow, queryHigh, references[r]),
+                                    byteDistances(queryLow, queryHigh, references[r + 1])),
+                          vpaddq_u8(byteDistances(queryLow, queryHigh, references[r + 2]),
+                                    byteDistances(queryLow, queryHigh, references[r + 3])));
+            const uint32x4_t d = vpaddlq_u16(vpaddlq_u8(sums));
+            const uint32x4_t closer = vcltq_u32(d, best);
+            second = vminq_u32(second, vmaxq_u32(best, d));
+            bestIndex = vbslq_u32(closer, index, bestIndex);
+            best = vminq_u32(best, d);
+            index = vaddq_u32(index, step);
+        }
+        int lanes[3][4];
+        vst1q_s32(lanes[0], vreinterpretq_s32_u32(best));
+        vst1q_s32(lanes[1], vreinterpretq_s32_u32(second));
+        vst1q_s32(lanes[2], vreinterpretq_s32_u32(bestIndex));
+        mergeLanes(lanes[0], lanes[1], lanes[2], 4, image, neighbours);
+    }
+    nearestTwoScalar(query, references + vectorCount, count - vectorCount, image,
+                     firstReference + static_cast<int>(vectorCount), neighbours);
+}
+
+}
+}
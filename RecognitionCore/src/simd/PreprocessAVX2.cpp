@@ -0,0 +1,83 @@
+//
+//  PreprocessAVX2.cpp
+//  RecognitionCore
+//
+//  Built with -mavx2; only called after the runtime CPU check.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "PreprocessKernels.h"
+
+#include <immintrin.h>
+
+namespace rsr {
+namespace detail {
+
+namespace {
+
+// _mm256_hadd_epi32 works within 128-bit lanes; this restores element order
+// so that the result is the pairwise sums of a followed by those of b.
+inline __m256i haddOrdered(__m256i a, __m256i b) {
+    return _mm256_permute4x64_epi64(_mm256_hadd_epi32(a, b), 0xD8);
+}
+
+// Weighted sum 29 B + 150 G + 77 R of 8 consecutive BGRA pixels, as int32 in order.
+inline __m256i luma8(const uint8_t* p, __m256i weights) {
+    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    const __m256i lo = _mm256_madd_epi16(_mm256_cvtepu8_epi16(_mm256_castsi256_si128(v)), weights);
+    const __m256i hi = _mm256_madd_epi16(_mm256_cvtepu8_epi16(_mm256_extracti128_si256(v, 1)), weights);
+    return haddOrdered(lo, hi);
+}
+
+inline void store8(uint8_t* out, __m256i values) {
+    const __m128i words = _mm_packus_epi32(_mm256_castsi256_si128(values), _mm256_extracti128_si256(values, 1));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(words, words));
+}
+
+}
+
+void reduceBGRAToGrayAVX2(const VideoFrame& frame, int factor, GrayImage& gray) {
+    const __m256i weights = _mm256_setr_epi16(kWeightB, kWeightG, kWeightR, 0, kWeightB, kWeightG, kWeightR, 0,
+                                              kWeightB, kWeightG, kWeightR, 0, kWeightB, kWeightG, kWeightR, 0);
+    const int shift = factor == 1 ? 8 : factor == 2 ? 10 : 12;
+    const __m256i bias = _mm256_set1_epi32(1 << (shift - 1));
+    const int pixelsPerStep = 8 * factor;  // input pixels per row that make 8 outputs
+    const int vectorWidth = (frame.width / pixelsPerStep) * 8;
+    const int outWidth = gray.width < vectorWidth ? gray.width : vectorWidth;
+
+    for (int y = 0; y < gray.height; ++y) {
+        const uint8_t* rows[4];
+        for (int r = 0; r < factor; ++r) {
+            rows[r] = frame.bgraBytes + static_cast<size_t>(y * factor + r) * frame.bytesPerRow;
+        }
+        uint8_t* out = gray.row(y);
+        int x = 0;
+        for (; x + 8 <= outWidth; x += 8) {
+            const size_t offset = static_cast<size_t>(x) * factor * 4;
+            __m256i sum;
+            if (factor == 1) {
+                sum = luma8(rows[0] + offset, weights);
+            } else if (factor == 2) {
+                const __m256i a = _mm256_add_epi32(luma8(rows[0] + offset, weights), luma8(rows[1] + offset, weights));
+                const __m256i b = _mm256_add_epi32(luma8(rows[0] + offset + 32, weights),
+                                                   luma8(rows[1] + offset + 32, weights));
+                sum = haddOrdered(a, b);
+            } else {
+                __m256i s[4];
+                for (int k = 0; k < 4; ++k) {
+                    s[k] = _mm256_add_epi32(_mm256_add_epi32(luma8(rows[0] + offset + 32 * k, weights),
+                                                             luma8(rows[1] + offset + 32 * k, weights)),
+                                            _mm256_add_epi32(luma8(rows[2] + offset + 32 * k, weights),
+                                                             luma8(rows[3] + offset + 32 * k, weights)));
+                }
+                sum = haddOrdered(haddOrdered(s[0], s[1]), haddOrdered(s[2], s[3]));
+            }
+            store8(out + x, _mm256_srli_epi32(_mm256_add_epi32(sum, bias), shift));
+        }
+        reduceRowScalar(frame, factor, y, x, gray);
+    }
+}
+
+}
+}
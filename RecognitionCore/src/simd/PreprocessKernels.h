@@ -0,0 +1,37 @@
+//
+//  PreprocessKernels.h
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <cstdint>
+
+#include "rsr/Image.h"
+#include "rsr/VideoFrame.h"
+
+namespace rsr {
+namespace detail {
+
+// Luminance weights in 8-bit fixed point, shared by every kernel.
+constexpr int kWeightB = 29;
+constexpr int kWeightG = 150;
+constexpr int kWeightR = 77;
+
+/**
+ * Scalar reference: fills columns [xBegin, gray.width) of output row y.
+ * Vectorized kernels call it for the columns left over by their last full vector.
+ */
+void reduceRowScalar(const VideoFrame& frame, int factor, int y, int xBegin, GrayImage& gray);
+
+/**
+ * Vectorized kernels for factors 1, 2 and 4. gray is already sized.
+ */
+void reduceBGRAToGraySSE41(const VideoFrame& frame, int factor, GrayImage& gray);
+void reduceBGRAToGrayAVX2(const VideoFrame& frame, int factor, GrayImage& gray);
+void reduceBGRAToGrayNEON(const VideoFrame& frame, int factor, GrayImage& gray);
+
+}
+}
@@ -0,0 +1,81 @@
+//
+//  PreprocessNEON.cpp
+//  RecognitionCore
+//
+//  AArch64 only; NEON is part of the baseline there so no runtime check is needed.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "PreprocessKernels.h"
+
+#include <arm_neon.h>
+
+namespace rsr {
+namespace detail {
+
+namespace {
+
+// Weighted sums of 16 BGRA pixels; every pixel sum fits in 16 bits (max 65280).
+inline void luma16(const uint8_t* p, uint16x8_t& lo, uint16x8_t& hi) {
+    const uint8x16x4_t v = vld4q_u8(p);
+    const uint8x8_t wb = vdup_n_u8(kWeightB);
+    const uint8x8_t wg = vdup_n_u8(kWeightG);
+    const uint8x8_t wr = vdup_n_u8(kWeightR);
+    lo = vmull_u8(vget_low_u8(v.val[0]), wb);
+    lo = vmlal_u8(lo, vget_low_u8(v.val[1]), wg);
+    lo = vmlal_u8(lo, vget_low_u8(v.val[2]), wr);
+    hi = vmull_u8(vget_high_u8(v.val[0]), wb);
+    hi = vmlal_u8(hi, vget_high_u8(v.val[1]), wg);
+    hi = vmlal_u8(hi, vget_high_u8(v.val[2]), wr);
+}
+
+}
+
+void reduceBGRAToGrayNEON(const VideoFrame& frame, int factor, GrayImage& gray) {
+    const int outPerStep = 16 / factor;  // one 16-pixel load per row makes this many outputs
+    const int vectorWidth = (frame.width / 16) * outPerStep;
+    const int outWidth = gray.width < vectorWidth ? gray.width : vectorWidth;
+
+    for (int y = 0; y < gray.height; ++y) {
+        const uint8_t* rows[4];
+        for (int r = 0; r < factor; ++r) {
+            rows[r] = frame.bgraBytes + static_cast<size_t>(y * factor + r) * frame.bytesPerRow;
+        }
+        uint8_t* out = gray.row(y);
+        int x = 0;
+        for (; x + outPerStep <= outWidth; x += outPerStep) {
+            const size_t offset = static_cast<size_t>(x) * factor * 4;
+            uint16x8_t lo;
+            uint16x8_t hi;
+            if (factor == 1) {
+                luma16(rows[0] + offset, lo, hi);
+                vst1q_u8(out + x, vcombine_u8(vrshrn_n_u16(lo, 8), vrshrn_n_u16(hi, 8)));
+                continue;
+            }
+            // Horizontal pairs widened to 32 bits, then summed over the rows.
+            uint32x4_t pairsLo = vdupq_n_u32(0);
+            uint32x4_t pairsHi = vdupq_n_u32(0);
+            for (int r = 0; r < factor; ++r) {
+                luma16(rows[r] + offset, lo, hi);
+                pairsLo = vpadalq_u16(pairsLo, lo);
+                pairsHi = vpadalq_u16(pairsHi, hi);
+            }
+            if (factor == 2) {
+                const uint16x4_t a = vrshrn_n_u32(pairsLo, 10);
+                const uint16x4_t b = vrshrn_n_u32(pairsHi, 10);
+                vst1_u8(out + x, vmovn_u16(vcombine_u16(a, b)));
+            } else {
+                const uint32x4_t quads = vpaddq_u32(pairsLo, pairsHi);
+                const uint16x4_t q = vrshrn_n_u32(quads, 12);
+                const uint8x8_t bytes = vmovn_u16(vcombine_u16(q, q));
+                const uint32_t word = vget_lane_u32(vreinterpret_u32_u8(bytes), 0);
+                __builtin_memcpy(out + x, &word, 4);
+            }
+        }
+        reduceRowScalar(frame, factor, y, x, gray);
+    }
+}
+
+}
+}
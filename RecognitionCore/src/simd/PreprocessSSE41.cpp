@@ -0,0 +1,77 @@
+//
+//  PreprocessSSE41.cpp
+//  RecognitionCore
+//
+//  Built with -msse4.1; only called after the runtime CPU check.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include "PreprocessKernels.h"
+
+#include <smmintrin.h>
+
+namespace rsr {
+namespace detail {
+
+namespace {
+
+// Weighted sum 29 B + 150 G + 77 R of 4 consecutive BGRA pixels, as int32.
+inline __m128i luma4(const uint8_t* p, __m128i weights) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    const __m128i lo = _mm_madd_epi16(_mm_cvtepu8_epi16(v), weights);
+    const __m128i hi = _mm_madd_epi16(_mm_cvtepu8_epi16(_mm_srli_si128(v, 8)), weights);
+    return _mm_hadd_epi32(lo, hi);
+}
+
+inline void store4(uint8_t* out, __m128i values) {
+    const __m128i packed = _mm_packus_epi16(_mm_packus_epi32(values, values), _mm_setzero_si128());
+    const int word = _mm_cvtsi128_si32(packed);
+    __builtin_memcpy(out, &word, 4);
+}
+
+}
+
+void reduceBGRAToGraySSE41(const VideoFrame& frame, int factor, GrayImage& gray) {
+    const __m128i weights = _mm_setr_epi16(kWeightB, kWeightG, kWeightR, 0, kWeightB, kWeightG, kWeightR, 0);
+    const int shift = factor == 1 ? 8 : factor == 2 ? 10 : 12;
+    const __m128i bias = _mm_set1_epi32(1 << (shift - 1));
+    const int pixelsPerStep = 4 * factor;  // input pixels per row that make 4 outputs
+    const int vectorWidth = (frame.width / pixelsPerStep) * 4;
+    const int outWidth = gray.width < vectorWidth ? gray.width : vectorWidth;
+
+    for (int y = 0; y < gray.height; ++y) {
+        const uint8_t* rows[4];
+        for (int r = 0; r < factor; ++r) {
+            rows[r] = frame.bgraBytes + static_cast<size_t>(y * factor + r) * frame.bytesPerRow;
+        }
+        uint8_t* out = gray.row(y);
+        int x = 0;
+        for (; x + 4 <= outWidth; x += 4) {
+            const size_t offset = static_cast<size_t>(x) * factor * 4;
+            __m128i sum;
+            if (factor == 1) {
+                sum = luma4(rows[0] + offset, weights);
+            } else if (factor == 2) {
+                const __m128i a = _mm_add_epi32(luma4(rows[0] + offset, weights), luma4(rows[1] + offset, weights));
+                const __m128i b = _mm_add_epi32(luma4(rows[0] + offset + 16, weights),
+                                                luma4(rows[1] + offset + 16, weights));
+                sum = _mm_hadd_epi32(a, b);
+            } else {
+                __m128i s[4];
+                for (int k = 0; k < 4; ++k) {
+                    s[k] = _mm_add_epi32(_mm_add_epi32(luma4(rows[0] + offset + 16 * k, weights),
+                                                       luma4(rows[1] + offset + 16 * k, weights)),
+                                         _mm_add_epi32(luma4(rows[2] + offset + 16 * k, weights),
+                                                       luma4(rows[3] + offset + 16 * k, weights)));
+                }
+                sum = _mm_hadd_epi32(_mm_hadd_epi32(s[0], s[1]), _mm_hadd_epi32(s[2], s[3]));
+            }
+            store4(out + x, _mm_srli_epi32(_mm_add_epi32(sum, bias), shift));
+        }
+        reduceRowScalar(frame, factor, y, x, gray);
+    }
+}
+
+}
+}
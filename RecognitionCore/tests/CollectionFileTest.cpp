@@ -0,0 +1,256 @@
+//
+//  CollectionFileTest.cpp
+//  RecognitionCore
+//
+//  Collection::write and Collection::open: a round trip, files damaged in
+//  the ways open must reject before a search reads past the mapping, and a
+//  damaged stored index, which is rebuilt instead of used.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "TestUtil.h"
+#include "rsr/Collection.h"
+#include "rsr/DescriptorIndex.h"
+
+using namespace rsr;
+
+namespace {
+
+// Offsets in the file header: magic, version, item, image and feature
+// counts, the uuid and name strings, then an offset and size per section.
+constexpr size_t kVersionOffset = 4;
+constexpr size_t kSectionsOffset = 40;
+constexpr int kImagesSection = 2;
+constexpr int kOwnersSection = 5;
+constexpr int kIndexSection = 6;
+constexpr size_t kImageRecordSize = 28;
+constexpr size_t kFeatureCount = 125;
+
+FeatureSet randomFeatures(size_t count, uint32_t seed) {
+    std::mt19937_64 random(seed);
+    FeatureSet features;
+    features.width = 256;
+    features.height = 256;
+    for (size_t i = 0; i < count; ++i) {
+        Keypoint keypoint;
+        keypoint.x = static_cast<float>(random() % 256);
+        keypoint.y = static_cast<float>(random() % 256);
+        features.keypoints.push_back(keypoint);
+        Descriptor descriptor;
+        for (uint64_t& bits : descriptor.bits) {
+            bits = random();
+        }
+        features.descriptors.push_back(descriptor);
+    }
+    return features;
+}
+
+// Three images of two items, 40, 25 and 60 features.
+std::string writeCollection(const std::string& name, const IndexOptions& indexOptions = IndexOptions()) {
+    Collection collection("collection-uuid", "Signs");
+    const Item stop{"stop", "Stop", "http://example.com/stop", "{}"};
+    const Item yield{"yield", "Yield", "", ""};
+    CHECK_EQ(collection.addImageFeatures(stop, "stop-front", randomFeatures(40, 1)), ErrorCode::SUCCESS);
+    CHECK_EQ(collection.addImageFeatures(yield, "yield-front", randomFeatures(25, 2)), ErrorCode::SUCCESS);
+    CHECK_EQ(collection.addImageFeatures(stop, "stop-side", randomFeatures(60, 3)), ErrorCode::SUCCESS);
+    const std::string path = test::temporaryPath(name);
+    CHECK_EQ(collection.write(path, indexOptions), ErrorCode::SUCCESS);
+    return path;
+}
+
+std::vector<uint8_t> readFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void writeFile(const std::string& path, const std::vector<uint8_t>& bytes) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+}
+
+template <typename T>
+T readAt(const std::vector<uint8_t>& bytes, size_t offset) {
+    T value;
+    std::memcpy(&value, bytes.data() + offset, sizeof(value));
+    return value;
+}
+
+template <typename T>
+void writeAt(std::vector<uint8_t>& bytes, size_t offset, T value) {
+    std::memcpy(bytes.data() + offset, &value, sizeof(value));
+}
+
+uint64_t sectionOffset(const std::vector<uint8_t>& bytes, int section) {
+    return readAt<uint64_t>(bytes, kSectionsOffset + section * 16);
+}
+
+ErrorCode openDamaged(const std::string& name, const std::vector<uint8_t>& bytes,
+                      std::shared_ptr<const Collection>* opened = nullptr) {
+    const std::string path = test::temporaryPath(name);
+    writeFile(path, bytes);
+    std::shared_ptr<const Collection> collection;
+    const ErrorCode error = Collection::open(path, collection);
+    CHECK(error == ErrorCode::SUCCESS || !collection);
+    if (opened) {
+        *opened = collection;
+    }
+    return error;
+}
+
+IndexOptions lshOptions() {
+    IndexOptions options;
+    options.type = IndexType::LSH;
+    options.lshTables = 2;
+    options.lshKeyBits = 8;
+    return options;
+}
+
+// Offset in the file of a table of the stored LSH index: its key bits, its
+// bucket offsets, then its entries.
+size_t lshTableOffset(const std::vector<uint8_t>& bytes, int table) {
+    const size_t buckets = size_t(1) << lshOptions().lshKeyBits;
+    const size_t tableSize = lshOptions().lshKeyBits + (buckets + 1 + kFeatureCount) * sizeof(uint32_t);
+    return sectionOffset(bytes, kIndexSection) + 16 + table * tableSize;
+}
+
+// The index create() gives for the collection, serialized.
+std::vector<uint8_t> indexOf(const Collection& collection) {
+    std::vector<uint8_t> data;
+    DescriptorIndex::create(collection, lshOptions())->serialize(data);
+    return data;
+}
+
+}
+
+RSR_TEST(openReadsBackWhatWasWritten) {
+    const std::string path = writeCollection("roundtrip.rsrc");
+    std::shared_ptr<const Collection> opened;
+    CHECK_EQ(Collection::open(path, opened), ErrorCode::SUCCESS);
+    if (!opened) {
+        return;
+    }
+    CHECK(opened->isMapped());
+    CHECK_EQ(opened->uuid(), "collection-uuid");
+    CHECK_EQ(opened->name(), "Signs");
+    CHECK_EQ(opened->items().size(), 2u);
+    CHECK_EQ(opened->items()[0].url, "http://example.com/stop");
+    CHECK_EQ(opened->images().size(), 3u);
+    CHECK_EQ(opened->descriptors().size(), kFeatureCount);
+    CHECK_EQ(opened->images()[2].itemIndex, 0);
+    CHECK_EQ(opened->images()[2].firstFeature, 65u);
+    CHECK_EQ(opened->images()[2].descriptors.size(), 60u);
+    const FeatureSet side = randomFeatures(60, 3);
+    CHECK(std::memcmp(opened->images()[2].descriptors.data(), side.descriptors.data(),
+                      side.descriptors.size() * sizeof(Descriptor)) == 0);
+    for (size_t f = 0; f < opened->featureImages().size(); ++f) {
+        CHECK_EQ(opened->featureImages()[f], f < 40 ? 0u : (f < 65 ? 1u : 2u));
+    }
+}
+
+RSR_TEST(openReportsMissingAndForeignFiles) {
+    std::shared_ptr<const Collection> collection;
+    CHECK_EQ(Collection::open(test::temporaryPath("missing.rsrc"), collection), ErrorCode::COLLECTION_NOT_FOUND);
+    CHECK_EQ(openDamaged("empty.rsrc", std::vector<uint8_t>()), ErrorCode::COLLECTION_INVALID);
+    CHECK_EQ(openDamaged("text.rsrc", std::vector<uint8_t>(4096, 'x')), ErrorCode::COLLECTION_INVALID);
+}
+
+RSR_TEST(openRejectsOtherFormatVersions) {
+    std::vector<uint8_t> bytes = readFile(writeCollection("versions.rsrc"));
+    const uint32_t version = readAt<uint32_t>(bytes, kVersionOffset);
+    writeAt<uint32_t>(bytes, kVersionOffset, version - 1);
+    CHECK_EQ(openDamaged("older.rsrc", bytes), ErrorCode::COLLECTION_BUNDLE_VERSION_IS_OLD);
+    writeAt<uint32_t>(bytes, kVersionOffset, version + 1);
+    CHECK_EQ(openDamaged("newer.rsrc", bytes), ErrorCode::COLLECTION_BUNDLE_SDK_VERSION_IS_OLD);
+}
+
+RSR_TEST(openRejectsTruncatedFiles) {
+    std::vector<uint8_t> bytes = readFile(writeCollection("truncated.rsrc"));
+    bytes.resize(sectionOffset(bytes, kOwnersSection) + 8);
+    CHECK_EQ(openDamaged("truncated-owners.rsrc", bytes), ErrorCode::COLLECTION_INVALID);
+}
+
+RSR_TEST(openRejectsImagesThatDoNotTileTheFeatures) {
+    std::vector<uint8_t> bytes = readFile(writeCollection("tiling.rsrc"));
+    // firstFeature of the second image, one past where the first ends.
+    const size_t secondImage = sectionOffset(bytes, kImagesSection) + kImageRecordSize;
+    writeAt<uint32_t>(bytes, secondImage + 20, 41);
+    CHECK_EQ(openDamaged("gap.rsrc", bytes), ErrorCode::COLLECTION_INVALID);
+}
+
+// Owners are not read at open. One past the images, or naming another image
+// than the one whose features it is among, drops the matches of that
+// feature instead of sending them out of the image.
+RSR_TEST(searchesDropFeaturesOwnedByTheWrongImage) {
+    std::vector<uint8_t> bytes = readFile(writeCollection("owners.rsrc", lshOptions()));
+    const size_t owners = sectionOffset(bytes, kOwnersSection);
+    writeAt<uint32_t>(bytes, owners + 10 * sizeof(uint32_t), 3);
+    writeAt<uint32_t>(bytes, owners + 11 * sizeof(uint32_t), 2);
+    writeAt<uint32_t>(bytes, owners + 124 * sizeof(uint32_t), 0);
+    std::shared_ptr<const Collection> opened;
+    CHECK_EQ(openDamaged("owners-damaged.rsrc", bytes, &opened), ErrorCode::SUCCESS);
+    if (!opened) {
+        return;
+    }
+
+    // Each query is a feature's own descriptor, so that feature is its nearest neighbour.
+    const size_t features[] = {10, 11, 124, 12, 70};
+    std::vector<const Descriptor*> queries;
+    for (size_t feature : features) {
+        queries.push_back(&opened->descriptors()[feature]);
+    }
+    for (const IndexOptions& options : {IndexOptions(), lshOptions()}) {
+        std::vector<NearestNeighbours> neighbours;
+        DescriptorIndex::create(*opened, options)->search(queries, neighbours);
+        for (size_t q = 0; q < 3; ++q) {
+            CHECK_EQ(neighbours[q].image, -1);
+            CHECK_EQ(neighbours[q].reference, -1);
+        }
+        CHECK_EQ(neighbours[3].image, 0);
+        CHECK_EQ(neighbours[3].reference, 12);
+        CHECK_EQ(neighbours[4].image, 2);
+        CHECK_EQ(neighbours[4].reference, 5);
+    }
+}
+
+// Bucket offsets and entries index the collection: damaged ones must not be
+// used, and create() builds the index again instead.
+RSR_TEST(createRebuildsADamagedStoredIndex) {
+    const std::vector<uint8_t> bytes = readFile(writeCollection("lsh.rsrc", lshOptions()));
+    std::shared_ptr<const Collection> intact;
+    CHECK_EQ(openDamaged("lsh-intact.rsrc", bytes, &intact), ErrorCode::SUCCESS);
+    if (!intact) {
+        return;
+    }
+    const std::vector<uint8_t> built = indexOf(*intact);
+    CHECK(!intact->storedIndex().empty());
+    CHECK(std::equal(built.begin(), built.end(), intact->storedIndex().begin(), intact->storedIndex().end()));
+
+    const size_t buckets = size_t(1) << lshOptions().lshKeyBits;
+    const size_t secondTable = lshTableOffset(bytes, 1);
+    const size_t bucketStart = secondTable + lshOptions().lshKeyBits;
+    const size_t entries = bucketStart + (buckets + 1) * sizeof(uint32_t);
+
+    std::vector<uint8_t> pastFeatures = bytes;
+    writeAt<uint32_t>(pastFeatures, entries + 7 * sizeof(uint32_t), 0xFFFFFFFFu);
+    std::vector<uint8_t> backwards = bytes;
+    writeAt<uint32_t>(backwards, bucketStart + 5 * sizeof(uint32_t), 100);
+    writeAt<uint32_t>(backwards, bucketStart + 6 * sizeof(uint32_t), 10);
+    for (const std::vector<uint8_t>* damaged : {&pastFeatures, &backwards}) {
+        std::shared_ptr<const Collection> collection;
+        CHECK_EQ(openDamaged("lsh-damaged.rsrc", *damaged, &collection), ErrorCode::SUCCESS);
+        if (collection) {
+            CHECK(indexOf(*collection) == built);
+        }
+    }
+}
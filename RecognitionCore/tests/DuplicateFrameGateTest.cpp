@@ -0,0 +1,155 @@
+//
+//  DuplicateFrameGateTest.cpp
+//  RecognitionCore
+//
+//  Reuse of the last search for near-duplicate frames, drift, forced
+//  refreshes and failed searches.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "TestUtil.h"
+#include "rsr/Collection.h"
+#include "rsr/DuplicateFrameGate.h"
+
+using namespace rsr;
+
+namespace {
+
+struct GreyFrame {
+    std::vector<uint8_t> pixels;
+    VideoFrame frame;
+
+    explicit GreyFrame(uint8_t level) : pixels(64 * 64 * 4, level) {
+        for (size_t i = 3; i < pixels.size(); i += 4) {
+            pixels[i] = 255;
+        }
+        frame = VideoFrame{pixels.data(), 64, 64, 64 * 4};
+    }
+};
+
+// Blocks of random grey, with corners enough to extract features from.
+struct TexturedFrame {
+    std::vector<uint8_t> pixels;
+    VideoFrame frame;
+
+    TexturedFrame() : pixels(128 * 128 * 4, 255) {
+        uint32_t state = 12345;
+        for (int y = 0; y < 128; ++y) {
+            for (int x = 0; x < 128; ++x) {
+                if (x % 8 == 0 && y % 8 == 0) {
+                    state = state * 1664525u + 1013904223u;
+                }
+                const uint8_t level = static_cast<uint8_t>(((state >> 24) + 37 * ((x / 8) ^ (y / 8))) & 0xff);
+                uint8_t* pixel = &pixels[(y * 128 + x) * 4];
+                pixel[0] = pixel[1] = pixel[2] = level;
+            }
+        }
+        frame = VideoFrame{pixels.data(), 128, 128, 128 * 4};
+    }
+};
+
+std::vector<SearchResult> resultsFor(const char* uuid) {
+    SearchResult result;
+    result.matchedImageUUID = uuid;
+    result.score = 0.5f;
+    return std::vector<SearchResult>(1, result);
+}
+
+}
+
+RSR_TEST(nearDuplicatesReuseTheLastResults) {
+    DuplicateFrameGate gate;
+    const GreyFrame frame(100);
+    const GreyFrame nearly(102);
+    const GreyFrame other(180);
+    // Nothing to reuse yet.
+    CHECK(gate.shouldSearch(frame.frame));
+    gate.recordResults(resultsFor("first"));
+    CHECK(!gate.shouldSearch(frame.frame));
+    CHECK(!gate.shouldSearch(nearly.frame));
+    CHECK_EQ(gate.lastResults().size(), 1u);
+    CHECK_EQ(gate.lastResults()[0].matchedImageUUID, std::string("first"));
+    CHECK(gate.shouldSearch(other.frame));
+    gate.recordResults(resultsFor("second"));
+    CHECK(!gate.shouldSearch(other.frame));
+    CHECK_EQ(gate.lastResults()[0].matchedImageUUID, std::string("second"));
+
+    const FrameGateCounters& counters = gate.counters();
+    CHECK_EQ(counters.frames, 5u);
+    CHECK_EQ(counters.searched, 2u);
+    CHECK_EQ(counters.reused, 3u);
+
+    gate.reset();
+    CHECK(gate.shouldSearch(other.frame));
+    CHECK(gate.lastResults().empty());
+}
+
+// Compared with the frame last searched, so drift in small steps adds up.
+RSR_TEST(slowDriftStillSearchesAgain) {
+    FrameGateOptions options;
+    options.maxReuses = 0;
+    DuplicateFrameGate gate(options);
+    const GreyFrame start(100);
+    CHECK(gate.shouldSearch(start.frame));
+    gate.recordResults(resultsFor("start"));
+    int searches = 0;
+    for (int level = 103; level <= 130; level += 3) {
+        const GreyFrame step(static_cast<uint8_t>(level));
+        if (gate.shouldSearch(step.frame)) {
+            ++searches;
+            gate.recordResults(resultsFor("step"));
+        }
+    }
+    CHECK(searches >= 5);
+    CHECK(searches < 10);
+}
+
+RSR_TEST(maxReusesForcesARefresh) {
+    FrameGateOptions options;
+    options.maxReuses = 3;
+    DuplicateFrameGate gate(options);
+    const GreyFrame frame(100);
+    CHECK(gate.shouldSearch(frame.frame));
+    gate.recordResults(resultsFor("first"));
+    for (int i = 0; i < 3; ++i) {
+        CHECK(!gate.shouldSearch(frame.frame));
+    }
+    CHECK(gate.shouldSearch(frame.frame));
+    gate.recordResults(resultsFor("refreshed"));
+    CHECK(!gate.shouldSearch(frame.frame));
+    CHECK_EQ(gate.lastResults()[0].matchedImageUUID, std::string("refreshed"));
+}
+
+// A failed search leaves the previous results answering their own frame.
+RSR_TEST(failedSearchesAreNotReused) {
+    DuplicateFrameGate gate;
+    OnDeviceIR onDeviceIR;
+    const TexturedFrame frame;
+    std::vector<SearchResult> results;
+    bool reused = true;
+    CHECK_EQ(gate.search(onDeviceIR, frame.frame, results, &reused), ErrorCode::ON_DEVICE_IR_NO_ACTIVE_COLLECTION);
+    CHECK(!reused);
+    CHECK_EQ(gate.search(onDeviceIR, frame.frame, results, &reused), ErrorCode::ON_DEVICE_IR_NO_ACTIVE_COLLECTION);
+    CHECK(!reused);
+
+    auto collection = std::make_shared<Collection>("collection", "Signs");
+    FeatureSet features;
+    features.width = 64;
+    features.height = 64;
+    features.keypoints.resize(16);
+    features.descriptors.resize(16);
+    collection->addImageFeatures(Item{"item", "Item", "", ""}, "image", std::move(features));
+    onDeviceIR.setCollection(collection);
+    CHECK_EQ(gate.search(onDeviceIR, frame.frame, results, &reused), ErrorCode::SUCCESS);
+    CHECK(!reused);
+    CHECK_EQ(gate.search(onDeviceIR, frame.frame, results, &reused), ErrorCode::SUCCESS);
+    CHECK(reused);
+    CHECK_EQ(gate.counters().searched, 3u);
+    CHECK_EQ(gate.counters().reused, 1u);
+}
@@ -0,0 +1,164 @@
+//
+//  RecordedVideoTest.cpp
+//  RecognitionCore
+//
+//  RecordedVideo on small raw BGRA and Y4M files written here, and headers
+//  it must refuse before sizing frames from them.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "TestUtil.h"
+#include "rsr/RecordedVideo.h"
+
+using namespace rsr;
+
+namespace {
+
+std::string writeFile(const std::string& name, const std::string& header, const std::vector<uint8_t>& data) {
+    const std::string path = test::temporaryPath(name);
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(header.data(), static_cast<std::streamsize>(header.size()));
+    out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    return path;
+}
+
+// A Y4M file of the frames, each a FRAME line and its planes.
+std::string writeY4m(const std::string& name, const std::string& header,
+                     const std::vector<std::vector<uint8_t>>& frames) {
+    std::vector<uint8_t> data;
+    for (const std::vector<uint8_t>& planes : frames) {
+        static const std::string kFrame = "FRAME\n";
+        data.insert(data.end(), kFrame.begin(), kFrame.end());
+        data.insert(data.end(), planes.begin(), planes.end());
+    }
+    return writeFile(name, header, data);
+}
+
+ErrorCode openY4m(const std::string& name, const std::string& header) {
+    RecordedVideo video;
+    return video.open(writeY4m(name, header, {}));
+}
+
+}
+
+RSR_TEST(readsRawFramesAndRewinds) {
+    std::vector<uint8_t> data;
+    for (int frame = 0; frame < 3; ++frame) {
+        for (int i = 0; i < 4 * 4 * 2; ++i) {
+            data.push_back(static_cast<uint8_t>(frame * 50 + i));
+        }
+    }
+    RecordingInfo raw;
+    raw.width = 4;
+    raw.height = 2;
+    raw.fps = 0.0;
+    RecordedVideo video;
+    CHECK_EQ(video.open(writeFile("raw.bgra", "", data), raw), ErrorCode::SUCCESS);
+    CHECK(video.info().format == RecordingFormat::RAW_BGRA);
+    CHECK_EQ(video.info().fps, 30.0);
+    for (int pass = 0; pass < 2; ++pass) {
+        FrameBuffer frame;
+        for (int f = 0; f < 3; ++f) {
+            CHECK_EQ(video.next(frame), ErrorCode::SUCCESS);
+            CHECK(frame);
+            if (frame) {
+                CHECK_EQ(frame.frame().width, 4);
+                CHECK_EQ(static_cast<int>(frame.frame().bgraBytes[5]), f * 50 + 5);
+            }
+        }
+        CHECK_EQ(video.next(frame), ErrorCode::SUCCESS);
+        CHECK(!frame);
+        CHECK(video.finished());
+        CHECK_EQ(video.frameIndex(), 3u);
+        CHECK_EQ(video.rewind(), ErrorCode::SUCCESS);
+    }
+}
+
+RSR_TEST(reportsTruncatedRawFrames) {
+    RecordingInfo raw;
+    raw.width = 4;
+    raw.height = 2;
+    RecordedVideo video;
+    CHECK_EQ(video.open(writeFile("partial.bgra", "", std::vector<uint8_t>(32 + 10, 1)), raw), ErrorCode::SUCCESS);
+    FrameBuffer frame;
+    CHECK_EQ(video.next(frame), ErrorCode::SUCCESS);
+    CHECK_EQ(video.next(frame), ErrorCode::SEARCH_ERROR_READING_FILE);
+}
+
+RSR_TEST(rawFilesNeedASize) {
+    RecordedVideo video;
+    const std::string path = writeFile("unsized.bgra", "", std::vector<uint8_t>(64, 0));
+    CHECK_EQ(video.open(path), ErrorCode::SEARCH_ERROR_READING_FILE);
+    CHECK_EQ(video.open(test::temporaryPath("missing.bgra")), ErrorCode::SEARCH_ERROR_READING_FILE);
+}
+
+RSR_TEST(convertsY4mFrames) {
+    // 2x2 4:2:0: four luma samples, one Cb and one Cr; grey has both at 128.
+    RecordedVideo studio;
+    CHECK_EQ(studio.open(writeY4m("studio.y4m", "YUV4MPEG2 W2 H2 F25:1 C420mpeg2\n", {{16, 235, 126, 126, 128, 128}})),
+             ErrorCode::SUCCESS);
+    CHECK(studio.info().format == RecordingFormat::Y4M);
+    CHECK_EQ(studio.info().fps, 25.0);
+    FrameBuffer frame;
+    CHECK_EQ(studio.next(frame), ErrorCode::SUCCESS);
+    CHECK(frame);
+    if (frame) {
+        const uint8_t* p = frame.frame().bgraBytes;
+        CHECK_EQ(static_cast<int>(p[0]), 0);
+        CHECK_EQ(static_cast<int>(p[4 + 2]), 255);
+        CHECK_EQ(static_cast<int>(p[8 + 1]), 128);
+        CHECK_EQ(static_cast<int>(p[12 + 3]), 255);
+    }
+    CHECK_EQ(studio.next(frame), ErrorCode::SUCCESS);
+    CHECK(!frame);
+    CHECK(studio.finished());
+
+    RecordedVideo full;
+    CHECK_EQ(full.open(writeY4m("full.y4m", "YUV4MPEG2 W2 H1 F30000:1001 Cmono XCOLORRANGE=FULL\n", {{7, 200}})),
+             ErrorCode::SUCCESS);
+    CHECK_EQ(full.next(frame), ErrorCode::SUCCESS);
+    if (frame) {
+        CHECK_EQ(static_cast<int>(frame.frame().bgraBytes[0]), 7);
+        CHECK_EQ(static_cast<int>(frame.frame().bgraBytes[4]), 200);
+    }
+}
+
+RSR_TEST(reportsDamagedY4mFrames) {
+    RecordedVideo video;
+    CHECK_EQ(video.open(writeY4m("damaged.y4m", "YUV4MPEG2 W2 H2 C420\n", {{1, 2, 3}})), ErrorCode::SUCCESS);
+    FrameBuffer frame;
+    CHECK_EQ(video.next(frame), ErrorCode::SEARCH_ERROR_READING_FILE);
+
+    RecordedVideo unmarked;
+    CHECK_EQ(unmarked.open(writeFile("unmarked.y4m", "YUV4MPEG2 W2 H1 Cmono\nFRAMX\n", {1, 2})),
+             ErrorCode::SUCCESS);
+    CHECK_EQ(unmarked.next(frame), ErrorCode::SEARCH_ERROR_READING_FILE);
+}
+
+RSR_TEST(rejectsY4mHeadersWithoutAUsableSize) {
+    CHECK_EQ(openY4m("no-size.y4m", "YUV4MPEG2 F30:1\n"), ErrorCode::SEARCH_ERROR_READING_FILE);
+    CHECK_EQ(openY4m("negative.y4m", "YUV4MPEG2 W-4 H4\n"), ErrorCode::SEARCH_ERROR_READING_FILE);
+    CHECK_EQ(openY4m("deep.y4m", "YUV4MPEG2 W4 H4 C420p10\n"), ErrorCode::SEARCH_ERROR_READING_FILE);
+    CHECK_EQ(openY4m("no-newline.y4m", "YUV4MPEG2 W4 H4"), ErrorCode::SEARCH_ERROR_READING_FILE);
+    CHECK_EQ(openY4m("long-line.y4m", "YUV4MPEG2 W4 H4 X" + std::string(5000, 'a') + "\n"),
+             ErrorCode::SEARCH_ERROR_READING_FILE);
+}
+
+// Sizes beyond 16384 a side would overflow frame byte counts; they are refused at open.
+RSR_TEST(rejectsFramesLargerThan16384OnASide) {
+    CHECK_EQ(openY4m("wide.y4m", "YUV4MPEG2 W16385 H2\n"), ErrorCode::SEARCH_ERROR_READING_FILE);
+    CHECK_EQ(openY4m("huge.y4m", "YUV4MPEG2 W65536 H65536\n"), ErrorCode::SEARCH_ERROR_READING_FILE);
+    CHECK_EQ(openY4m("largest.y4m", "YUV4MPEG2 W16384 H16384\n"), ErrorCode::SUCCESS);
+    RecordingInfo raw;
+    raw.width = 100000;
+    raw.height = 100000;
+    RecordedVideo video;
+    CHECK_EQ(video.open(writeFile("huge.bgra", "", std::vector<uint8_t>(64, 0)), raw),
+             ErrorCode::SEARCH_ERROR_READING_FILE);
+}
@@ -0,0 +1,219 @@
+//
+//  SearchAsyncTest.cpp
+//  RecognitionCore
+//
+//  Parallel runs on the scheduler, asynchronous searches on it, finder
+//  searches replaced while queued, and the rate controller slots those
+//  searches hold.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "TestUtil.h"
+#include "rsr/Collection.h"
+#include "rsr/FinderRateController.h"
+#include "rsr/OnDeviceIR.h"
+#include "rsr/SearchScheduler.h"
+
+using namespace rsr;
+
+namespace {
+
+QueryImage greyImage() {
+    const std::vector<uint8_t> pixels(64 * 64 * 4, 128);
+    return QueryImage(pixels.data(), 64, 64, 64 * 4);
+}
+
+std::shared_ptr<const Collection> oneImageCollection() {
+    auto collection = std::make_shared<Collection>("collection", "Signs");
+    FeatureSet features;
+    features.width = 64;
+    features.height = 64;
+    features.keypoints.resize(16);
+    features.descriptors.resize(16);
+    collection->addImageFeatures(Item{"item", "Item", "", ""}, "image", std::move(features));
+    return collection;
+}
+
+}
+
+// Nested runs included, and runs from tasks on the workers.
+RSR_TEST(runExecutesEveryPartOnce) {
+    SchedulerOptions options;
+    options.workerCount = 3;
+    SearchScheduler scheduler(options);
+    for (int round = 0; round < 200; ++round) {
+        const int parts = 1 + round % 6;
+        std::vector<std::atomic<int>> runs(parts * 4);
+        scheduler.run(parts, SearchPriority::API, [&](int part) {
+            scheduler.run(4, SearchPriority::API, [&](int inner) { ++runs[part * 4 + inner]; });
+        });
+        for (const std::atomic<int>& count : runs) {
+            CHECK_EQ(count.load(), 1);
+        }
+    }
+    std::atomic<int> fromWorkers{0};
+    std::vector<std::shared_ptr<SearchTask>> tasks;
+    for (int t = 0; t < 8; ++t) {
+        tasks.push_back(scheduler.submit(SearchPriority::FINDER, [&] {
+            scheduler.run(3, SearchPriority::FINDER, [&](int) { ++fromWorkers; });
+        }));
+    }
+    for (const std::shared_ptr<SearchTask>& task : tasks) {
+        task->wait();
+    }
+    CHECK_EQ(fromWorkers.load(), 24);
+}
+
+// Tasks a caller ran itself stay queued on their scheduler: reused on another
+// one, a worker of the first would pick up parts of the second's runs.
+RSR_TEST(runKeepsPartsOnItsOwnScheduler) {
+    SchedulerOptions options;
+    options.workerCount = 1;
+    SearchScheduler first(options);
+    SearchScheduler second(options);
+    std::promise<void> releaseFirst;
+    std::promise<void> releaseSecond;
+    std::shared_future<void> firstReleased = releaseFirst.get_future().share();
+    std::shared_future<void> secondReleased = releaseSecond.get_future().share();
+    std::promise<std::thread::id> firstWorker;
+    std::shared_ptr<SearchTask> firstBlocker = first.submit(SearchPriority::API, [&] {
+        firstWorker.set_value(std::this_thread::get_id());
+        firstReleased.wait();
+    });
+    std::shared_ptr<SearchTask> secondBlocker =
+        second.submit(SearchPriority::API, [&] { secondReleased.wait(); });
+    const std::thread::id firstWorkerId = firstWorker.get_future().get();
+
+    // With the worker busy, this thread runs every part itself.
+    first.run(4, SearchPriority::API, [](int) {});
+
+    std::atomic<int> started{0};
+    std::vector<std::thread::id> ranOn(4);
+    second.run(4, SearchPriority::API, [&](int part) {
+        ranOn[part] = std::this_thread::get_id();
+        if (part != 0) {
+            ++started;
+            return;
+        }
+        // Give the freed worker of the first scheduler time to take parts, were they in its queue.
+        releaseFirst.set_value();
+        firstBlocker->wait();
+        const auto giveUp = std::chrono::steady_clock::now() + std::chrono::milliseconds(200);
+        while (started.load() < 3 && std::chrono::steady_clock::now() < giveUp) {
+            std::this_thread::yield();
+        }
+    });
+    for (const std::thread::id& id : ranOn) {
+        CHECK(id != firstWorkerId);
+    }
+    releaseSecond.set_value();
+    secondBlocker->wait();
+}
+
+// Queued or running, an asynchronous search counts once.
+RSR_TEST(asyncSearchesCountOnceWhileRunning) {
+    SchedulerOptions schedulerOptions;
+    schedulerOptions.workerCount = 1;
+    OnDeviceIR onDeviceIR(ExtractorOptions(), MatcherOptions(), schedulerOptions);
+    onDeviceIR.setCollection(oneImageCollection());
+    // Called at the end of the search itself, before onDone.
+    std::atomic<int> duringSearch{-1};
+    onDeviceIR.setScratchObserver([&](const ScratchUsage&) { duringSearch = onDeviceIR.getCurrentSearchCount(); });
+    std::atomic<int> inCallback{-1};
+    std::shared_ptr<SearchTask> task = onDeviceIR.searchAsync(
+        greyImage(), SearchPriority::API,
+        [&](ErrorCode, std::vector<SearchResult>) { inCallback = onDeviceIR.getCurrentSearchCount(); });
+    task->wait();
+    CHECK_EQ(duringSearch.load(), 1);
+    CHECK_EQ(inCallback.load(), 1);
+    CHECK_EQ(onDeviceIR.getCurrentSearchCount(), 0);
+
+    std::vector<SearchResult> results;
+    duringSearch = -1;
+    onDeviceIR.searchWithImage(greyImage(), results);
+    CHECK_EQ(duringSearch.load(), 1);
+}
+
+// A finder search that a newer one replaces reports it, so that its slot can be freed.
+RSR_TEST(replacedFinderSearchesReportCancellation) {
+    SchedulerOptions schedulerOptions;
+    schedulerOptions.workerCount = 1;
+    OnDeviceIR onDeviceIR(ExtractorOptions(), MatcherOptions(), schedulerOptions);
+
+    // Keeps the only worker busy until released.
+    std::promise<void> started;
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::shared_ptr<SearchTask> blocker =
+        onDeviceIR.searchAsync(greyImage(), SearchPriority::API, [&](ErrorCode, std::vector<SearchResult>) {
+            started.set_value();
+            released.wait();
+        });
+    started.get_future().wait();
+
+    std::vector<ErrorCode> first;
+    std::vector<ErrorCode> second;
+    std::vector<ErrorCode> third;
+    auto recordInto = [](std::vector<ErrorCode>& errors) {
+        return [&errors](ErrorCode error, std::vector<SearchResult> results) {
+            CHECK(results.empty());
+            errors.push_back(error);
+        };
+    };
+    onDeviceIR.searchAsync(greyImage(), SearchPriority::FINDER, recordInto(first));
+    std::shared_ptr<SearchTask> cancelled =
+        onDeviceIR.searchAsync(greyImage(), SearchPriority::FINDER, recordInto(second));
+    // Reported on this thread before searchAsync returns.
+    CHECK_EQ(first.size(), 1u);
+    if (!first.empty()) {
+        CHECK_EQ(first[0], ErrorCode::SEARCH_CANCELLED);
+    }
+
+    // One the caller cancels itself is not reported when replaced.
+    CHECK(cancelled->cancel());
+    std::shared_ptr<SearchTask> last =
+        onDeviceIR.searchAsync(greyImage(), SearchPriority::FINDER, recordInto(third));
+    CHECK(second.empty());
+
+    release.set_value();
+    blocker->wait();
+    last->wait();
+    CHECK_EQ(first.size(), 1u);
+    CHECK(second.empty());
+    CHECK_EQ(third.size(), 1u);
+    if (!third.empty()) {
+        CHECK_EQ(third[0], ErrorCode::ON_DEVICE_IR_NO_ACTIVE_COLLECTION);
+    }
+    const SearchStatsSnapshot stats = onDeviceIR.statsSnapshot();
+    CHECK_EQ(stats.outcomes.count(ErrorCode::SEARCH_CANCELLED), 1u);
+    if (stats.outcomes.count(ErrorCode::SEARCH_CANCELLED)) {
+        CHECK_EQ(stats.outcomes.at(ErrorCode::SEARCH_CANCELLED), 1u);
+    }
+}
+
+// Searches that never complete must hand back their slot, or finder mode stops for good.
+RSR_TEST(droppedSearchesFreeTheirSlots) {
+    FinderRateController controller(RateControllerOptions::onDevice(30.0, 1));
+    CHECK(controller.shouldSubmit(0.0));
+    CHECK(controller.shouldSubmit(10.0));
+    CHECK(!controller.shouldSubmit(20.0));
+    CHECK_EQ(controller.inFlight(), 2);
+    controller.onSearchDropped(20.0);
+    CHECK_EQ(controller.inFlight(), 1);
+    CHECK_EQ(controller.smoothedLatency(), 0.0);
+    CHECK(controller.shouldSubmit(30.0));
+    controller.onSearchCompleted(31.0, 0.2);
+    controller.onSearchDropped(31.0);
+    CHECK_EQ(controller.inFlight(), 0);
+    controller.onSearchDropped(32.0);
+    CHECK_EQ(controller.inFlight(), 0);
+}
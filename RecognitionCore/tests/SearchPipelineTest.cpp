@@ -0,0 +1,128 @@
+//
+//  SearchPipelineTest.cpp
+//  RecognitionCore
+//
+//  Dropping the oldest waiting frame for a new one, draining, and the
+//  frames the pipeline holds from the pool and counts as searches.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include <cstdint>
+#include <future>
+#include <mutex>
+#include <vector>
+
+#include "TestUtil.h"
+#include "rsr/OnDeviceIR.h"
+#include "rsr/SearchPipeline.h"
+
+using namespace rsr;
+
+namespace {
+
+struct Dispatched {
+    std::mutex mutex;
+    std::vector<uint64_t> sequences;
+    std::vector<ErrorCode> errors;
+
+    PipelineCallback callback() {
+        return [this](uint64_t sequence, ErrorCode error, const std::vector<SearchResult>&) {
+            std::lock_guard<std::mutex> lock(mutex);
+            sequences.push_back(sequence);
+            errors.push_back(error);
+        };
+    }
+};
+
+FrameBuffer greyFrame(FrameBufferPool& pool) {
+    const std::vector<uint8_t> pixels(64 * 64 * 4, 128);
+    return pool.copy(VideoFrame{pixels.data(), 64, 64, 64 * 4});
+}
+
+bool increasing(const std::vector<uint64_t>& sequences) {
+    for (size_t i = 1; i < sequences.size(); ++i) {
+        if (sequences[i] <= sequences[i - 1]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+// Every frame submitted before drain is dispatched, in order, and nothing stays held.
+RSR_TEST(drainWaitsForEveryFrame) {
+    OnDeviceIR onDeviceIR;
+    FramePoolOptions poolOptions;
+    poolOptions.maxOutstanding = 8;
+    FrameBufferPool pool(poolOptions);
+    Dispatched dispatched;
+    SearchPipeline pipeline(onDeviceIR, dispatched.callback());
+    for (int i = 0; i < 20; ++i) {
+        CHECK_EQ(pipeline.submit(greyFrame(pool), true), static_cast<uint64_t>(i + 1));
+    }
+    pipeline.drain();
+    const PipelineCounters counters = pipeline.counters();
+    CHECK_EQ(counters.submitted, 20u);
+    CHECK_EQ(counters.dropped, 0u);
+    CHECK_EQ(counters.completed, 20u);
+    CHECK_EQ(counters.failed, 20u);
+    CHECK_EQ(counters.inFlight, 0);
+    CHECK_EQ(onDeviceIR.getCurrentSearchCount(), 0);
+    CHECK_EQ(pool.counters().outstanding, 0);
+
+    std::lock_guard<std::mutex> lock(dispatched.mutex);
+    CHECK_EQ(dispatched.sequences.size(), 20u);
+    CHECK(increasing(dispatched.sequences));
+    for (ErrorCode error : dispatched.errors) {
+        CHECK_EQ(error, ErrorCode::ON_DEVICE_IR_NO_ACTIVE_COLLECTION);
+    }
+}
+
+// With dispatch held up the pipeline fills, and submit then drops the oldest waiting frame, never the newest.
+RSR_TEST(fullPipelineDropsTheOldestWaitingFrame) {
+    OnDeviceIR onDeviceIR;
+    FramePoolOptions poolOptions;
+    poolOptions.maxOutstanding = 8;
+    FrameBufferPool pool(poolOptions);
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    Dispatched dispatched;
+    const PipelineCallback record = dispatched.callback();
+    bool first = true;
+    // Only ever called on the dispatch thread.
+    auto holdFirst = [&](uint64_t sequence, ErrorCode error, const std::vector<SearchResult>& results) {
+        if (first) {
+            first = false;
+            released.wait();
+        }
+        record(sequence, error, results);
+    };
+    SearchPipeline pipeline(onDeviceIR, holdFirst);
+    const int frames = 40;
+    for (int i = 0; i < frames; ++i) {
+        pipeline.submit(greyFrame(pool));
+    }
+    PipelineCounters counters = pipeline.counters();
+    CHECK(counters.dropped > 0);
+    CHECK(onDeviceIR.getCurrentSearchCount() > 0);
+    release.set_value();
+    pipeline.drain();
+
+    counters = pipeline.counters();
+    CHECK_EQ(counters.submitted, static_cast<uint64_t>(frames));
+    CHECK_EQ(counters.completed + counters.dropped, static_cast<uint64_t>(frames));
+    CHECK_EQ(counters.inFlight, 0);
+    CHECK_EQ(onDeviceIR.getCurrentSearchCount(), 0);
+    CHECK_EQ(pool.counters().outstanding, 0);
+    CHECK_EQ(pool.counters().refused, 0u);
+
+    std::lock_guard<std::mutex> lock(dispatched.mutex);
+    CHECK_EQ(dispatched.sequences.size(), counters.completed);
+    CHECK(increasing(dispatched.sequences));
+    if (dispatched.sequences.size() >= 2) {
+        CHECK_EQ(dispatched.sequences[dispatched.sequences.size() - 2], static_cast<uint64_t>(frames - 1));
+        CHECK_EQ(dispatched.sequences.back(), static_cast<uint64_t>(frames));
+    }
+}
@@ -0,0 +1,143 @@
+//
+//  SearchRequestQueueTest.cpp
+//  RecognitionCore
+//
+//  Coalescing, the depth bound and deadlines of the cloud request queue.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "TestUtil.h"
+#include "rsr/SearchRequestQueue.h"
+
+using namespace rsr;
+
+namespace {
+
+// Uniform frame whose sketch is that grey level everywhere.
+struct GreyFrame {
+    std::vector<uint8_t> pixels;
+    VideoFrame frame;
+
+    explicit GreyFrame(uint8_t level) : pixels(64 * 64 * 4, level) {
+        for (size_t i = 3; i < pixels.size(); i += 4) {
+            pixels[i] = 255;
+        }
+        frame = VideoFrame{pixels.data(), 64, 64, 64 * 4};
+    }
+};
+
+RequestQueueOptions noCoalescing() {
+    RequestQueueOptions options;
+    options.coalesceDistance = 0.0;
+    return options;
+}
+
+}
+
+// A near-duplicate replaces the newest waiting request, keeping its place and id.
+RSR_TEST(nearDuplicatesCoalesceIntoTheNewestRequest) {
+    SearchRequestQueue queue;
+    const GreyFrame dark(60);
+    const GreyFrame darkAgain(62);
+    const GreyFrame light(200);
+    CHECK(queue.push(dark.frame));
+    CHECK(queue.push(darkAgain.frame));
+    CHECK(queue.push(light.frame));
+    RequestQueueCounters counters = queue.counters();
+    CHECK_EQ(counters.enqueued, 3u);
+    CHECK_EQ(counters.coalesced, 1u);
+    CHECK_EQ(counters.depth, 2);
+
+    SearchRequestQueue::Request request;
+    CHECK(queue.pop(request));
+    CHECK_EQ(request.id, 1u);
+    CHECK_EQ(request.frames, 2);
+    CHECK_EQ(static_cast<int>(request.image.bgraBytes()[0]), 62);
+    CHECK(queue.pop(request));
+    CHECK_EQ(request.id, 2u);
+    CHECK_EQ(request.frames, 1);
+    CHECK(!queue.pop(request));
+}
+
+// With nothing waiting, a frame the last sent search already covers is not queued.
+RSR_TEST(framesLikeTheLastSentOneAreDropped) {
+    SearchRequestQueue queue;
+    const GreyFrame dark(60);
+    const GreyFrame light(200);
+    SearchRequestQueue::Request request;
+    CHECK(queue.push(dark.frame));
+    CHECK(queue.pop(request));
+    CHECK(!queue.push(dark.frame));
+    CHECK(!queue.pop(request));
+    CHECK(queue.push(light.frame));
+    CHECK(queue.pop(request));
+    CHECK_EQ(request.id, 2u);
+    const RequestQueueCounters counters = queue.counters();
+    CHECK_EQ(counters.enqueued, 3u);
+    CHECK_EQ(counters.sent, 2u);
+    CHECK_EQ(counters.coalesced, 1u);
+}
+
+RSR_TEST(fullQueueDropsTheOldest) {
+    SearchRequestQueue queue(noCoalescing());
+    const GreyFrame frame(128);
+    for (int i = 0; i < 5; ++i) {
+        CHECK(queue.push(frame.frame));
+    }
+    RequestQueueCounters counters = queue.counters();
+    CHECK_EQ(counters.dropped, 3u);
+    CHECK_EQ(counters.depth, 2);
+    SearchRequestQueue::Request request;
+    CHECK(queue.pop(request));
+    CHECK_EQ(request.id, 4u);
+    CHECK(queue.pop(request));
+    CHECK_EQ(request.id, 5u);
+    counters = queue.counters();
+    CHECK_EQ(counters.sent, 2u);
+    CHECK_EQ(counters.depth, 0);
+}
+
+RSR_TEST(expiredRequestsAreNeverSent) {
+    RequestQueueOptions options = noCoalescing();
+    options.deadlineSeconds = 0.01;
+    SearchRequestQueue queue(options);
+    const GreyFrame frame(128);
+    CHECK(queue.push(frame.frame));
+    CHECK(queue.push(frame.frame));
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    SearchRequestQueue::Request request;
+    CHECK(!queue.pop(request));
+    RequestQueueCounters counters = queue.counters();
+    CHECK_EQ(counters.expired, 2u);
+    CHECK_EQ(counters.sent, 0u);
+
+    // Checked when popped, so one pushed since is still sent.
+    CHECK(queue.push(frame.frame));
+    CHECK(queue.pop(request));
+    CHECK_EQ(request.id, 3u);
+    CHECK(request.deadline > request.enqueuedAt);
+}
+
+RSR_TEST(closeWakesWaitingSenders) {
+    SearchRequestQueue queue(noCoalescing());
+    bool popped = true;
+    std::thread sender([&] {
+        SearchRequestQueue::Request request;
+        popped = queue.pop(request, 10000);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    const auto closed = std::chrono::steady_clock::now();
+    queue.close();
+    sender.join();
+    CHECK(!popped);
+    CHECK(std::chrono::steady_clock::now() - closed < std::chrono::seconds(5));
+    const GreyFrame frame(128);
+    CHECK(!queue.push(frame.frame));
+    CHECK_EQ(queue.counters().enqueued, 0u);
+}
@@ -0,0 +1,168 @@
+//
+//  SignTrackerTest.cpp
+//  RecognitionCore
+//
+//  Following a textured sign as it moves, losing it when it goes, and when
+//  TrackedSearch tracks, refreshes and searches again.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "TestUtil.h"
+#include "rsr/Collection.h"
+#include "rsr/SignTracker.h"
+
+using namespace rsr;
+
+namespace {
+
+constexpr int kSignSize = 96;
+constexpr int kFrameWidth = 320;
+constexpr int kFrameHeight = 240;
+
+// Random grey blocks of varying size, with corners everywhere to follow and match.
+std::vector<uint8_t> signPixels() {
+    std::vector<uint8_t> pixels(kSignSize * kSignSize * 4, 255);
+    uint32_t state = 2016;
+    auto next = [&state] {
+        state = state * 1664525u + 1013904223u;
+        return state >> 8;
+    };
+    for (int block = 0; block < 120; ++block) {
+        const int size = 6 + static_cast<int>(next() % 14);
+        const int x0 = static_cast<int>(next() % (kSignSize - size));
+        const int y0 = static_cast<int>(next() % (kSignSize - size));
+        const uint8_t level = static_cast<uint8_t>(next() % 256);
+        for (int y = y0; y < y0 + size; ++y) {
+            for (int x = x0; x < x0 + size; ++x) {
+                uint8_t* pixel = &pixels[(y * kSignSize + x) * 4];
+                pixel[0] = pixel[1] = pixel[2] = level;
+            }
+        }
+    }
+    return pixels;
+}
+
+// Plain mid grey frame, with the sign at (x, y) if x is not negative.
+struct Frame {
+    std::vector<uint8_t> pixels;
+    VideoFrame view;
+
+    Frame(int x, int y) : pixels(kFrameWidth * kFrameHeight * 4, 128) {
+        for (size_t i = 3; i < pixels.size(); i += 4) {
+            pixels[i] = 255;
+        }
+        if (x >= 0) {
+            static const std::vector<uint8_t> sign = signPixels();
+            for (int row = 0; row < kSignSize; ++row) {
+                std::copy(sign.begin() + row * kSignSize * 4, sign.begin() + (row + 1) * kSignSize * 4,
+                          pixels.begin() + ((y + row) * kFrameWidth + x) * 4);
+            }
+        }
+        view = VideoFrame{pixels.data(), kFrameWidth, kFrameHeight, kFrameWidth * 4};
+    }
+};
+
+BoundingBox boxAt(float x, float y) {
+    BoundingBox box;
+    box.topLeftX = box.bottomLeftX = x;
+    box.topRightX = box.bottomRightX = x + kSignSize;
+    box.topLeftY = box.topRightY = y;
+    box.bottomLeftY = box.bottomRightY = y + kSignSize;
+    return box;
+}
+
+bool near(const BoundingBox& box, float x, float y, float tolerance) {
+    return std::fabs(box.topLeftX - x) <= tolerance && std::fabs(box.topLeftY - y) <= tolerance &&
+           std::fabs(box.bottomRightX - (x + kSignSize)) <= tolerance &&
+           std::fabs(box.bottomRightY - (y + kSignSize)) <= tolerance;
+}
+
+std::shared_ptr<const Collection> signCollection() {
+    auto collection = std::make_shared<Collection>("collection", "Signs");
+    const std::vector<uint8_t> sign = signPixels();
+    Item item;
+    item.uuid = "sign";
+    collection->addImage(item, "sign-image", QueryImage(sign.data(), kSignSize, kSignSize, kSignSize * 4));
+    return collection;
+}
+
+}
+
+RSR_TEST(trackerFollowsAMovingSign) {
+    SignTracker tracker;
+    const Frame first(100, 70);
+    CHECK(tracker.start(first.view, std::vector<BoundingBox>(1, boxAt(100, 70))));
+    CHECK(tracker.isTracking());
+    std::vector<BoundingBox> boxes;
+    for (int step = 1; step <= 8; ++step) {
+        const Frame frame(100 + 3 * step, 70 + 2 * step);
+        CHECK(tracker.track(frame.view, boxes));
+        CHECK_EQ(boxes.size(), 1u);
+        if (!boxes.empty()) {
+            CHECK(near(boxes[0], 100.0f + 3 * step, 70.0f + 2 * step, 2.0f));
+        }
+    }
+}
+
+RSR_TEST(trackerLosesASignThatLeaves) {
+    SignTracker tracker;
+    const Frame first(100, 70);
+    CHECK(tracker.start(first.view, std::vector<BoundingBox>(1, boxAt(100, 70))));
+    const Frame empty(-1, -1);
+    std::vector<BoundingBox> boxes;
+    CHECK(!tracker.track(empty.view, boxes));
+    CHECK(!tracker.isTracking());
+
+    // Nothing to follow in a plain box.
+    CHECK(!tracker.start(empty.view, std::vector<BoundingBox>(1, boxAt(100, 70))));
+    CHECK(!tracker.isTracking());
+}
+
+// Tracks between searches, refreshes every refreshFrames, and searches at once when the sign is lost.
+RSR_TEST(trackedSearchTracksRefreshesAndRecovers) {
+    OnDeviceIR onDeviceIR;
+    onDeviceIR.setCollection(signCollection());
+    TrackingOptions options;
+    options.refreshFrames = 4;
+    TrackedSearch tracked(options);
+    std::vector<SearchResult> results;
+    std::vector<bool> searches;
+    int step = 0;
+    for (; step < 10; ++step) {
+        const Frame frame(100 + 2 * step, 70 + step);
+        bool searched = false;
+        CHECK_EQ(tracked.process(onDeviceIR, frame.view, results, &searched), ErrorCode::SUCCESS);
+        searches.push_back(searched);
+        CHECK_EQ(results.size(), 1u);
+        if (!results.empty()) {
+            CHECK(near(results[0].matchBoundingBox, 100.0f + 2 * step, 70.0f + step, 3.0f));
+        }
+    }
+    // A search, four tracked frames, a refresh, four more.
+    const bool expected[] = {true, false, false, false, false, true, false, false, false, false};
+    for (size_t i = 0; i < searches.size(); ++i) {
+        CHECK_EQ(searches[i], expected[i]);
+    }
+
+    const Frame empty(-1, -1);
+    bool searched = false;
+    CHECK_EQ(tracked.process(onDeviceIR, empty.view, results, &searched), ErrorCode::SEARCH_ERROR_IMAGE_NO_DETAILS);
+    CHECK(searched);
+    const Frame back(100, 70);
+    CHECK_EQ(tracked.process(onDeviceIR, back.view, results, &searched), ErrorCode::SUCCESS);
+    CHECK(searched);
+    CHECK_EQ(results.size(), 1u);
+
+    const TrackedSearchCounters& counters = tracked.counters();
+    CHECK_EQ(counters.frames, 12u);
+    CHECK_EQ(counters.searches, 4u);
+    CHECK_EQ(counters.tracked, 8u);
+    CHECK_EQ(counters.losses, 1u);
+}
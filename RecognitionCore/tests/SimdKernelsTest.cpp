@@ -0,0 +1,133 @@
+//
+//  SimdKernelsTest.cpp
+//  RecognitionCore
+//
+//  The vectorized kernels at every level this CPU supports against their
+//  scalar versions, on sizes that are not a multiple of the vector width
+//  and on descriptors with many tied distances.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "TestUtil.h"
+#include "rsr/DescriptorIndex.h"
+#include "rsr/Preprocess.h"
+
+using namespace rsr;
+
+namespace {
+
+const SimdLevel kVectorLevels[] = {SimdLevel::SSE41, SimdLevel::AVX2, SimdLevel::AVX512, SimdLevel::NEON};
+
+// References a few bits away from the query, so that many distances tie, with exact copies among them.
+std::vector<Descriptor> nearbyDescriptors(const Descriptor& query, size_t count, std::mt19937& random) {
+    std::vector<Descriptor> descriptors(count, query);
+    for (Descriptor& descriptor : descriptors) {
+        const int flips = static_cast<int>(random() % 5);
+        for (int f = 0; f < flips; ++f) {
+            const uint32_t bit = random() % 256;
+            descriptor.bits[bit / 64] ^= uint64_t(1) << (bit % 64);
+        }
+    }
+    return descriptors;
+}
+
+Descriptor randomDescriptor(std::mt19937& random) {
+    Descriptor descriptor;
+    for (uint64_t& word : descriptor.bits) {
+        word = (static_cast<uint64_t>(random()) << 32) | random();
+    }
+    return descriptor;
+}
+
+bool sameNeighbours(const NearestNeighbours& a, const NearestNeighbours& b) {
+    return a.best == b.best && a.second == b.second && a.image == b.image && a.reference == b.reference;
+}
+
+}
+
+RSR_TEST(nearestTwoMatchesScalarAtEveryLevel) {
+    std::mt19937 random(2016);
+    for (size_t count = 0; count <= 67; ++count) {
+        for (int trial = 0; trial < 4; ++trial) {
+            const Descriptor query = randomDescriptor(random);
+            // Half the trials with ties near the query, half far from it.
+            const Descriptor centre = trial % 2 == 0 ? query : randomDescriptor(random);
+            const std::vector<Descriptor> references = nearbyDescriptors(centre, count, random);
+            NearestNeighbours expected;
+            nearestTwo(query, references.data(), count, 3, 100, expected, SimdLevel::SCALAR);
+            for (SimdLevel level : kVectorLevels) {
+                if (!isSimdLevelSupported(level)) {
+                    continue;
+                }
+                NearestNeighbours found;
+                nearestTwo(query, references.data(), count, 3, 100, found, level);
+                if (!sameNeighbours(found, expected)) {
+                    test::fail(__FILE__, __LINE__, std::string(simdLevelName(level)) + " differs for " +
+                                                       std::to_string(count) + " references");
+                }
+            }
+        }
+    }
+}
+
+// Searches are run block by block with the neighbours carried over, as the exact index does.
+RSR_TEST(nearestTwoAccumulatesAcrossCallsLikeScalar) {
+    std::mt19937 random(7);
+    const Descriptor query = randomDescriptor(random);
+    const std::vector<Descriptor> references = nearbyDescriptors(query, 203, random);
+    for (size_t split = 1; split < references.size(); split += 13) {
+        NearestNeighbours expected;
+        nearestTwo(query, references.data(), split, 1, 0, expected, SimdLevel::SCALAR);
+        nearestTwo(query, references.data() + split, references.size() - split, 2, 0, expected, SimdLevel::SCALAR);
+        for (SimdLevel level : kVectorLevels) {
+            if (!isSimdLevelSupported(level)) {
+                continue;
+            }
+            NearestNeighbours found;
+            nearestTwo(query, references.data(), split, 1, 0, found, level);
+            nearestTwo(query, references.data() + split, references.size() - split, 2, 0, found, level);
+            if (!sameNeighbours(found, expected)) {
+                test::fail(__FILE__, __LINE__, std::string(simdLevelName(level)) + " differs split at " +
+                                                   std::to_string(split));
+            }
+        }
+    }
+}
+
+// Odd sizes, padded rows and a start that is not aligned, for every factor.
+RSR_TEST(reduceBGRAToGrayMatchesScalarAtEveryLevel) {
+    std::mt19937 random(11);
+    for (int width = 1; width <= 70; width += 3) {
+        for (int height = 1; height <= 9; height += 2) {
+            const int bytesPerRow = 4 * (width + 1) + 3;
+            std::vector<uint8_t> pixels(static_cast<size_t>(bytesPerRow) * height + 4);
+            for (uint8_t& byte : pixels) {
+                byte = static_cast<uint8_t>(random());
+            }
+            const VideoFrame frame{pixels.data() + 1, width, height, bytesPerRow};
+            for (int factor : {1, 2, 3, 4}) {
+                GrayImage expected;
+                reduceBGRAToGray(frame, factor, expected, SimdLevel::SCALAR);
+                for (SimdLevel level : kVectorLevels) {
+                    if (!isSimdLevelSupported(level)) {
+                        continue;
+                    }
+                    GrayImage gray;
+                    reduceBGRAToGray(frame, factor, gray, level);
+                    if (gray.width != expected.width || gray.height != expected.height ||
+                        gray.pixels != expected.pixels) {
+                        test::fail(__FILE__, __LINE__, std::string(simdLevelName(level)) + " differs for " +
+                                                           std::to_string(width) + "x" + std::to_string(height) +
+                                                           " at factor " + std::to_string(factor));
+                    }
+                }
+            }
+        }
+    }
+}
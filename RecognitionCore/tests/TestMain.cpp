@@ -0,0 +1,75 @@
+//
+//  TestMain.cpp
+//  RecognitionCore
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "TestUtil.h"
+
+namespace rsr {
+namespace test {
+
+namespace {
+
+std::vector<std::pair<const char*, TestFunction>>& registry() {
+    static std::vector<std::pair<const char*, TestFunction>> tests;
+    return tests;
+}
+
+int gFailures = 0;
+std::string gDirectory;
+
+}
+
+Registrar::Registrar(const char* name, TestFunction function) {
+    registry().emplace_back(name, function);
+}
+
+void fail(const char* file, int line, const std::string& message) {
+    std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, message.c_str());
+    ++gFailures;
+}
+
+std::string temporaryPath(const std::string& name) {
+    if (gDirectory.empty()) {
+        const char* base = std::getenv("TMPDIR");
+        std::string pattern = std::string(base && *base ? base : "/tmp") + "/rsr_test_XXXXXX";
+        if (!mkdtemp(&pattern[0])) {
+            std::perror("mkdtemp");
+            std::exit(1);
+        }
+        gDirectory = pattern;
+    }
+    return gDirectory + "/" + name;
+}
+
+}
+}
+
+int main() {
+    using namespace rsr::test;
+    int failedTests = 0;
+    for (const auto& test : registry()) {
+        const int failuresBefore = gFailures;
+        test.second();
+        const bool passed = gFailures == failuresBefore;
+        failedTests += !passed;
+        std::printf("%-48s %s\n", test.first, passed ? "ok" : "FAILED");
+    }
+    if (!gDirectory.empty()) {
+        std::error_code error;
+        std::filesystem::remove_all(gDirectory, error);
+    }
+    std::printf("%d of %zu tests failed\n", failedTests, registry().size());
+    return failedTests == 0 ? 0 : 1;
+}
@@ -0,0 +1,68 @@
+//
+//  TestUtil.h
+//  RecognitionCore
+//
+//  Minimal test registry and checks for the unit tests: every test file
+//  defines its cases with RSR_TEST and links TestMain, which runs them all
+//  and exits non-zero if any check failed.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#pragma once
+
+#include <ostream>
+#include <sstream>
+#include <string>
+
+#include "rsr/ErrorCodes.h"
+
+namespace rsr {
+
+inline std::ostream& operator<<(std::ostream& out, ErrorCode code) {
+    return out << errorCodeName(code);
+}
+
+namespace test {
+
+using TestFunction = void (*)();
+
+struct Registrar {
+    Registrar(const char* name, TestFunction function);
+};
+
+/**
+ * Record a failed check; the test goes on so that one run reports them all.
+ */
+void fail(const char* file, int line, const std::string& message);
+
+/**
+ * Path for a file a test writes, in a directory removed once the tests have run.
+ */
+std::string temporaryPath(const std::string& name);
+
+template <typename A, typename B>
+void checkEqual(const A& actual, const B& expected, const char* expression, const char* file, int line) {
+    if (!(actual == expected)) {
+        std::ostringstream message;
+        message << expression << ": got " << actual << ", expected " << expected;
+        fail(file, line, message.str());
+    }
+}
+
+}
+}
+
+#define RSR_TEST(name)                                                    \
+    static void name();                                                   \
+    static const ::rsr::test::Registrar name##Registrar(#name, &name);   \
+    static void name()
+
+#define CHECK(condition)                                                  \
+    do {                                                                  \
+        if (!(condition)) {                                               \
+            ::rsr::test::fail(__FILE__, __LINE__, #condition);            \
+        }                                                                 \
+    } while (false)
+
+#define CHECK_EQ(actual, expected) ::rsr::test::checkEqual((actual), (expected), #actual, __FILE__, __LINE__)
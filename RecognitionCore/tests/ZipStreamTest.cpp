@@ -0,0 +1,190 @@
+//
+//  ZipStreamTest.cpp
+//  RecognitionCore
+//
+//  ZipStreamReader on archives built here byte by byte: stored, deflated and
+//  streamed entries, and damaged headers it must refuse without allocating
+//  what they claim.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include <zlib.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "TestUtil.h"
+#include "rsr/ZipStream.h"
+
+using namespace rsr;
+
+namespace {
+
+constexpr uint16_t kStored = 0;
+constexpr uint16_t kDeflated = 8;
+constexpr uint16_t kDataDescriptorFlag = 1 << 3;
+
+void put16(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+void put32(std::vector<uint8_t>& out, uint32_t value) {
+    put16(out, value & 0xffff);
+    put16(out, value >> 16);
+}
+
+std::vector<uint8_t> bytesOf(const std::string& text) {
+    return std::vector<uint8_t>(text.begin(), text.end());
+}
+
+std::vector<uint8_t> rawDeflate(const std::vector<uint8_t>& data) {
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+    std::vector<uint8_t> out(deflateBound(&stream, static_cast<uLong>(data.size())));
+    stream.next_in = const_cast<Bytef*>(data.data());
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = out.data();
+    stream.avail_out = static_cast<uInt>(out.size());
+    deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return out;
+}
+
+struct Entry {
+    std::string name;
+    std::vector<uint8_t> contents;
+    uint16_t method = kStored;
+    bool dataDescriptor = false;
+};
+
+// Local headers and data, then the start of a central directory, which is where the reader stops.
+std::vector<uint8_t> makeArchive(const std::vector<Entry>& entries) {
+    std::vector<uint8_t> out;
+    for (const Entry& entry : entries) {
+        const uint32_t crc = crc32(0L, entry.contents.data(), static_cast<uInt>(entry.contents.size()));
+        const std::vector<uint8_t> data = entry.method == kDeflated ? rawDeflate(entry.contents) : entry.contents;
+        put32(out, 0x04034b50);
+        put16(out, 20);
+        put16(out, entry.dataDescriptor ? kDataDescriptorFlag : 0);
+        put16(out, entry.method);
+        put32(out, 0);
+        put32(out, entry.dataDescriptor ? 0 : crc);
+        put32(out, entry.dataDescriptor ? 0 : static_cast<uint32_t>(data.size()));
+        put32(out, entry.dataDescriptor ? 0 : static_cast<uint32_t>(entry.contents.size()));
+        put16(out, static_cast<uint32_t>(entry.name.size()));
+        put16(out, 0);
+        out.insert(out.end(), entry.name.begin(), entry.name.end());
+        out.insert(out.end(), data.begin(), data.end());
+        if (entry.dataDescriptor) {
+            put32(out, 0x08074b50);
+            put32(out, crc);
+            put32(out, static_cast<uint32_t>(data.size()));
+            put32(out, static_cast<uint32_t>(entry.contents.size()));
+        }
+    }
+    put32(out, 0x02014b50);
+    return out;
+}
+
+std::string writeArchive(const std::string& name, const std::vector<uint8_t>& bytes) {
+    const std::string path = test::temporaryPath(name);
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    return path;
+}
+
+// Error of the first entry of the archive.
+ErrorCode readFirst(const std::string& name, const std::vector<uint8_t>& bytes) {
+    ZipStreamReader reader;
+    CHECK_EQ(reader.open(writeArchive(name, bytes)), ErrorCode::SUCCESS);
+    std::string entryName;
+    std::vector<uint8_t> contents;
+    return reader.next(entryName, contents);
+}
+
+}
+
+RSR_TEST(readsStoredDeflatedAndStreamedEntries) {
+    std::vector<uint8_t> large;
+    for (int i = 0; i < 300000; ++i) {
+        large.push_back(static_cast<uint8_t>((i * 7) ^ (i >> 5)));
+    }
+    const std::vector<Entry> entries = {
+        {"collection/", {}, kStored, false},
+        {"collection/manifest.json", bytesOf("{\"items\":[]}"), kStored, false},
+        {"collection/features.bin", large, kDeflated, false},
+        {"collection/streamed.bin", bytesOf(std::string(5000, 'a')), kDeflated, true},
+        {"collection/empty.txt", {}, kStored, false},
+    };
+    ZipStreamReader reader;
+    CHECK_EQ(reader.open(writeArchive("entries.zip", makeArchive(entries))), ErrorCode::SUCCESS);
+    std::string name;
+    std::vector<uint8_t> contents;
+    // The directory entry is skipped.
+    for (size_t i = 1; i < entries.size(); ++i) {
+        CHECK_EQ(reader.next(name, contents), ErrorCode::SUCCESS);
+        CHECK_EQ(name, entries[i].name);
+        CHECK(contents == entries[i].contents);
+    }
+    CHECK_EQ(reader.next(name, contents), ErrorCode::SUCCESS);
+    CHECK(name.empty());
+    CHECK_EQ(reader.progress(), 1.0f);
+}
+
+RSR_TEST(openReportsMissingArchives) {
+    ZipStreamReader reader;
+    CHECK_EQ(reader.open(test::temporaryPath("missing.zip")), ErrorCode::COLLECTION_NOT_FOUND);
+}
+
+RSR_TEST(rejectsCorruptedContents) {
+    std::vector<uint8_t> bytes = makeArchive({{"a.txt", bytesOf("hello, world"), kStored, false}});
+    // Last byte of the contents, just before the central directory signature.
+    bytes[bytes.size() - 5] ^= 1;
+    CHECK_EQ(readFirst("crc.zip", bytes), ErrorCode::COLLECTION_MANAGER_EXTRACT_ERROR);
+}
+
+RSR_TEST(rejectsTruncatedArchives) {
+    std::vector<uint8_t> bytes = makeArchive({{"a.bin", std::vector<uint8_t>(4000, 7), kDeflated, false}});
+    bytes.resize(40);
+    CHECK_EQ(readFirst("truncated.zip", bytes), ErrorCode::COLLECTION_MANAGER_EXTRACT_ERROR);
+    CHECK_EQ(readFirst("signature.zip", bytesOf("not a zip file")), ErrorCode::COLLECTION_MANAGER_EXTRACT_ERROR);
+}
+
+RSR_TEST(rejectsEncryptedAndUnknownMethods) {
+    std::vector<uint8_t> encrypted = makeArchive({{"a.txt", bytesOf("secret"), kStored, false}});
+    encrypted[6] |= 1;
+    CHECK_EQ(readFirst("encrypted.zip", encrypted), ErrorCode::COLLECTION_MANAGER_EXTRACT_ERROR);
+    std::vector<uint8_t> bzip2 = makeArchive({{"a.txt", bytesOf("data"), kStored, false}});
+    bzip2[8] = 12;
+    CHECK_EQ(readFirst("bzip2.zip", bzip2), ErrorCode::COLLECTION_MANAGER_EXTRACT_ERROR);
+}
+
+// Sizes over 1 GB in a header are refused before anything is allocated for them.
+RSR_TEST(rejectsEntriesClaimingHugeSizes) {
+    const std::vector<uint8_t> bytes = makeArchive({{"a.txt", bytesOf("tiny"), kStored, false}});
+    std::vector<uint8_t> storedHuge = bytes;
+    for (size_t offset : {size_t(18), size_t(22)}) {
+        storedHuge[offset] = 0xff;
+        storedHuge[offset + 1] = 0xff;
+        storedHuge[offset + 2] = 0xff;
+        storedHuge[offset + 3] = 0xff;
+    }
+    CHECK_EQ(readFirst("stored-huge.zip", storedHuge), ErrorCode::COLLECTION_MANAGER_EXTRACT_ERROR);
+
+    std::vector<uint8_t> deflatedHuge = makeArchive({{"a.bin", std::vector<uint8_t>(100, 1), kDeflated, false}});
+    deflatedHuge[25] = 0x7f;  // Uncompressed size of about 2 GB.
+    CHECK_EQ(readFirst("deflated-huge.zip", deflatedHuge), ErrorCode::COLLECTION_MANAGER_EXTRACT_ERROR);
+
+    // Within the limit but far beyond the data: fails when the data runs out.
+    std::vector<uint8_t> storedLong = bytes;
+    storedLong[20] = 0x10;  // Compressed and uncompressed size of about 1 MB.
+    storedLong[24] = 0x10;
+    CHECK_EQ(readFirst("stored-long.zip", storedLong), ErrorCode::COLLECTION_MANAGER_EXTRACT_ERROR);
+}
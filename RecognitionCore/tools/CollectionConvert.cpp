@@ -0,0 +1,78 @@
+//
+//  CollectionConvert.cpp
+//  RecognitionCore
+//
+//  Converts a collection bundle, zipped or unpacked, into a collection file
+//  that Collection::open maps without extracting anything:
+//
+//      rsr_collection_convert <bundle.zip | bundle directory> <collection file>
+//          [--index exact|lsh] [--lsh-tables 8] [--lsh-key-bits 16]
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "rsr/Bundle.h"
+#include "rsr/DescriptorIndex.h"
+
+using namespace rsr;
+
+namespace {
+
+const char* option(int argc, char** argv, const char* name, const char* fallback) {
+    for (int i = 3; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], name) == 0) {
+            return argv[i + 1];
+        }
+    }
+    return fallback;
+}
+
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::fprintf(stderr,
+                     "usage: %s <bundle.zip | bundle directory> <collection file> [--index exact|lsh] "
+                     "[--lsh-tables N] [--lsh-key-bits N]\n",
+                     argv[0]);
+        return 2;
+    }
+
+    IndexOptions indexOptions;
+    const std::string index = option(argc, argv, "--index", "exact");
+    if (index == "lsh") {
+        indexOptions.type = IndexType::LSH;
+    } else if (index != "exact") {
+        std::fprintf(stderr, "unknown index type %s\n", index.c_str());
+        return 2;
+    }
+    indexOptions.lshTables = std::atoi(option(argc, argv, "--lsh-tables", "8"));
+    indexOptions.lshKeyBits = std::atoi(option(argc, argv, "--lsh-key-bits", "16"));
+
+    const std::string bundle = argv[1];
+    const auto progress = [](float fraction) { std::fprintf(stderr, "\rextracting features %3.0f%%", fraction * 100.0f); };
+    std::unique_ptr<Collection> collection;
+    ErrorCode error = bundle.size() > 4 && bundle.compare(bundle.size() - 4, 4, ".zip") == 0
+                          ? loadCollectionBundleZip(bundle, collection, progress)
+                          : loadCollectionBundle(bundle, collection, progress);
+    std::fprintf(stderr, "\n");
+    if (error != ErrorCode::SUCCESS) {
+        std::fprintf(stderr, "cannot load bundle %s: %s\n", argv[1], errorCodeName(error));
+        return 1;
+    }
+
+    error = collection->write(argv[2], indexOptions);
+    if (error != ErrorCode::SUCCESS) {
+        std::fprintf(stderr, "cannot write %s: %s\n", argv[2], errorCodeName(error));
+        return 1;
+    }
+    std::printf("%s: %zu items, %zu images, %zu features, %s index\n", argv[2], collection->items().size(),
+                collection->images().size(), collection->descriptors().size(), index.c_str());
+    return 0;
+}
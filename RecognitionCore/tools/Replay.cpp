@@ -0,0 +1,131 @@
+//
+//  Replay.cpp
+//  RecognitionCore
+//
+//  Plays a recorded drive into the on-device search the way the camera
+//  would, and reports frames searched per second, latency from frame to
+//  result and the recognition rate:
+//
+//      rsr_replay <collection file> <recording.y4m | recording.bgra>
+//          [--width W --height H --fps 30]   size and rate of a raw BGRA recording
+//          [--pacing realtime|fixed|fast] [--rate 30] [--pipeline]
+//          [--labels labels.txt] [--max-frames N] [--json]
+//
+//  Labels are lines of "<first frame> <last frame> <item uuid>". With --json
+//  the report is printed as one line of JSON, to be collected per recording.
+//
+//  Copyright © 2016 David Lashkhi. All rights reserved.
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rsr/Collection.h"
+#include "rsr/OnDeviceIR.h"
+#include "rsr/RecordedVideo.h"
+#include "rsr/Replay.h"
+
+using namespace rsr;
+
+namespace {
+
+const char* option(int argc, char** argv, const char* name, const char* fallback) {
+    for (int i = 3; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], name) == 0) {
+            return argv[i + 1];
+        }
+    }
+    return fallback;
+}
+
+bool flag(int argc, char** argv, const char* name) {
+    for (int i = 3; i < argc; ++i) {
+        if (std::strcmp(argv[i], name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::fprintf(stderr,
+                     "usage: %s <collection file> <recording.y4m | recording.bgra> [--width W --height H --fps F] "
+                     "[--pacing realtime|fixed|fast] [--rate F] [--pipeline] [--labels file] [--max-frames N] "
+                     "[--json]\n",
+                     argv[0]);
+        return 2;
+    }
+
+    ReplayOptions options;
+    const std::string pacing = option(argc, argv, "--pacing", "realtime");
+    if (pacing == "fixed") {
+        options.pacing = ReplayPacing::FIXED_RATE;
+    } else if (pacing == "fast") {
+        options.pacing = ReplayPacing::AS_FAST_AS_POSSIBLE;
+    } else if (pacing != "realtime") {
+        std::fprintf(stderr, "unknown pacing %s\n", pacing.c_str());
+        return 2;
+    }
+    options.rate = std::atof(option(argc, argv, "--rate", "30"));
+    options.pipeline = flag(argc, argv, "--pipeline");
+    options.maxFrames = std::strtoull(option(argc, argv, "--max-frames", "0"), nullptr, 10);
+
+    std::shared_ptr<const Collection> collection;
+    ErrorCode error = Collection::open(argv[1], collection);
+    if (error != ErrorCode::SUCCESS) {
+        std::fprintf(stderr, "cannot open collection %s: %s\n", argv[1], errorCodeName(error));
+        return 1;
+    }
+
+    RecordingInfo raw;
+    raw.width = std::atoi(option(argc, argv, "--width", "0"));
+    raw.height = std::atoi(option(argc, argv, "--height", "0"));
+    raw.fps = std::atof(option(argc, argv, "--fps", "30"));
+    RecordedVideo video;
+    error = video.open(argv[2], raw);
+    if (error != ErrorCode::SUCCESS) {
+        std::fprintf(stderr, "cannot open recording %s: %s\n", argv[2], errorCodeName(error));
+        return 1;
+    }
+
+    std::vector<ReplayLabel> labels;
+    const char* labelPath = option(argc, argv, "--labels", nullptr);
+    if (labelPath && loadReplayLabels(labelPath, labels) != ErrorCode::SUCCESS) {
+        std::fprintf(stderr, "cannot read labels %s\n", labelPath);
+        return 1;
+    }
+
+    OnDeviceIR onDeviceIR;
+    onDeviceIR.setCollection(collection);
+    ReplayReport report;
+    error = replayRecording(onDeviceIR, video, options, labels, report);
+    if (error != ErrorCode::SUCCESS) {
+        std::fprintf(stderr, "recording damaged after frame %llu: %s\n",
+                     static_cast<unsigned long long>(video.frameIndex()), errorCodeName(error));
+    }
+
+    if (flag(argc, argv, "--json")) {
+        std::printf("%s\n", report.toJson().c_str());
+    } else {
+        const RecordingInfo& info = video.info();
+        std::printf("%s: %dx%d at %.2f fps, %llu frames\n", argv[2], info.width, info.height, info.fps,
+                    static_cast<unsigned long long>(report.frames));
+        std::printf("delivered %llu, late %llu, refused %llu, searched %llu in %.2f s: %.2f frames/s\n",
+                    static_cast<unsigned long long>(report.delivered), static_cast<unsigned long long>(report.late),
+                    static_cast<unsigned long long>(report.refused), static_cast<unsigned long long>(report.searched),
+                    report.seconds, report.framesPerSecond());
+        std::printf("latency ms: mean %.2f, p50 %.2f, p90 %.2f, p99 %.2f, max %.2f\n", report.latencyMean,
+                    report.latencyP50, report.latencyP90, report.latencyP99, report.latencyMax);
+        std::printf("recognition rate %.1f%% (%llu correct of %llu labeled, %llu wrong)\n",
+                    report.recognitionRate() * 100.0, static_cast<unsigned long long>(report.correct),
+                    static_cast<unsigned long long>(report.labeled), static_cast<unsigned long long>(report.wrong));
+    }
+    return error == ErrorCode::SUCCESS ? 0 : 1;
+}